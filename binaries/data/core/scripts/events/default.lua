@@ -1,5 +1,6 @@
 local starting_event = {
-    chain = 0
+    chain = 0,
+    wake_date = 0
 }
 
 function starting_event:on_tick()
@@ -23,8 +24,9 @@ function starting_event:on_tick()
                 end
             }}
         })
+        return 101
     end
-    if self.chain == 1 and date > 100 then
+    if self.chain == 1 then
         core.push_event(core.get_player(), {
             id = "rocket-event",
             image = "core:rocket-event",
@@ -38,7 +40,10 @@ function starting_event:on_tick()
                 end
             }}
         })
+        return false
     end
+    -- Check again in a day
+    return date + 24
 end
 
 -- Disable the starting event for now because it was for testing
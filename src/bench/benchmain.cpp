@@ -0,0 +1,397 @@
+/* Conquer Space
+ * Copyright (C) 2021-2023 Conquer Space
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#include <hjson.h>
+#include <spdlog/sinks/stdout_color_sinks.h>
+#include <spdlog/spdlog.h>
+
+#include <algorithm>
+#include <charconv>
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <vector>
+
+#ifdef _WIN32
+// clang-format off
+#include <windows.h>
+#include <psapi.h>
+// clang-format on
+#else
+#include <sys/resource.h>
+#endif
+
+#include "common/game.h"
+#include "common/scripting/luafunctions.h"
+#include "common/simulation.h"
+#include "common/systems/loading/hjsonloader.h"
+#include "common/systems/loading/loadcities.h"
+#include "common/systems/loading/loadcountries.h"
+#include "common/systems/loading/loadgoods.h"
+#include "common/systems/loading/loadnames.h"
+#include "common/systems/loading/loadplanets.h"
+#include "common/systems/loading/loadprovinces.h"
+#include "common/systems/loading/loadsatellites.h"
+#include "common/systems/loading/timezoneloader.h"
+#include "common/systems/science/fields.h"
+#include "common/systems/science/technology.h"
+#include "common/systems/sysuniversegenerator.h"
+#include "common/util/paths.h"
+#include "common/util/profiler.h"
+
+namespace {
+namespace fs = std::filesystem;
+
+struct BenchOptions {
+    int ticks = 24 * 365;
+    std::string data_path;
+    std::string output;
+    std::string trace;
+};
+
+void PrintUsage() {
+    std::cout << "Usage: cqsp-bench [--ticks n] [--data path/to/core] [--output file.json] [--trace trace.json]\n"
+              << "Loads the core package without a window, runs the simulation for n ticks and\n"
+              << "prints the timings as json. --trace writes the profiled zones of every tick as a\n"
+              << "Chrome trace, which can be opened in chrome://tracing or https://ui.perfetto.dev.\n";
+}
+
+std::string ReadFile(const fs::path& path) {
+    std::ifstream stream(path, std::ios::binary);
+    std::stringstream buffer;
+    buffer << stream.rdbuf();
+    return buffer.str();
+}
+
+/// <summary>
+/// Reads a hjson file, or all of the hjson files in a directory, the same way that the asset manager does.
+/// Directories are assumed to be lists, so they are appended into a single list.
+/// </summary>
+Hjson::Value ReadHjson(const fs::path& path) {
+    Hjson::DecoderOptions dec_opt;
+    dec_opt.comments = false;
+    if (!fs::is_directory(path)) {
+        return Hjson::Unmarshal(ReadFile(path), dec_opt);
+    }
+
+    // Sort the files so that entities are created in the same order on every machine
+    std::vector<fs::path> files;
+    for (const auto& entry : fs::recursive_directory_iterator(path)) {
+        if (entry.is_regular_file() && entry.path().extension() == ".hjson") {
+            files.push_back(entry.path());
+        }
+    }
+    std::sort(files.begin(), files.end());
+
+    Hjson::Value list(Hjson::Type::Vector);
+    for (const auto& file : files) {
+        try {
+            Hjson::Value result = Hjson::Unmarshal(ReadFile(file), dec_opt);
+            if (result.type() != Hjson::Type::Vector) {
+                SPDLOG_ERROR("Failed to load hjson file {}: it needs to be a array", file.string());
+                continue;
+            }
+            for (int k = 0; k < result.size(); k++) {
+                list.push_back(result[k]);
+            }
+        } catch (Hjson::syntax_error& ex) {
+            SPDLOG_ERROR("Failed to load hjson file {}: {}", file.string(), ex.what());
+        }
+    }
+    return list;
+}
+
+template <class T>
+void LoadResource(cqsp::common::Universe& universe, const fs::path& path) {
+    using cqsp::common::systems::loading::HjsonLoader;
+    static_assert(std::is_base_of<HjsonLoader, T>::value, "Class is not child of");
+    T loader(universe);
+    int count = loader.LoadHjson(ReadHjson(path));
+    SPDLOG_INFO("Loaded {} assets from {}", count, path.string());
+}
+
+void LoadResource(cqsp::common::Universe& universe, const fs::path& path,
+                  void (*func)(cqsp::common::Universe& universe, Hjson::Value& value)) {
+    Hjson::Value value = ReadHjson(path);
+    func(universe, value);
+}
+
+/// <summary>
+/// Loads the core package into the universe, in the same order as the client's LoadAllResources.
+/// </summary>
+void LoadCore(cqsp::common::Game& game, const fs::path& core) {
+    using namespace cqsp::common::systems::loading;  // NOLINT
+    namespace science = cqsp::common::systems::science;
+    cqsp::common::Universe& universe = game.GetUniverse();
+    const fs::path data = core / "data";
+
+    LoadResource<GoodLoader>(universe, data / "goods");
+    LoadResource<RecipeLoader>(universe, data / "recipes");
+    LoadResource<PlanetLoader>(universe, data / "planets");
+    LoadResource<TimezoneLoader>(universe, data / "timezones.hjson");
+    LoadResource<CountryLoader>(universe, data / "countries");
+    LoadProvinces(universe, ReadFile(core / "map" / "definitions.csv"));
+    LoadResource<CityLoader>(universe, data / "cities");
+    LoadResource<SatelliteLoader>(universe, data / "planet_data" / "earth" / "satellites");
+
+    LoadResource(universe, data / "names", LoadNameLists);
+    LoadResource(universe, data / "science" / "fields", science::LoadFields);
+    LoadResource(universe, data / "science" / "technology", science::LoadTechnologies);
+    LoadResource(universe, data / "planetterrain.hjson", LoadTerrainData);
+
+    cqsp::scripting::LoadFunctions(universe, game.GetScriptInterface());
+    game.GetScriptInterface().RegisterDataGroup("generators");
+    game.GetScriptInterface().RegisterDataGroup("events");
+
+    cqsp::common::systems::universegenerator::ScriptUniverseGenerator generator(game.GetScriptInterface());
+    generator.Generate(universe);
+}
+
+/// <returns>The peak resident set size of the process in bytes</returns>
+uint64_t GetPeakRss() {
+#ifdef _WIN32
+    PROCESS_MEMORY_COUNTERS counters;
+    if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) {
+        return counters.PeakWorkingSetSize;
+    }
+    return 0;
+#else
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0) {
+        return 0;
+    }
+#ifdef __APPLE__
+    // macOS reports bytes
+    return usage.ru_maxrss;
+#else
+    // Linux reports kilobytes
+    return static_cast<uint64_t>(usage.ru_maxrss) * 1024;
+#endif
+#endif
+}
+
+/// <summary>
+/// Time of walking the same components with a view and with the universe's group, see Universe::IndustryGroup
+/// </summary>
+struct IterationTiming {
+    std::string name;
+    size_t entities = 0;
+    double view_ns = 0;
+    double group_ns = 0;
+};
+
+/// <returns>Mean nanoseconds per pass of func over passes runs</returns>
+template <class Function>
+double TimePasses(int passes, Function func) {
+    // The sum keeps the compiler from removing the loops
+    volatile double sink = 0;
+    auto start = std::chrono::high_resolution_clock::now();
+    for (int i = 0; i < passes; i++) {
+        sink = sink + func();
+    }
+    auto end = std::chrono::high_resolution_clock::now();
+    return std::chrono::duration<double, std::nano>(end - start).count() / passes;
+}
+
+/// <summary>
+/// Compares walking the hot component tuples of the economy with views against walking the owning groups
+/// </summary>
+std::vector<IterationTiming> BenchIteration(cqsp::common::Universe& universe) {
+    namespace cqspc = cqsp::common::components;
+    const int passes = 1000;
+    std::vector<IterationTiming> timings;
+
+    IterationTiming& industry = timings.emplace_back();
+    industry.name = "industry";
+    industry.entities = universe.IndustryGroup().size();
+    industry.view_ns = TimePasses(passes, [&]() {
+        double sum = 0;
+        auto view = universe.view<cqspc::IndustrySize, cqspc::CostBreakdown, cqspc::Production>();
+        for (auto [entity, size, costs, production] : view.each()) {
+            sum += size.utilization + costs.profit;
+        }
+        return sum;
+    });
+    industry.group_ns = TimePasses(passes, [&]() {
+        double sum = 0;
+        for (auto [entity, size, costs, production] : universe.IndustryGroup().each()) {
+            sum += size.utilization + costs.profit;
+        }
+        return sum;
+    });
+
+    IterationTiming& population = timings.emplace_back();
+    population.name = "population";
+    population.entities = universe.PopulationGroup().size();
+    population.view_ns = TimePasses(passes, [&]() {
+        double sum = 0;
+        auto view = universe.view<cqspc::PopulationSegment, cqspc::LaborInformation>();
+        for (auto [entity, segment, labor] : view.each()) {
+            sum += static_cast<double>(segment.population) + labor.working_population;
+        }
+        return sum;
+    });
+    population.group_ns = TimePasses(passes, [&]() {
+        double sum = 0;
+        for (auto [entity, segment, labor] : universe.PopulationGroup().each()) {
+            sum += static_cast<double>(segment.population) + labor.working_population;
+        }
+        return sum;
+    });
+    return timings;
+}
+
+bool ParseOptions(int argc, char* argv[], BenchOptions& options) {
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "-h" || arg == "--help") {
+            return false;
+        }
+        if (i + 1 >= argc) {
+            std::cerr << "Missing value for " << arg << "\n";
+            return false;
+        }
+        if (arg == "--ticks" || arg == "-t") {
+            const std::string_view value = argv[++i];
+            int ticks = 0;
+            auto [end, error] = std::from_chars(value.data(), value.data() + value.size(), ticks);
+            if (error != std::errc() || end != value.data() + value.size() || ticks <= 0) {
+                std::cerr << "Invalid tick count " << value << ", it has to be a positive number\n";
+                return false;
+            }
+            options.ticks = ticks;
+        } else if (arg == "--data" || arg == "-d") {
+            options.data_path = argv[++i];
+        } else if (arg == "--output" || arg == "-o") {
+            options.output = argv[++i];
+        } else if (arg == "--trace") {
+            options.trace = argv[++i];
+        } else {
+            std::cerr << "Unknown option " << arg << "\n";
+            return false;
+        }
+    }
+    return true;
+}
+}  // namespace
+
+int main(int argc, char* argv[]) {
+    BenchOptions options;
+    if (!ParseOptions(argc, argv, options)) {
+        PrintUsage();
+        return 1;
+    }
+    cqsp::common::util::ExePath::exe_path = argv[0];
+    if (options.data_path.empty()) {
+        options.data_path = (fs::path(cqsp::common::util::GetCqspDataPath()) / "core").string();
+    }
+
+    // Keep stdout clean for the json, logs go to stderr
+    spdlog::set_default_logger(spdlog::stderr_color_mt("cqsp-bench"));
+    spdlog::set_level(spdlog::level::warn);
+
+    auto load_start = std::chrono::high_resolution_clock::now();
+    cqsp::common::Game game;
+    LoadCore(game, options.data_path);
+    cqsp::common::systems::simulation::Simulation simulation(game);
+    auto load_end = std::chrono::high_resolution_clock::now();
+
+    const auto& names = simulation.GetSystemNames();
+    std::vector<double> total(names.size(), 0);
+    std::vector<double> worst(names.size(), 0);
+    std::vector<int> runs(names.size(), 0);
+
+    auto& profiler = cqsp::common::util::Profiler::Get();
+    if (!options.trace.empty()) {
+        profiler.SetTracing(true);
+    }
+    auto sim_start = std::chrono::high_resolution_clock::now();
+    for (int tick = 0; tick < options.ticks; tick++) {
+        simulation.tick();
+        const auto& times = simulation.GetLastSystemTimes();
+        for (size_t i = 0; i < times.size(); i++) {
+            if (times[i] <= 0) {
+                continue;
+            }
+            total[i] += times[i];
+            worst[i] = std::max(worst[i], times[i]);
+            runs[i]++;
+        }
+    }
+    auto sim_end = std::chrono::high_resolution_clock::now();
+    if (!options.trace.empty()) {
+        profiler.WriteChromeTrace(options.trace);
+        profiler.SetTracing(false);
+    }
+
+    const double load_seconds = std::chrono::duration<double>(load_end - load_start).count();
+    const double sim_seconds = std::chrono::duration<double>(sim_end - sim_start).count();
+
+    std::string json = "{\n";
+    json += fmt::format("    \"ticks\": {},\n", options.ticks);
+    json += fmt::format("    \"load_seconds\": {},\n", load_seconds);
+    json += fmt::format("    \"simulation_seconds\": {},\n", sim_seconds);
+    json += fmt::format("    \"ticks_per_second\": {},\n", sim_seconds > 0 ? options.ticks / sim_seconds : 0);
+    json += fmt::format("    \"peak_rss_bytes\": {},\n", GetPeakRss());
+    json += "    \"systems\": [\n";
+    for (size_t i = 0; i < names.size(); i++) {
+        // Entities and allocations are from the telemetry, which only keeps the last ticks
+        const auto telemetry = simulation.SummarizeSystem(i);
+        json += fmt::format(
+            "        {{\"name\": \"{}\", \"runs\": {}, \"total_us\": {}, \"mean_us\": {}, \"max_us\": {}, "
+            "\"mean_entities\": {}, \"mean_allocations\": {}, \"max_allocations\": {}}}{}\n",
+            names[i], runs[i], total[i], runs[i] > 0 ? total[i] / runs[i] : 0, worst[i], telemetry.mean_entities,
+            telemetry.mean_allocations, telemetry.worst_allocations, i + 1 < names.size() ? "," : "");
+    }
+    json += "    ],\n";
+    // After the simulation, so that the components are laid out the way the systems leave them
+    const auto iteration = BenchIteration(game.GetUniverse());
+    json += "    \"iteration\": [\n";
+    for (size_t i = 0; i < iteration.size(); i++) {
+        const auto& timing = iteration[i];
+        json += fmt::format(
+            "        {{\"name\": \"{}\", \"entities\": {}, \"view_ns\": {}, \"group_ns\": {}, \"speedup\": {}}}{}\n",
+            timing.name, timing.entities, timing.view_ns, timing.group_ns,
+            timing.group_ns > 0 ? timing.view_ns / timing.group_ns : 0, i + 1 < iteration.size() ? "," : "");
+    }
+    json += "    ],\n";
+    // Percentiles are over the last runs of each zone
+    const auto zones = profiler.GetStats();
+    json += "    \"zones\": [\n";
+    for (size_t i = 0; i < zones.size(); i++) {
+        const auto& zone = zones[i];
+        json += fmt::format(
+            "        {{\"name\": \"{}\", \"runs\": {}, \"p50_us\": {}, \"p95_us\": {}, \"p99_us\": {}, "
+            "\"max_us\": {}}}{}\n",
+            zone.name, zone.count, zone.p50_us, zone.p95_us, zone.p99_us, zone.max_us,
+            i + 1 < zones.size() ? "," : "");
+    }
+    json += "    ]\n}\n";
+
+    if (options.output.empty()) {
+        std::cout << json;
+    } else {
+        std::ofstream(options.output) << json;
+    }
+    return 0;
+}
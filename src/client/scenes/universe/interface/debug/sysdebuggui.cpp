@@ -16,11 +16,16 @@
  */
 #include "sysdebuggui.h"
 
+#include <filesystem>
+
 #include "GLFW/glfw3.h"
 #include "client/components/clientctx.h"
+#include "client/scenes/universe/universescene.h"
 #include "client/scenes/universe/views/starsystemview.h"
 #include "common/components/name.h"
+#include "common/util/allocationcounter.h"
 #include "common/util/nameutil.h"
+#include "common/util/paths.h"
 #include "common/util/profiler.h"
 #include "glad/glad.h"
 
@@ -70,12 +75,48 @@ SysDebugMenu::SysDebugMenu(Application& app) : SysUserInterface(app) {
 
     auto lua = [](sysdebuggui_parameters) { script_interface.RunScript(args); };
 
+    auto fast_forward = [](sysdebuggui_parameters) {
+        using cqsp::common::components::StarDate;
+        auto& simulation_thread = cqsp::scene::GetSimulationThread();
+        if (args == "cancel") {
+            simulation_thread.CancelFastForward();
+            input.push_back("Cancelled fast forward");
+            return;
+        }
+        if (args.empty() || args == "status") {
+            auto progress = simulation_thread.GetFastForwardProgress();
+            input.push_back(fmt::format("Fast forward {}: {} to {}, at {} ({:.0f}%), {:.0f} ticks/s",
+                                        progress.running ? "running" : "stopped", progress.start_date,
+                                        progress.target_date, progress.date, progress.Fraction() * 100,
+                                        progress.ticks_per_second));
+            return;
+        }
+        // The amount is in ticks, or in days or years with a d or y suffix
+        int multiplier = 1;
+        std::string_view amount = args;
+        if (amount.back() == 'd') {
+            multiplier = StarDate::TICKS_PER_DAY;
+            amount.remove_suffix(1);
+        } else if (amount.back() == 'y') {
+            multiplier = StarDate::TICKS_PER_YEAR;
+            amount.remove_suffix(1);
+        }
+        if (amount.empty() || !std::all_of(amount.begin(), amount.end(), ::isdigit)) {
+            input.push_back("Usage: fastforward <ticks>[d|y] | status | cancel");
+            return;
+        }
+        const int ticks = std::stoi(std::string(amount)) * multiplier;
+        simulation_thread.FastForward(universe.date.GetDate() + ticks);
+        input.push_back(fmt::format("Fast forwarding {} ticks", ticks));
+    };
+
     commands = {{"help", {"Shows this help menu", help_command}},
                 {"mouseon", {"Get the entitiy the mouse is over", entity_command}},
                 {"clear", {"Clears screen", screen_clear}},
                 {"entitycount", {"Gets number of entities", entitycount}},
                 {"name", {"Gets name and identifier of entity", entity_name}},
-                {"lua", {"Executes lua script", lua}}};
+                {"lua", {"Executes lua script", lua}},
+                {"fastforward", {"Runs ticks as fast as possible, like 1000, 30d or 5y", fast_forward}}};
 }
 
 void SysDebugMenu::Init() {}
@@ -102,7 +143,81 @@ void SysDebugMenu::CqspMetricsWindow() {
         }
         ImPlot::EndPlot();
     }
-    profiler_information_map.clear();
+    if (ImGui::BeginTable("profiler_table", 6, ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg)) {
+        ImGui::TableSetupColumn("Zone");
+        ImGui::TableSetupColumn("Runs");
+        ImGui::TableSetupColumn("p50 (us)");
+        ImGui::TableSetupColumn("p95 (us)");
+        ImGui::TableSetupColumn("p99 (us)");
+        ImGui::TableSetupColumn("Max (us)");
+        ImGui::TableHeadersRow();
+        for (const auto& zone : profiler_stats) {
+            ImGui::TableNextRow();
+            ImGui::TableSetColumnIndex(0);
+            ImGui::TextFmt("{}", zone.name);
+            ImGui::TableSetColumnIndex(1);
+            ImGui::TextFmt("{}", zone.count);
+            ImGui::TableSetColumnIndex(2);
+            ImGui::TextFmt("{:.1f}", zone.p50_us);
+            ImGui::TableSetColumnIndex(3);
+            ImGui::TextFmt("{:.1f}", zone.p95_us);
+            ImGui::TableSetColumnIndex(4);
+            ImGui::TextFmt("{:.1f}", zone.p99_us);
+            ImGui::TableSetColumnIndex(5);
+            ImGui::TextFmt("{:.1f}", zone.max_us);
+        }
+        ImGui::EndTable();
+    }
+
+    ImGui::Separator();
+    auto& simulation = cqsp::scene::GetSimulationThread().GetSimulation();
+    ImGui::SliderInt("Ticks", &telemetry_ticks, 1, static_cast<int>(common::Simulation::telemetry_history));
+    ImGui::SameLine();
+    if (ImGui::Button("Dump csv")) {
+        std::string path = (std::filesystem::path(common::util::GetCqspAppDataPath()) / "telemetry.csv").string();
+        telemetry_message = simulation.WriteTelemetryCsv(path) ? fmt::format("Wrote {}", path)
+                                                               : fmt::format("Failed to write {}", path);
+    }
+    if (!telemetry_message.empty()) {
+        ImGui::TextFmt("{}", telemetry_message);
+    }
+    if (ImGui::BeginTable("system_table", 7, ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg)) {
+        ImGui::TableSetupColumn("System");
+        ImGui::TableSetupColumn("Runs");
+        ImGui::TableSetupColumn("Last (us)");
+        ImGui::TableSetupColumn("Mean (us)");
+        ImGui::TableSetupColumn("Worst (us)");
+        ImGui::TableSetupColumn("Entities");
+        ImGui::TableSetupColumn(cqsp::common::util::kCountAllocations ? "Allocations" : "Allocations (not counted)");
+        ImGui::TableHeadersRow();
+        const auto& names = simulation.GetSystemNames();
+        for (size_t i = 0; i < names.size(); i++) {
+            auto summary = simulation.SummarizeSystem(i, telemetry_ticks);
+            ImGui::TableNextRow();
+            ImGui::TableSetColumnIndex(0);
+            ImGui::TextFmt("{}", names[i]);
+            ImGui::TableSetColumnIndex(1);
+            ImGui::TextFmt("{}", summary.runs);
+            ImGui::TableSetColumnIndex(2);
+            ImGui::TextFmt("{:.1f}", summary.last.duration_us);
+            ImGui::TableSetColumnIndex(3);
+            ImGui::TextFmt("{:.1f}", summary.mean_us);
+            ImGui::TableSetColumnIndex(4);
+            ImGui::TextFmt("{:.1f}", summary.worst_us);
+            ImGui::TableSetColumnIndex(5);
+            ImGui::TextFmt("{:.0f} / {}", summary.mean_entities, summary.worst_entities);
+            ImGui::TableSetColumnIndex(6);
+            if (cqsp::common::util::kCountAllocations) {
+                ImGui::TextFmt("{:.0f} / {}", summary.mean_allocations, summary.worst_allocations);
+            } else {
+                ImGui::TextUnformatted("n/a");
+                if (ImGui::IsItemHovered()) {
+                    ImGui::SetTooltip("Build with CQSP_COUNT_ALLOCATIONS to count the allocations of each system");
+                }
+            }
+        }
+        ImGui::EndTable();
+    }
     ImGui::End();
 }
 
@@ -282,12 +397,18 @@ void SysDebugMenu::DoUpdate(int delta_time) {
     }
     fps_history.emplace_back(time, fps);
 
-    for (auto it = profiler_information_map.begin(); it != profiler_information_map.end(); it++) {
-        if (!history_maps[it->first].empty() && (history_maps[it->first].begin()->x + fps_history_len) < time) {
-            history_maps[it->first].erase(history_maps[it->first].begin());
+    profiler_stats = common::util::Profiler::Get().GetStats();
+    for (const auto& zone : profiler_stats) {
+        auto& history = history_maps[zone.name];
+        if (!history.empty() && (history.begin()->x + fps_history_len) < time) {
+            history.erase(history.begin());
         }
-
-        history_maps[it->first].emplace_back(time, it->second);
+        uint64_t& count = profiler_counts[zone.name];
+        if (count == zone.count) {
+            continue;
+        }
+        count = zone.count;
+        history.emplace_back(time, zone.last_us);
     }
 
     // Add lua logging information
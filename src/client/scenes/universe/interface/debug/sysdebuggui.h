@@ -24,6 +24,7 @@
 #include <vector>
 
 #include "client/systems/sysgui.h"
+#include "common/util/profiler.h"
 
 #define sysdebuggui_parameters                                                                                \
     cqsp::engine::Application &app, common::Universe &universe, scripting::ScriptInterface &script_interface, \
@@ -68,6 +69,12 @@ class SysDebugMenu : public SysUserInterface {
     float fps_history_len = 10;
 
     std::map<std::string, std::vector<ImVec2>> history_maps;
+    std::vector<common::util::ProfileZoneStats> profiler_stats;
+    // Runs of each zone when the history was last updated, to only add a point when the zone ran again
+    std::map<std::string, uint64_t> profiler_counts;
+    // Number of ticks that the system telemetry is summarized over
+    int telemetry_ticks = 100;
+    std::string telemetry_message;
 };
 }  // namespace systems
 }  // namespace client
@@ -68,7 +68,7 @@ void MarketInformationTable(common::Universe& universe, const entt::entity& mark
         }
         ImGui::TableSetColumnIndex(1);
         // Mark the cell as red if the thing is not valid
-        ImGui::TextFmt("{}", market.price[good_entity]);
+        ImGui::TextFmt("{}", market.SettledPrice(good_entity));
         ImGui::TableSetColumnIndex(2);
         ImGui::TextFmt("{}", cqsp::util::LongToHumanString(market.previous_supply[good_entity]));
         ImGui::TableSetColumnIndex(3);
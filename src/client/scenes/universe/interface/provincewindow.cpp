@@ -23,6 +23,7 @@
 #include "client/scenes/universe/interface/marketwindow.h"
 #include "client/scenes/universe/interface/sysstockpileui.h"
 #include "client/scenes/universe/interface/systooltips.h"
+#include "client/scenes/universe/universescene.h"
 #include "client/scenes/universe/views/starsystemview.h"
 #include "common/components/economy.h"
 #include "common/components/infrastructure.h"
@@ -78,15 +79,14 @@ void SysProvinceInformation::ProvinceView() {
     ImGui::TextFmt("{}", common::util::GetName(GetUniverse(), current_country));
     // List the cities
     auto& city_list = GetUniverse().get<common::components::Province>(current_country);
-    int population = 0;
-    for (entt::entity entity : city_list.cities) {
-        using cqsp::common::components::PopulationSegment;
-        using cqsp::common::components::Settlement;
-        // Get city population
-        auto& settlement = GetUniverse().get<Settlement>(entity);
-        for (auto& seg_entity : settlement.population) {
-            auto& segment = GetUniverse().get<PopulationSegment>(seg_entity);
-            population += segment.population;
+    uint64_t population = 0;
+    {
+        // Get city population from the last tick
+        auto snapshot = scene::ReadSnapshot();
+        for (entt::entity entity : city_list.cities) {
+            if (const auto* city = snapshot->GetCity(entity); city != nullptr) {
+                population += city->population;
+            }
         }
     }
     ImGui::TextFmt("Part of {}", common::util::GetName(GetUniverse(), city_list.country));
@@ -16,6 +16,10 @@
  */
 #include "client/scenes/universe/interface/spaceshipwindow.h"
 
+#include <utility>
+#include <vector>
+
+#include "client/scenes/universe/universescene.h"
 #include "client/scenes/universe/views/starsystemview.h"
 #include "common/components/coordinates.h"
 #include "common/components/movement.h"
@@ -24,8 +28,20 @@
 #include "common/systems/maneuver/hohmann.h"
 #include "common/systems/maneuver/maneuver.h"
 #include "common/systems/maneuver/rendezvous.h"
+#include "common/systems/movement/sysmovement.h"
 #include "common/util/nameutil.h"
 
+namespace {
+/// <summary>
+/// Adds the maneuvers to the ship's command queue on the simulation thread
+/// </summary>
+void QueueManeuvers(entt::entity ship, std::vector<cqsp::common::components::Maneuver> maneuvers) {
+    cqsp::scene::QueueCommand([ship, maneuvers = std::move(maneuvers)](cqsp::common::Universe& universe) {
+        cqsp::common::systems::QueueManeuvers(universe, ship, maneuvers);
+    });
+}
+}  // namespace
+
 void cqsp::client::systems::SpaceshipWindow::Init() {}
 
 void cqsp::client::systems::SpaceshipWindow::DoUI(int delta_time) {
@@ -88,7 +104,9 @@ void cqsp::client::systems::SpaceshipWindow::DoUI(int delta_time) {
         ImGui::SliderAngle("trueanomaly", &true_anomaly, (0));
         if (ImGui::Button("Fix True anomaly")) {
             // Emplace
-            GetUniverse().emplace_or_replace<common::components::types::SetTrueAnomaly>(body, true_anomaly);
+            scene::QueueCommand([body, anomaly = true_anomaly](common::Universe& universe) {
+                universe.emplace_or_replace<common::components::types::SetTrueAnomaly>(body, anomaly);
+            });
         }
         if (GetUniverse().any_of<common::components::types::SetTrueAnomaly>(body)) {
             // Now set the true anomaly consistently or something
@@ -97,7 +115,7 @@ void cqsp::client::systems::SpaceshipWindow::DoUI(int delta_time) {
             // Add random delta v
             common::components::Maneuver maneuver(common::systems::CircularizeAtApoapsis(orbit));
             maneuver.time += GetUniverse().date.ToSecond();
-            GetUniverse().get_or_emplace<common::components::CommandQueue>(body).commands.push_back(maneuver);
+            QueueManeuvers(body, {maneuver});
         }
         if (ImGui::IsItemHovered()) {
             double circular_velocity =
@@ -113,7 +131,7 @@ void cqsp::client::systems::SpaceshipWindow::DoUI(int delta_time) {
         if (ImGui::Button("Circularize at perapsis")) {
             common::components::Maneuver maneuver(common::systems::CircularizeAtPeriapsis(orbit));
             maneuver.time += GetUniverse().date.ToSecond();
-            GetUniverse().get_or_emplace<common::components::CommandQueue>(body).commands.push_back(maneuver);
+            QueueManeuvers(body, {maneuver});
         }
 
         if (ImGui::IsItemHovered()) {
@@ -136,7 +154,7 @@ void cqsp::client::systems::SpaceshipWindow::DoUI(int delta_time) {
             auto m = common::systems::SetApoapsis(orbit, new_perigee);
             maneuver.delta_v = m.first;
             maneuver.time = GetUniverse().date.ToSecond() + m.second;
-            GetUniverse().get_or_emplace<common::components::CommandQueue>(body).commands.push_back(maneuver);
+            QueueManeuvers(body, {maneuver});
         }
 
         if (ImGui::IsItemHovered()) {
@@ -157,7 +175,7 @@ void cqsp::client::systems::SpaceshipWindow::DoUI(int delta_time) {
             auto m = common::systems::SetPeriapsis(orbit, new_apogee);
             maneuver.delta_v = m.first;
             maneuver.time = GetUniverse().date.ToSecond() + m.second;
-            GetUniverse().get_or_emplace<common::components::CommandQueue>(body).commands.push_back(maneuver);
+            QueueManeuvers(body, {maneuver});
         }
 
         if (ImGui::IsItemHovered()) {
@@ -175,13 +193,11 @@ void cqsp::client::systems::SpaceshipWindow::DoUI(int delta_time) {
             // Get the velocity
             auto hohmann = common::systems::HohmannTransfer(orbit, new_hohmann);
             if (hohmann.has_value()) {
-                auto& queue = GetUniverse().get_or_emplace<common::components::CommandQueue>(body);
                 common::components::Maneuver man_1(hohmann->first);
                 common::components::Maneuver man_2(hohmann->second);
                 man_1.time += (GetUniverse().date.ToSecond() + 1000);
                 man_2.time += (GetUniverse().date.ToSecond() + 1000);
-                queue.commands.push_back(man_1);
-                queue.commands.push_back(man_2);
+                QueueManeuvers(body, {man_1, man_2});
             } else {
                 SPDLOG_INFO("Orbit is not circular!");
             }
@@ -202,26 +218,22 @@ void cqsp::client::systems::SpaceshipWindow::DoUI(int delta_time) {
         if (ImGui::Button("Rendez-vous!")) {
             // Rdv with target
             auto pair = cqsp::common::systems::CoplanarIntercept(orbit, target, GetUniverse().date.ToSecond());
-            auto& queue = GetUniverse().get_or_emplace<common::components::CommandQueue>(body);
             common::components::Maneuver man_1(pair.first);
             common::components::Maneuver man_2(pair.second);
             man_1.time += GetUniverse().date.ToSecond();
             man_2.time += GetUniverse().date.ToSecond();
-            queue.commands.push_back(man_1);
-            queue.commands.push_back(man_2);
+            QueueManeuvers(body, {man_1, man_2});
         }
         if (ImGui::Button("Maneuver to point")) {
             auto pair = cqsp::common::systems::CoplanarIntercept(orbit, target, GetUniverse().date.ToSecond());
-            auto& queue = GetUniverse().get_or_emplace<common::components::CommandQueue>(body);
             common::components::Maneuver man_1(pair.first);
             man_1.time += GetUniverse().date.ToSecond();
-            queue.commands.push_back(man_1);
+            QueueManeuvers(body, {man_1});
         }
         if (ImGui::Button("Match Planes")) {
-            auto& queue = GetUniverse().get_or_emplace<common::components::CommandQueue>(body);
             auto maneuver = cqsp::common::systems::MatchPlanes(orbit, target);
             maneuver.second += GetUniverse().date.ToSecond();
-            queue.commands.emplace_back(maneuver);
+            QueueManeuvers(body, {common::components::Maneuver(maneuver)});
         }
         ImGui::TextFmt("Phase angle: {}", cqsp::common::components::types::CalculatePhaseAngle(
                                               orbit, target, GetUniverse().date.ToSecond()));
@@ -17,6 +17,7 @@
 #include "turnsavewindow.h"
 
 #include "client/components/clientctx.h"
+#include "client/scenes/universe/universescene.h"
 
 namespace cqsp::client::systems::rmlui {
 TurnSaveWindow::~TurnSaveWindow() {
@@ -45,6 +46,19 @@ void TurnSaveWindow::Update(double delta_time) {
         }
         is_paused = pause_opt.to_tick;
     }
+
+    // Show how far the fast forward is
+    auto progress = scene::GetSimulationThread().GetFastForwardProgress();
+    if (progress.running) {
+        fast_forward_status_element->SetInnerRML(fmt::format("Fast forwarding: {:.0f}% ({:.0f} ticks/s)",
+                                                             progress.Fraction() * 100, progress.ticks_per_second));
+    } else if (was_fast_forwarding) {
+        fast_forward_status_element->SetInnerRML("");
+    }
+    if (progress.running != was_fast_forwarding) {
+        fast_forward_element->SetInnerRML(progress.running ? "Cancel" : "Skip a year");
+        was_fast_forwarding = progress.running;
+    }
 }
 
 void TurnSaveWindow::OpenDocument() {
@@ -57,6 +71,8 @@ void TurnSaveWindow::OpenDocument() {
     time_element = document->GetElementById("time");
     speed_element = document->GetElementById("speed");
     pause_element = document->GetElementById("pause_button");
+    fast_forward_element = document->GetElementById("fast_forward_year");
+    fast_forward_status_element = document->GetElementById("fast_forward_status");
 
     auto& pause_opt = GetUniverse().ctx().at<client::ctx::PauseOptions>();
     speed_element->SetInnerRML(fmt::format("Speed: {}", pause_opt.tick_speed));
@@ -75,6 +91,13 @@ void TurnSaveWindow::EventListener::ProcessEvent(Rml::Event& event) {
         if (pause_opt.tick_speed < 6) {
             pause_opt.tick_speed++;
         }
+    } else if (id_pressed == "fast_forward_year") {
+        auto& simulation_thread = scene::GetSimulationThread();
+        if (simulation_thread.GetFastForwardProgress().running) {
+            simulation_thread.CancelFastForward();
+        } else {
+            simulation_thread.FastForward(universe->date.GetDate() + common::components::StarDate::TICKS_PER_YEAR);
+        }
     }
 }
 }  // namespace cqsp::client::systems::rmlui
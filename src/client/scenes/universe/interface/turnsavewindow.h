@@ -44,5 +44,8 @@ class TurnSaveWindow : public SysRmlUiInterface {
     Rml::Element* time_element;
     Rml::Element* pause_element;
     Rml::Element* speed_element;
+    Rml::Element* fast_forward_element;
+    Rml::Element* fast_forward_status_element;
+    bool was_fast_forwarding = false;
 };
 }  // namespace cqsp::client::systems::rmlui
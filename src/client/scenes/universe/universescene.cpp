@@ -16,8 +16,12 @@
  */
 #include "client/scenes/universe/universescene.h"
 
+#include <chrono>
 #include <cmath>
 #include <string>
+#include <utility>
+
+#include <spdlog/spdlog.h>
 
 #include "client/components/clientctx.h"
 #include "client/scenes/objecteditor/sysfieldviewer.h"
@@ -56,9 +60,28 @@
 
 // If the game is paused or not, like when escape is pressed
 bool game_halted = false;
+// The simulation thread of the scene that is running
+cqsp::common::systems::simulation::SimulationThread* running_simulation = nullptr;
 
 cqsp::scene::UniverseScene::UniverseScene(cqsp::engine::Application& app) : cqsp::client::Scene(app) {}
 
+cqsp::scene::UniverseScene::~UniverseScene() {
+    // The thread has to be stopped before the simulation it runs is deleted
+    running_simulation = nullptr;
+    simulation_thread.reset();
+    // Let the last autosave finish writing
+    autosaver.reset();
+    // Delete ui
+    simulation.reset();
+    for (auto it = user_interfaces.begin(); it != user_interfaces.end(); it++) {
+        it->reset();
+    }
+    for (auto& it : documents) {
+        it.reset();
+    }
+    delete system_renderer;
+}
+
 void cqsp::scene::UniverseScene::Init() {
     ZoneScoped;
     namespace cqspb = cqsp::common::components::bodies;
@@ -96,75 +119,124 @@ void cqsp::scene::UniverseScene::Init() {
     simulation->tick();
 
     AddRmlUiSystem<cqsps::rmlui::TurnSaveWindow>();
+
+    simulation_thread = std::make_unique<cqspco::systems::simulation::SimulationThread>(
+        dynamic_cast<cqsp::client::ConquerSpace*>(GetApp().GetGame())->GetGame(), *simulation);
+    running_simulation = simulation_thread.get();
+    simulation_thread->Start();
+
+    Hjson::Value autosave_options = GetApp().GetClientOptions().GetOptions()["autosave"];
+    autosave_interval = static_cast<int>(autosave_options["interval"]);
+    autosaver = std::make_unique<client::save::Autosaver>(static_cast<int>(autosave_options["slots"]));
+    last_autosave_date = GetUniverse().date.GetDate();
+
+    // Fast forward from the lua console, the functions outlive the scene so they go through running_simulation
+    GetScriptInterface().set_function("fast_forward", [&universe = GetUniverse()](int ticks) {
+        if (running_simulation != nullptr) {
+            running_simulation->FastForward(universe.date.GetDate() + ticks);
+        }
+    });
+    GetScriptInterface().set_function("cancel_fast_forward", []() {
+        if (running_simulation != nullptr) {
+            running_simulation->CancelFastForward();
+        }
+    });
 }
 
 void cqsp::scene::UniverseScene::Update(float deltaTime) {
     ZoneScoped;
-
-    auto& pause_opt = GetUniverse().ctx().at<client::ctx::PauseOptions>();
+    // Input that doesn't need the universe is handled every frame, even while a tick is running
     if (!ImGui::GetIO().WantCaptureKeyboard) {
         if (GetApp().ButtonIsReleased(engine::KeyInput::KEY_SPACE)) {
-            ToggleTick();
+            toggle_tick = !toggle_tick;
+        }
+        if (!game_halted && GetApp().ButtonIsReleased(engine::KeyInput::KEY_M)) {
+            view_mode = !view_mode;
         }
     }
+    DoScreenshot();
 
-    double tick_length = static_cast<float>(tick_speeds[pause_opt.tick_speed]) / 1000.f;
-    if (pause_opt.to_tick && GetApp().GetTime() - last_tick > tick_length) {
-        GetUniverse().EnableTick();
-        last_tick = GetApp().GetTime();
-    }
+    auto universe_lock = simulation_thread->TryLockUniverse(universe_wait);
+    if (universe_lock.owns_lock()) {
+        auto& pause_opt = GetUniverse().ctx().at<client::ctx::PauseOptions>();
+        if (toggle_tick) {
+            ToggleTick();
+            toggle_tick = false;
+        }
+        pause_options = pause_opt;
+        GetUniverse().tick_fraction = interp ? simulation_thread->GetTickFraction() : 0;
 
-    if (pause_opt.to_tick) {
-        GetUniverse().tick_fraction = (GetApp().GetTime() - last_tick) / tick_length;
-        if (!interp) GetUniverse().tick_fraction = 0;
-    }
+        // Check if the simulation has ticked since the last frame
+        if (simulation_thread->GetTickCount() != last_tick_count) {
+            last_tick_count = simulation_thread->GetTickCount();
+            system_renderer->OnTick();
+            DoAutosave();
+        }
 
-    // Check for last tick
-    if (GetUniverse().ToTick() && !game_halted) {
-        // Game tick
-        simulation->tick();
-        system_renderer->OnTick();
-    }
+        system_renderer->PrepareFrame();
+        if (!game_halted) {
+            system_renderer->Update(deltaTime);
+        }
 
-    if (!game_halted) {
-        if (!ImGui::GetIO().WantCaptureKeyboard && GetApp().ButtonIsReleased(engine::KeyInput::KEY_M)) {
-            view_mode = !view_mode;
+        if (view_mode) {
+            GetUniverse().clear<cqsp::client::systems::MouseOverEntity>();
+            system_renderer->GetMouseOnObject(GetApp().GetMouseX(), GetApp().GetMouseY());
         }
-        system_renderer->Update(deltaTime);
-        // Check to see if you have to switch
-    }
 
-    DoScreenshot();
+        for (auto& ui : documents) {
+            ui->Update(deltaTime);
+        }
 
-    if (view_mode) {
-        GetUniverse().clear<cqsp::client::systems::MouseOverEntity>();
-        system_renderer->GetMouseOnObject(GetApp().GetMouseX(), GetApp().GetMouseY());
+        for (auto& ui : user_interfaces) {
+            if (game_halted) {
+                ui->window_flags = ImGuiWindowFlags_NoInputs;
+            } else {
+                ui->window_flags = 0;
+            }
+            ui->DoUpdate(deltaTime);
+        }
     }
 
-    for (auto& ui : documents) {
-        ui->Update(deltaTime);
-    }
+    // The options from the last frame that could read them are used while a tick is running
+    simulation_thread->SetTickLength(std::chrono::milliseconds(tick_speeds[pause_options.tick_speed]));
+    simulation_thread->SetRunning(pause_options.to_tick && !game_halted);
+}
 
-    for (auto& ui : user_interfaces) {
-        if (game_halted) {
-            ui->window_flags = ImGuiWindowFlags_NoInputs;
-        } else {
-            ui->window_flags = 0;
-        }
-        ui->DoUpdate(deltaTime);
+void cqsp::scene::UniverseScene::DoAutosave() {
+    if (autosave_interval <= 0) {
+        return;
+    }
+    const int date = GetUniverse().date.GetDate();
+    if (date - last_autosave_date < autosave_interval * common::components::StarDate::TICKS_PER_DAY) {
+        return;
+    }
+    // The universe is locked, so the simulation is between ticks while the autosave copies it
+    ZoneScopedN("Autosave");
+    if (autosaver->Save(GetUniverse())) {
+        last_autosave_date = date;
     }
 }
 
 void cqsp::scene::UniverseScene::Ui(float deltaTime) {
+    auto universe_lock = simulation_thread->TryLockUniverse(universe_wait);
+    if (!universe_lock.owns_lock()) {
+        // The windows read the universe, so instead of waiting for the tick they show what they showed on the last
+        // frame that could read it
+        window_replay.Replay();
+        return;
+    }
+    window_replay.BeginRecord();
     for (auto& ui : user_interfaces) {
         ui->DoUI(deltaTime);
     }
     system_renderer->DoUI(deltaTime);
+    window_replay.EndRecord();
 }
 
 void cqsp::scene::UniverseScene::Render(float deltaTime) {
     ZoneScoped;
     glEnable(GL_MULTISAMPLE);
+    // Drawn from the snapshot, so this doesn't need the universe lock
     system_renderer->Render(deltaTime);
 }
 
@@ -193,3 +265,21 @@ void cqsp::scene::SeePlanet(cqsp::common::Universe& universe, entt::entity ent)
 void cqsp::scene::SetGameHalted(bool b) { game_halted = b; }
 
 bool cqsp::scene::IsGameHalted() { return game_halted; }
+
+void cqsp::scene::QueueCommand(std::function<void(cqsp::common::Universe&)> command) {
+    if (running_simulation == nullptr) {
+        SPDLOG_WARN("Dropped a command because the simulation isn't running");
+        return;
+    }
+    running_simulation->PushCommand(std::move(command));
+}
+
+cqsp::common::systems::simulation::SimulationThread::SnapshotView cqsp::scene::ReadSnapshot() {
+    using cqsp::common::systems::simulation::SimulationThread;
+    if (running_simulation == nullptr) {
+        return SimulationThread::EmptySnapshot();
+    }
+    return running_simulation->ReadSnapshot();
+}
+
+cqsp::common::systems::simulation::SimulationThread& cqsp::scene::GetSimulationThread() { return *running_simulation; }
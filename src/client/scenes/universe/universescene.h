@@ -17,37 +17,33 @@
 #pragma once
 
 #include <array>
+#include <chrono>
+#include <functional>
 #include <memory>
 #include <utility>
 #include <vector>
 
+#include "client/components/clientctx.h"
 #include "client/scenes/scene.h"
 #include "client/scenes/universe/views/starsystemview.h"
+#include "client/systems/savegame.h"
 #include "client/systems/sysgui.h"
 #include "common/components/bodies.h"
 #include "common/components/organizations.h"
 #include "common/simulation.h"
+#include "common/simulationthread.h"
 #include "engine/application.h"
 #include "engine/graphics/renderable.h"
 #include "engine/renderer/renderer.h"
 #include "engine/renderer/renderer2d.h"
+#include "engine/windowreplay.h"
 
 namespace cqsp {
 namespace scene {
 class UniverseScene : public cqsp::client::Scene {
  public:
     explicit UniverseScene(cqsp::engine::Application& app);
-    ~UniverseScene() {
-        // Delete ui
-        simulation.reset();
-        for (auto it = user_interfaces.begin(); it != user_interfaces.end(); it++) {
-            it->reset();
-        }
-        for (auto& it : documents) {
-            it.reset();
-        }
-        delete system_renderer;
-    }
+    ~UniverseScene();
 
     void Init();
     void Update(float deltaTime);
@@ -90,6 +86,24 @@ class UniverseScene : public cqsp::client::Scene {
     cqsp::client::systems::SysStarSystemRenderer* system_renderer;
 
     std::unique_ptr<cqsp::common::systems::simulation::Simulation> simulation;
+    std::unique_ptr<cqsp::common::systems::simulation::SimulationThread> simulation_thread;
+    uint64_t last_tick_count = 0;
+    // How long a frame waits for the simulation to finish a tick before it skips reading the universe. Short
+    // ticks finish within it, so the frame is only skipped when a tick is slow.
+    static constexpr std::chrono::microseconds universe_wait {2000};
+    // The pause options from the last frame that could read the universe
+    client::ctx::PauseOptions pause_options;
+    // If the space bar was pressed, but the universe couldn't be locked to pause yet
+    bool toggle_tick = false;
+    // The windows of the last frame that could read the universe, shown again while a tick is running
+    engine::WindowReplay window_replay;
+
+    void DoAutosave();
+
+    std::unique_ptr<client::save::Autosaver> autosaver;
+    // In game days between autosaves
+    int autosave_interval = 0;
+    int last_autosave_date = 0;
 
     bool to_show_planet_window = false;
 
@@ -100,8 +114,6 @@ class UniverseScene : public cqsp::client::Scene {
 
     std::vector<std::unique_ptr<client::systems::SysRmlUiInterface>> documents;
 
-    double last_tick = 0;
-
     std::array<int, 7> tick_speeds {1000, 500, 333, 100, 50, 10, 1};
     void ToggleTick();
 
@@ -113,5 +125,18 @@ entt::entity GetCurrentViewingPlanet(cqsp::common::Universe&);
 // Halts all other things
 void SetGameHalted(bool b);
 bool IsGameHalted();
+/// <summary>
+/// Queues a change to the universe, which is made on the simulation thread before the next tick.
+/// </summary>
+void QueueCommand(std::function<void(cqsp::common::Universe&)> command);
+/// <summary>
+/// The state of the universe after the last tick, which can be read while the simulation is ticking. The snapshot
+/// is empty if the simulation isn't running.
+/// </summary>
+cqsp::common::systems::simulation::SimulationThread::SnapshotView ReadSnapshot();
+/// <summary>
+/// The thread that runs the simulation, for controlling it directly, like fast forwarding.
+/// </summary>
+cqsp::common::systems::simulation::SimulationThread& GetSimulationThread();
 }  // namespace scene
 }  // namespace cqsp
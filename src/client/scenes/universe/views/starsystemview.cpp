@@ -28,6 +28,7 @@
 #include "client/components/clientctx.h"
 #include "client/components/planetrendering.h"
 #include "client/scenes/universe/interface/systooltips.h"
+#include "client/scenes/universe/universescene.h"
 #include "common/components/area.h"
 #include "common/components/bodies.h"
 #include "common/components/coordinates.h"
@@ -121,10 +122,8 @@ void SysStarSystemRenderer::OnTick() {
     namespace cqspb = cqsp::common::components::bodies;
 }
 
-void SysStarSystemRenderer::Render(float deltaTime) {
+void SysStarSystemRenderer::PrepareFrame() {
     ZoneScoped;
-    namespace cqspb = cqsp::common::components::bodies;
-
     // Seeing new planet
     entt::entity current_planet = m_universe.view<FocusedPlanet>().front();
     if (current_planet != m_viewing_entity && current_planet != entt::null) {
@@ -136,11 +135,14 @@ void SysStarSystemRenderer::Render(float deltaTime) {
 
     FocusCityView();
 
+    GenerateOrbitLines();
+}
+
+void SysStarSystemRenderer::Render(float deltaTime) {
+    ZoneScoped;
     // Check for resized window
     window_ratio = static_cast<float>(m_app.GetWindowWidth()) / static_cast<float>(m_app.GetWindowHeight());
 
-    GenerateOrbitLines();
-
     renderer.NewFrame(*m_app.GetWindow());
 
     glEnable(GL_DEPTH_TEST);
@@ -155,9 +157,11 @@ void SysStarSystemRenderer::Render(float deltaTime) {
     // FIXME(EhWhoAmI): Unify all the rendering of planets and stars into one single loop
     // FIXME(EhWhoAmI): Orbit lines dissapear based on distance away from the planet.
     // make them dissapear if you're focused on the planet.
-    DrawStars();
-    DrawBodies();
-    DrawShips();
+    // What the simulation changes is read from the snapshot, so that the frame doesn't wait for a tick to finish
+    auto snapshot = scene::ReadSnapshot();
+    DrawStars(*snapshot);
+    DrawBodies(*snapshot);
+    DrawShips(*snapshot);
     DrawSkybox();
 
     // Unable to render this
@@ -263,62 +267,59 @@ void SysStarSystemRenderer::DoUI(float deltaTime) {
     RenderSelectedObjectInformation();
 }
 
-void SysStarSystemRenderer::DrawStars() {
+void SysStarSystemRenderer::DrawStars(const Snapshot& snapshot) {
     ZoneScoped;
     // Draw stars
-    namespace cqspb = cqsp::common::components::bodies;
-    namespace cqsps = cqsp::common::components::ships;
-    auto stars = m_universe.view<cqspb::Body, cqspb::LightEmitter>();
     renderer.BeginDraw(physical_layer);
-    for (auto ent_id : stars) {
+    for (const auto& [ent_id, body] : snapshot.bodies) {
+        if (!body.celestial || !body.star) {
+            continue;
+        }
         // Draw the star circle
-        glm::vec3 object_pos = CalculateCenteredObject(ent_id);
+        glm::vec3 object_pos = CalculateCenteredObject(body);
         sun_position = object_pos;
-        DrawStar(ent_id, object_pos);
+        DrawStar(body, object_pos);
     }
     renderer.EndDraw(physical_layer);
 }
 
-void SysStarSystemRenderer::DrawBodies() {
+void SysStarSystemRenderer::DrawBodies(const Snapshot& snapshot) {
     ZoneScoped;
     // Draw other bodies
-    auto bodies = m_universe.view<cqspb::Body>(entt::exclude<cqspb::LightEmitter>);
     renderer.BeginDraw(planet_icon_layer);
     glDepthFunc(GL_ALWAYS);
-    DrawAllPlanetBillboards(bodies);
+    DrawAllPlanetBillboards(snapshot);
     glDepthFunc(GL_LESS);
     renderer.EndDraw(planet_icon_layer);
 
     renderer.BeginDraw(physical_layer);
-    DrawAllPlanets(bodies);
-    DrawAllOrbits();
-    DrawModels();
+    DrawAllPlanets(snapshot);
+    DrawAllOrbits(snapshot);
+    DrawModels(snapshot);
     renderer.EndDraw(physical_layer);
 
     // This is on the ship icon layer because the cities have to appear on top of planets
     // and planet_icon_layer is behind all the planets.
     renderer.BeginDraw(ship_icon_layer);
-    DrawAllCities(bodies);
+    DrawAllCities(snapshot);
     renderer.EndDraw(ship_icon_layer);
 }
 
-void SysStarSystemRenderer::DrawShips() {
+void SysStarSystemRenderer::DrawShips(const Snapshot& snapshot) {
     ZoneScoped;
-    namespace cqsps = cqsp::common::components::ships;
     // Draw Ships
-    auto ships = m_universe.view<cqsps::Ship, ctx::VisibleOrbit>();
-
     renderer.BeginDraw(ship_icon_layer);
     ship_overlay.shaderProgram->UseProgram();
-    for (auto ent_id : ships) {
+    for (const auto& [ent_id, body] : snapshot.bodies) {
         // if it's not visible, then don't render
-        glm::vec3 object_pos = CalculateCenteredObject(ent_id);
+        if (!body.ship || !m_universe.all_of<ctx::VisibleOrbit>(ent_id)) {
+            continue;
+        }
+        glm::vec3 object_pos = CalculateCenteredObject(body);
         ship_overlay.shaderProgram->setVec4("color", 1, 0, 0, 1);
         // Interpolate so that it looks nice
-        if (m_universe.any_of<common::components::types::FuturePosition>(ent_id)) {
-            auto& future_comp = m_universe.get<common::components::types::FuturePosition>(ent_id);
-            const auto& pos = future_comp.position + future_comp.center;
-            glm::vec3 future_pos = CalculateCenteredObject(ConvertPoint(pos));
+        if (body.has_future) {
+            glm::vec3 future_pos = CalculateCenteredObject(ConvertPoint(body.future_position + body.future_center));
             DrawShipIcon(glm::mix(object_pos, future_pos, m_universe.tick_fraction));
         } else {
             DrawShipIcon(object_pos);
@@ -341,19 +342,18 @@ void SysStarSystemRenderer::DrawSkybox() {
     renderer.EndDraw(skybox_layer);
 }
 
-void SysStarSystemRenderer::DrawModels() {
-    namespace cqsps = cqsp::common::components::ships;
-
-    auto ships = m_universe.view<cqsps::Ship, ctx::VisibleOrbit>();
+void SysStarSystemRenderer::DrawModels(const Snapshot& snapshot) {
     // Loop through the space bodies that are close
-    for (entt::entity body_entity : ships) {
+    for (const auto& [body_entity, body] : snapshot.bodies) {
+        if (!body.ship || !m_universe.all_of<ctx::VisibleOrbit>(body_entity)) {
+            continue;
+        }
         // Get the model of the object
-
         if (!m_universe.any_of<common::components::WorldModel>(body_entity)) {
             continue;
         }
         auto model_name = m_universe.get<common::components::WorldModel>(body_entity);
-        glm::vec3 object_pos = CalculateCenteredObject(body_entity);
+        glm::vec3 object_pos = CalculateCenteredObject(body);
         if (glm::distance(cam_pos, object_pos) > 1000) {
             continue;
         }
@@ -368,9 +368,7 @@ void SysStarSystemRenderer::DrawModels() {
     }
 }
 
-void SysStarSystemRenderer::DrawEntityName(glm::vec3& object_pos, entt::entity ent_id) {
-    using cqsp::common::components::Name;
-    std::string text = common::util::GetName(m_universe, ent_id);
+void SysStarSystemRenderer::DrawEntityName(glm::vec3& object_pos, const std::string& text) {
     glm::vec3 pos = GetBillboardPosition(object_pos);
     // Check if the position on screen is within bounds
     if (pos.z < 1 && pos.z > -1 &&
@@ -386,7 +384,7 @@ void SysStarSystemRenderer::DrawPlanetIcon(glm::vec3& object_pos) {
     engine::Draw(planet_circle);
 }
 
-void SysStarSystemRenderer::DrawPlanetBillboards(const entt::entity& ent_id, const glm::vec3& object_pos) {
+void SysStarSystemRenderer::DrawPlanetBillboards(const Snapshot::Body& body, const glm::vec3& object_pos) {
     glm::vec3 pos = GetBillboardPosition(object_pos);
     glm::vec4 gl_Position = CalculateGLPosition(object_pos);
 
@@ -395,15 +393,13 @@ void SysStarSystemRenderer::DrawPlanetBillboards(const entt::entity& ent_id, con
         return;
     }
 
-    std::string text = common::util::GetName(m_universe, ent_id);
-
     glm::mat4 planetDispMat = GetBillboardMatrix(pos);
 
     SetBillboardProjection(planet_circle.shaderProgram, planetDispMat);
 
     engine::Draw(planet_circle);
 
-    m_app.DrawText(text, pos.x, pos.y, 20);
+    m_app.DrawText(body.name, pos.x, pos.y, 20);
 }
 
 void SysStarSystemRenderer::DrawCityIcon(const glm::vec3& object_pos) {
@@ -422,11 +418,14 @@ void SysStarSystemRenderer::DrawCityIcon(const glm::vec3& object_pos) {
     engine::Draw(city);
 }
 
-void SysStarSystemRenderer::DrawAllCities(auto& bodies) {
-    for (auto body_entity : bodies) {
-        glm::vec3 object_pos = CalculateCenteredObject(body_entity);
+void SysStarSystemRenderer::DrawAllCities(const Snapshot& snapshot) {
+    for (const auto& [body_entity, body] : snapshot.bodies) {
+        if (!body.celestial || body.star) {
+            continue;
+        }
+        glm::vec3 object_pos = CalculateCenteredObject(body);
         // if (glm::distance(object_pos, cam_pos) <= dist) {
-        RenderCities(object_pos, body_entity);
+        RenderCities(snapshot, object_pos, body);
         //}
     }
 }
@@ -447,19 +446,16 @@ void SysStarSystemRenderer::DrawShipIcon(const glm::vec3& object_pos) {
     engine::Draw(ship_overlay);
 }
 
-void SysStarSystemRenderer::DrawTexturedPlanet(const glm::vec3& object_pos, const entt::entity entity) {
+void SysStarSystemRenderer::DrawTexturedPlanet(const glm::vec3& object_pos, const entt::entity entity,
+                                               const Snapshot::Body& body, double seconds) {
     bool have_normal = false;
     bool have_roughness = false;
     bool have_province;
     GetPlanetTexture(entity, have_normal, have_roughness, have_province);
 
-    namespace cqspb = cqsp::common::components::bodies;
-    namespace cqspt = cqsp::common::components::types;
-    auto& body = m_universe.get<cqspb::Body>(entity);
-
     glm::mat4 position = glm::mat4(1.f);
     position = glm::translate(position, object_pos);
-    position *= glm::mat4(GetBodyRotation(body.axial, body.rotation, body.rotation_offset));
+    position *= glm::mat4(GetBodyRotation(body.axial, body.rotation, body.rotation_offset, seconds));
 
     // Rotate
     float scale = body.radius;  // cqsp::common::components::types::toAU(body.radius)
@@ -517,10 +513,13 @@ void SysStarSystemRenderer::GetPlanetTexture(const entt::entity entity, bool& ha
     }
 }
 
-void SysStarSystemRenderer::DrawAllPlanets(auto& bodies) {
+void SysStarSystemRenderer::DrawAllPlanets(const Snapshot& snapshot) {
     ZoneScoped;
-    for (entt::entity body_entity : bodies) {
-        glm::vec3 object_pos = CalculateCenteredObject(body_entity);
+    for (const auto& [body_entity, body] : snapshot.bodies) {
+        if (!body.celestial || body.star) {
+            continue;
+        }
+        glm::vec3 object_pos = CalculateCenteredObject(body);
 
         namespace cqspc = cqsp::common::components;
 
@@ -532,41 +531,43 @@ void SysStarSystemRenderer::DrawAllPlanets(auto& bodies) {
         // if (m_universe.all_of<cqspb::Terrain>(body_entity)) {
         // Do empty terrain
         // Check if the planet has the thing
-        if (m_universe.all_of<cqspb::TexturedTerrain>(body_entity)) {
-            DrawTexturedPlanet(object_pos, body_entity);
+        if (body.textured) {
+            DrawTexturedPlanet(object_pos, body_entity, body, snapshot.seconds);
         } else {
-            DrawTerrainlessPlanet(body_entity, object_pos);
+            DrawTerrainlessPlanet(body, object_pos);
         }
         //}
     }
 }
 
-void SysStarSystemRenderer::DrawAllPlanetBillboards(auto& bodies) {
+void SysStarSystemRenderer::DrawAllPlanetBillboards(const Snapshot& snapshot) {
     ZoneScoped;
     planet_circle.shaderProgram->UseProgram();
     planet_circle.shaderProgram->setVec4("color", 0, 0, 1, 1);
-    for (auto body_entity : bodies) {
+    for (const auto& [body_entity, body] : snapshot.bodies) {
+        if (!body.celestial || body.star) {
+            continue;
+        }
         // Draw the planet circle
-        glm::vec3 object_pos = CalculateCenteredObject(body_entity);
+        glm::vec3 object_pos = CalculateCenteredObject(body);
 
         namespace cqspc = cqsp::common::components;
         //if (true) {
         // Check if it's obscured by a planet, but eh, we can deal with
         // it later Set planet circle color
-        DrawPlanetBillboards(body_entity, object_pos);
+        DrawPlanetBillboards(body, object_pos);
         //continue;
         //}
     }
 }
 
-void SysStarSystemRenderer::DrawStar(const entt::entity& entity, glm::vec3& object_pos) {
+void SysStarSystemRenderer::DrawStar(const Snapshot::Body& body, glm::vec3& object_pos) {
     glm::mat4 position = glm::mat4(1.f);
     position = glm::translate(position, object_pos);
 
     glm::mat4 transform = glm::mat4(1.f);
     // Scale it by radius
-    const double& radius = m_universe.get<common::components::bodies::Body>(entity).radius;
-    double scale = radius;
+    double scale = body.radius;
     transform = glm::scale(transform, glm::vec3(scale, scale, scale));
     position = position * transform;
 
@@ -575,14 +576,12 @@ void SysStarSystemRenderer::DrawStar(const entt::entity& entity, glm::vec3& obje
     engine::Draw(sun);
 }
 
-void SysStarSystemRenderer::DrawTerrainlessPlanet(const entt::entity& entity, glm::vec3& object_pos) {
-    namespace cqspb = cqsp::common::components::bodies;
-
+void SysStarSystemRenderer::DrawTerrainlessPlanet(const Snapshot::Body& body, glm::vec3& object_pos) {
     glm::mat4 position = glm::mat4(1.f);
     position = glm::translate(position, object_pos);
     float scale = 300;
-    if (m_universe.any_of<cqspb::Body>(entity)) {
-        scale = m_universe.get<cqspb::Body>(entity).radius;
+    if (body.celestial) {
+        scale = body.radius;
     }
 
     position = glm::scale(position, glm::vec3(scale));
@@ -594,25 +593,19 @@ void SysStarSystemRenderer::DrawTerrainlessPlanet(const entt::entity& entity, gl
     engine::Draw(sun);
 }
 
-void SysStarSystemRenderer::RenderCities(glm::vec3& object_pos, const entt::entity& body_entity) {
+void SysStarSystemRenderer::RenderCities(const Snapshot& snapshot, glm::vec3& object_pos,
+                                         const Snapshot::Body& body) {
     ZoneScoped;
     // Draw Cities
-    namespace cqspc = cqsp::common::components;
-    namespace cqspt = cqsp::common::components::types;
-    if (!m_universe.all_of<cqspc::Habitation>(body_entity)) {
-        return;
-    }
-    std::vector<entt::entity> cities = m_universe.get<cqspc::Habitation>(body_entity).settlements;
-    if (cities.empty()) {
+    if (body.settlements.empty()) {
         return;
     }
 
-    auto& body = m_universe.get<cqspc::bodies::Body>(body_entity);
-    auto quat = GetBodyRotation(body.axial, body.rotation, body.rotation_offset);
+    auto quat = GetBodyRotation(body.axial, body.rotation, body.rotation_offset, snapshot.seconds);
 
     city.shaderProgram->UseProgram();
     city.shaderProgram->setVec4("color", 0.5, 0.5, 0.5, 1);
-    for (auto city_entity : cities) {
+    for (auto city_entity : body.settlements) {
         // Calculate position to render
         if (!m_universe.any_of<Offset>(city_entity)) {
             // Calculate offset
@@ -626,7 +619,9 @@ void SysStarSystemRenderer::RenderCities(glm::vec3& object_pos, const entt::enti
         if (CityIsVisible(city_world_pos, object_pos, cam_pos)) {
             // If it's reasonably close, then we can show city names
             //if (scroll < 3) {
-            DrawEntityName(city_world_pos, city_entity);
+            if (const auto* city_snapshot = snapshot.GetCity(city_entity); city_snapshot != nullptr) {
+                DrawEntityName(city_world_pos, city_snapshot->name);
+            }
             //}
             DrawCityIcon(city_world_pos);
         }
@@ -789,12 +784,11 @@ void SysStarSystemRenderer::InitializeMeshes() {
     model_shader = m_app.GetAssetManager().GetAsset<asset::ShaderDefinition>("core:model_pbr_log_shader")->MakeShader();
 }
 
-glm::quat SysStarSystemRenderer::GetBodyRotation(double axial, double rotation, double day_offset) {
+glm::quat SysStarSystemRenderer::GetBodyRotation(double axial, double rotation, double day_offset, double seconds) {
     namespace cqspt = cqsp::common::components::types;
     // Need to interpolate between the frames
     float rot = (float)common::components::bodies::GetPlanetRotationAngle(
-        m_universe.date.ToSecond() + m_universe.tick_fraction * cqsp::common::components::StarDate::TIME_INCREMENT,
-        rotation, day_offset);
+        seconds + m_universe.tick_fraction * cqsp::common::components::StarDate::TIME_INCREMENT, rotation, day_offset);
     if (rotation == 0) {
         rot = 0;
     }
@@ -819,14 +813,17 @@ void SysStarSystemRenderer::FocusCityView() {
 }
 
 glm::vec3 SysStarSystemRenderer::CalculateObjectPos(const entt::entity& ent) {
-    namespace cqspt = cqsp::common::components::types;
     // Get the position
-    if (!m_universe.all_of<cqspt::Kinematics>(ent)) {
+    auto snapshot = scene::ReadSnapshot();
+    return CalculateObjectPos(*snapshot, ent);
+}
+
+glm::vec3 SysStarSystemRenderer::CalculateObjectPos(const Snapshot& snapshot, const entt::entity& ent) {
+    const auto* body = snapshot.GetBody(ent);
+    if (body == nullptr) {
         return glm::vec3(0, 0, 0);
     }
-    auto& kin = m_universe.get<cqspt::Kinematics>(ent);
-    const auto& pos = kin.position + kin.center;
-    return ConvertPoint(pos);
+    return ConvertPoint(body->position + body->center);
 }
 
 glm::vec3 SysStarSystemRenderer::CalculateCenteredObject(const glm::vec3& vec) { return vec - view_center; }
@@ -892,7 +889,7 @@ void SysStarSystemRenderer::CenterCameraOnCity() {
     }
     auto& body = m_universe.get<cqsp::common::components::bodies::Body>(planet);
 
-    glm::quat quat = GetBodyRotation(body.axial, body.rotation, body.rotation_offset);
+    glm::quat quat = GetBodyRotation(body.axial, body.rotation, body.rotation_offset, m_universe.date.ToSecond());
 
     glm::vec3 vec = cqspt::toVec3(surf.universe_view(), 1);
     auto s = quat * vec;
@@ -905,6 +902,10 @@ glm::vec3 SysStarSystemRenderer::CalculateCenteredObject(const entt::entity& ent
     return CalculateCenteredObject(CalculateObjectPos(ent));
 }
 
+glm::vec3 SysStarSystemRenderer::CalculateCenteredObject(const Snapshot::Body& body) {
+    return CalculateCenteredObject(ConvertPoint(body.position + body.center));
+}
+
 void SysStarSystemRenderer::CalculateCamera() {
     cam_pos = glm::vec3(cos(view_y) * sin(view_x), sin(view_y), cos(view_y) * cos(view_x)) * (float)scroll;
     cam_up = glm::vec3(0.0f, 1.0f, 0.0f);
@@ -1149,8 +1150,9 @@ void SysStarSystemRenderer::RenderSelectedObjectInformation() {
 
         if (ImGui::Button("Burn prograde")) {
             // Add 10m/s prograde or something
-            auto& impulse = m_universe.get_or_emplace<common::components::types::Impulse>(m_viewing_entity);
-            impulse.impulse += norm;
+            scene::QueueCommand([entity = m_viewing_entity, impulse = glm::dvec3(norm)](common::Universe& universe) {
+                universe.get_or_emplace<common::components::types::Impulse>(entity).impulse += impulse;
+            });
         }
         ImGui::SliderFloat("Text", &delta_v, -1, 1);
     }
@@ -1172,7 +1174,8 @@ common::components::types::SurfaceCoordinate SysStarSystemRenderer::GetMouseSurf
     p = glm::normalize(p);
 
     auto& planet_comp = m_universe.get<cqspc::bodies::Body>(on_planet);
-    glm::quat quat = GetBodyRotation(planet_comp.axial, planet_comp.rotation, planet_comp.rotation_offset);
+    glm::quat quat = GetBodyRotation(planet_comp.axial, planet_comp.rotation, planet_comp.rotation_offset,
+                                     m_universe.date.ToSecond());
     // Rotate the vector based on the axial tilt and rotation.
     p = glm::inverse(quat) * p;
 
@@ -1260,6 +1263,10 @@ void SysStarSystemRenderer::GenerateOrbit(entt::entity body) {
         SOI = m_universe.get<common::components::bodies::Body>(orb.reference_body).SOI;
     }
 
+    // Only the true anomaly changes between the points, so the rotation is only computed once. The orbit was
+    // just marked dirty, so the simulation's cache of it can be out of date.
+    const common::components::types::OrbitCache cache(orb);
+
     orbit_points.reserve(res);
     // If hyperbolic
     if (orb.eccentricity > 1) {
@@ -1269,7 +1276,7 @@ void SysStarSystemRenderer::GenerateOrbit(entt::entity body) {
             ZoneScoped;
             double theta = -v_inf * (1 - (double)i / (double)res) + v_inf * (((double)i / (double)res));
 
-            glm::vec3 vec = common::components::types::toVec3(orb, theta);
+            glm::vec3 vec = cache.Position(theta);
             // Check if the length is greater than the SOI, then we don't add it
             if (glm::length(vec) < SOI) {
                 orbit_points.push_back(ConvertPoint(vec));
@@ -1280,7 +1287,7 @@ void SysStarSystemRenderer::GenerateOrbit(entt::entity body) {
             ZoneScoped;
             double theta = 3.1415926535 * 2 / res * i;
 
-            glm::vec3 vec = common::components::types::toVec3(orb, theta);
+            glm::vec3 vec = cache.Position(theta);
 
             // If the length is greater than the sphere of influence, then
             // remove it
@@ -1333,61 +1340,50 @@ bool SysStarSystemRenderer::IsFoundingCity(common::Universe& universe) {
     return !universe.view<CityFounding>().empty();
 }
 
-void SysStarSystemRenderer::DrawAllOrbits() {
+void SysStarSystemRenderer::DrawAllOrbits(const Snapshot& snapshot) {
     ZoneScoped;
-    namespace cqspt = cqsp::common::components::types;
-    auto orbits = m_universe.view<cqspt::Orbit>();
     // Always render planet orbits
     // Visible orbits will not be rendered
-    for (entt::entity orbit_entity : orbits) {
+    for (const auto& [orbit_entity, body] : snapshot.bodies) {
+        if (!body.has_orbit) {
+            continue;
+        }
         // Check the type of orbiting things, and then don't render if it doesn't fit the filter
-        if (m_universe.any_of<common::components::bodies::Planet>(orbit_entity)) {
+        if (body.planet) {
             // Render no matter what
-            DrawOrbit(orbit_entity);
+            DrawOrbit(snapshot, orbit_entity, body);
             continue;
         }
         if (!m_universe.any_of<ctx::VisibleOrbit>(orbit_entity)) {
             // Then don't render
             continue;
         }
-        DrawOrbit(orbit_entity);
+        DrawOrbit(snapshot, orbit_entity, body);
     }
 }
 
-void SysStarSystemRenderer::DrawOrbit(const entt::entity& entity) {
+void SysStarSystemRenderer::DrawOrbit(const Snapshot& snapshot, const entt::entity& entity,
+                                      const Snapshot::Body& body) {
     if (!m_universe.any_of<PlanetOrbit>(entity)) {
         return;
     }
     glm::vec3 center = glm::vec3(0, 0, 0);
     // If it has a parent, draw around the parent
-    entt::entity ref = m_universe.get<common::components::types::Orbit>(entity).reference_body;
+    entt::entity ref = body.reference_body;
     if (ref != entt::null) {
-        center = CalculateObjectPos(ref);
+        center = CalculateObjectPos(snapshot, ref);
     } else {
         return;
     }
     glm::mat4 transform = glm::mat4(1.f);
     transform = glm::translate(transform, CalculateCenteredObject(center));
     // Actually you just need to rotate the orbit
-    auto body = m_universe.get<common::components::bodies::Body>(ref);
     //transform *= glm::mat4(
     //    glm::quat{{0.f, 0, (float)body.axial}});
     // Draw orbit
     orbit_shader->SetMVP(transform, camera_matrix, m_app.Get3DProj());
 
-    //Set the color of each orbit based on its distance from its center body
-
-    auto& orb = m_universe.get<common::components::types::Orbit>(entity);
-
-    const double dis = orb.semi_major_axis;
-    const double max_dis = body.SOI;
-    const double inc = orb.inclination;
-
-    const float min_launch_dis = body.radius;
-    float col = dis - min_launch_dis;
-    float r = log(col) / log(max_dis);
-    float g = 1 - r;
-    float b = inc / 3.15;
+    // TODO(EhWhoAmI): Set the color of each orbit based on its distance from its center body
     glm::vec4 color_v = {1, 1, 1, 1};
     orbit_shader->Set("color", color_v);
 
@@ -21,6 +21,7 @@
 #include <vector>
 
 #include "common/components/coordinates.h"
+#include "common/simulationthread.h"
 #include "common/universe.h"
 #include "engine/application.h"
 #include "engine/graphics/model.h"
@@ -48,9 +49,21 @@ struct CityFounding {};
  */
 class SysStarSystemRenderer {
  public:
+    using Snapshot = cqsp::common::systems::simulation::WorldSnapshot;
+
     SysStarSystemRenderer(cqsp::common::Universe &, cqsp::engine::Application &);
     void Initialize();
     void OnTick();
+    /// <summary>
+    /// Sets up what the next frames draw from the universe, like the orbit lines and the planet being looked at.
+    /// Needs the universe lock.
+    /// </summary>
+    void PrepareFrame();
+    /// <summary>
+    /// Draws the star system from the snapshot of the last tick, so it doesn't need the universe lock. The only
+    /// components it reads from the universe are the ones that the simulation doesn't change, like the textures
+    /// and the orbit filter.
+    /// </summary>
     void Render(float deltaTime);
     void SeeStarSystem();
     void SeeEntity();
@@ -81,8 +94,8 @@ class SysStarSystemRenderer {
 
     static bool IsFoundingCity(common::Universe &universe);
 
-    void DrawAllOrbits();
-    void DrawOrbit(const entt::entity &entity);
+    void DrawAllOrbits(const Snapshot &snapshot);
+    void DrawOrbit(const Snapshot &snapshot, const entt::entity &entity, const Snapshot::Body &body);
 
     void OrbitEditor();
 
@@ -120,29 +133,30 @@ class SysStarSystemRenderer {
 
     float circle_size = 0.01f;
 
-    void DrawStars();
-    void DrawBodies();
-    void DrawShips();
+    void DrawStars(const Snapshot &snapshot);
+    void DrawBodies(const Snapshot &snapshot);
+    void DrawShips(const Snapshot &snapshot);
     void DrawSkybox();
-    void DrawModels();
+    void DrawModels(const Snapshot &snapshot);
 
-    void DrawEntityName(glm::vec3 &object_pos, entt::entity ent_id);
+    void DrawEntityName(glm::vec3 &object_pos, const std::string &text);
     void DrawPlanetIcon(glm::vec3 &object_pos);
-    void DrawPlanetBillboards(const entt::entity &ent_id, const glm::vec3 &object_pos);
+    void DrawPlanetBillboards(const Snapshot::Body &body, const glm::vec3 &object_pos);
     void DrawShipIcon(const glm::vec3 &object_pos);
     void DrawCityIcon(const glm::vec3 &object_pos);
 
-    void DrawAllCities(auto &bodies);
+    void DrawAllCities(const Snapshot &snapshot);
 
-    void DrawAllPlanets(auto &bodies);
-    void DrawAllPlanetBillboards(auto &bodies);
+    void DrawAllPlanets(const Snapshot &snapshot);
+    void DrawAllPlanetBillboards(const Snapshot &snapshot);
 
-    void DrawTexturedPlanet(const glm::vec3 &object_pos, const entt::entity entity);
+    void DrawTexturedPlanet(const glm::vec3 &object_pos, const entt::entity entity, const Snapshot::Body &body,
+                            double seconds);
     void GetPlanetTexture(const entt::entity entity, bool &have_normal, bool &have_roughness, bool &have_province);
-    void DrawTerrainlessPlanet(const entt::entity &entity, glm::vec3 &object_pos);
+    void DrawTerrainlessPlanet(const Snapshot::Body &body, glm::vec3 &object_pos);
 
-    void DrawStar(const entt::entity &entity, glm::vec3 &object_pos);
-    void RenderCities(glm::vec3 &object_pos, const entt::entity &body_entity);
+    void DrawStar(const Snapshot::Body &body, glm::vec3 &object_pos);
+    void RenderCities(const Snapshot &snapshot, glm::vec3 &object_pos, const Snapshot::Body &body);
     bool CityIsVisible(glm::vec3 city_pos, glm::vec3 planet_pos, glm::vec3 cam_pos);
     void CalculateCityPositions();
     void CalculateScroll();
@@ -160,11 +174,14 @@ class SysStarSystemRenderer {
     /// </summary>
     /// <param name="axial">Axial rotation in radians</param>
     /// <param name="rotation">Rotation period in seconds</param>
-    glm::quat GetBodyRotation(double axial, double rotation, double day_offset);
+    /// <param name="seconds">The date in seconds</param>
+    glm::quat GetBodyRotation(double axial, double rotation, double day_offset, double seconds);
     void FocusCityView();
 
     glm::vec3 CalculateObjectPos(const entt::entity &);
+    glm::vec3 CalculateObjectPos(const Snapshot &, const entt::entity &);
     glm::vec3 CalculateCenteredObject(const entt::entity &);
+    glm::vec3 CalculateCenteredObject(const Snapshot::Body &);
     glm::vec3 CalculateCenteredObject(const glm::vec3 &);
     glm::vec3 TranslateToNormalized(const glm::vec3 &);
     glm::vec3 ConvertPoint(const glm::vec3 &);
@@ -16,33 +16,67 @@
  */
 #include "client/systems/savegame.h"
 
+#include <fmt/format.h>
+#include <spdlog/spdlog.h>
+
+#include <algorithm>
 #include <filesystem>
 #include <fstream>
+#include <memory>
+#include <stdexcept>
 #include <string>
+#include <utility>
+#include <vector>
 
 #include "common/components/name.h"
 #include "common/components/player.h"
 #include "common/util/paths.h"
 #include "common/util/save/save.h"
 
+namespace {
+std::string GetSaveName(cqsp::common::Universe& universe) {
+    entt::entity player = universe.view<cqsp::common::components::Player>().front();
+    auto& name = universe.get<cqsp::common::components::Identifier>(player);
+    return name.identifier + "_" + universe.uuid;
+}
+
+/// <summary>
+/// Writes a save into a folder. The universe is written to a temporary file first and then moved over the old
+/// one, so that a crash while saving leaves the previous save in the folder intact.
+/// </summary>
+bool WriteSave(const std::filesystem::path& path, const Hjson::Value& metadata, const std::vector<char>& data) {
+    std::filesystem::create_directories(path);
+    const std::string universe_path = cqsp::common::save::GetUniversePath(path.string());
+    const std::string temp_path = universe_path + ".tmp";
+    {
+        std::ofstream universe_file(temp_path, std::ios::binary | std::ios::trunc);
+        universe_file.write(data.data(), data.size());
+        if (!universe_file) {
+            SPDLOG_ERROR("Failed to write save to {}", path.string());
+            return false;
+        }
+    }
+    std::error_code error;
+    std::filesystem::rename(temp_path, universe_path, error);
+    if (error) {
+        SPDLOG_ERROR("Failed to write save to {}: {}", path.string(), error.message());
+        return false;
+    }
+    // The meta file is written last, because the load window only lists folders that have one
+    Hjson::MarshalToFile(metadata, cqsp::common::save::GetMetaPath(path.string()));
+    SPDLOG_INFO("Saved {} bytes to {}", data.size(), path.string());
+    return true;
+}
+}  // namespace
+
 void cqsp::client::save::save_game(common::Universe& universe) {
     std::string save_dir_path = common::util::GetCqspSavePath();
-    if (!std::filesystem::exists(save_dir_path)) std::filesystem::create_directories(save_dir_path);
 
     // Generate basic information
     common::save::Save save(universe);
-    Hjson::Value metadata = save.GetMetadata();
-    // Write to a file
-    entt::entity player = universe.view<common::components::Player>().front();
-    auto& name = universe.get<common::components::Identifier>(player);
     // Generate the folder
-    std::filesystem::path path = std::filesystem::path(save_dir_path) / (name.identifier + "_" + universe.uuid);
-    std::filesystem::create_directories(path);
-
-    // Generate the file
-    Hjson::MarshalToFile(save.GetMetadata(), common::save::GetMetaPath(path.string()));
-
-    // Then write other game information, however we do that.
+    std::filesystem::path path = std::filesystem::path(save_dir_path) / GetSaveName(universe);
+    WriteSave(path, save.GetMetadata(), save.SaveGame());
 }
 
 void cqsp::client::save::load_game(common::Universe& universe, std::string_view directory) {
@@ -50,4 +84,72 @@ void cqsp::client::save::load_game(common::Universe& universe, std::string_view
     // Load meta file
     Hjson::Value metadata = Hjson::UnmarshalFromFile(common::save::GetMetaPath(directory));
     load.LoadMetadata(metadata);
+
+    // Older saves only have the metadata
+    const std::string universe_path = common::save::GetUniversePath(directory);
+    if (!std::filesystem::exists(universe_path)) {
+        return;
+    }
+    std::ifstream universe_file(universe_path, std::ios::binary);
+    std::vector<char> data(std::filesystem::file_size(universe_path));
+    universe_file.read(data.data(), data.size());
+    if (!universe_file) {
+        SPDLOG_ERROR("Failed to read save {}", universe_path);
+        return;
+    }
+    try {
+        load.LoadGame(data.data(), data.size());
+    } catch (const std::runtime_error& error) {
+        SPDLOG_ERROR("Failed to load save {}: {}", universe_path, error.what());
+    }
+}
+
+cqsp::client::save::Autosaver::~Autosaver() {
+    if (worker.joinable()) {
+        worker.join();
+    }
+}
+
+bool cqsp::client::save::Autosaver::Save(common::Universe& universe) {
+    if (saving) {
+        return false;
+    }
+    if (worker.joinable()) {
+        worker.join();
+    }
+
+    // This is the only part that blocks the game. The storages are copied, and the copy is serialized and
+    // written on the worker.
+    common::save::Save save(universe);
+    Hjson::Value metadata = save.GetMetadata();
+    metadata["autosave"] = true;
+    std::unique_ptr<common::Universe> copy = save.Capture();
+    std::string path = GetSlotPath(GetSaveName(universe));
+
+    saving = true;
+    worker = std::thread([this, path = std::move(path), metadata = std::move(metadata), copy = std::move(copy)]() {
+        WriteSave(path, metadata, common::save::Save(*copy).SaveGame());
+        saving = false;
+    });
+    return true;
+}
+
+std::string cqsp::client::save::Autosaver::GetSlotPath(const std::string& save_name) const {
+    // Use the first empty slot, or the one that was written the longest time ago
+    std::filesystem::path save_dir_path = common::util::GetCqspSavePath();
+    std::filesystem::path oldest;
+    std::filesystem::file_time_type oldest_time = std::filesystem::file_time_type::max();
+    for (int slot = 0; slot < std::max(slots, 1); slot++) {
+        std::filesystem::path path = save_dir_path / fmt::format("{}_autosave_{}", save_name, slot);
+        std::error_code error;
+        const auto time = std::filesystem::last_write_time(common::save::GetMetaPath(path.string()), error);
+        if (error) {
+            return path.string();
+        }
+        if (time < oldest_time) {
+            oldest_time = time;
+            oldest = path;
+        }
+    }
+    return oldest.string();
 }
@@ -16,11 +16,39 @@
  */
 #pragma once
 
+#include <atomic>
+#include <string>
 #include <string_view>
+#include <thread>
 
 #include "common/universe.h"
 
 namespace cqsp::client::save {
 void save_game(common::Universe& universe);
 void load_game(common::Universe& universe, std::string_view directory);
+
+/// <summary>
+/// Saves the game in the background, rotating between a fixed number of autosave slots in the save folder.
+/// Only copying the component storages happens on the calling thread. The copy is serialized and written on
+/// a worker thread.
+/// </summary>
+class Autosaver {
+ public:
+    explicit Autosaver(int slots) : slots(slots) {}
+    ~Autosaver();
+
+    /// <summary>
+    /// Captures the universe and starts writing it to the oldest autosave slot. The universe must not be
+    /// ticking while this is called. Returns false without saving if the last autosave is still being written.
+    /// </summary>
+    bool Save(common::Universe& universe);
+    bool IsSaving() const { return saving; }
+
+ private:
+    std::string GetSlotPath(const std::string& save_name) const;
+
+    int slots;
+    std::thread worker;
+    std::atomic_bool saving = false;
+};
 }  // namespace cqsp::client::save
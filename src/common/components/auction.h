@@ -16,6 +16,7 @@
  */
 #pragma once
 
+#include <deque>
 #include <functional>
 #include <map>
 #include <vector>
@@ -66,30 +67,114 @@ typedef SortedOrderList<std::greater<Order>> DescendingSortedOrderList;
 /// </summary>
 typedef SortedOrderList<std::less<Order>> AscendingSortedOrderList;
 
+/// <summary>
+/// The orders on one side of the market for one good, grouped into price levels.
+/// </summary>
+/// The levels are kept best price first, and the orders in a level are kept in the order they were placed, so
+/// orders at the same price are filled first come, first served. Adding an order is O(log levels), the best
+/// order is always at the front, and the total quantity is kept up to date as orders are added and filled.
+template <class Compare>
+class OrderBook {
+ public:
+    struct PriceLevel {
+        std::deque<Order> orders;
+        double quantity = 0;
+    };
+    using LevelMap = std::map<double, PriceLevel, Compare>;
+
+    void put(const Order& order) {
+        PriceLevel& level = levels[order.price];
+        level.orders.push_back(order);
+        level.quantity += order.quantity;
+        quantity += order.quantity;
+        count++;
+    }
+
+    /// <summary>
+    /// The oldest order at the best price
+    /// </summary>
+    const Order& front() const { return levels.begin()->second.orders.front(); }
+    double BestPrice() const { return levels.begin()->first; }
+
+    /// <summary>
+    /// Takes amount out of the front order, and removes the order once nothing is left in it
+    /// </summary>
+    void Fill(double amount) {
+        PriceLevel& level = levels.begin()->second;
+        Order& order = level.orders.front();
+        order.quantity -= amount;
+        level.quantity -= amount;
+        quantity -= amount;
+        if (order.quantity <= 0) {
+            pop_front();
+        }
+    }
+
+    void pop_front() {
+        auto level = levels.begin();
+        const double order_quantity = level->second.orders.front().quantity;
+        level->second.quantity -= order_quantity;
+        quantity -= order_quantity;
+        level->second.orders.pop_front();
+        if (level->second.orders.empty()) {
+            levels.erase(level);
+        }
+        count--;
+        if (count == 0) {
+            // Don't let rounding leave quantity behind in an empty book
+            quantity = 0;
+        }
+    }
+
+    void clear() {
+        levels.clear();
+        quantity = 0;
+        count = 0;
+    }
+
+    bool empty() const { return count == 0; }
+    /// <summary>
+    /// Number of orders in the book
+    /// </summary>
+    size_t size() const { return count; }
+    /// <summary>
+    /// Sum of the quantity of every order in the book
+    /// </summary>
+    double GetQuantity() const { return quantity; }
+    const LevelMap& GetLevels() const { return levels; }
+
+ private:
+    LevelMap levels;
+    double quantity = 0;
+    size_t count = 0;
+};
+
+/// <summary>
+/// Sell orders, cheapest first
+/// </summary>
+typedef OrderBook<std::less<double>> AskOrderBook;
+
+/// <summary>
+/// Buy orders, highest bid first
+/// </summary>
+typedef OrderBook<std::greater<double>> BidOrderBook;
+
 struct AuctionHouse {
-    std::map<entt::entity, DescendingSortedOrderList> sell_orders;
-    std::map<entt::entity, AscendingSortedOrderList> buy_orders;
+    std::map<entt::entity, AskOrderBook> sell_orders;
+    std::map<entt::entity, BidOrderBook> buy_orders;
 
     void AddSellOrder(entt::entity good, Order&& order) { sell_orders[good].put(order); }
 
     void AddBuyOrder(entt::entity good, Order&& order) { buy_orders[good].put(order); }
 
-    double GetDemand(entt::entity good) {
-        const AscendingSortedOrderList& buy_list = buy_orders[good];
-        double demand = 0;
-        for (const Order& order : buy_list) {
-            demand += order.quantity;
-        }
-        return demand;
+    double GetDemand(entt::entity good) const {
+        auto it = buy_orders.find(good);
+        return it == buy_orders.end() ? 0 : it->second.GetQuantity();
     }
 
-    double GetSupply(entt::entity good) {
-        const DescendingSortedOrderList& sell_list = sell_orders[good];
-        double supply = 0;
-        for (const Order& order : sell_list) {
-            supply += order.quantity;
-        }
-        return supply;
+    double GetSupply(entt::entity good) const {
+        auto it = sell_orders.find(good);
+        return it == sell_orders.end() ? 0 : it->second.GetQuantity();
     }
 };
 }  // namespace components
@@ -66,6 +66,7 @@ typedef PolarCoordinate_tp<types::astronomical_unit> PolarCoordinate;
 
 struct MoveTarget {
     entt::entity target;
+    MoveTarget() = default;
     explicit MoveTarget(entt::entity _targetent) : target(_targetent) {}
 };
 
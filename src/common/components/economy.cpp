@@ -16,6 +16,9 @@
  */
 #include "common/components/economy.h"
 
+#include <cmath>
+
+using cqsp::common::components::GoodIndex;
 using cqsp::common::components::Market;
 using cqsp::common::components::ResourceStockpile;
 
@@ -58,3 +61,54 @@ double Market::GetSupply(const entt::entity& good) { return market_information[g
 double Market::GetDemand(const entt::entity& good) { return market_information[good].demand; }
 
 double Market::GetPrice(const entt::entity& good) { return market_information[good].price; }
+
+namespace {
+/// <summary>
+/// Adds the steps that SysMarket takes for a good without supply, `price += 0.02 + price * 0.01`. The step
+/// is affine, so after n of them the price is (price + 0.02 / 0.01) * 1.01^n - 0.02 / 0.01.
+/// </summary>
+double DriftPrice(double price, double runs) {
+    // The same numbers as SysMarket, float included
+    constexpr double rate = 0.01f;
+    constexpr double step = 0.02;
+    return (price + step / rate) * std::pow(1 + rate, runs) - step / rate;
+}
+}  // namespace
+
+double Market::SettledPrice(uint32_t index) const {
+    if (!price.HasIndex(index)) {
+        return 0;
+    }
+    const double missed = pricing_runs - priced_run.Get(index);
+    return missed > 0 ? DriftPrice(price.Get(index), missed) : price.Get(index);
+}
+
+double Market::SettledPrice(entt::entity good) const {
+    const uint32_t index = GoodIndex::Find(good);
+    return index == GoodIndex::null ? 0 : SettledPrice(index);
+}
+
+double& Market::SettlePrice(uint32_t index) {
+    double& run = priced_run.At(index);
+    if (!price.HasIndex(index)) {
+        // A new price doesn't have any steps to catch up on
+        run = pricing_runs;
+        return price.At(index);
+    }
+    double& value = price.At(index);
+    if (run < pricing_runs) {
+        value = DriftPrice(value, pricing_runs - run);
+        run = pricing_runs;
+    }
+    return value;
+}
+
+void Market::SettlePrices() {
+    for (auto& [good, value] : price) {
+        double& run = priced_run[good];
+        if (run < pricing_runs) {
+            value = DriftPrice(value, pricing_runs - run);
+            run = pricing_runs;
+        }
+    }
+}
@@ -25,6 +25,11 @@
 
 #include "common/components/resource.h"
 
+namespace cqsp::common::save {
+template <typename T, typename Enable>
+struct Serializer;
+}  // namespace cqsp::common::save
+
 namespace cqsp {
 namespace common {
 namespace components {
@@ -71,8 +76,6 @@ struct MarketElementInformation {
 struct PlanetaryMarket {};
 
 struct Market : MarketInformation {
-    std::vector<MarketInformation> history;
-
     std::map<entt::entity, MarketElementInformation> market_information;
     std::map<entt::entity, MarketElementInformation> last_market_information;
 
@@ -81,6 +84,11 @@ struct Market : MarketInformation {
 
     double GDP = 0;
 
+    // Number of times SysMarket has priced this market
+    int pricing_runs = 0;
+    // The value of pricing_runs that each price in `price` is up to, see SettledPrice
+    ResourceLedger priced_run;
+
     // Math
     void AddSupply(const ResourceLedger& stockpile);
     void AddSupply(const ResourceLedger& stockpile, double multiplier);
@@ -93,6 +101,24 @@ struct Market : MarketInformation {
     double GetSupply(const entt::entity& good);
     double GetDemand(const entt::entity& good);
 
+    /// <summary>
+    /// Every time SysMarket runs, the price of each good that nobody traded goes up by the same step. SysMarket
+    /// only prices the goods that were traded, and the other prices catch up on the steps that they missed all
+    /// at once, when they are next used.
+    /// </summary>
+    /// <returns>The price of the good with the steps that it missed, or 0 if it has no price</returns>
+    double SettledPrice(uint32_t index) const;
+    double SettledPrice(entt::entity good) const;
+    /// <summary>
+    /// Adds the steps that the price of the good missed to its price, and returns the price
+    /// </summary>
+    double& SettlePrice(uint32_t index);
+    double& SettlePrice(entt::entity good) { return SettlePrice(GoodIndex::Find(good)); }
+    /// <summary>
+    /// Settles every price, for code that uses the whole price ledger
+    /// </summary>
+    void SettlePrices();
+
     void AddParticipant(entt::entity participant) { participants.insert(participant); }
 
     MarketElementInformation& operator[](entt::entity ent) { return market_information[ent]; }
@@ -128,7 +154,7 @@ struct Currency {};
 /// <summary>
 ///  Records the prices of goods and other things
 /// </summary>
-struct CostTable : public ResourceLedger {};
+struct CostTable : public LedgerComponent {};
 
 // TODO(EhWhoAmI): Add multiple currency support
 struct Wallet {
@@ -181,6 +207,9 @@ struct Wallet {
     double GetGDPChange() { return GDP_change; }
 
  private:
+    template <typename T, typename Enable>
+    friend struct save::Serializer;
+
     double balance = 0;
     double change = 0;
     // Only records when spending money, so when money decreases
@@ -0,0 +1,177 @@
+/* Conquer Space
+ * Copyright (C) 2021-2023 Conquer Space
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#include "common/components/history.h"
+
+#include <algorithm>
+
+#include "common/components/economy.h"
+#include "common/components/resource.h"
+
+namespace cqsp::common::components {
+namespace {
+constexpr size_t metric_count = static_cast<size_t>(MarketMetric::Count);
+
+const ResourceLedger& GetLedger(const Market& market, MarketMetric metric) {
+    // The market moves supply and demand to the previous ledgers at the end of its tick
+    switch (metric) {
+        case MarketMetric::Price:
+            return market.price;
+        case MarketMetric::Supply:
+            return market.previous_supply;
+        case MarketMetric::Demand:
+            return market.previous_demand;
+        case MarketMetric::SDRatio:
+            return market.sd_ratio;
+        case MarketMetric::Volume:
+        default:
+            return market.volume;
+    }
+}
+}  // namespace
+
+HistoryTier::HistoryTier(size_t capacity, int merge) : capacity(std::max<size_t>(capacity, 1)), merge(merge) {
+    gdp.resize(this->capacity);
+    dates.resize(this->capacity);
+}
+
+void HistoryTier::Push(int date, const double* row, double sample_gdp) {
+    for (size_t column = 0; column < metric_count * goods; column++) {
+        columns[column * capacity + head] = row[column];
+    }
+    gdp[head] = sample_gdp;
+    dates[head] = date;
+    head = (head + 1) % capacity;
+    size = std::min(size + 1, capacity);
+}
+
+void HistoryTier::Resize(uint32_t new_goods) {
+    // Columns are only ever added at the end, so the column of a good stays the same
+    std::vector<double> resized(metric_count * new_goods * capacity, 0.0);
+    std::vector<double> resized_pending(metric_count * new_goods, 0.0);
+    for (size_t metric = 0; metric < metric_count; metric++) {
+        for (uint32_t good = 0; good < std::min(goods, new_goods); good++) {
+            std::copy_n(columns.begin() + (metric * goods + good) * capacity, capacity,
+                        resized.begin() + (metric * new_goods + good) * capacity);
+            if (!pending.empty()) {
+                resized_pending[metric * new_goods + good] = pending[metric * goods + good];
+            }
+        }
+    }
+    columns = std::move(resized);
+    pending = std::move(resized_pending);
+    goods = new_goods;
+}
+
+MarketHistory::MarketHistory(size_t daily, size_t weekly, size_t monthly) {
+    tiers[static_cast<size_t>(HistoryResolution::Daily)] = HistoryTier(daily, 1);
+    tiers[static_cast<size_t>(HistoryResolution::Weekly)] = HistoryTier(weekly, 7);
+    tiers[static_cast<size_t>(HistoryResolution::Monthly)] = HistoryTier(monthly, 4);
+}
+
+void MarketHistory::AddColumn(uint32_t good_index) {
+    if (good_index >= column_of.size()) {
+        column_of.resize(good_index + 1, null_column);
+    }
+    column_of[good_index] = static_cast<uint32_t>(goods.size());
+    goods.push_back(good_index);
+}
+
+void MarketHistory::AddTradedGoods(const Market& market) {
+    const uint32_t columns = ColumnCount();
+    // Prices are kept for every good, so they don't say if the market deals in the good
+    for (const ResourceLedger* ledger :
+         {&market.previous_supply, &market.previous_demand, &market.sd_ratio, &market.volume}) {
+        for (const auto& [good, amount] : *ledger) {
+            const uint32_t good_index = GoodIndex::Find(good);
+            if (good_index != GoodIndex::null && FindColumn(good_index) == null_column) {
+                AddColumn(good_index);
+            }
+        }
+    }
+    if (ColumnCount() != columns) {
+        for (HistoryTier& tier : tiers) {
+            tier.Resize(ColumnCount());
+        }
+    }
+}
+
+void MarketHistory::Record(int date, const Market& market, double gdp) {
+    AddTradedGoods(market);
+
+    const uint32_t columns = ColumnCount();
+    row.resize(metric_count * columns);
+    for (size_t metric = 0; metric < metric_count; metric++) {
+        double* values = row.data() + metric * columns;
+        if (static_cast<MarketMetric>(metric) == MarketMetric::Price) {
+            // Prices of goods that weren't traded are behind until they are used
+            for (uint32_t column = 0; column < columns; column++) {
+                values[column] = market.SettledPrice(goods[column]);
+            }
+            continue;
+        }
+        const ResourceLedger& ledger = GetLedger(market, static_cast<MarketMetric>(metric));
+        for (uint32_t column = 0; column < columns; column++) {
+            values[column] = ledger.Get(goods[column]);
+        }
+    }
+    tiers[0].Push(date, row.data(), gdp);
+
+    // Merge into the lower resolutions
+    double sample_gdp = gdp;
+    for (size_t i = 1; i < std::size(tiers); i++) {
+        HistoryTier& tier = tiers[i];
+        for (size_t column = 0; column < row.size(); column++) {
+            tier.pending[column] += row[column];
+        }
+        tier.pending_gdp += sample_gdp;
+        if (++tier.pending_count < tier.merge) {
+            break;
+        }
+        for (size_t column = 0; column < row.size(); column++) {
+            row[column] = tier.pending[column] / tier.merge;
+        }
+        sample_gdp = tier.pending_gdp / tier.merge;
+        tier.Push(date, row.data(), sample_gdp);
+        std::fill(tier.pending.begin(), tier.pending.end(), 0.0);
+        tier.pending_gdp = 0;
+        tier.pending_count = 0;
+    }
+}
+
+uint32_t MarketHistory::FindColumn(entt::entity good) const {
+    const uint32_t good_index = GoodIndex::Find(good);
+    return good_index == GoodIndex::null ? null_column : FindColumn(good_index);
+}
+
+double MarketHistory::Latest(MarketMetric metric, entt::entity good) const {
+    return Latest(metric, GoodIndex::Find(good));
+}
+
+double MarketHistory::Latest(MarketMetric metric, uint32_t good_index) const {
+    const HistoryTier& daily = tiers[0];
+    const uint32_t column = FindColumn(good_index);
+    if (daily.Empty() || column == null_column) {
+        return 0;
+    }
+    return daily.Get(metric, column, daily.Size() - 1);
+}
+
+double MarketHistory::LatestGDP() const {
+    const HistoryTier& daily = tiers[0];
+    return daily.Empty() ? 0 : daily.GetGDP(daily.Size() - 1);
+}
+}  // namespace cqsp::common::components
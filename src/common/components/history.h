@@ -16,25 +16,159 @@
  */
 #pragma once
 
-#include <map>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
 #include <vector>
 
 #include <entt/entt.hpp>
 
+namespace cqsp::common::save {
+template <typename T, typename Enable>
+struct Serializer;
+}  // namespace cqsp::common::save
+
 namespace cqsp {
 namespace common {
 namespace components {
+struct Market;
+
+/// <summary>
+/// The values that the market history records for every good.
+/// </summary>
+enum class MarketMetric : uint8_t { Price, Supply, Demand, SDRatio, Volume, Count };
+
+/// <summary>
+/// The resolutions that the market history is kept at. Each resolution holds the average of the samples
+/// of the resolution before it, so a weekly sample is the average of 7 daily samples, and a monthly sample
+/// is the average of 4 weekly samples.
+/// </summary>
+enum class HistoryResolution : uint8_t { Daily, Weekly, Monthly, Count };
+
+/// <summary>
+/// A fixed size ring buffer of market samples at one resolution.
+/// </summary>
+/// The values are stored by column, one contiguous column per metric and good, so reading the series of
+/// one good doesn't touch any of the other goods. Columns are numbered by MarketHistory::FindColumn.
+class HistoryTier {
+ public:
+    HistoryTier() = default;
+    /// <param name="capacity">Number of samples kept before the oldest sample is overwritten</param>
+    /// <param name="merge">Number of samples of the previous resolution that are averaged into one sample</param>
+    HistoryTier(size_t capacity, int merge);
+
+    size_t Capacity() const { return capacity; }
+    size_t Size() const { return size; }
+    bool Empty() const { return size == 0; }
+    int Merge() const { return merge; }
+
+    /// <summary>
+    /// The date of the sample, where 0 is the oldest sample that is still kept.
+    /// </summary>
+    int GetDate(size_t sample) const { return dates[Slot(sample)]; }
+    /// <param name="column">Column of the good, see MarketHistory::FindColumn</param>
+    double Get(MarketMetric metric, uint32_t column, size_t sample) const {
+        return columns[Column(metric, column) + Slot(sample)];
+    }
+    double GetGDP(size_t sample) const { return gdp[Slot(sample)]; }
+
+ private:
+    friend class MarketHistory;
+    template <typename T, typename Enable>
+    friend struct save::Serializer;
+
+    size_t Slot(size_t sample) const { return (head + capacity - size + sample) % capacity; }
+    size_t Column(MarketMetric metric, uint32_t column) const {
+        return (static_cast<size_t>(metric) * goods + column) * capacity;
+    }
+    /// <summary>
+    /// Adds a sample, where `row` has `goods` values for every metric, in the order of MarketMetric.
+    /// </summary>
+    void Push(int date, const double* row, double sample_gdp);
+    /// <summary>
+    /// Changes the number of goods, keeping the samples of the goods that are already recorded.
+    /// </summary>
+    void Resize(uint32_t new_goods);
+
+    std::vector<double> columns;
+    std::vector<double> gdp;
+    std::vector<int> dates;
+    size_t capacity = 0;
+    size_t head = 0;
+    size_t size = 0;
+    uint32_t goods = 0;
+    int merge = 1;
+
+    // Samples of the previous resolution that haven't been merged into a sample yet
+    std::vector<double> pending;
+    double pending_gdp = 0;
+    int pending_count = 0;
+};
+
 /// <summary>
 /// Records the history of market.
 /// </summary>
+/// The history takes the same amount of memory no matter how long the game runs: it keeps the last
+/// couple of months daily, the last year weekly, and the last decade monthly. Only goods that the market has
+/// supplied, demanded or traded get a column, from the first sample they were traded in, so a market pays for
+/// the goods it deals in rather than for every good in the game. With the default sizes each good costs
+/// 5 metrics * 232 samples * 8 bytes, about 9 KB, so a market that trades 20 goods keeps about 185 KB.
 class MarketHistory {
  public:
-    std::map<entt::entity, std::vector<double>> price_history;
-    std::map<entt::entity, std::vector<double>> sd_ratio;
-    std::map<entt::entity, std::vector<double>> supply;
-    std::map<entt::entity, std::vector<double>> demand;
-    std::map<entt::entity, std::vector<double>> volume;
-    std::vector<double> gdp;
+    static constexpr size_t default_daily = 60;
+    static constexpr size_t default_weekly = 52;
+    static constexpr size_t default_monthly = 120;
+    static constexpr uint32_t null_column = std::numeric_limits<uint32_t>::max();
+
+    MarketHistory() : MarketHistory(default_daily, default_weekly, default_monthly) {}
+    MarketHistory(size_t daily, size_t weekly, size_t monthly);
+
+    /// <summary>
+    /// Records the current state of the market, and merges samples into the lower resolutions when
+    /// enough of them have been recorded.
+    /// </summary>
+    void Record(int date, const Market& market, double gdp);
+
+    const HistoryTier& GetTier(HistoryResolution resolution) const {
+        return tiers[static_cast<size_t>(resolution)];
+    }
+
+    /// <returns>The column of the good in the tiers, or null_column if it hasn't been recorded</returns>
+    uint32_t FindColumn(entt::entity good) const;
+    /// <param name="good_index">GoodIndex of the good</param>
+    uint32_t FindColumn(uint32_t good_index) const {
+        return good_index < column_of.size() ? column_of[good_index] : null_column;
+    }
+    /// <summary>
+    /// Number of goods that have a column.
+    /// </summary>
+    uint32_t ColumnCount() const { return static_cast<uint32_t>(goods.size()); }
+
+    /// <summary>
+    /// The value of the latest daily sample, or 0 if nothing is recorded for the good.
+    /// </summary>
+    double Latest(MarketMetric metric, entt::entity good) const;
+    /// <param name="good_index">GoodIndex of the good</param>
+    double Latest(MarketMetric metric, uint32_t good_index) const;
+    double LatestGDP() const;
+
+ private:
+    template <typename T, typename Enable>
+    friend struct save::Serializer;
+
+    /// <summary>
+    /// Gives the goods that the market traded since the last sample a column.
+    /// </summary>
+    void AddTradedGoods(const Market& market);
+    void AddColumn(uint32_t good_index);
+
+    HistoryTier tiers[static_cast<size_t>(HistoryResolution::Count)];
+    // GoodIndex of the good in each column
+    std::vector<uint32_t> goods;
+    // Column of each good, by GoodIndex, null_column for goods without one
+    std::vector<uint32_t> column_of;
+    // Reused for building a sample
+    std::vector<double> row;
 };
 }  // namespace components
 }  // namespace common
@@ -19,6 +19,7 @@
 #include <algorithm>
 #include <cassert>
 #include <iostream>
+#include <limits>
 
 #include <glm/gtc/quaternion.hpp>
 #include <glm/gtx/projection.hpp>
@@ -170,6 +171,28 @@ glm::dvec3 OrbitVelocityToVec3(const Orbit& orb, double v) {
 
 glm::dvec3 OrbitVelocityToVec3(const Orbit& orb) { return OrbitVelocityToVec3(orb, orb.v); }
 
+OrbitCache::OrbitCache(const Orbit& orbit) : eccentricity(orbit.eccentricity) {
+    rotation = glm::dmat3(ConvertOrbParams(orbit.LAN, orbit.inclination, orbit.w, glm::dvec3(1, 0, 0)),
+                          ConvertOrbParams(orbit.LAN, orbit.inclination, orbit.w, glm::dvec3(0, 1, 0)),
+                          ConvertOrbParams(orbit.LAN, orbit.inclination, orbit.w, glm::dvec3(0, 0, 1)));
+    if (orbit.semi_major_axis == 0) {
+        return;
+    }
+    mean_motion = orbit.nu();
+    semi_param = orbit.semi_major_axis * (1 - orbit.eccentricity * orbit.eccentricity);
+    velocity_scale = sqrt(orbit.GM / semi_param);
+}
+
+glm::dvec3 OrbitCache::Position(radian v) const {
+    const double cos_v = cos(v);
+    const double sin_v = sin(v);
+    return semi_param / (1 + eccentricity * cos_v) * (cos_v * rotation[0] + sin_v * rotation[1]);
+}
+
+glm::dvec3 OrbitCache::Velocity(radian v) const {
+    return velocity_scale * (-sin(v) * rotation[0] + (eccentricity + cos(v)) * rotation[1]);
+}
+
 double SolveKeplerElliptic(const double& mean_anomaly, const double& ecc, const int steps) {
     if (abs(ecc) < 1.0E-9) {
         return mean_anomaly;
@@ -190,6 +213,28 @@ double SolveKeplerElliptic(const double& mean_anomaly, const double& ecc, const
     return ea;
 }
 
+void SolveKeplerEllipticBatch(const double* __restrict mean_anomaly, const double* __restrict ecc,
+                              double* __restrict eccentric_anomaly, size_t count) {
+    // Halley's method converges cubically from Danby's guess, 6 steps is at double precision even for
+    // eccentricities close to 1
+    constexpr int iterations = 6;
+    for (size_t i = 0; i < count; i++) {
+        const double M = mean_anomaly[i];
+        const double e = ecc[i];
+        const double sin_M = sin(M);
+        double E = M + 0.85 * e * ((sin_M > 0) - (sin_M < 0));
+        for (int it = 0; it < iterations; it++) {
+            const double sin_E = sin(E);
+            const double cos_E = cos(E);
+            const double f = E - e * sin_E - M;
+            const double df = 1.0 - e * cos_E;
+            const double ddf = e * sin_E;
+            E -= 2 * f * df / (2 * df * df - f * ddf);
+        }
+        eccentric_anomaly[i] = E;
+    }
+}
+
 double SolveKeplerHyperbolic(const double& mean_anomaly, const double& ecc, const int steps) {
     if (abs(ecc) < 1.0E-9) {
         return mean_anomaly;
@@ -261,6 +306,80 @@ radian EccentricAnomaly(double v, double e) { return 2 * atan(tan(v / 2) * sqrt(
 
 radian HyperbolicAnomaly(double v, double e) { return 2 * atanh(tan(v / 2) * sqrt((e - 1) / (e + 1))); }
 
+namespace {
+/// <summary>
+/// Mean anomaly of the outbound point where the orbit is radius from the body it orbits.
+/// The radius has to be between the periapsis and apoapsis.
+/// </summary>
+double MeanAnomalyAtRadius(const Orbit& orbit, double radius) {
+    const double e = orbit.eccentricity;
+    const double p = orbit.semi_major_axis * (1 - e * e);
+    const double v = std::acos(std::clamp((p / radius - 1) / e, -1., 1.));
+    if (e < 1) {
+        const double E = EccentricAnomaly(v, e);
+        return E - e * sin(E);
+    }
+    const double H = HyperbolicAnomaly(v, e);
+    return e * sinh(H) - H;
+}
+}  // namespace
+
+double TimeToLeaveRadius(const Orbit& orbit, double radius, second time) {
+    constexpr double never = std::numeric_limits<double>::infinity();
+    if (orbit.semi_major_axis == 0) {
+        return never;
+    }
+    if (orbit.GetPeriapsis() > radius) {
+        return 0;
+    }
+    if (orbit.eccentricity < 1) {
+        if (orbit.GetApoapsis() <= radius) {
+            return never;
+        }
+        // Outside between the two crossings, which are symmetric around the periapsis
+        const double M_cross = MeanAnomalyAtRadius(orbit, radius);
+        const double M = orbit.GetMtElliptic(time);
+        if (M > M_cross && M < TWOPI - M_cross) {
+            return 0;
+        }
+        return normalize_radian(M_cross - M) / orbit.nu();
+    }
+    const double M_cross = MeanAnomalyAtRadius(orbit, radius);
+    const double M = GetMtHyperbolic(orbit.M0, orbit.nu(), time, orbit.epoch);
+    if (std::abs(M) > M_cross) {
+        return 0;
+    }
+    return (M_cross - M) / orbit.nu();
+}
+
+double TimeToEnterRadius(const Orbit& orbit, double radius, second time) {
+    constexpr double never = std::numeric_limits<double>::infinity();
+    if (orbit.semi_major_axis == 0 || orbit.GetPeriapsis() >= radius) {
+        return never;
+    }
+    if (orbit.eccentricity < 1) {
+        if (orbit.GetApoapsis() < radius) {
+            return 0;
+        }
+        const double M_cross = MeanAnomalyAtRadius(orbit, radius);
+        const double M = orbit.GetMtElliptic(time);
+        if (M < M_cross || M > TWOPI - M_cross) {
+            return 0;
+        }
+        return (TWOPI - M_cross - M) / orbit.nu();
+    }
+    const double M_cross = MeanAnomalyAtRadius(orbit, radius);
+    const double M = GetMtHyperbolic(orbit.M0, orbit.nu(), time, orbit.epoch);
+    if (std::abs(M) < M_cross) {
+        return 0;
+    }
+    if (M > M_cross) {
+        // Already past the periapsis and moving away
+        return never;
+    }
+    return (-M_cross - M) / orbit.nu();
+}
+
 void UpdateOrbit(Orbit& orb, const second& time) {
     // Get the thingy
     if (orb.eccentricity < 1) {
@@ -326,6 +445,12 @@ glm::dvec3 OrbitTimeToVec3(const Orbit& orb, const second& time) {
     return toVec3(orb, v);
 }
 
+glm::dvec3 OrbitTimeToVec3(const Orbit& orb, const OrbitCache& cache, const second& time) {
+    double E = 0;
+    const double v = orb.eccentricity < 1 ? TrueAnomalyElliptic(orb, time, E) : TrueAnomalyHyperbolic(orb, time);
+    return cache.Position(v);
+}
+
 double CalculateTransferTime(const Orbit& orb1, const Orbit& orb2) {
     kilometer transfer_sma = (orb1.semi_major_axis + orb2.semi_major_axis) / 2;
     double e = 1 - orb1.semi_major_axis / transfer_sma;  // Assume it's circular for now
@@ -18,6 +18,8 @@
 
 #include <math.h>
 
+#include <cstddef>
+
 #include <entt/entt.hpp>
 #include <glm/glm.hpp>
 
@@ -153,6 +155,35 @@ struct SetTrueAnomaly {
     double true_anomaly;
 };
 
+/// <summary>
+/// Constants derived from the elements of an orbit, so that positions and velocities on it don't have to rebuild
+/// the rotation into the parent frame and the square roots every time. SysOrbit rebuilds it when the orbit is
+/// created or marked with DirtyOrbit.
+/// </summary>
+struct OrbitCache {
+    // Rotates from the orbital plane to the parent frame. The columns point to the periapsis, 90 degrees ahead of
+    // it, and along the orbit normal.
+    glm::dmat3 rotation = glm::dmat3(1);
+    double eccentricity = 0;
+    double mean_motion = 0;
+    // Semi latus rectum, 0 for orbits that have no size, such as crashed ships
+    double semi_param = 0;
+    // sqrt(GM/p)
+    double velocity_scale = 0;
+
+    OrbitCache() = default;
+    explicit OrbitCache(const Orbit& orbit);
+
+    /// <summary>
+    /// Same as toVec3, relative to the parent
+    /// </summary>
+    glm::dvec3 Position(radian v) const;
+    /// <summary>
+    /// Same as OrbitVelocityToVec3
+    /// </summary>
+    glm::dvec3 Velocity(radian v) const;
+};
+
 /// <summary>
 /// Transforms a vector to the orbital plane vector
 /// </summary>
@@ -250,6 +281,18 @@ glm::dvec3 OrbitVelocityToVec3(const Orbit& orb);
 /// <returns>Eccentric anomaly (E)goog</returns>
 double SolveKeplerElliptic(const double& mean_anomaly, const double& ecc, const int steps = 200);
 
+/// <summary>
+/// Computes the eccentric anomaly of many elliptic orbits at once. Starts from Danby's guess and does a fixed
+/// number of Halley steps instead of iterating to a tolerance, so every element does the same work and the
+/// loop can be vectorized. That is enough to converge to double precision for any eccentricity below 1.
+/// </summary>
+/// <param name="mean_anomaly">Mean anomalies, normalized to [0, 2pi)</param>
+/// <param name="ecc">Eccentricities, must be below 1</param>
+/// <param name="eccentric_anomaly">Output, can't overlap the inputs</param>
+/// <param name="count">Number of orbits</param>
+void SolveKeplerEllipticBatch(const double* mean_anomaly, const double* ecc, double* eccentric_anomaly,
+                              size_t count);
+
 /// <summary>
 /// Computes eccentric anomaly for a hyperbolic or parabolic orbit (e > 1)
 /// in radians given mean anomaly and eccentricity
@@ -304,6 +347,18 @@ radian TrueAnomalyHyperbolic(const Orbit& orbit, const second& time);
 /// <returns></returns>
 radian EccentricAnomaly(double v, double e);
 radian HyperbolicAnomaly(double v, double e);
+
+/// <summary>
+/// Time from time until the orbit is first further than radius from the body it orbits
+/// </summary>
+/// <returns>Seconds, 0 if it is already further, or infinity if the orbit never gets that far</returns>
+double TimeToLeaveRadius(const Orbit& orbit, double radius, second time);
+
+/// <summary>
+/// Time from time until the orbit is first closer than radius to the body it orbits
+/// </summary>
+/// <returns>Seconds, 0 if it is already closer, or infinity if the orbit never gets that close</returns>
+double TimeToEnterRadius(const Orbit& orbit, double radius, second time);
 /// <summary>
 /// Convert orbit to AU coordinates
 /// </summary>
@@ -338,6 +393,10 @@ inline glm::dvec3 toVec3(const Orbit& orb, radian theta) {
 }
 
 glm::dvec3 OrbitTimeToVec3(const Orbit& orb, const second& time);
+/// <summary>
+/// Same as OrbitTimeToVec3, using the rotation and constants of the orbit that were already computed
+/// </summary>
+glm::dvec3 OrbitTimeToVec3(const Orbit& orb, const OrbitCache& cache, const second& time);
 
 inline glm::dvec3 toVec3(const Orbit& orb) { return toVec3(orb, orb.v); }
 /// <summary>
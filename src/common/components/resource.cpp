@@ -19,71 +19,31 @@
 #include <spdlog/spdlog.h>
 
 #include <algorithm>
+#include <cstring>
 #include <limits>
-#include <ranges>
+#include <memory>
+#include <new>
 #include <utility>
 
 namespace cqsp::common::components {
 namespace {
 using cqsp::common::components::ResourceLedger;
-template <class Function>
-ResourceLedger merge_apply(const ResourceLedger &m1, const ResourceLedger &m2, ResourceLedger::mapped_type identity,
-                           Function func) {
-    auto it1 = m1.begin();
-    auto it2 = m2.begin();
-
-    auto comp = m1.value_comp();
-    ResourceLedger res;
-    while (true) {
-        bool end1 = it1 == m1.end();
-        bool end2 = it2 == m2.end();
-        if (end1 && end2) break;
-
-        if (end2 || (!end1 && comp(*it1, *it2))) {
-            res.emplace(it1->first, func(it1->second, identity));
-            ++it1;
-            continue;
-        }
-        if (end1 || comp(*it2, *it1)) {
-            res.emplace(it2->first, func(identity, it2->second));
-            ++it2;
-            continue;
-        }
-        res.emplace(it1->first, func(it1->second, it2->second));
-        ++it1;
-        ++it2;
-    }
-    return res;
-}
 
+/// <summary>
+/// Applies func to every value that is in either ledger, with missing values set to identity, and returns
+/// true if func returned true for all of them.
+/// </summary>
 template <class Function>
 bool MergeCompare(const ResourceLedger &m1, const ResourceLedger &m2, ResourceLedger::mapped_type identity,
                   Function func) {
-    auto it1 = m1.begin();
-    auto it2 = m2.begin();
-
-    auto comp = m1.value_comp();
     bool op = true;
-    while (true) {
-        bool end1 = it1 == m1.end();
-        bool end2 = it2 == m2.end();
-        if (end1 && end2) break;
-
-        if (end2 || (!end1 && comp(*it1, *it2))) {
-            // Compare
-            op &= func(it1->second, identity);
-            ++it1;
-            continue;
-        }
-        if (end1 || comp(*it2, *it1)) {
-            // Compare
-            op &= func(identity, it2->second);
-            ++it2;
-            continue;
+    for (auto it = m1.begin(); it != m1.end(); ++it) {
+        op &= func(it->second, m2.HasGood(it->first) ? m2[it->first] : identity);
+    }
+    for (auto it = m2.begin(); it != m2.end(); ++it) {
+        if (!m1.HasGood(it->first)) {
+            op &= func(identity, it->second);
         }
-        op &= func(it1->second, it2->second);
-        ++it1;
-        ++it2;
     }
     return op;
 }
@@ -91,16 +51,198 @@ bool MergeCompare(const ResourceLedger &m1, const ResourceLedger &m2, ResourceLe
 
 using cqsp::common::components::ResourceLedger;
 
+uint32_t GoodIndex::Register(entt::entity entity) {
+    const uint32_t found = Find(entity);
+    if (found != null) {
+        return found;
+    }
+    std::scoped_lock lock(mutex);
+    // Another thread could have registered it while this was waiting for the lock
+    const auto id = static_cast<size_t>(entt::to_entity(entity));
+    const uint32_t current = Load(indices, id, null);
+    if (current != null && Entity(current) == entity) {
+        return current;
+    }
+    const uint32_t index = count.load(std::memory_order_relaxed);
+    if (index / page_size >= max_pages) {
+        SPDLOG_CRITICAL("Ran out of good indices registering entity {}", entt::to_integral(entity));
+        return null;
+    }
+    // The entity has to be stored before the index is, so that Find never sees an index without its entity
+    Store(entities, index, entt::to_integral(entity), entt::to_integral(entt::entity(entt::null)));
+    count.store(index + 1, std::memory_order_release);
+    Store(indices, id, index, null);
+    return index;
+}
+
+void GoodIndex::Store(Table &table, size_t slot, uint32_t value, uint32_t missing) {
+    std::atomic<Page *> &page = table[slot / page_size];
+    Page *current = page.load(std::memory_order_relaxed);
+    if (current == nullptr) {
+        // Pages are never freed, because a lookup on another thread could be reading one at any time
+        current = new Page;
+        for (auto &entry : current->entries) {
+            entry.store(missing, std::memory_order_relaxed);
+        }
+        page.store(current, std::memory_order_release);
+    }
+    current->entries[slot % page_size].store(value, std::memory_order_release);
+}
+
+ResourceLedger::ResourceLedger(const ResourceLedger &other) { *this = other; }
+
+ResourceLedger::ResourceLedger(const ResourceLedger &other, std::pmr::memory_resource *resource)
+    : resource(resource) {
+    *this = other;
+}
+
+ResourceLedger::ResourceLedger(ResourceLedger &&other) noexcept {
+    if (other.resource != nullptr) {
+        // The other ledger is a temporary, and this could be kept for longer than its arena
+        *this = other;
+        return;
+    }
+    values = std::exchange(other.values, nullptr);
+    present = std::exchange(other.present, nullptr);
+    capacity = std::exchange(other.capacity, 0);
+    count = std::exchange(other.count, 0);
+}
+
+ResourceLedger &ResourceLedger::operator=(const ResourceLedger &other) {
+    if (&other == this) {
+        return *this;
+    }
+    if (capacity < other.capacity) {
+        Reserve(other.capacity);
+    }
+    if (other.capacity > 0) {
+        std::memcpy(values, other.values, other.capacity * sizeof(double));
+        std::memcpy(present, other.present, other.capacity);
+    }
+    // Clear anything past the end of the other ledger
+    if (capacity > other.capacity) {
+        std::fill(values + other.capacity, values + capacity, 0.);
+        std::fill(present + other.capacity, present + capacity, 0);
+    }
+    count = other.count;
+    return *this;
+}
+
+ResourceLedger &ResourceLedger::operator=(ResourceLedger &&other) noexcept {
+    if (&other == this) {
+        return *this;
+    }
+    if (resource != other.resource) {
+        return *this = other;
+    }
+    std::swap(values, other.values);
+    std::swap(present, other.present);
+    std::swap(capacity, other.capacity);
+    std::swap(count, other.count);
+    return *this;
+}
+
+ResourceLedger::~ResourceLedger() { Deallocate(); }
+
+void ResourceLedger::Deallocate() {
+    if (values == nullptr) {
+        return;
+    }
+    if (resource != nullptr) {
+        resource->deallocate(values, capacity * (sizeof(double) + sizeof(uint8_t)), alignment);
+    } else {
+        ::operator delete(values, std::align_val_t(alignment));
+    }
+}
+
+void ResourceLedger::Reserve(uint32_t size) {
+    if (size <= capacity) {
+        return;
+    }
+    // Round to a whole number of vector lanes so the kernels never need a remainder loop, and make room for
+    // every registered good, so that ledgers rarely have to grow more than once.
+    uint32_t new_capacity = std::max(size, GoodIndex::Count());
+    new_capacity = (new_capacity + lanes - 1) / lanes * lanes;
+
+    // Values and flags share an allocation; the flags go after the values so the values stay aligned.
+    const size_t bytes = new_capacity * (sizeof(double) + sizeof(uint8_t));
+    void *block = resource != nullptr ? resource->allocate(bytes, alignment)
+                                      : ::operator new(bytes, std::align_val_t(alignment));
+    double *new_values = static_cast<double *>(block);
+    uint8_t *new_present = reinterpret_cast<uint8_t *>(new_values + new_capacity);
+    if (capacity > 0) {
+        std::memcpy(new_values, values, capacity * sizeof(double));
+        std::memcpy(new_present, present, capacity);
+    }
+    std::fill(new_values + capacity, new_values + new_capacity, 0.);
+    std::fill(new_present + capacity, new_present + new_capacity, 0);
+
+    Deallocate();
+    values = new_values;
+    present = new_present;
+    capacity = new_capacity;
+}
+
+void ResourceLedger::Recount() {
+    uint32_t total = 0;
+    for (uint32_t i = 0; i < capacity; i++) {
+        total += present[i];
+    }
+    count = total;
+}
+
 double ResourceLedger::operator[](const entt::entity entity) const {
-    cqsp::common::components::LedgerMap::const_iterator location = this->find(entity);
-    if (location == this->end()) {
+    const uint32_t index = GoodIndex::Find(entity);
+    if (index >= capacity) {
         return 0;
-    } else {
-        return location->second;
     }
+    // Goods that aren't in the ledger are always 0
+    return values[index];
+}
+
+double &ResourceLedger::operator[](const entt::entity entity) {
+    uint32_t index = GoodIndex::Find(entity);
+    if (index == GoodIndex::null) {
+        index = GoodIndex::Register(entity);
+    }
+    return At(index);
+}
+
+double &ResourceLedger::At(uint32_t index) {
+    Reserve(index + 1);
+    if (present[index] == 0) {
+        present[index] = 1;
+        count++;
+    }
+    return values[index];
+}
+
+ResourceLedger::iterator ResourceLedger::find(entt::entity good) {
+    return HasGood(good) ? iterator(this, GoodIndex::Find(good)) : end();
+}
+
+ResourceLedger::const_iterator ResourceLedger::find(entt::entity good) const {
+    return HasGood(good) ? const_iterator(this, GoodIndex::Find(good)) : end();
+}
+
+std::pair<ResourceLedger::iterator, bool> ResourceLedger::emplace(entt::entity good, double amount) {
+    if (HasGood(good)) {
+        return std::make_pair(find(good), false);
+    }
+    (*this)[good] = amount;
+    return std::make_pair(find(good), true);
+}
+
+void ResourceLedger::clear() {
+    // Goods that aren't in the ledger are already 0, so an empty ledger has nothing to clear
+    if (count > 0) {
+        std::fill(values, values + capacity, 0.);
+        std::fill(present, present + capacity, 0);
+    }
+    count = 0;
 }
 
-bool ResourceLedger::EnoughToTransfer(const ResourceLedger &amount) {
+bool ResourceLedger::EnoughToTransfer(const ResourceLedger &amount) const {
     bool b = true;
     for (auto it = amount.begin(); it != amount.end(); it++) {
         b &= (*this)[it->first] >= it->second;
@@ -108,98 +250,125 @@ bool ResourceLedger::EnoughToTransfer(const ResourceLedger &amount) {
     return b;
 }
 
+// The element-wise kernels below run over the whole array without branching, so that they can be
+// vectorized. Goods missing from the other ledger are 0 there, so they don't change the sum, and for
+// multiplication and division they are masked out with a select.
 void ResourceLedger::operator-=(const ResourceLedger &other) {
-    for (auto iterator = other.begin(); iterator != other.end(); iterator++) {
-        (*this)[iterator->first] -= iterator->second;
+    Reserve(other.capacity);
+    double *__restrict a = std::assume_aligned<alignment>(values);
+    const double *__restrict b = std::assume_aligned<alignment>(other.values);
+    for (uint32_t i = 0; i < other.capacity; i++) {
+        a[i] -= b[i];
+        present[i] |= other.present[i];
     }
+    Recount();
 }
 
 void ResourceLedger::operator+=(const ResourceLedger &other) {
-    for (auto iterator = other.begin(); iterator != other.end(); iterator++) {
-        (*this)[iterator->first] += iterator->second;
+    Reserve(other.capacity);
+    double *__restrict a = std::assume_aligned<alignment>(values);
+    const double *__restrict b = std::assume_aligned<alignment>(other.values);
+    for (uint32_t i = 0; i < other.capacity; i++) {
+        a[i] += b[i];
+        present[i] |= other.present[i];
     }
+    Recount();
 }
 
 void ResourceLedger::operator*=(const ResourceLedger &other) {
-    for (auto iterator = other.begin(); iterator != other.end(); iterator++) {
-        (*this)[iterator->first] *= iterator->second;
+    Reserve(other.capacity);
+    double *__restrict a = std::assume_aligned<alignment>(values);
+    const double *__restrict b = std::assume_aligned<alignment>(other.values);
+    for (uint32_t i = 0; i < other.capacity; i++) {
+        a[i] = other.present[i] ? a[i] * b[i] : a[i];
+        present[i] |= other.present[i];
     }
+    Recount();
 }
 
 void ResourceLedger::operator/=(const ResourceLedger &other) {
-    for (auto iterator = other.begin(); iterator != other.end(); iterator++) {
-        (*this)[iterator->first] /= iterator->second;
+    Reserve(other.capacity);
+    double *__restrict a = std::assume_aligned<alignment>(values);
+    const double *__restrict b = std::assume_aligned<alignment>(other.values);
+    for (uint32_t i = 0; i < other.capacity; i++) {
+        a[i] = other.present[i] ? a[i] / b[i] : a[i];
+        present[i] |= other.present[i];
     }
+    Recount();
 }
 
 void ResourceLedger::operator-=(const double value) {
-    for (auto iterator = this->begin(); iterator != this->end(); iterator++) {
-        (*this)[iterator->first] -= value;
+    double *a = std::assume_aligned<alignment>(values);
+    for (uint32_t i = 0; i < capacity; i++) {
+        a[i] = present[i] ? a[i] - value : a[i];
     }
 }
 
 void ResourceLedger::operator+=(const double value) {
-    for (auto iterator = this->begin(); iterator != this->end(); iterator++) {
-        (*this)[iterator->first] += value;
+    double *a = std::assume_aligned<alignment>(values);
+    for (uint32_t i = 0; i < capacity; i++) {
+        a[i] = present[i] ? a[i] + value : a[i];
     }
 }
 
 void ResourceLedger::operator*=(const double value) {
-    for (auto iterator = this->begin(); iterator != this->end(); iterator++) {
-        (*this)[iterator->first] *= value;
+    double *a = std::assume_aligned<alignment>(values);
+    for (uint32_t i = 0; i < capacity; i++) {
+        a[i] = present[i] ? a[i] * value : a[i];
     }
 }
 
 void ResourceLedger::operator/=(const double value) {
-    for (auto iterator = this->begin(); iterator != this->end(); iterator++) {
-        (*this)[iterator->first] /= value;
+    double *a = std::assume_aligned<alignment>(values);
+    for (uint32_t i = 0; i < capacity; i++) {
+        a[i] = present[i] ? a[i] / value : a[i];
     }
 }
 
 ResourceLedger ResourceLedger::operator+(const ResourceLedger &other) const {
-    ResourceLedger ledger = *this;
+    ResourceLedger ledger = Temporary(*this);
     ledger += other;
     return ledger;
 }
 
 ResourceLedger ResourceLedger::operator-(const ResourceLedger &other) const {
-    ResourceLedger ledger = *this;
+    ResourceLedger ledger = Temporary(*this);
     ledger -= other;
     return ledger;
 }
 
 ResourceLedger ResourceLedger::operator*(const ResourceLedger &other) const {
-    ResourceLedger ledger = *this;
+    ResourceLedger ledger = Temporary(*this);
     ledger *= other;
     return ledger;
 }
 
 ResourceLedger ResourceLedger::operator/(const ResourceLedger &other) const {
-    ResourceLedger ledger = *this;
+    ResourceLedger ledger = Temporary(*this);
     ledger /= other;
     return ledger;
 }
 
 ResourceLedger ResourceLedger::operator+(const double value) const {
-    ResourceLedger ledger = *this;
+    ResourceLedger ledger = Temporary(*this);
     ledger += value;
     return ledger;
 }
 
 ResourceLedger ResourceLedger::operator-(const double value) const {
-    ResourceLedger ledger = *this;
+    ResourceLedger ledger = Temporary(*this);
     ledger -= value;
     return ledger;
 }
 
 ResourceLedger ResourceLedger::operator*(const double value) const {
-    ResourceLedger ledger = *this;
+    ResourceLedger ledger = Temporary(*this);
     ledger *= value;
     return ledger;
 }
 
 ResourceLedger ResourceLedger::operator/(const double value) const {
-    ResourceLedger ledger = *this;
+    ResourceLedger ledger = Temporary(*this);
     ledger /= value;
     return ledger;
 }
@@ -247,22 +416,28 @@ bool ResourceLedger::operator<=(const ResourceLedger &ledger) {
 }
 
 void ResourceLedger::AssignFrom(const ResourceLedger &ledger) {
-    for (auto iterator = ledger.begin(); iterator != ledger.end(); iterator++) {
-        (*this)[iterator->first] = iterator->second;
+    Reserve(ledger.capacity);
+    for (uint32_t i = 0; i < ledger.capacity; i++) {
+        values[i] = ledger.present[i] ? ledger.values[i] : values[i];
+        present[i] |= ledger.present[i];
     }
+    Recount();
 }
 
 void ResourceLedger::TransferTo(ResourceLedger &ledger_to, const ResourceLedger &amount) {
-    for (auto iterator = amount.begin(); iterator != amount.end(); iterator++) {
-        (*this)[iterator->first] -= iterator->second;
-        ledger_to[iterator->first] += iterator->second;
-    }
+    (*this) -= amount;
+    ledger_to += amount;
 }
 
 void ResourceLedger::MultiplyAdd(const ResourceLedger &other, double value) {
-    for (auto iterator = other.begin(); iterator != other.end(); iterator++) {
-        (*this)[iterator->first] += iterator->second * value;
+    Reserve(other.capacity);
+    double *__restrict a = std::assume_aligned<alignment>(values);
+    const double *__restrict b = std::assume_aligned<alignment>(other.values);
+    for (uint32_t i = 0; i < other.capacity; i++) {
+        a[i] = other.present[i] ? a[i] + b[i] * value : a[i];
+        present[i] |= other.present[i];
     }
+    Recount();
 }
 
 void ResourceLedger::RemoveResourcesLimited(const ResourceLedger &other) {
@@ -276,7 +451,7 @@ void ResourceLedger::RemoveResourcesLimited(const ResourceLedger &other) {
 }
 
 ResourceLedger ResourceLedger::LimitedRemoveResources(const ResourceLedger &other) {
-    ResourceLedger removed;
+    ResourceLedger removed = Temporary();
     for (auto iterator = other.begin(); iterator != other.end(); iterator++) {
         double &t = (*this)[iterator->first];
         if (t > iterator->second) {
@@ -290,73 +465,90 @@ ResourceLedger ResourceLedger::LimitedRemoveResources(const ResourceLedger &othe
     return removed;
 }
 
-ResourceLedger ResourceLedger::UnitLeger(const double val) {
-    ResourceLedger newleg;
-    for (auto iterator = this->begin(); iterator != this->end(); iterator++) {
-        newleg[iterator->first] = val;
+ResourceLedger ResourceLedger::UnitLeger(const double val) const {
+    ResourceLedger newleg = Temporary(*this);
+    for (uint32_t i = 0; i < capacity; i++) {
+        newleg.values[i] = present[i] ? val : 0;
     }
     return newleg;
 }
 
-ResourceLedger ResourceLedger::Clamp(const double minclamp, const double maxclamp) {
-    ResourceLedger newleg;
-    for (auto iterator = this->begin(); iterator != this->end(); iterator++) {
-        double val = newleg[iterator->first];
-        if (val > maxclamp) {
-            val = maxclamp;
-        } else if (val < minclamp) {
-            val = minclamp;
-        }
-        newleg[iterator->first];
+ResourceLedger ResourceLedger::Clamp(const double minclamp, const double maxclamp) const {
+    ResourceLedger newleg = Temporary(*this);
+    for (uint32_t i = 0; i < capacity; i++) {
+        newleg.values[i] = present[i] ? std::clamp(values[i], minclamp, maxclamp) : 0;
     }
     return newleg;
 }
 
-bool ResourceLedger::HasAllResources(const ResourceLedger &ledger) {
+bool ResourceLedger::HasAllResources(const ResourceLedger &ledger) const {
     if (&ledger == this) {
         return true;
     }
-    return std::ranges::all_of(ledger, [this](auto led) { return (*this)[led.first] > 0; });
+    bool has = true;
+    for (uint32_t i = 0; i < ledger.capacity; i++) {
+        has &= (ledger.present[i] == 0) || (i < capacity && values[i] > 0);
+    }
+    return has;
 }
 
-double ResourceLedger::GetSum() {
+double ResourceLedger::GetSum() const {
+    // Accumulate in independent lanes so that the sum can be vectorized without reassociating
+    // floating point math
+    double lane_sum[lanes] = {};
+    const double *a = std::assume_aligned<alignment>(values);
+    for (uint32_t i = 0; i < capacity; i += lanes) {
+        for (uint32_t l = 0; l < lanes; l++) {
+            lane_sum[l] += a[i + l];
+        }
+    }
     double t = 0;
-    for (auto it = this->begin(); it != this->end(); it++) {
-        t += it->second;
+    for (double sum : lane_sum) {
+        t += sum;
     }
     return t;
 }
 
-double ResourceLedger::MultiplyAndGetSum(ResourceLedger &other) {
+double ResourceLedger::MultiplyAndGetSum(const ResourceLedger &other) const {
+    double lane_sum[lanes] = {};
+    const uint32_t size = std::min(capacity, other.capacity);
+    const double *__restrict a = std::assume_aligned<alignment>(values);
+    const double *__restrict b = std::assume_aligned<alignment>(other.values);
+    for (uint32_t i = 0; i < size; i += lanes) {
+        for (uint32_t l = 0; l < lanes; l++) {
+            lane_sum[l] += present[i + l] ? a[i + l] * b[i + l] : 0;
+        }
+    }
     double sum = 0;
-    for (auto iterator = this->begin(); iterator != this->end(); iterator++) {
-        sum += iterator->second * other[iterator->first];
+    for (double s : lane_sum) {
+        sum += s;
     }
     return sum;
 }
 
-ResourceLedger ResourceLedger::SafeDivision(const ResourceLedger &other) {
-    ResourceLedger ledger;
-    ledger = *this;
-    for (auto iterator = other.begin(); iterator != other.end(); iterator++) {
-        if (iterator->second == 0) {
-            ledger[iterator->first] = std::numeric_limits<double>::infinity();
-        } else if (ledger[iterator->first] == 0) {
-            ledger[iterator->first] = 0;
-        } else {
-            ledger[iterator->first] = ledger[iterator->first] / iterator->second;
-        }
+ResourceLedger ResourceLedger::SafeDivision(const ResourceLedger &other) const {
+    ResourceLedger ledger = Temporary(*this);
+    ledger.Reserve(other.capacity);
+    double *__restrict a = std::assume_aligned<alignment>(ledger.values);
+    const double *__restrict b = std::assume_aligned<alignment>(other.values);
+    for (uint32_t i = 0; i < other.capacity; i++) {
+        double quotient = (a[i] == 0) ? 0 : a[i] / b[i];
+        quotient = (b[i] == 0) ? std::numeric_limits<double>::infinity() : quotient;
+        a[i] = other.present[i] ? quotient : a[i];
+        ledger.present[i] |= other.present[i];
     }
+    ledger.Recount();
     return ledger;
 }
+
 /// <summary>
 /// Finds the smallest value in the Ledger.
 /// </summary>
 /// <returns>The smallest value in the ledger</returns>
-double ResourceLedger::Min() {
-    double Minimum = this->begin()->second;
-    for (auto iterator = this->begin(); iterator != this->end(); iterator++) {
-        if (iterator->second < Minimum) Minimum = iterator->second;
+double ResourceLedger::Min() const {
+    double Minimum = std::numeric_limits<double>::infinity();
+    for (uint32_t i = 0; i < capacity; i++) {
+        Minimum = (present[i] && values[i] < Minimum) ? values[i] : Minimum;
     }
     return Minimum;
 }
@@ -365,17 +557,17 @@ double ResourceLedger::Min() {
 /// Finds the largest value in the Ledger.
 /// </summary>
 /// <returns>The largest value in the ledger</returns>
-double ResourceLedger::Max() {
-    double Maximum = this->begin()->second;
-    for (auto iterator = this->begin(); iterator != this->end(); iterator++) {
-        if (iterator->second > Maximum) Maximum = iterator->second;
+double ResourceLedger::Max() const {
+    double Maximum = -std::numeric_limits<double>::infinity();
+    for (uint32_t i = 0; i < capacity; i++) {
+        Maximum = (present[i] && values[i] > Maximum) ? values[i] : Maximum;
     }
     return Maximum;
 }
 
-double ResourceLedger::Average() { return this->GetSum() / this->size(); }
+double ResourceLedger::Average() const { return this->GetSum() / this->size(); }
 
-std::string ResourceLedger::to_string() {
+std::string ResourceLedger::to_string() const {
     std::string str = "{";
     for (auto it = this->begin(); it != this->end(); it++) {
         str.append(" ");
@@ -388,23 +580,44 @@ std::string ResourceLedger::to_string() {
 }
 
 ResourceLedger RecipeOutput::operator*(const double value) const {
-    ResourceLedger ledger;
+    ResourceLedger ledger(util::FrameScope::Current());
     ledger[entity] = value * amount;
     return ledger;
 }
 ResourceLedger RecipeOutput::operator*(ResourceLedger &ledger) const {
-    ResourceLedger ret;
+    ResourceLedger ret(util::FrameScope::Current());
     ret[entity] = ledger[entity] * amount;
     return ret;
 }
 
+CompiledRecipe CompileRecipe(const Recipe &recipe) {
+    CompiledRecipe compiled;
+    compiled.input_goods.reserve(recipe.input.size());
+    compiled.input_amounts.reserve(recipe.input.size());
+    for (const auto &[good, amount] : recipe.input) {
+        compiled.input_goods.push_back(GoodIndex::Find(good));
+        compiled.input_amounts.push_back(amount);
+    }
+    compiled.capital_goods.reserve(recipe.capitalcost.size());
+    compiled.capital_amounts.reserve(recipe.capitalcost.size());
+    for (const auto &[good, amount] : recipe.capitalcost) {
+        compiled.capital_goods.push_back(GoodIndex::Find(good));
+        compiled.capital_amounts.push_back(amount);
+    }
+    compiled.output = recipe.output.entity;
+    compiled.output_good = GoodIndex::Register(recipe.output.entity);
+    compiled.output_amount = recipe.output.amount;
+    compiled.workers = recipe.workers;
+    return compiled;
+}
+
 /// <summary>
 /// Creates a new resource ledger using the keys from one resource ledger, and the values from annother
 /// </summary>
 ResourceLedger CopyVals(const ResourceLedger &keys, const ResourceLedger &values) {
-    ResourceLedger tkeys = keys;
-    for (auto iterator = keys.begin(); iterator != keys.end(); iterator++) {
-        tkeys[iterator->first] = values[iterator->first];
+    ResourceLedger tkeys(keys, util::FrameScope::Current());
+    for (auto iterator = tkeys.begin(); iterator != tkeys.end(); iterator++) {
+        iterator->second = values[iterator->first];
     }
     return tkeys;
 }
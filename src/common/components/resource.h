@@ -16,15 +16,27 @@
  */
 #pragma once
 
+#include <array>
+#include <atomic>
+#include <cassert>
+#include <cstdint>
 #include <iostream>
+#include <iterator>
+#include <limits>
 #include <map>
+#include <memory_resource>
+#include <mutex>
+#include <optional>
 #include <string>
+#include <type_traits>
+#include <utility>
 #include <vector>
 
 #include <entt/entt.hpp>
 
 #include "common/components/area.h"
 #include "common/components/units.h"
+#include "common/util/framearena.h"
 
 namespace cqsp {
 namespace common {
@@ -71,21 +83,173 @@ struct Mineral {};
 // Good is for capital goods
 struct CapitalGood {};
 
-typedef std::map<entt::entity, double> LedgerMap;
+/// <summary>
+/// Assigns every good a compact index, so that ledgers can be laid out as flat arrays instead of trees.
+/// Goods are registered when they are loaded into `Universe::goods`. Any other entity that is used as a
+/// ledger key is given the next free index the first time it is written to a ledger.
+/// </summary>
+/// Systems run at the same time, so registration takes a lock, and lookups don't take any. The tables are
+/// split into pages that are never moved or freed, so a lookup never reads memory that is being
+/// reallocated. An index belongs to one version of an entity, so a recycled entity id gets a new index
+/// instead of the one of the good that was destroyed.
+class GoodIndex {
+ public:
+    static constexpr uint32_t null = std::numeric_limits<uint32_t>::max();
+
+    /// <summary>
+    /// Registers the entity if it isn't registered yet.
+    /// </summary>
+    /// <returns>The index of the entity</returns>
+    static uint32_t Register(entt::entity entity);
+
+    /// <returns>The index of the entity, or GoodIndex::null if it's not registered</returns>
+    static uint32_t Find(entt::entity entity) {
+        const auto id = static_cast<size_t>(entt::to_entity(entity));
+        const uint32_t index = Load(indices, id, null);
+        // The id may have been registered by an earlier version of the entity
+        return index != null && Entity(index) == entity ? index : null;
+    }
+
+    static entt::entity Entity(uint32_t index) {
+        return static_cast<entt::entity>(Load(entities, index, entt::to_integral(entt::entity(entt::null))));
+    }
+
+    static uint32_t Count() { return count.load(std::memory_order_acquire); }
+
+ private:
+    static constexpr size_t page_size = 1 << 12;
+    // Enough pages for every entity id
+    static constexpr size_t max_pages =
+        (static_cast<size_t>(entt::entt_traits<entt::entity>::entity_mask) + page_size) / page_size;
+
+    struct Page {
+        std::atomic<uint32_t> entries[page_size];
+    };
+    using Table = std::array<std::atomic<Page*>, max_pages>;
+
+    static uint32_t Load(const Table& table, size_t slot, uint32_t missing) {
+        if (slot / page_size >= max_pages) {
+            return missing;
+        }
+        const Page* page = table[slot / page_size].load(std::memory_order_acquire);
+        return page != nullptr ? page->entries[slot % page_size].load(std::memory_order_acquire) : missing;
+    }
+
+    // Has to be called with the mutex held
+    static void Store(Table& table, size_t slot, uint32_t value, uint32_t missing);
+
+    // Indexed by entity id
+    inline static Table indices {};
+    inline static Table entities {};
+    inline static std::atomic<uint32_t> count = 0;
+    inline static std::mutex mutex;
+};
 
-class ResourceLedger : private LedgerMap {
+/// <summary>
+/// Amount of each good, stored densely by good index (see GoodIndex).
+/// </summary>
+/// The values are kept in one aligned array with a parallel array of flags marking which goods are in
+/// the ledger, so the element-wise operators are straight loops over both arrays that the compiler can
+/// vectorize. Goods that are not in the ledger always hold 0, so they act as the identity for addition.
+///
+/// Iteration only visits goods that are in the ledger and yields `first` (the good) and `second` (a
+/// reference to the amount), the same as the map this replaces. Like a vector, adding a good that is past
+/// the end of the ledger can reallocate it and invalidate iterators.
+///
+/// The ledgers that the arithmetic operators return are temporaries, so they are allocated from the frame
+/// arena of the thread if there is one (see util::FrameScope). Everything else allocates from the heap.
+/// A ledger that is moved into a ledger with different storage is copied, so a temporary that is kept
+/// in a component ends up on the heap, and never outlives the arena. A temporary that directly initializes
+/// an object isn't moved at all, so components that are ledgers derive from LedgerComponent instead.
+class ResourceLedger {
  public:
+    using key_type = entt::entity;
+    using mapped_type = double;
+
+    template <bool Const>
+    class Iterator {
+     public:
+        using ledger_type = std::conditional_t<Const, const ResourceLedger, ResourceLedger>;
+        using value_type = std::pair<const entt::entity, std::conditional_t<Const, const double&, double&>>;
+        using reference = value_type&;
+        using pointer = value_type*;
+        using difference_type = std::ptrdiff_t;
+        using iterator_category = std::forward_iterator_tag;
+
+        Iterator() = default;
+        Iterator(ledger_type* ledger, uint32_t index) : ledger(ledger), index(index) { Seek(); }
+        Iterator(const Iterator& other) : ledger(other.ledger), index(other.index), entry(other.entry) {}
+        Iterator& operator=(const Iterator& other) {
+            ledger = other.ledger;
+            index = other.index;
+            entry.reset();
+            if (other.entry) {
+                entry.emplace(*other.entry);
+            }
+            return *this;
+        }
+        // Allow iterator to const_iterator conversion
+        operator Iterator<true>() const { return Iterator<true>(ledger, index); }
+
+        reference operator*() const { return *entry; }
+        pointer operator->() const { return &*entry; }
+
+        Iterator& operator++() {
+            index++;
+            Seek();
+            return *this;
+        }
+
+        Iterator operator++(int) {
+            Iterator tmp = *this;
+            ++(*this);
+            return tmp;
+        }
+
+        bool operator==(const Iterator& other) const { return index == other.index && ledger == other.ledger; }
+        bool operator!=(const Iterator& other) const { return !(*this == other); }
+
+     private:
+        void Seek() {
+            while (index < ledger->capacity && ledger->present[index] == 0) {
+                index++;
+            }
+            if (index < ledger->capacity) {
+                entry.emplace(GoodIndex::Entity(index), ledger->values[index]);
+            } else {
+                entry.reset();
+            }
+        }
+
+        ledger_type* ledger = nullptr;
+        uint32_t index = 0;
+        mutable std::optional<value_type> entry;
+    };
+
+    using iterator = Iterator<false>;
+    using const_iterator = Iterator<true>;
+
     ResourceLedger() = default;
-    ~ResourceLedger() = default;
+    /// <param name="resource">Where the storage is allocated from, or nullptr for the heap</param>
+    explicit ResourceLedger(std::pmr::memory_resource* resource) : resource(resource) {}
+    ResourceLedger(const ResourceLedger&, std::pmr::memory_resource* resource);
+    ResourceLedger(const ResourceLedger&);
+    ResourceLedger(ResourceLedger&&) noexcept;
+    ResourceLedger& operator=(const ResourceLedger&);
+    ResourceLedger& operator=(ResourceLedger&&) noexcept;
+    ~ResourceLedger();
 
     double operator[](const entt::entity) const;
-
+    /// <summary>
+    /// Gets the amount of the good, and adds the good to the ledger with 0 if it isn't in it.
+    /// </summary>
+    double& operator[](const entt::entity);
     /// <summary>
     /// This resource ledger has enough resources inside to transfer "amount" amount of resources away
     /// </summary>
     /// <param name="amount">Other resource ledger</param>
     /// <returns></returns>
-    bool EnoughToTransfer(const ResourceLedger& amount);
+    bool EnoughToTransfer(const ResourceLedger& amount) const;
 
     void operator-=(const ResourceLedger&);
     void operator+=(const ResourceLedger&);
@@ -164,37 +328,52 @@ class ResourceLedger : private LedgerMap {
     /// <summary>
     /// Returns a copy of the vector with the values set to indicated value
     /// </summary>
-    ResourceLedger UnitLeger(const double);
+    ResourceLedger UnitLeger(const double) const;
 
     /// <summary>
     /// Returns a copy of the vector with the values clamped between the min and max indicated
     /// </summary>
-    ResourceLedger Clamp(const double, const double);
+    ResourceLedger Clamp(const double, const double) const;
 
     /// <summary>
     /// Returns a copy of the vector divided by the indicated vector, with division by zero resulting in infiniy
     /// </summary>
-    ResourceLedger SafeDivision(const ResourceLedger&);
+    ResourceLedger SafeDivision(const ResourceLedger&) const;
 
     /// <summary>
     /// Returns a copy of the vector divided by the indicated vector, with
     /// division by zero resulting in infiniy
     /// </summary>
-    double Average();
+    double Average() const;
 
-    double Min();
-    double Max();
+    /// <returns>The smallest amount in the ledger, or infinity if it is empty</returns>
+    double Min() const;
+    /// <returns>The largest amount in the ledger, or -infinity if it is empty</returns>
+    double Max() const;
 
     /// <summary>
     /// Checks if this current resource ledger has any resources in this list
     /// </summary>
     /// <param name=""></param>
     /// <returns></returns>
-    bool HasAllResources(const ResourceLedger&);
+    bool HasAllResources(const ResourceLedger&) const;
+
+    bool HasGood(entt::entity good) const {
+        const uint32_t index = GoodIndex::Find(good);
+        return index < capacity && present[index] != 0;
+    }
 
-    bool HasGood(entt::entity good) { return (*this).find(good) != (*this).end(); }
+    /// <summary>
+    /// Same as HasGood and the const operator[], for code that has already looked up the GoodIndex of the good
+    /// </summary>
+    bool HasIndex(uint32_t index) const { return index < capacity && present[index] != 0; }
+    double Get(uint32_t index) const { return index < capacity ? values[index] : 0; }
+    /// <summary>
+    /// Same as the non-const operator[], by GoodIndex. The index has to be registered.
+    /// </summary>
+    double& At(uint32_t index);
 
-    double GetSum();
+    double GetSum() const;
 
     /// <summary>
     /// Multiplies the numbers stated in the resource ledger. Used for calculating the price, becuase
@@ -202,26 +381,62 @@ class ResourceLedger : private LedgerMap {
     /// </summary>
     /// <param name=""></param>
     /// <returns></returns>
-    double MultiplyAndGetSum(ResourceLedger& other);
-
-    std::string to_string();
-
-    // All the things that we get from map
-    using LedgerMap::operator[];
-    using LedgerMap::begin;
-    using LedgerMap::cbegin;
-    using LedgerMap::cend;
-    using LedgerMap::clear;
-    using LedgerMap::crbegin;
-    using LedgerMap::crend;
-    using LedgerMap::emplace;
-    using LedgerMap::empty;
-    using LedgerMap::end;
-    using LedgerMap::mapped_type;
-    using LedgerMap::rbegin;
-    using LedgerMap::rend;
-    using LedgerMap::size;
-    using LedgerMap::value_comp;
+    double MultiplyAndGetSum(const ResourceLedger& other) const;
+
+    std::string to_string() const;
+
+    /// <summary>
+    /// If the ledger is allocated from a frame arena, so it can't be kept past the end of the tick
+    /// </summary>
+    bool IsTemporary() const { return resource != nullptr; }
+
+    iterator begin() { return iterator(this, 0); }
+    iterator end() { return iterator(this, capacity); }
+    const_iterator begin() const { return const_iterator(this, 0); }
+    const_iterator end() const { return const_iterator(this, capacity); }
+    const_iterator cbegin() const { return begin(); }
+    const_iterator cend() const { return end(); }
+
+    iterator find(entt::entity good);
+    const_iterator find(entt::entity good) const;
+
+    std::pair<iterator, bool> emplace(entt::entity good, double amount);
+
+    /// <summary>
+    /// Removes all goods, but keeps the allocated storage so that the ledger can be refilled without
+    /// allocating.
+    /// </summary>
+    void clear();
+    bool empty() const { return count == 0; }
+    size_t size() const { return count; }
+
+ private:
+    // Width of the widest vector registers we expect to target (AVX, 4 doubles), in bytes
+    static constexpr size_t alignment = 32;
+    static constexpr uint32_t lanes = alignment / sizeof(double);
+
+    /// <summary>
+    /// Grows the storage so that it can hold at least `size` goods.
+    /// </summary>
+    void Reserve(uint32_t size);
+    void Recount();
+    void Deallocate();
+
+    /// <summary>
+    /// Empty ledger for the result of an operator
+    /// </summary>
+    static ResourceLedger Temporary() { return ResourceLedger(util::FrameScope::Current()); }
+    static ResourceLedger Temporary(const ResourceLedger& copy) {
+        return ResourceLedger(copy, util::FrameScope::Current());
+    }
+
+    /// Amounts of each good, by good index. Goods that are not in the ledger are 0.
+    double* values = nullptr;
+    /// 1 if the good at that index is in the ledger. Lives in the same allocation as `values`.
+    uint8_t* present = nullptr;
+    uint32_t capacity = 0;
+    uint32_t count = 0;
+    std::pmr::memory_resource* resource = nullptr;
 };
 
 ResourceLedger CopyVals(const ResourceLedger& keys, const ResourceLedger& values);
@@ -245,6 +460,26 @@ struct Recipe {
     ResourceLedger capitalcost;
 };
 
+/// <summary>
+/// A recipe laid out as parallel arrays of good indices (see GoodIndex) and amounts, so that factories can
+/// read their inputs and outputs straight out of the market ledgers without building ledgers of their own.
+/// </summary>
+/// Made from the Recipe when it is loaded, or by SysProduction if the recipe doesn't have one yet. Recipes
+/// don't change after loading, so it is never rebuilt.
+struct CompiledRecipe {
+    std::vector<uint32_t> input_goods;
+    std::vector<double> input_amounts;
+    std::vector<uint32_t> capital_goods;
+    std::vector<double> capital_amounts;
+
+    entt::entity output = entt::null;
+    uint32_t output_good = GoodIndex::null;
+    double output_amount = 0;
+    double workers = 0;
+};
+
+CompiledRecipe CompileRecipe(const Recipe& recipe);
+
 struct RecipeCost {
     ResourceLedger fixed;
     ResourceLedger scaling;
@@ -293,14 +528,30 @@ struct FactoryTimer {
 
 //Resource generator
 
-struct ResourceConsumption : public ResourceLedger {};
-struct ResourceProduction : public ResourceLedger {};
+/// <summary>
+/// Base of the components that are ledgers. A temporary that initializes it is always copied to the heap, even
+/// where the copy would be elided, like in `ResourceStockpile {a * b}`, so that the component can outlive the
+/// frame arena.
+/// </summary>
+struct LedgerComponent : public ResourceLedger {
+    LedgerComponent() = default;
+    // Not explicit, so that the components can be brace initialized from a ledger
+    LedgerComponent(const ResourceLedger& ledger) : ResourceLedger(ledger) {  // NOLINT
+        assert(!IsTemporary());
+    }
+    LedgerComponent(ResourceLedger&& ledger) : ResourceLedger(std::move(ledger)) {  // NOLINT
+        assert(!IsTemporary());
+    }
+};
+
+struct ResourceConsumption : public LedgerComponent {};
+struct ResourceProduction : public LedgerComponent {};
 
 struct ResourceConverter {
     entt::entity recipe;
 };
 
-struct ResourceStockpile : public ResourceLedger {};
+struct ResourceStockpile : public LedgerComponent {};
 
 struct FailedResourceTransfer {
     // Ledgers later to show how much
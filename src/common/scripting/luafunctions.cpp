@@ -247,6 +247,7 @@ void FunctionPopulation(cqsp::common::Universe& universe, cqsp::scripting::Scrip
         universe.emplace<cqspc::PopulationSegment>(population, popsize);
         universe.emplace<cqspc::ResourceStockpile>(population);
         universe.emplace<cqspc::LaborInformation>(population);
+        universe.emplace<cqspc::Wallet>(population);
         // Add to planet list
         universe.get<cqspc::Settlement>(settlement).population.push_back(population);
 
@@ -16,10 +16,20 @@
  */
 #include "common/simulation.h"
 
+#include <fmt/format.h>
 #include <spdlog/spdlog.h>
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <exception>
+#include <fstream>
+#include <functional>
 #include <memory>
+#include <mutex>
 #include <string>
+#include <thread>
 #include <vector>
 
 #include "common/components/area.h"
@@ -44,12 +54,17 @@
 #include "common/systems/science/syssciencelab.h"
 #include "common/systems/science/systechnology.h"
 #include "common/systems/scriptrunner.h"
+#include "common/util/allocationcounter.h"
+#include "common/util/framearena.h"
 #include "common/util/profiler.h"
 
 using cqsp::common::Universe;
 using cqsp::common::systems::simulation::Simulation;
 
-Simulation::Simulation(cqsp::common::Game& game) : m_game(game), m_universe(game.GetUniverse()) {
+Simulation::Simulation(cqsp::common::Game& game)
+    : m_game(game),
+      thread_pool(std::make_unique<cqsp::common::util::ThreadPool>(std::thread::hardware_concurrency())),
+      m_universe(game.GetUniverse()) {
     namespace cqspcs = cqsp::common::systems;
     AddSystem<cqspcs::SysScript>();
     AddSystem<cqspcs::SysWalletReset>();
@@ -82,12 +97,22 @@ void Simulation::tick() {
     auto start = std::chrono::high_resolution_clock::now();
     BEGIN_TIMED_BLOCK(Game_Loop);
 
-    for (auto& sys : system_list) {
-        if (m_universe.date.GetDate() % sys->Interval() == 0) {
-            sys->DoSystem();
+    // Loops that the systems split over the workers put their temporaries into the arena too
+    thread_pool->SetFrameArena(&frame_arena);
+    if (parallel && thread_pool->Size() > 1) {
+        RunParallel();
+    } else {
+        for (size_t i = 0; i < system_list.size(); i++) {
+            RunSystem(i);
         }
     }
     END_TIMED_BLOCK(Game_Loop);
+    thread_pool->SetFrameArena(nullptr);
+    // Every system is done, so none of the temporaries are in use anymore
+    frame_arena.Reset();
+    RecordTelemetry();
+    // Empty the profiler's buffers once per tick, so they don't fill up on long runs without a profiler window
+    cqsp::common::util::Profiler::Get().Collect();
     auto end = std::chrono::high_resolution_clock::now();
     int len = std::chrono::duration_cast<std::chrono::milliseconds>(end - start).count();
     const int expected_len = 250;
@@ -95,3 +120,231 @@ void Simulation::tick() {
         SPDLOG_WARN("Tick has taken more than {} ms at {} ms", expected_len, len);
     }
 }
+
+int Simulation::FastForward(int target_date, const std::function<void()>& between_ticks) {
+    fast_forward_cancelled = false;
+    const int start_date = m_universe.date.GetDate();
+    {
+        std::scoped_lock lock(fast_forward_mutex);
+        fast_forward = FastForwardProgress {true, start_date, target_date, start_date, 0};
+    }
+    SPDLOG_INFO("Fast forwarding from {} to {}", start_date, target_date);
+
+    const auto start = std::chrono::steady_clock::now();
+    auto last_report = start;
+    int ticks = 0;
+    auto report = [&](bool running) {
+        const auto now = std::chrono::steady_clock::now();
+        const double seconds = std::chrono::duration<double>(now - start).count();
+        std::scoped_lock lock(fast_forward_mutex);
+        fast_forward.running = running;
+        fast_forward.date = m_universe.date.GetDate();
+        fast_forward.ticks_per_second = seconds > 0 ? ticks / seconds : 0;
+        last_report = now;
+    };
+
+    while (m_universe.date.GetDate() < target_date && !fast_forward_cancelled) {
+        tick();
+        ticks++;
+        // Don't take the lock every tick
+        if (std::chrono::steady_clock::now() - last_report > std::chrono::milliseconds(100)) {
+            report(true);
+        }
+        if (between_ticks) {
+            between_ticks();
+        }
+    }
+    report(false);
+    SPDLOG_INFO("Fast forwarded {} ticks at {} ticks/s{}", ticks, GetFastForwardProgress().ticks_per_second,
+                fast_forward_cancelled ? " before it was cancelled" : "");
+    return ticks;
+}
+
+cqsp::common::systems::simulation::FastForwardProgress Simulation::GetFastForwardProgress() const {
+    std::scoped_lock lock(fast_forward_mutex);
+    return fast_forward;
+}
+
+void Simulation::BuildSchedule() {
+    const size_t count = system_list.size();
+    dependents.assign(count, {});
+    dependency_count.assign(count, 0);
+    // A system has to wait for every system before it that it conflicts with, so conflicting systems
+    // keep the order that they were added in.
+    for (size_t later = 0; later < count; later++) {
+        for (size_t earlier = 0; earlier < later; earlier++) {
+            if (system_list[earlier]->GetAccess().ConflictsWith(system_list[later]->GetAccess())) {
+                dependents[earlier].push_back(later);
+                dependency_count[later]++;
+            }
+        }
+    }
+    schedule_dirty = false;
+}
+
+void Simulation::RunSystem(size_t index) {
+    auto& sys = system_list[index];
+    system_times[index] = 0;
+    system_stats[index] = SystemTickStats();
+    if (m_universe.date.GetDate() % sys->Interval() != 0) {
+        return;
+    }
+    // The pool carries this over to the loops that the system splits over the workers
+    std::atomic<uint64_t> allocations = 0;
+    auto system_start = std::chrono::high_resolution_clock::now();
+    {
+        util::ProfileBlock block(*system_zones[index]);
+        util::FrameScope frame(frame_arena.GetThreadResource());
+        util::AllocationScope allocation_scope(&allocations);
+        sys->DoSystem();
+    }
+    auto system_end = std::chrono::high_resolution_clock::now();
+    system_times[index] = std::chrono::duration<double, std::micro>(system_end - system_start).count();
+
+    SystemTickStats& stats = system_stats[index];
+    stats.duration_us = system_times[index];
+    stats.entities = sys->TakeProcessedCount();
+    stats.allocations = allocations;
+    stats.ran = true;
+}
+
+void Simulation::ResetTelemetry() {
+    std::scoped_lock lock(telemetry_mutex);
+    const size_t count = system_list.size();
+    system_stats.assign(count, SystemTickStats());
+    telemetry.assign(telemetry_history * count, SystemTickStats());
+    telemetry_dates.assign(telemetry_history, 0);
+    telemetry_next = 0;
+    telemetry_count = 0;
+}
+
+void Simulation::RecordTelemetry() {
+    std::scoped_lock lock(telemetry_mutex);
+    std::copy(system_stats.begin(), system_stats.end(), telemetry.begin() + telemetry_next * system_stats.size());
+    telemetry_dates[telemetry_next] = m_universe.date.GetDate();
+    telemetry_next = (telemetry_next + 1) % telemetry_history;
+    telemetry_count = std::min(telemetry_count + 1, telemetry_history);
+}
+
+size_t Simulation::GetTelemetryTicks() const {
+    std::scoped_lock lock(telemetry_mutex);
+    return telemetry_count;
+}
+
+SystemTelemetrySummary Simulation::SummarizeSystem(size_t system, size_t ticks) const {
+    std::scoped_lock lock(telemetry_mutex);
+    SystemTelemetrySummary summary;
+    const size_t system_count = system_list.size();
+    ticks = std::min(ticks, telemetry_count);
+    // From the newest tick back
+    for (size_t i = 0; i < ticks; i++) {
+        const size_t row = (telemetry_next + telemetry_history - 1 - i) % telemetry_history;
+        const SystemTickStats& stats = telemetry[row * system_count + system];
+        if (!stats.ran) {
+            continue;
+        }
+        if (summary.runs == 0) {
+            summary.last = stats;
+        }
+        summary.runs++;
+        summary.mean_us += stats.duration_us;
+        summary.worst_us = std::max(summary.worst_us, stats.duration_us);
+        summary.mean_entities += stats.entities;
+        summary.worst_entities = std::max(summary.worst_entities, stats.entities);
+        summary.mean_allocations += stats.allocations;
+        summary.worst_allocations = std::max(summary.worst_allocations, stats.allocations);
+    }
+    if (summary.runs > 0) {
+        summary.mean_us /= summary.runs;
+        summary.mean_entities /= summary.runs;
+        summary.mean_allocations /= summary.runs;
+    }
+    return summary;
+}
+
+bool Simulation::WriteTelemetryCsv(const std::string& path) const {
+    std::ofstream stream(path);
+    if (!stream) {
+        SPDLOG_ERROR("Failed to write telemetry to {}", path);
+        return false;
+    }
+    std::scoped_lock lock(telemetry_mutex);
+    const size_t system_count = system_list.size();
+    stream << "date,system,duration_us,entities,allocations\n";
+    // Oldest tick first
+    for (size_t i = 0; i < telemetry_count; i++) {
+        const size_t row = (telemetry_next + telemetry_history - telemetry_count + i) % telemetry_history;
+        for (size_t system = 0; system < system_count; system++) {
+            const SystemTickStats& stats = telemetry[row * system_count + system];
+            if (!stats.ran) {
+                continue;
+            }
+            // Left as n/a instead of 0 when the allocations aren't counted, so that it isn't read as none
+            stream << fmt::format("{},{},{},{},{}\n", telemetry_dates[row], system_names[system], stats.duration_us,
+                                  stats.entities,
+                                  util::kCountAllocations ? std::to_string(stats.allocations) : "n/a");
+        }
+    }
+    return static_cast<bool>(stream);
+}
+
+void Simulation::RunParallel() {
+    if (schedule_dirty) {
+        BuildSchedule();
+    }
+    const size_t count = system_list.size();
+    if (count == 0) {
+        return;
+    }
+
+    std::vector<std::atomic<int>> remaining(count);
+    for (size_t i = 0; i < count; i++) {
+        remaining[i] = dependency_count[i];
+    }
+    std::mutex done_mutex;
+    std::condition_variable done;
+    size_t finished = 0;
+    std::exception_ptr exception;
+
+    std::function<void(size_t)> run = [&](size_t index) {
+        try {
+            RunSystem(index);
+        } catch (...) {
+            std::scoped_lock lock(done_mutex);
+            if (!exception) {
+                exception = std::current_exception();
+            }
+        }
+        // Start everything that was only waiting on this system
+        for (size_t next : dependents[index]) {
+            if (remaining[next].fetch_sub(1) == 1) {
+                thread_pool->Submit([&run, next]() { run(next); });
+            }
+        }
+        // Notify while holding the lock, so that tick() can't return while this is still using it
+        std::scoped_lock lock(done_mutex);
+        if (++finished == count) {
+            done.notify_one();
+        }
+    };
+
+    for (size_t i = 0; i < count; i++) {
+        if (dependency_count[i] == 0) {
+            thread_pool->Submit([&run, i]() { run(i); });
+        }
+    }
+
+    // Help run systems instead of idling
+    std::unique_lock lock(done_mutex);
+    while (finished != count) {
+        lock.unlock();
+        bool ran = thread_pool->RunPendingTask();
+        lock.lock();
+        if (!ran) {
+            done.wait_for(lock, std::chrono::microseconds(100), [&]() { return finished == count; });
+        }
+    }
+    if (exception) {
+        std::rethrow_exception(exception);
+    }
+}
@@ -16,16 +16,72 @@
  */
 #pragma once
 
+#include <atomic>
+#include <cstdint>
+#include <functional>
 #include <memory>
+#include <mutex>
+#include <string>
 #include <vector>
 
+#include <entt/entt.hpp>
+
 #include "common/game.h"
 #include "common/systems/isimulationsystem.h"
+#include "common/util/framearena.h"
+#include "common/util/profiler.h"
+#include "common/util/threadpool.h"
 
 namespace cqsp {
 namespace common {
 namespace systems {
 namespace simulation {
+/// <summary>
+/// Progress of a fast forward, see Simulation::FastForward.
+/// </summary>
+struct FastForwardProgress {
+    bool running = false;
+    int start_date = 0;
+    int target_date = 0;
+    int date = 0;
+    double ticks_per_second = 0;
+
+    /// <summary>
+    /// How much of the fast forward is done, from 0 to 1.
+    /// </summary>
+    double Fraction() const {
+        return target_date > start_date ? static_cast<double>(date - start_date) / (target_date - start_date) : 1;
+    }
+};
+
+/// <summary>
+/// What a system did in one tick
+/// </summary>
+struct SystemTickStats {
+    double duration_us = 0;
+    // As reported by the system with CountProcessed
+    uint64_t entities = 0;
+    // Allocations made by the system, including the ones in loops that it split over the thread pool. Always 0
+    // when the allocations aren't counted, see util::kCountAllocations
+    uint64_t allocations = 0;
+    bool ran = false;
+};
+
+/// <summary>
+/// A system's telemetry over a number of ticks, see Simulation::SummarizeSystem
+/// </summary>
+struct SystemTelemetrySummary {
+    // Ticks that the system ran in
+    size_t runs = 0;
+    SystemTickStats last;
+    double mean_us = 0;
+    double worst_us = 0;
+    double mean_entities = 0;
+    uint64_t worst_entities = 0;
+    double mean_allocations = 0;
+    uint64_t worst_allocations = 0;
+};
+
 /// <summary>
 /// Main simulation of game.
 ///</summary>
@@ -35,8 +91,15 @@ namespace simulation {
 /// AddSystem<SimSystemName>();
 /// ```
 ///
+/// Systems that declare the components they read and write (see ISimulationSystem::Reads and
+/// ISimulationSystem::Writes) are run at the same time as other systems that they don't conflict with.
+/// Systems that conflict are always run in the order that they were added, so the result is the same as
+/// running them one after another.
 class Simulation {
  public:
+    // Number of ticks that the telemetry is kept for
+    static constexpr size_t telemetry_history = 1024;
+
     explicit Simulation(cqsp::common::Game &game);
 
     /// <summary>
@@ -44,18 +107,119 @@ class Simulation {
     /// </summary>
     void tick();
 
+    /// <summary>
+    /// Runs ticks back to back until the date reaches `target_date`, or until the fast forward is cancelled.
+    /// </summary>
+    /// Nothing else runs between the ticks, so the client isn't updated until it's done.
+    /// <param name="between_ticks">Run after every tick, for example to let other threads use the universe</param>
+    /// <returns>Number of ticks that were run</returns>
+    int FastForward(int target_date, const std::function<void()>& between_ticks = {});
+    /// <summary>
+    /// Stops the fast forward that is running after the current tick. This can be called from any thread.
+    /// </summary>
+    void CancelFastForward() { fast_forward_cancelled = true; }
+    /// <summary>
+    /// Progress of the fast forward that is running, or of the last one. This can be called from any thread.
+    /// </summary>
+    FastForwardProgress GetFastForwardProgress() const;
+
     template <class T>
     void AddSystem() {
         static_assert(std::is_base_of<cqsp::common::systems::ISimulationSystem, T>::value);
         system_list.push_back(std::make_unique<T>(m_game));
+        system_list.back()->SetThreadPool(thread_pool.get());
+        system_names.emplace_back(entt::type_name<T>::value());
+        system_times.push_back(0);
+        // The profiler keeps its zones forever, so there is one for each type of system instead of each system
+        static const std::string zone_name(entt::type_name<T>::value());
+        static util::ProfileZone zone(zone_name.c_str(), __FILE__, __LINE__);
+        system_zones.push_back(&zone);
+        schedule_dirty = true;
+        ResetTelemetry();
     }
 
+    /// <summary>
+    /// Runs independent systems at the same time. If this is false, the systems are run one after
+    /// another on the calling thread.
+    /// </summary>
+    void SetParallel(bool parallel) { this->parallel = parallel; }
+
+    /// <summary>
+    /// Names of the systems, in the order that they are run.
+    /// </summary>
+    const std::vector<std::string>& GetSystemNames() const { return system_names; }
+
+    /// <summary>
+    /// How long each system took during the last tick in microseconds, in the same order as GetSystemNames.
+    /// Systems that didn't run last tick are 0.
+    /// </summary>
+    const std::vector<double>& GetLastSystemTimes() const { return system_times; }
+
+    /// <summary>
+    /// Summarizes the telemetry of a system over the last ticks, only counting the ticks that it ran in.
+    /// This can be called from any thread.
+    /// </summary>
+    /// <param name="system">Index of the system, in the same order as GetSystemNames</param>
+    /// <param name="ticks">How many of the last ticks to look at, at most telemetry_history</param>
+    SystemTelemetrySummary SummarizeSystem(size_t system, size_t ticks = telemetry_history) const;
+
+    /// <summary>
+    /// Number of ticks in the telemetry history
+    /// </summary>
+    size_t GetTelemetryTicks() const;
+
+    /// <summary>
+    /// Writes the telemetry history as csv, with a row for each system in each tick. The allocations are written
+    /// as n/a if they aren't counted. This can be called from any thread.
+    /// </summary>
+    /// <returns>false if the file couldn't be written</returns>
+    bool WriteTelemetryCsv(const std::string& path) const;
+
  private:
+    /// <summary>
+    /// Builds the dependency graph of the systems from what they read and write.
+    /// </summary>
+    void BuildSchedule();
+    void RunSystem(size_t index);
+    void RunParallel();
+    /// <summary>
+    /// Adds the stats of the systems in the last tick to the telemetry history
+    /// </summary>
+    void RecordTelemetry();
+    void ResetTelemetry();
+
     cqsp::common::Game &m_game;
+    // Declared before the systems so that it outlives them
+    std::unique_ptr<util::ThreadPool> thread_pool;
+    // Temporaries made by the systems during a tick, freed at the end of the tick
+    util::FrameArena frame_arena;
     /// <summary>
     /// Holds all the systems.
     /// </summary>
     std::vector<std::unique_ptr<cqsp::common::systems::ISimulationSystem>> system_list;
+    std::vector<std::string> system_names;
+    std::vector<double> system_times;
+    std::vector<const util::ProfileZone*> system_zones;
+    // Stats of the systems in the tick that is running
+    std::vector<SystemTickStats> system_stats;
+
+    mutable std::mutex telemetry_mutex;
+    // A ring buffer of telemetry_history ticks, each with a row of stats for every system
+    std::vector<SystemTickStats> telemetry;
+    std::vector<int> telemetry_dates;
+    size_t telemetry_next = 0;
+    size_t telemetry_count = 0;
+
+    /// The systems that have to wait for each system
+    std::vector<std::vector<size_t>> dependents;
+    /// The number of systems that each system has to wait for
+    std::vector<int> dependency_count;
+    bool schedule_dirty = true;
+    bool parallel = true;
+
+    std::atomic<bool> fast_forward_cancelled = false;
+    mutable std::mutex fast_forward_mutex;
+    FastForwardProgress fast_forward;
     cqsp::common::Universe &m_universe;
 };
 }  // namespace simulation
@@ -0,0 +1,299 @@
+/* Conquer Space
+ * Copyright (C) 2021-2023 Conquer Space
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#include "common/simulationthread.h"
+
+#include <algorithm>
+#include <utility>
+
+#include <tracy/Tracy.hpp>
+
+#include "common/components/bodies.h"
+#include "common/components/coordinates.h"
+#include "common/components/economy.h"
+#include "common/components/orbit.h"
+#include "common/components/population.h"
+#include "common/components/ships.h"
+#include "common/components/surface.h"
+#include "common/util/nameutil.h"
+
+using cqsp::common::Universe;
+using cqsp::common::systems::simulation::SimulationThread;
+using cqsp::common::systems::simulation::WorldSnapshot;
+
+void WorldSnapshot::Capture(Universe& universe) {
+    ZoneScoped;
+    namespace cqspc = cqsp::common::components;
+    namespace cqspt = cqsp::common::components::types;
+    namespace cqspb = cqsp::common::components::bodies;
+    date = universe.date.GetDate();
+    seconds = universe.date.ToSecond();
+
+    bodies.clear();
+    for (auto [entity, kinematics] : universe.view<cqspt::Kinematics>().each()) {
+        Body& body = bodies[entity];
+        body.position = kinematics.position;
+        body.center = kinematics.center;
+        body.has_future = false;
+        if (const auto* future = universe.try_get<cqspt::FuturePosition>(entity); future != nullptr) {
+            body.future_position = future->position;
+            body.future_center = future->center;
+            body.has_future = true;
+        }
+
+        body.name = cqsp::common::util::GetName(universe, entity);
+        if (const auto* orbit = universe.try_get<cqspt::Orbit>(entity); orbit != nullptr) {
+            body.reference_body = orbit->reference_body;
+            body.has_orbit = true;
+        }
+        if (const auto* celestial = universe.try_get<cqspb::Body>(entity); celestial != nullptr) {
+            body.celestial = true;
+            body.radius = celestial->radius;
+            body.rotation = celestial->rotation;
+            body.axial = celestial->axial;
+            body.rotation_offset = celestial->rotation_offset;
+        }
+        body.star = universe.all_of<cqspb::LightEmitter>(entity);
+        body.planet = universe.all_of<cqspb::Planet>(entity);
+        body.ship = universe.all_of<cqspc::ships::Ship>(entity);
+        body.textured = universe.all_of<cqspb::TexturedTerrain>(entity);
+        if (const auto* habitation = universe.try_get<cqspc::Habitation>(entity); habitation != nullptr) {
+            body.settlements = habitation->settlements;
+        }
+    }
+
+    cities.clear();
+    for (auto [entity, settlement] : universe.view<cqspc::Settlement>().each()) {
+        City& city = cities[entity];
+        city.name = cqsp::common::util::GetName(universe, entity);
+        for (entt::entity segment : settlement.population) {
+            if (const auto* population = universe.try_get<cqspc::PopulationSegment>(segment); population != nullptr) {
+                city.population += population->population;
+            }
+        }
+    }
+
+    markets.clear();
+    for (auto [entity, market] : universe.view<cqspc::Market>().each()) {
+        markets[entity] = MarketSummary {market.GDP, market.previous_supply.GetSum(), market.previous_demand.GetSum()};
+    }
+}
+
+const WorldSnapshot::Body* WorldSnapshot::GetBody(entt::entity entity) const {
+    auto it = bodies.find(entity);
+    return it == bodies.end() ? nullptr : &it->second;
+}
+
+const WorldSnapshot::City* WorldSnapshot::GetCity(entt::entity entity) const {
+    auto it = cities.find(entity);
+    return it == cities.end() ? nullptr : &it->second;
+}
+
+const WorldSnapshot::MarketSummary* WorldSnapshot::GetMarket(entt::entity entity) const {
+    auto it = markets.find(entity);
+    return it == markets.end() ? nullptr : &it->second;
+}
+
+SimulationThread::SimulationThread(Game& game, Simulation& simulation) : game(game), simulation(simulation) {
+    // Both buffers have to be valid before the first tick
+    snapshots[0].Capture(game.GetUniverse());
+    snapshots[1] = snapshots[0];
+    last_tick = paused_at = std::chrono::steady_clock::now();
+}
+
+SimulationThread::~SimulationThread() { Stop(); }
+
+void SimulationThread::Start() {
+    std::scoped_lock lock(control_mutex);
+    if (thread.joinable()) {
+        return;
+    }
+    stopping = false;
+    thread = std::thread(&SimulationThread::Run, this);
+}
+
+void SimulationThread::Stop() {
+    {
+        std::scoped_lock lock(control_mutex);
+        stopping = true;
+        commands.clear();
+        fast_forward_target = -1;
+    }
+    simulation.CancelFastForward();
+    wake.notify_all();
+    if (thread.joinable()) {
+        thread.join();
+    }
+}
+
+void SimulationThread::SetRunning(bool to_run) {
+    {
+        std::scoped_lock lock(control_mutex);
+        if (running == to_run) {
+            return;
+        }
+        running = to_run;
+        if (running) {
+            // Continue waiting for the tick from where it was paused
+            last_tick += std::chrono::steady_clock::now() - paused_at;
+        } else {
+            paused_at = std::chrono::steady_clock::now();
+        }
+    }
+    wake.notify_all();
+}
+
+bool SimulationThread::IsRunning() const {
+    std::scoped_lock lock(control_mutex);
+    return running;
+}
+
+void SimulationThread::SetTickLength(std::chrono::milliseconds length) {
+    {
+        std::scoped_lock lock(control_mutex);
+        if (tick_length == length) {
+            return;
+        }
+        tick_length = length;
+    }
+    wake.notify_all();
+}
+
+void SimulationThread::FastForward(int target_date) {
+    {
+        std::scoped_lock lock(control_mutex);
+        fast_forward_target = target_date;
+    }
+    wake.notify_all();
+}
+
+void SimulationThread::CancelFastForward() {
+    {
+        std::scoped_lock lock(control_mutex);
+        fast_forward_target = -1;
+    }
+    simulation.CancelFastForward();
+}
+
+void SimulationThread::PushCommand(std::function<void(Universe&)> command) {
+    {
+        std::scoped_lock lock(control_mutex);
+        commands.push_back(std::move(command));
+    }
+    wake.notify_all();
+}
+
+SimulationThread::SnapshotView SimulationThread::EmptySnapshot() {
+    static const WorldSnapshot empty;
+    return SnapshotView(std::shared_lock<std::shared_mutex>(), empty);
+}
+
+SimulationThread::SnapshotView SimulationThread::ReadSnapshot() const {
+    // The buffers are only swapped while holding the lock exclusively, so the front buffer stays the same
+    // while the view holds the shared lock
+    std::shared_lock lock(snapshot_mutex);
+    const WorldSnapshot& snapshot = snapshots[front];
+    return SnapshotView(std::move(lock), snapshot);
+}
+
+double SimulationThread::GetTickFraction() const {
+    std::scoped_lock lock(control_mutex);
+    auto now = running ? std::chrono::steady_clock::now() : paused_at;
+    double fraction = std::chrono::duration<double>(now - last_tick) / std::chrono::duration<double>(tick_length);
+    return std::clamp(fraction, 0.0, 1.0);
+}
+
+void SimulationThread::Run() {
+    std::unique_lock lock(control_mutex);
+    while (!stopping) {
+        if (!commands.empty()) {
+            auto pending = std::move(commands);
+            commands.clear();
+            lock.unlock();
+            RunCommands(pending);
+            lock.lock();
+            continue;
+        }
+        if (fast_forward_target >= 0) {
+            const int target = fast_forward_target;
+            fast_forward_target = -1;
+            lock.unlock();
+            RunFastForward(target);
+            lock.lock();
+            // Start waiting for the next tick from now
+            last_tick = paused_at = std::chrono::steady_clock::now();
+            continue;
+        }
+        if (!running) {
+            wake.wait(lock);
+            continue;
+        }
+        const auto next_tick = last_tick + tick_length;
+        if (std::chrono::steady_clock::now() < next_tick) {
+            wake.wait_until(lock, next_tick);
+            continue;
+        }
+        // Keep to the tick length, but if the simulation has fallen more than a tick behind, don't try to catch
+        // up by running the missed ticks back to back
+        const auto now = std::chrono::steady_clock::now();
+        last_tick = (now - next_tick < tick_length) ? next_tick : now;
+        lock.unlock();
+        Tick();
+        lock.lock();
+    }
+}
+
+void SimulationThread::Tick() {
+    ZoneScoped;
+    std::scoped_lock lock(universe_mutex);
+    simulation.tick();
+    PublishSnapshot();
+}
+
+void SimulationThread::RunFastForward(int target_date) {
+    ZoneScoped;
+    std::unique_lock universe_lock(universe_mutex);
+    auto last_release = std::chrono::steady_clock::now();
+    simulation.FastForward(target_date, [&]() {
+        // Let the client draw a frame every now and then, so that it can show the progress and cancel
+        if (std::chrono::steady_clock::now() - last_release < std::chrono::milliseconds(50)) {
+            return;
+        }
+        universe_lock.unlock();
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        universe_lock.lock();
+        last_release = std::chrono::steady_clock::now();
+    });
+    PublishSnapshot();
+}
+
+void SimulationThread::PublishSnapshot() {
+    // Called with the universe locked
+    const int back = 1 - front;
+    snapshots[back].Capture(game.GetUniverse());
+    {
+        std::unique_lock lock(snapshot_mutex);
+        front = back;
+    }
+    tick_count++;
+}
+
+void SimulationThread::RunCommands(std::deque<std::function<void(Universe&)>>& pending) {
+    std::scoped_lock lock(universe_mutex);
+    for (auto& command : pending) {
+        command(game.GetUniverse());
+    }
+}
@@ -0,0 +1,231 @@
+/* Conquer Space
+ * Copyright (C) 2021-2023 Conquer Space
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <entt/entt.hpp>
+#include <glm/glm.hpp>
+
+#include "common/game.h"
+#include "common/simulation.h"
+
+namespace cqsp {
+namespace common {
+namespace systems {
+namespace simulation {
+/// <summary>
+/// The state that the client displays, copied out of the universe after every tick so that it can be read
+/// while the next tick is running.
+/// </summary>
+struct WorldSnapshot {
+    struct Body {
+        glm::dvec3 position;
+        glm::dvec3 center;
+        /// Where the body will be next tick, to interpolate between ticks with `Universe::tick_fraction`
+        glm::dvec3 future_position;
+        glm::dvec3 future_center;
+        bool has_future = false;
+
+        std::string name;
+        /// The body that it orbits, or null if it doesn't have an orbit
+        entt::entity reference_body = entt::null;
+        bool has_orbit = false;
+        /// If it is a star, planet, or moon, which also have the values of bodies::Body below
+        bool celestial = false;
+        bool star = false;
+        /// If the orbit is a planet's, which is always drawn
+        bool planet = false;
+        bool ship = false;
+        bool textured = false;
+        double radius = 0;
+        double rotation = 0;
+        double axial = 0;
+        double rotation_offset = 0;
+        std::vector<entt::entity> settlements;
+    };
+
+    struct City {
+        uint64_t population = 0;
+        std::string name;
+    };
+
+    struct MarketSummary {
+        double gdp = 0;
+        double supply = 0;
+        double demand = 0;
+    };
+
+    int date = 0;
+    /// The date in seconds, see StarDate::ToSecond
+    double seconds = 0;
+    std::unordered_map<entt::entity, Body> bodies;
+    std::unordered_map<entt::entity, City> cities;
+    std::unordered_map<entt::entity, MarketSummary> markets;
+
+    /// <summary>
+    /// Copies the state out of the universe, reusing the memory of the last capture.
+    /// </summary>
+    void Capture(Universe& universe);
+
+    const Body* GetBody(entt::entity entity) const;
+    const City* GetCity(entt::entity entity) const;
+    const MarketSummary* GetMarket(entt::entity entity) const;
+};
+
+/// <summary>
+/// Runs the simulation on its own thread, so that a slow tick doesn't hold up rendering.
+/// </summary>
+/// The simulation holds the universe lock while it ticks. Anything on another thread that reads the universe
+/// directly has to hold the lock, and anything that changes the universe should go through PushCommand, so
+/// that it happens between ticks. The state that is drawn every frame is published in a double buffered
+/// WorldSnapshot after each tick, which can be read without waiting for the tick to finish. Code that runs
+/// every frame should draw from the snapshot, or use TryLockUniverse and keep what it showed last if a tick is
+/// running, so that a slow tick doesn't hold up the frame.
+class SimulationThread {
+ public:
+    SimulationThread(Game& game, Simulation& simulation);
+    ~SimulationThread();
+
+    SimulationThread(const SimulationThread&) = delete;
+    SimulationThread& operator=(const SimulationThread&) = delete;
+
+    void Start();
+    /// <summary>
+    /// Stops the thread after the current tick is done. Commands that are still queued are dropped.
+    /// </summary>
+    void Stop();
+
+    /// <summary>
+    /// Sets if the simulation should tick. Commands are still run while it is paused.
+    /// </summary>
+    void SetRunning(bool running);
+    bool IsRunning() const;
+    void SetTickLength(std::chrono::milliseconds length);
+
+    /// <summary>
+    /// Runs ticks as fast as possible until the date reaches `target_date`, see Simulation::FastForward. The
+    /// snapshot is only updated when the fast forward is done.
+    /// </summary>
+    void FastForward(int target_date);
+    void CancelFastForward();
+    FastForwardProgress GetFastForwardProgress() const { return simulation.GetFastForwardProgress(); }
+
+    /// <summary>
+    /// Queues a change to the universe, which is run on the simulation thread before the next tick.
+    /// </summary>
+    void PushCommand(std::function<void(Universe&)> command);
+
+    /// <summary>
+    /// Locks the universe so that it can be read or changed directly. This waits for the current tick to finish.
+    /// </summary>
+    std::unique_lock<std::timed_mutex> LockUniverse() { return std::unique_lock(universe_mutex); }
+
+    /// <summary>
+    /// Locks the universe if it can be locked within `wait`, such as when the simulation is between ticks.
+    /// </summary>
+    /// <returns>The lock, which doesn't own the mutex if the simulation kept it for longer than `wait`</returns>
+    std::unique_lock<std::timed_mutex> TryLockUniverse(std::chrono::microseconds wait = {}) {
+        std::unique_lock lock(universe_mutex, std::defer_lock);
+        lock.try_lock_for(wait);
+        return lock;
+    }
+
+    /// <summary>
+    /// Snapshot of the last finished tick. The snapshot isn't replaced while this is held.
+    /// </summary>
+    class SnapshotView {
+     public:
+        const WorldSnapshot& operator*() const { return snapshot; }
+        const WorldSnapshot* operator->() const { return &snapshot; }
+
+     private:
+        friend class SimulationThread;
+        SnapshotView(std::shared_lock<std::shared_mutex>&& lock, const WorldSnapshot& snapshot)
+            : lock(std::move(lock)), snapshot(snapshot) {}
+
+        std::shared_lock<std::shared_mutex> lock;
+        const WorldSnapshot& snapshot;
+    };
+    SnapshotView ReadSnapshot() const;
+    /// <summary>
+    /// A snapshot with nothing in it, for when there isn't a simulation to read from.
+    /// </summary>
+    static SnapshotView EmptySnapshot();
+
+    /// <summary>
+    /// How far the simulation is into waiting for the next tick, from 0 to 1.
+    /// </summary>
+    double GetTickFraction() const;
+
+    /// <summary>
+    /// Number of ticks that have finished, so that the client can tell when a tick has happened.
+    /// </summary>
+    uint64_t GetTickCount() const { return tick_count.load(); }
+
+    /// <summary>
+    /// The simulation being run. Only the parts of it that are safe to use from other threads, like the
+    /// telemetry, should be used without holding the universe lock.
+    /// </summary>
+    Simulation& GetSimulation() { return simulation; }
+
+ private:
+    void Run();
+    void Tick();
+    void RunFastForward(int target_date);
+    void PublishSnapshot();
+    void RunCommands(std::deque<std::function<void(Universe&)>>& pending);
+
+    Game& game;
+    Simulation& simulation;
+    std::thread thread;
+
+    std::timed_mutex universe_mutex;
+
+    // Guards everything that controls the thread
+    mutable std::mutex control_mutex;
+    std::condition_variable wake;
+    std::deque<std::function<void(Universe&)>> commands;
+    bool running = false;
+    bool stopping = false;
+    // The date that was asked to be fast forwarded to, or -1 if there isn't any
+    int fast_forward_target = -1;
+    std::chrono::steady_clock::duration tick_length = std::chrono::milliseconds(100);
+    std::chrono::steady_clock::time_point last_tick;
+    std::chrono::steady_clock::time_point paused_at;
+
+    WorldSnapshot snapshots[2];
+    int front = 0;
+    mutable std::shared_mutex snapshot_mutex;
+    std::atomic<uint64_t> tick_count = 0;
+};
+}  // namespace simulation
+}  // namespace systems
+}  // namespace common
+}  // namespace cqsp
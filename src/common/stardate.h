@@ -51,6 +51,10 @@ class StarDate {
     static const int DAY = 24 * HOUR;
     static const int WEEK = DAY * 7;
 
+    // Ticks in an earth day and year, for when the player asks for calendar time, like when fast forwarding
+    static const int TICKS_PER_DAY = 24 * 60 * 60 / TIME_INCREMENT;
+    static const int TICKS_PER_YEAR = TICKS_PER_DAY * 365;
+
     void IncrementDate() { date++; }
 
     int GetDate() { return date; }
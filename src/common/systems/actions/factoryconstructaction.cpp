@@ -74,9 +74,11 @@ entt::entity cqsp::common::systems::actions::CreateFactory(Universe& universe, e
 
     // Add capacity
     // Add producivity
-    auto& prod = universe.emplace<cqspc::IndustrySize>(factory);
-    prod.size = productivity;
-    prod.utilization = productivity;
+    // Adding both puts the factory into Universe::IndustryGroup, which moves its components, so references to
+    // them can't be held across the emplaces
+    universe.emplace<cqspc::IndustrySize>(factory, static_cast<double>(productivity),
+                                          static_cast<double>(productivity));
+    universe.emplace<cqspc::CostBreakdown>(factory);
     const auto& recipe_comp = universe.get<cqspc::Recipe>(recipe);
     switch (recipe_comp.type) {
         case cqspc::mine:
@@ -18,38 +18,24 @@
 
 #include <spdlog/spdlog.h>
 
+#include <algorithm>
+#include <cmath>
+#include <utility>
+
 bool cqsp::common::systems::BuyGood(components::AuctionHouse& auction_house, entt::entity agent, entt::entity good,
                                     double price, double quantity) {
     // The orders we want to try and fufill
     auto& sell_order_list = auction_house.sell_orders[good];
-    auto& buy_order_list = auction_house.buy_orders[good];
 
-    // Check if goods are being sold
-    if (sell_order_list.empty()) {
-        // Then make new buy order
-        components::Order order(price, quantity, agent);
-        buy_order_list.put(order);
-        return false;
-    }
-    // Then pop the first in the list, and check if the price works
-    while (!sell_order_list.empty()) {
-        components::Order& first = sell_order_list.front();
-        // Then check if the price is right
-        if (first.price > price) {
-            break;
-        }
-        // Buy good, and fufill demand
+    // Take from the cheapest sell orders until they cost more than we want to pay
+    while (quantity > 0 && !sell_order_list.empty() && sell_order_list.BestPrice() <= price) {
+        const components::Order& first = sell_order_list.front();
         if (first.quantity > quantity) {
-            first.quantity -= quantity;
+            sell_order_list.Fill(quantity);
             quantity = 0;
-            // Also subtract wallet
-            // Thing done!
-            return true;
         } else {
-            // remove order, remove quantity
             quantity -= first.quantity;
-            // Remove buy order
-            sell_order_list.erase(sell_order_list.begin());
+            sell_order_list.pop_front();
         }
     }
 
@@ -57,48 +43,24 @@ bool cqsp::common::systems::BuyGood(components::AuctionHouse& auction_house, ent
         return true;
     }
     // Then place a buy order because the order could not be fufulled.
-    components::Order order(price, quantity, agent);
-    buy_order_list.put(order);
+    auction_house.buy_orders[good].put(components::Order(price, quantity, agent));
     return false;
 }
 
 bool cqsp::common::systems::SellGood(components::AuctionHouse& auction_house, entt::entity agent, entt::entity good,
                                      double price, double quantity) {
-    // The place we will put our order if we cannot fufill it
-    auto& sell_order_list = auction_house.sell_orders[good];
-
     // The orders we want to try and fufill
     auto& buy_order_list = auction_house.buy_orders[good];
 
-    // Check if goods are being sold
-    if (buy_order_list.empty()) {
-        // Then make new order
-        components::Order order(price, quantity, agent);
-        sell_order_list.put(order);
-        return false;
-    }
-    // Then pop the first in the list, and check if the price works
-    while (!buy_order_list.empty()) {
-        components::Order& first = buy_order_list.front();
-        // Then check if the price is right
-        if (first.price < price) {
-            break;
-        }
-        // Buy good, and fufill demand
+    // Sell to the highest bids until they offer less than we want
+    while (quantity > 0 && !buy_order_list.empty() && buy_order_list.BestPrice() >= price) {
+        const components::Order& first = buy_order_list.front();
         if (first.quantity > quantity) {
-            first.quantity -= quantity;
+            buy_order_list.Fill(quantity);
             quantity = 0;
-            // Also subtract wallet
-            // Thing done!
-            return true;
         } else {
-            // remove order, remove quantity
             quantity -= first.quantity;
-            // Remove buy order
-            buy_order_list.erase(buy_order_list.begin());
-            if (quantity == 0) {
-                break;
-            }
+            buy_order_list.pop_front();
         }
     }
 
@@ -106,7 +68,141 @@ bool cqsp::common::systems::SellGood(components::AuctionHouse& auction_house, en
         return true;
     }
     // Then place a sell order because the order could not be fufulled.
-    components::Order order(price, quantity, agent);
-    sell_order_list.put(order);
+    auction_house.sell_orders[good].put(components::Order(price, quantity, agent));
     return false;
 }
+
+namespace cqsp::common::systems {
+namespace {
+/// <summary>
+/// Fills orders from the front of the book until volume runs out or the orders are past the price
+/// </summary>
+template <class Book, class Eligible>
+void FillOrders(Book& book, entt::entity good, double price, double volume, bool buy, Eligible eligible,
+                std::vector<AuctionFill>& fills) {
+    while (volume > 0 && !book.empty() && eligible(book.BestPrice())) {
+        const components::Order& order = book.front();
+        const double quantity = std::min(order.quantity, volume);
+        fills.push_back({order.agent, good, quantity, price, buy});
+        volume -= quantity;
+        if (quantity < order.quantity) {
+            book.Fill(quantity);
+        } else {
+            book.pop_front();
+        }
+    }
+}
+}  // namespace
+
+AuctionResult ClearAuction(components::AskOrderBook& sell_orders, components::BidOrderBook& buy_orders,
+                           entt::entity good, std::vector<AuctionFill>& fills) {
+    AuctionResult result;
+    if (sell_orders.empty() || buy_orders.empty() || sell_orders.BestPrice() > buy_orders.BestPrice()) {
+        return result;
+    }
+    // The volume can only change at the price of a level, so only those prices have to be tried
+    std::vector<double> prices;
+    for (const auto& [price, level] : sell_orders.GetLevels()) {
+        prices.push_back(price);
+    }
+    for (const auto& [price, level] : buy_orders.GetLevels()) {
+        prices.push_back(price);
+    }
+    std::sort(prices.begin(), prices.end());
+    prices.erase(std::unique(prices.begin(), prices.end()), prices.end());
+
+    // Supply at a price is everything offered at or below it, and demand is everything bid at or above it.
+    // Supply grows with the price and demand shrinks, so both are swept once from the lowest price up.
+    auto ask = sell_orders.GetLevels().begin();
+    auto bid = buy_orders.GetLevels().rbegin();
+    double supply = 0;
+    double demand = buy_orders.GetQuantity();
+    double best_imbalance = 0;
+    double lowest = 0;
+    double highest = 0;
+    for (double price : prices) {
+        for (; ask != sell_orders.GetLevels().end() && ask->first <= price; ask++) {
+            supply += ask->second.quantity;
+        }
+        for (; bid != buy_orders.GetLevels().rend() && bid->first < price; bid++) {
+            demand -= bid->second.quantity;
+        }
+        const double volume = std::min(supply, demand);
+        const double imbalance = std::abs(supply - demand);
+        if (volume > result.volume || (volume == result.volume && volume > 0 && imbalance < best_imbalance)) {
+            result.volume = volume;
+            best_imbalance = imbalance;
+            lowest = price;
+            highest = price;
+        } else if (volume == result.volume && volume > 0 && imbalance == best_imbalance) {
+            highest = price;
+        }
+    }
+    if (result.volume <= 0) {
+        return result;
+    }
+    // Any price between equally good prices trades the same volume, so meet in the middle
+    result.price = (lowest + highest) / 2;
+    const double price = result.price;
+    FillOrders(
+        buy_orders, good, price, result.volume, true, [price](double bid) { return bid >= price; }, fills);
+    FillOrders(
+        sell_orders, good, price, result.volume, false, [price](double ask) { return ask <= price; }, fills);
+    return result;
+}
+
+std::vector<AuctionFill> ClearAuctions(components::AuctionHouse& auction_house, util::ThreadPool* pool) {
+    std::vector<std::pair<components::AskOrderBook*, components::BidOrderBook*>> books;
+    std::vector<entt::entity> goods;
+    for (auto& [good, sell_orders] : auction_house.sell_orders) {
+        auto buy_orders = auction_house.buy_orders.find(good);
+        if (sell_orders.empty() || buy_orders == auction_house.buy_orders.end() || buy_orders->second.empty()) {
+            continue;
+        }
+        books.emplace_back(&sell_orders, &buy_orders->second);
+        goods.push_back(good);
+    }
+
+    // Each good's books are only touched by one task
+    std::vector<std::vector<AuctionFill>> good_fills(goods.size());
+    auto clear = [&](size_t i) { ClearAuction(*books[i].first, *books[i].second, goods[i], good_fills[i]); };
+    if (pool != nullptr) {
+        pool->ParallelFor(goods.size(), clear);
+    } else {
+        for (size_t i = 0; i < goods.size(); i++) {
+            clear(i);
+        }
+    }
+
+    std::vector<AuctionFill> fills;
+    for (auto& good : good_fills) {
+        fills.insert(fills.end(), good.begin(), good.end());
+    }
+    return fills;
+}
+
+void ApplyAuctionFills(Universe& universe, components::Market& market, const std::vector<AuctionFill>& fills) {
+    for (const AuctionFill& fill : fills) {
+        const double cost = fill.quantity * fill.price;
+        auto* wallet = universe.try_get<components::Wallet>(fill.agent);
+        auto* stockpile = universe.try_get<components::ResourceStockpile>(fill.agent);
+        if (fill.buy) {
+            market.demand[fill.good] += fill.quantity;
+            if (wallet != nullptr) {
+                *wallet -= cost;
+            }
+            if (stockpile != nullptr) {
+                (*stockpile)[fill.good] += fill.quantity;
+            }
+        } else {
+            market.supply[fill.good] += fill.quantity;
+            if (wallet != nullptr) {
+                *wallet += cost;
+            }
+            if (stockpile != nullptr) {
+                (*stockpile)[fill.good] -= fill.quantity;
+            }
+        }
+    }
+}
+}  // namespace cqsp::common::systems
@@ -16,9 +16,14 @@
  */
 #pragma once
 
+#include <vector>
+
 #include <entt/entt.hpp>
 
 #include "common/components/auction.h"
+#include "common/components/economy.h"
+#include "common/universe.h"
+#include "common/util/threadpool.h"
 
 namespace cqsp {
 namespace common {
@@ -46,6 +51,51 @@ bool BuyGood(components::AuctionHouse& auction_house, entt::entity agent, entt::
 /// placed.</returns>
 bool SellGood(components::AuctionHouse& auction_house, entt::entity agent, entt::entity good, double price,
               double quantity);
+
+/// <summary>
+/// Goods that changed hands when an auction was cleared
+/// </summary>
+struct AuctionFill {
+    entt::entity agent;
+    entt::entity good;
+    double quantity;
+    /// Price per unit, the clearing price of the good
+    double price;
+    /// If the agent bought the goods, otherwise it sold them
+    bool buy;
+};
+
+struct AuctionResult {
+    double price = 0;
+    double volume = 0;
+};
+
+/// <summary>
+/// Clears the book of a good as a call auction. Instead of matching orders as they come in (see BuyGood and
+/// SellGood), the orders are added with AuctionHouse::AddBuyOrder and AddSellOrder during the tick, then
+/// matched all at once at the single price that trades the most goods. Every buy order at or above that
+/// price and every sell order at or below it trades at that price, best price first and in the order they
+/// were placed, until the volume runs out. What isn't filled stays in the books.
+/// </summary>
+/// <param name="fills">The trades are added to the end of this</param>
+/// <returns>The clearing price and volume, the volume is 0 if no orders cross</returns>
+AuctionResult ClearAuction(components::AskOrderBook& sell_orders, components::BidOrderBook& buy_orders,
+                           entt::entity good, std::vector<AuctionFill>& fills);
+
+/// <summary>
+/// Clears the books of every good in the auction house, with the goods split across the thread pool.
+/// </summary>
+/// <param name="pool">Can be null to clear them on this thread</param>
+/// <returns>The trades, sorted by good, which is the same no matter how many threads there are</returns>
+std::vector<AuctionFill> ClearAuctions(components::AuctionHouse& auction_house, util::ThreadPool* pool = nullptr);
+
+/// <summary>
+/// Settles the trades of a cleared auction. Buyers pay for and receive the goods, sellers are paid and give
+/// them up, and the goods traded are added to the supply and demand of the market. Money and goods are only
+/// checked when the order is placed, so an agent that spent them since can end up below zero.
+/// </summary>
+/// <param name="market">The market the auction house belongs to</param>
+void ApplyAuctionFills(Universe& universe, components::Market& market, const std::vector<AuctionFill>& fills);
 }  // namespace systems
 }  // namespace common
 }  // namespace cqsp
@@ -18,10 +18,16 @@
 
 #include <spdlog/spdlog.h>
 
+#include <algorithm>
+#include <limits>
+#include <utility>
+#include <vector>
+
 #include <tracy/Tracy.hpp>
 
 #include "common/components/area.h"
 #include "common/components/economy.h"
+#include "common/components/history.h"
 #include "common/components/infrastructure.h"
 #include "common/components/name.h"
 #include "common/components/organizations.h"
@@ -31,81 +37,114 @@
 namespace cqsp::common::systems {
 namespace cqspc = cqsp::common::components;
 namespace {
+using IndustryGroup = decltype(std::declval<Universe&>().IndustryGroup());
+
+/// <summary>
+/// Gets the lowest supply to demand ratio of the goods, on the last day that the market recorded
+/// </summary>
+double GetLimitingRatio(const std::vector<uint32_t>& goods, const components::MarketHistory* history) {
+    if (history == nullptr) {
+        // Markets start out balanced
+        return goods.empty() ? std::numeric_limits<double>::infinity() : 1;
+    }
+    double ratio = std::numeric_limits<double>::infinity();
+    for (uint32_t good : goods) {
+        ratio = std::min(ratio, history->Latest(components::MarketMetric::SDRatio, good));
+    }
+    return ratio;
+}
+
 /// <summary>
 /// Runs the production cycle
 /// Consumes material from the market based on supply and then sells the manufactured goods on the market.
 /// </summary>
 /// <param name="universe">Registry used for searching for components</param>
 /// <param name="entity">Entity containing an Inudstries that need to be processed</param>
-/// <param name="market">The market the industry uses.</param>
-void ProcessIndustries(Universe& universe, entt::entity entity) {
+/// <param name="industry_group">The factories, see Universe::IndustryGroup</param>
+/// <param name="payments">Wages that the industries pay to the population, paid after all cities are done</param>
+void ProcessIndustries(Universe& universe, entt::entity entity, const IndustryGroup& industry_group,
+                       SysProduction::WagePayments& payments) {
     auto& market = universe.get<components::Market>(entity);
+    const auto* history = universe.try_get<components::MarketHistory>(entity);
     // Get the transport cost
     auto& infrastructure = universe.get<cqspc::infrastructure::CityInfrastructure>(entity);
     // Calculate the infrastructure cost
     double infra_cost = infrastructure.default_purchase_cost - infrastructure.improvement;
 
     auto& industries = universe.get<cqspc::IndustrialZone>(entity);
-    auto& population_wallet =
-        universe.get_or_emplace<cqspc::Wallet>(universe.get<cqspc::Settlement>(entity).population.front());
+    payments.population = universe.get<cqspc::Settlement>(entity).population.front();
+    payments.wages.clear();
     for (entt::entity productionentity : industries.industries) {
         // Process imdustries
-        // Industries MUST have production and a linked recipe
-        if (!universe.all_of<components::Production>(productionentity)) continue;
-        components::Recipe recipe =
-            universe.get_or_emplace<components::Recipe>(universe.get<components::Production>(productionentity).recipe);
-        components::IndustrySize& size = universe.get_or_emplace<components::IndustrySize>(productionentity, 1000.0);
-        // Calculate resource consumption
-        components::ResourceLedger capitalinput = recipe.capitalcost * (0.01 * size.size);
-        components::ResourceLedger input = (recipe.input + size.utilization) + capitalinput;
-
-        // Calculate the greatest possible production
-        components::ResourceLedger output;  // * ratio.output;
-        output[recipe.output.entity] = recipe.output.amount * size.utilization;
+        // Industries MUST have production and a linked recipe, and a size and costs to be in the group
+        if (!industry_group.contains(productionentity)) continue;
+        auto [size, costs, production] =
+            industry_group.get<components::IndustrySize, components::CostBreakdown, components::Production>(
+                productionentity);
+        // The recipes are compiled in CompileRecipes
+        const components::CompiledRecipe& recipe = universe.get<components::CompiledRecipe>(production.recipe);
+        // Resources are consumed at the utilization from before it is adjusted
+        const double utilization = size.utilization;
 
         // Figure out what's throttling production and maintenance
-        double limitedinput = CopyVals(input, market.history.back().sd_ratio).Min();
-        double limitedcapitalinput = CopyVals(capitalinput, market.history.back().sd_ratio).Min();
+        double limitedcapitalinput = GetLimitingRatio(recipe.capital_goods, history);
+        double limitedinput = std::min(GetLimitingRatio(recipe.input_goods, history), limitedcapitalinput);
 
         // Log how much manufacturing is being throttled by input
-        market[recipe.output.entity].inputratio = limitedinput;
+        market[recipe.output].inputratio = limitedinput;
 
-        if (market.sd_ratio[recipe.output.entity] < 1.1) {
+        if (market.sd_ratio[recipe.output] < 1.1) {
             size.utilization *= 1 + (0.01) * std::fmin(limitedcapitalinput, 1);
         } else {
             size.utilization *= 0.99;
         }
         size.utilization = std::clamp(size.utilization, 0., size.size);
 
-        if (limitedinput < 1) {  // If an input good is undersupplied on
-                                 // the market, throttle production
-            input *= limitedinput;
-            output *= limitedinput;
-            // Industry
+        // If an input good is undersupplied on the market, throttle production
+        const double throttle = limitedinput < 1 ? limitedinput : 1;
+
+        // Calculate resource consumption
+        double input_total = 0;
+        for (size_t i = 0; i < recipe.input_goods.size(); i++) {
+            const double amount = (recipe.input_amounts[i] + utilization) * throttle;
+            market.demand.At(recipe.input_goods[i]) += amount;
+            input_total += amount;
+        }
+        const double capital_scale = 0.01 * size.size * throttle;
+        for (size_t i = 0; i < recipe.capital_goods.size(); i++) {
+            const double amount = recipe.capital_amounts[i] * capital_scale;
+            market.demand.At(recipe.capital_goods[i]) += amount;
+            input_total += amount;
         }
 
-        market.demand += input;
-        market.supply += output;
+        // Calculate the greatest possible production
+        double output = recipe.output_amount * utilization * throttle;
+        market.supply.At(recipe.output_good) += output;
 
-        double output_transport_cost = output.GetSum() * infra_cost;
-        double input_transport_cost = input.GetSum() * infra_cost;
+        double output_transport_cost = output * infra_cost;
+        double input_transport_cost = input_total * infra_cost;
         // Next time need to compute the costs along with input and
         // output so that the factory doesn't overspend. We sorta
         // need a balanced economy
-        components::CostBreakdown& costs = universe.get_or_emplace<components::CostBreakdown>(productionentity);
 
         // Maintenance costs will still have to be upkept, so if
         // there isnt any resources to upkeep the place, then stop
         // the production
-        costs.materialcosts = (recipe.input * size.utilization * market.price).GetSum();
-        costs.revenue = (recipe.output * market.price).GetSum();
-        if (market.sd_ratio[recipe.output.entity] > 1) {
-            costs.revenue /= market.sd_ratio[recipe.output.entity];
+        costs.materialcosts = 0;
+        for (size_t i = 0; i < recipe.input_goods.size(); i++) {
+            const uint32_t good = recipe.input_goods[i];
+            // Like multiplying by the price ledger, goods without a price keep their amount
+            const double price = market.price.HasIndex(good) ? market.SettledPrice(good) : 1;
+            costs.materialcosts += recipe.input_amounts[i] * size.utilization * price;
+        }
+        double& price = market.SettlePrice(recipe.output_good);
+        costs.revenue = price * recipe.output_amount;
+        if (market.sd_ratio[recipe.output] > 1) {
+            costs.revenue /= market.sd_ratio[recipe.output];
         }
         costs.wages = size.size * recipe.workers * size.wages;
         costs.profit = costs.revenue - costs.maintenance - costs.materialcosts - costs.wages;
         costs.transport = output_transport_cost + input_transport_cost;
-        double& price = market.price[recipe.output.entity];
         if (costs.profit > 0) {
             price += (-0.1 + price * -0.01f);
         } else {
@@ -113,25 +152,89 @@ void ProcessIndustries(Universe& universe, entt::entity entity) {
         }
 
         // Pay the workers
-        population_wallet += costs.wages;
+        payments.wages.push_back(costs.wages);
     }
 }
 }  // namespace
 
+SysProduction::SysProduction(Game& game) : ISimulationSystem(game) {
+    Reads<components::IndustrialZone, components::Production, components::Recipe,
+          cqspc::infrastructure::CityInfrastructure, components::Settlement, components::MarketHistory>();
+    // Recipes are compiled if they haven't been
+    Writes<components::Market, components::CompiledRecipe, components::IndustrySize, components::CostBreakdown,
+           components::Wallet>();
+}
+
+void SysProduction::CompileRecipes() {
+    Universe& universe = GetUniverse();
+    // Recipes made outside of the loader, such as in tests, are compiled the first time they're used
+    auto view = universe.view<components::Recipe>(entt::exclude<components::CompiledRecipe>);
+    uncompiled.assign(view.begin(), view.end());
+    for (entt::entity recipe : uncompiled) {
+        const auto& source = universe.get<components::Recipe>(recipe);
+        universe.emplace<components::CompiledRecipe>(recipe, components::CompileRecipe(source));
+    }
+}
+
+void SysProduction::SortIndustries() {
+    Universe& universe = GetUniverse();
+    auto industry_group = universe.IndustryGroup();
+    if (industry_group.size() == sorted_industries) {
+        return;
+    }
+    // Order the factories by the city that they're in, and then by their order in the city, so that each city
+    // walks its own run of the packed components
+    industry_order.assign(industry_order.size(), std::numeric_limits<uint32_t>::max());
+    uint32_t position = 0;
+    for (entt::entity city : cities) {
+        for (entt::entity factory : universe.get<cqspc::IndustrialZone>(city).industries) {
+            const auto id = static_cast<size_t>(entt::to_entity(factory));
+            if (id >= industry_order.size()) {
+                industry_order.resize(id + 1, std::numeric_limits<uint32_t>::max());
+            }
+            industry_order[id] = position++;
+        }
+    }
+    auto order = [&](entt::entity entity) {
+        const auto id = static_cast<size_t>(entt::to_entity(entity));
+        return id < industry_order.size() ? industry_order[id] : std::numeric_limits<uint32_t>::max();
+    };
+    industry_group.sort([&](entt::entity a, entt::entity b) { return order(a) < order(b); });
+    sorted_industries = industry_group.size();
+}
+
 void SysProduction::DoSystem() {
     ZoneScoped;
     Universe& universe = GetUniverse();
     auto view = universe.view<components::IndustrialZone, components::Market>();
     // Each industrial zone is a a market
     BEGIN_TIMED_BLOCK(INDUSTRY);
-    int factories = 0;
-    // Loop through the markets
-    int settlement_count = 0;
-    // Get the markets and process the values?
-    for (entt::entity entity : view) {
-        ProcessIndustries(universe, entity);
+    cities.assign(view.begin(), view.end());
+    CompileRecipes();
+    SortIndustries();
+    payments.resize(cities.size());
+
+    // Every city only writes to its own market and industries, so the cities can be processed at the same time
+    const IndustryGroup industry_group = universe.IndustryGroup();
+    auto process = [&](size_t i) { ProcessIndustries(universe, cities[i], industry_group, payments[i]); };
+    if (util::ThreadPool* pool = GetThreadPool(); pool != nullptr) {
+        pool->ParallelFor(cities.size(), process);
+    } else {
+        for (size_t i = 0; i < cities.size(); i++) {
+            process(i);
+        }
+    }
+
+    // Pay the wages in the same order as processing the cities one by one would, so that the wallets are the
+    // same no matter how many threads there are
+    for (const WagePayments& payment : payments) {
+        auto& population_wallet = universe.get<cqspc::Wallet>(payment.population);
+        for (double wage : payment.wages) {
+            population_wallet += wage;
+        }
     }
     END_TIMED_BLOCK(INDUSTRY);
-    SPDLOG_TRACE("Updated {} factories, {} industries", factories, view.size());
+    CountProcessed(cities.size());
+    SPDLOG_TRACE("Updated {} industries", cities.size());
 }
 }  // namespace cqsp::common::systems
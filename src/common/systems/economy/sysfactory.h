@@ -16,6 +16,8 @@
  */
 #pragma once
 
+#include <vector>
+
 #include "common/systems/isimulationsystem.h"
 
 namespace cqsp::common::systems {
@@ -24,8 +26,35 @@ namespace cqsp::common::systems {
 // Main goal is to maintain stable pricing
 class SysProduction : public ISimulationSystem {
  public:
-    explicit SysProduction(Game& game) : ISimulationSystem(game) {}
+    explicit SysProduction(Game& game);
     void DoSystem() override;
     int Interval() override { return components::StarDate::DAY; }
+
+    /// <summary>
+    /// Wages that a city's industries pay to the city's population during a tick.
+    /// </summary>
+    /// Cities are processed on different threads, so the wages are buffered and paid out afterwards in the
+    /// same order as a serial run would pay them.
+    struct WagePayments {
+        entt::entity population = entt::null;
+        std::vector<double> wages;
+    };
+
+ private:
+    /// <summary>
+    /// Compiles the recipes that don't have a CompiledRecipe, before the cities are processed on other threads
+    /// </summary>
+    void CompileRecipes();
+    /// <summary>
+    /// Sorts Universe::IndustryGroup by city when the number of factories has changed
+    /// </summary>
+    void SortIndustries();
+
+    std::vector<entt::entity> cities;
+    std::vector<WagePayments> payments;
+    std::vector<entt::entity> uncompiled;
+    // Position of each factory in the sorted group, by entity id
+    std::vector<uint32_t> industry_order;
+    size_t sorted_industries = 0;
 };
 }  // namespace cqsp::common::systems
@@ -19,6 +19,10 @@
 #include "common/components/economy.h"
 
 namespace cqsp::common::systems {
+SysWalletReset::SysWalletReset(Game& game) : ISimulationSystem(game) {
+    Writes<components::Wallet>();
+}
+
 void SysWalletReset::DoSystem() {
     namespace cqspc = cqsp::common::components;
     auto view = GetUniverse().view<cqspc::Wallet>();
@@ -21,7 +21,7 @@
 namespace cqsp::common::systems {
 class SysWalletReset : public ISimulationSystem {
  public:
-    explicit SysWalletReset(Game& game) : ISimulationSystem(game) {}
+    explicit SysWalletReset(Game& game);
     void DoSystem();
 };
 }  // namespace cqsp::common::systems
@@ -21,22 +21,30 @@
 #include "common/components/area.h"
 #include "common/components/infrastructure.h"
 
+cqsp::common::systems::InfrastructureSim::InfrastructureSim(Game& game) : ISimulationSystem(game) {
+    namespace cqspc = cqsp::common::components;
+    Reads<cqspc::IndustrialZone, cqspc::infrastructure::PowerPlant, cqspc::infrastructure::PowerConsumption,
+          cqspc::infrastructure::Highway>();
+    Writes<cqspc::infrastructure::CityPower, cqspc::infrastructure::BrownOut,
+           cqspc::infrastructure::CityInfrastructure>();
+}
+
 void cqsp::common::systems::InfrastructureSim::DoSystem() {
     ZoneScoped;
     namespace cqspc = cqsp::common::components;
     Universe& universe = GetUniverse();
     // Get all cities with industry and infrastruture
-    auto view = universe.view<cqspc::IndustrialZone>();
-    for (entt::entity entity : view) {
-        auto& industry = universe.get<cqspc::IndustrialZone>(entity);
+    auto view = universe.view<cqspc::IndustrialZone, cqspc::infrastructure::CityInfrastructure>();
+    for (auto [entity, industry, infra] : view.each()) {
         double power_production = 0;
         double power_consumption = 0;
         for (entt::entity industrial_site : industry.industries) {
-            if (universe.any_of<cqspc::infrastructure::PowerPlant>(industrial_site)) {
-                power_production += universe.get<cqspc::infrastructure::PowerPlant>(industrial_site).production;
+            // Look each site up once instead of checking and then getting
+            if (const auto* plant = universe.try_get<cqspc::infrastructure::PowerPlant>(industrial_site)) {
+                power_production += plant->production;
             }
-            if (universe.any_of<cqspc::infrastructure::PowerConsumption>(industrial_site)) {
-                power_consumption += universe.get<cqspc::infrastructure::PowerConsumption>(industrial_site).max;
+            if (const auto* consumption = universe.try_get<cqspc::infrastructure::PowerConsumption>(industrial_site)) {
+                power_consumption += consumption->max;
             }
         }
         // Now assign infrastrutural information
@@ -49,11 +57,10 @@ void cqsp::common::systems::InfrastructureSim::DoSystem() {
         } else {
             universe.remove<cqspc::infrastructure::BrownOut>(entity);
         }
-        auto& infra = GetUniverse().get<cqspc::infrastructure::CityInfrastructure>(entity);
         infra.improvement = 0;
         // Add highway things I guess
-        if (GetUniverse().any_of<cqspc::infrastructure::Highway>(entity)) {
-            infra.improvement += GetUniverse().get<cqspc::infrastructure::Highway>(entity).extent;
+        if (const auto* highway = universe.try_get<cqspc::infrastructure::Highway>(entity)) {
+            infra.improvement += highway->extent;
         }
     }
 }
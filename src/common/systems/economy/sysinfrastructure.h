@@ -23,7 +23,7 @@ namespace common {
 namespace systems {
 class InfrastructureSim : public ISimulationSystem {
  public:
-    explicit InfrastructureSim(Game& game) : ISimulationSystem(game) {}
+    explicit InfrastructureSim(Game& game);
     void DoSystem();
 };
 }  // namespace systems
@@ -22,10 +22,69 @@
 
 #include <tracy/Tracy.hpp>
 
+#include "common/components/auction.h"
 #include "common/components/economy.h"
+#include "common/components/history.h"
 #include "common/components/name.h"
+#include "common/systems/economy/auctionhandler.h"
 
-void cqsp::common::systems::SysMarket::DoSystem() {
+namespace cqsp::common::systems {
+namespace {
+/// <summary>
+/// The supply to demand ratio of a good, the same as in Market::supply.SafeDivision(Market::demand)
+/// </summary>
+double SupplyDemandRatio(const components::Market& market, entt::entity good) {
+    const double supply = market.supply[good];
+    if (!market.demand.HasGood(good)) {
+        // SafeDivision leaves the goods that aren't in the divisor alone
+        return supply;
+    }
+    const double demand = market.demand[good];
+    if (demand == 0) {
+        return std::numeric_limits<double>::infinity();
+    }
+    return (supply == 0) ? 0 : supply / demand;
+}
+
+void UpdatePrice(double& price, double sd_ratio) {
+    // If supply and demand = 0, then it will be undefined
+    if (sd_ratio < 1) {
+        // Too much demand, so we will increase the price
+        // Later increase it based on SD ratio
+        price += (0.02 + price * 0.01f);
+        //price = 0.5;
+    } else if (sd_ratio > 1 || sd_ratio == std::numeric_limits<double>::infinity()) {
+        // Too much supply, so we will decrease the price
+        price += (-0.01 + price * -0.01f);
+
+        // Limit price to a minimum of 0.001
+        if (price < 0.00001) {
+            price = 0.00001;
+        }
+    } else {
+        // Keep price approximately the same
+    }
+}
+
+/// <summary>
+/// Prices a good that was traded, after it catches up on the steps that it missed while it wasn't
+/// </summary>
+void PriceGood(components::Market& market, entt::entity good, double sd_ratio) {
+    UpdatePrice(market.SettlePrice(good), sd_ratio);
+    // This run's step was the update
+    market.priced_run[good] = market.pricing_runs + 1;
+}
+}  // namespace
+
+SysMarket::SysMarket(Game& game) : ISimulationSystem(game) {
+    Reads<components::Price>();
+    Writes<components::Market>();
+    Writes<components::AuctionHouse>();
+    Writes<components::Wallet>();
+    Writes<components::ResourceStockpile>();
+}
+
+void SysMarket::DoSystem() {
     ZoneScoped;
     // Get all the new and improved (tm) markets
     auto marketview = GetUniverse().view<components::Market>();
@@ -33,6 +92,7 @@ void cqsp::common::systems::SysMarket::DoSystem() {
     TracyPlot("Market Count", (int64_t)marketview.size());
     auto goodsview = GetUniverse().view<components::Price>();
     Universe& universe = GetUniverse();
+    size_t active_markets = 0;
     // Calculate all the things
     for (entt::entity entity : marketview) {
         // Get the resources and process the price, then do things, I guess
@@ -42,36 +102,38 @@ void cqsp::common::systems::SysMarket::DoSystem() {
         // TODO(EhWhoAmI): GDP Calculations
         // market.gdp = market.volume* market.price;
 
-        // Calculate Supply and demand
-        market.sd_ratio = market.supply.SafeDivision(market.demand);
-        // market.ds_ratio = market.previous_demand.SafeDivision(market.supply);
-        // market.ds_ratio = market.ds_ratio.Clamp(0, 2);
+        // The orders placed in the auction house during the day trade now, before the goods are priced
+        if (auto* auction_house = universe.try_get<components::AuctionHouse>(entity); auction_house != nullptr) {
+            ApplyAuctionFills(universe, market, ClearAuctions(*auction_house, GetThreadPool()));
+        }
 
-        for (entt::entity good_entity : goodsview) {
-            const double sd_ratio = market.sd_ratio[good_entity];
-            double& price = market.price[good_entity];
-            // If supply and demand = 0, then it will be undefined
-            if (sd_ratio < 1) {
-                // Too much demand, so we will increase the price
-                // Later increase it based on SD ratio
-                price += (0.02 + price * 0.01f);
-                //price = 0.5;
-            } else if (sd_ratio > 1 || sd_ratio == std::numeric_limits<double>::infinity()) {
-                // Too much supply, so we will decrease the price
-                price += (-0.01 + price * -0.01f);
-
-                // Limit price to a minimum of 0.001
-                if (price < 0.00001) {
-                    price = 0.00001;
+        // Only the goods that had supply or demand this tick are priced, most markets only trade a few of the
+        // goods, and markets that didn't trade anything are skipped. The prices of the other goods take the
+        // step for goods without supply when they are next used, see Market::SettledPrice.
+        market.sd_ratio.clear();
+        if (!market.supply.empty() || !market.demand.empty()) {
+            active_markets++;
+            for (const auto& [good_entity, amount] : market.supply) {
+                if (goodsview.contains(good_entity)) {
+                    const double sd_ratio = SupplyDemandRatio(market, good_entity);
+                    market.sd_ratio[good_entity] = sd_ratio;
+                    PriceGood(market, good_entity, sd_ratio);
+                }
+            }
+            for (const auto& [good_entity, amount] : market.demand) {
+                // The goods with supply are done already
+                if (!market.supply.HasGood(good_entity) && goodsview.contains(good_entity)) {
+                    const double sd_ratio = SupplyDemandRatio(market, good_entity);
+                    market.sd_ratio[good_entity] = sd_ratio;
+                    PriceGood(market, good_entity, sd_ratio);
                 }
-            } else {
-                // Keep price approximately the same
             }
         }
-        // Set the previous supply and demand
-        //components::MarketInformation current = market;
-        //market.history.push_back(current);
+        market.pricing_runs++;
+        // market.ds_ratio = market.previous_demand.SafeDivision(market.supply);
+        // market.ds_ratio = market.ds_ratio.Clamp(0, 2);
 
+        // Set the previous supply and demand, SysMarketHistory records them later in the tick
         // Swap and clear?
         std::swap(market.supply, market.previous_supply);
         std::swap(market.demand, market.previous_demand);
@@ -82,9 +144,10 @@ void cqsp::common::systems::SysMarket::DoSystem() {
         market.latent_supply.clear();
         market.latent_demand.clear();
     }
+    CountProcessed(active_markets);
 }
 
-void cqsp::common::systems::SysMarket::InitializeMarket(Game& game) {
+void SysMarket::InitializeMarket(Game& game) {
     auto marketview = game.GetUniverse().view<components::Market>();
     auto goodsview = game.GetUniverse().view<components::Price>();
 
@@ -95,9 +158,16 @@ void cqsp::common::systems::SysMarket::InitializeMarket(Game& game) {
         // Get demand
         components::Market& market = universe.get<components::Market>(entity);
 
+        // Markets that already have history were loaded from a save, and keep their prices
+        auto* history = universe.try_get<components::MarketHistory>(entity);
+        if (history != nullptr && history->GetTier(components::HistoryResolution::Daily).Size() > 0) {
+            continue;
+        }
+
         // Initialize the price
         for (entt::entity goodenity : goodsview) {
             market.price[goodenity] = universe.get<components::Price>(goodenity);
+            market.priced_run[goodenity] = market.pricing_runs;
             // Set the supply and demand things as 1 so that they sell for
             // now
             market.previous_demand[goodenity] = 1;
@@ -106,6 +176,10 @@ void cqsp::common::systems::SysMarket::InitializeMarket(Game& game) {
             market.demand[goodenity] = 1;
         }
         market.sd_ratio = market.supply.SafeDivision(market.demand);
-        market.history.push_back(market);
+        if (history == nullptr) {
+            history = &universe.emplace<components::MarketHistory>(entity);
+        }
+        history->Record(universe.date.GetDate(), market, 0);
     }
 }
+}  // namespace cqsp::common::systems
@@ -21,12 +21,13 @@
 namespace cqsp::common::systems {
 class SysMarket : public ISimulationSystem {
  public:
-    explicit SysMarket(Game& game) : ISimulationSystem(game) {}
+    explicit SysMarket(Game& game);
     void DoSystem() override;
     int Interval() override { return components::StarDate::DAY; }
 
     /// <summary>
-    /// To be called before the game starts
+    /// To be called before the game starts. Markets that already have history, such as the ones in a
+    /// loaded save, are left as they are.
     /// </summary>
     /// <param name="game"></param>
     static void InitializeMarket(Game& game);
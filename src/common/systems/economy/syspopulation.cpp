@@ -18,6 +18,8 @@
 
 #include <spdlog/spdlog.h>
 
+#include <utility>
+
 #include <tracy/Tracy.hpp>
 
 #include "common/components/economy.h"
@@ -39,9 +41,7 @@ void SysPopulationGrowth::DoSystem() {
     namespace cqspc = cqsp::common::components;
     Universe& universe = GetUniverse();
 
-    auto view = universe.view<cqspc::PopulationSegment>();
-    for (entt::entity entity : view) {
-        auto& segment = universe.get<cqspc::PopulationSegment>(entity);
+    for (auto [entity, segment, employee] : universe.PopulationGroup().each()) {
         // If it's hungry, decay population
         if (universe.all_of<cqspc::Hunger>(entity)) {
             // Population decrease will be about 1 percent each year.
@@ -67,15 +67,98 @@ void SysPopulationGrowth::DoSystem() {
         // For now, we would have 100% of the population working, because we
         // haven't got to social simulation yet. But in the future, this will
         // probably have to change.
-        auto& employee = universe.get_or_emplace<cqspc::LaborInformation>(entity);
         employee.working_population = segment.population;
     }
 }
 
 namespace {
-void ProcessSettlement(cqsp::common::Universe& universe, entt::entity settlement, cqspc::Market& market,
-                       cqspc::ResourceConsumption& marginal_propensity_base,
-                       cqspc::ResourceConsumption& autonomous_consumption_base, float savings) {
+/// <summary>
+/// The consumer goods of a market, worked out once per market so that each population segment only needs a few
+/// multiplications. It gives the same results as putting the ledgers together for every segment.
+/// </summary>
+struct ConsumptionBasis {
+    // Price of the autonomous consumption of one consumer
+    double autonomous_cost = 0;
+    // Goods bought with each unit of money left over, the marginal propensity divided by the price
+    cqspc::ResourceLedger marginal;
+
+    // The goods split by whether the market had supply of them last tick. Only the goods with supply can be bought,
+    // the rest turns into latent demand. The supplied ledgers hold every good consumed, with 0 for the goods
+    // without supply, because those goods still show up in the demand.
+    cqspc::ResourceLedger supplied_autonomous;
+    cqspc::ResourceLedger supplied_marginal;
+    cqspc::ResourceLedger unsupplied_autonomous;
+    cqspc::ResourceLedger unsupplied_marginal;
+    double supplied_autonomous_sum = 0;
+    double supplied_marginal_sum = 0;
+
+    void Build(const cqspc::Market& market, const cqspc::ResourceLedger& autonomous_consumption_base,
+               const cqspc::ResourceLedger& marginal_propensity_base) {
+        autonomous_cost = (autonomous_consumption_base * market.price).GetSum();
+        marginal = marginal_propensity_base / market.price;
+        supplied_autonomous.clear();
+        supplied_marginal.clear();
+        unsupplied_autonomous.clear();
+        unsupplied_marginal.clear();
+        supplied_autonomous_sum = 0;
+        supplied_marginal_sum = 0;
+        auto add = [&](entt::entity good) {
+            if (supplied_autonomous.HasGood(good)) {
+                return;
+            }
+            const double autonomous = autonomous_consumption_base[good];
+            const double extra = std::as_const(marginal)[good];
+            if (market.previous_supply[good] > 0) {
+                supplied_autonomous[good] = autonomous;
+                supplied_marginal[good] = extra;
+                supplied_autonomous_sum += autonomous;
+                supplied_marginal_sum += extra;
+            } else {
+                // Still in the demand, but as nothing
+                supplied_autonomous[good] = 0;
+                supplied_marginal[good] = 0;
+                unsupplied_autonomous[good] = autonomous;
+                unsupplied_marginal[good] = extra;
+            }
+        };
+        for (const auto& [good, amount] : autonomous_consumption_base) {
+            add(good);
+        }
+        for (const auto& [good, amount] : marginal) {
+            add(good);
+        }
+    }
+};
+
+/// <summary>
+/// What the segments of a market consumed, added to the market once all of its settlements are done
+/// </summary>
+struct ConsumptionTotals {
+    // Consumers in segments that had no money left after autonomous consumption
+    double broke_consumers = 0;
+    size_t broke_segments = 0;
+    // Consumers and money left over in the segments that could buy more
+    double spending_consumers = 0;
+    double spending_money = 0;
+    size_t spending_segments = 0;
+
+    void AddTo(cqspc::Market& market, const cqspc::ResourceLedger& autonomous_consumption_base,
+               const ConsumptionBasis& basis) const {
+        if (broke_segments > 0) {
+            market.demand.MultiplyAdd(autonomous_consumption_base, broke_consumers);
+        }
+        if (spending_segments > 0) {
+            market.demand.MultiplyAdd(basis.supplied_autonomous, spending_consumers);
+            market.demand.MultiplyAdd(basis.supplied_marginal, spending_money);
+            market.latent_demand.MultiplyAdd(basis.unsupplied_autonomous, spending_consumers);
+            market.latent_demand.MultiplyAdd(basis.unsupplied_marginal, spending_money);
+        }
+    }
+};
+
+void ProcessSettlement(cqsp::common::Universe& universe, entt::entity settlement,
+                       const cqspc::ResourceLedger& autonomous_consumption_base, const ConsumptionBasis& basis,
+                       ConsumptionTotals& totals, float savings) {
     // Get the transport cost
     auto& infrastructure = universe.get<cqspc::infrastructure::CityInfrastructure>(settlement);
     // Calculate the infrastructure cost
@@ -84,61 +167,47 @@ void ProcessSettlement(cqsp::common::Universe& universe, entt::entity settlement
     // Loop through the population segments through the settlements
     auto& settlement_comp = universe.get<cqspc::Settlement>(settlement);
     for (entt::entity segmententity : settlement_comp.population) {
-        // Compute things
-        cqspc::PopulationSegment& segment = universe.get_or_emplace<cqspc::PopulationSegment>(segmententity);
-        cqspc::ResourceConsumption& consumption = universe.get_or_emplace<cqspc::ResourceConsumption>(segmententity);
+        auto [segment, wallet] = universe.get<cqspc::PopulationSegment, cqspc::Wallet>(segmententity);
+        // Keeps its storage from the last tick, so refilling it doesn't allocate
+        auto& consumption = universe.get_or_emplace<cqspc::ResourceConsumption>(segmententity);
+        consumption.clear();
         // Reduce pop to some unreasonably low level so that the economy can
         // handle it
-        const uint64_t population = segment.population / 10;
-
-        consumption = autonomous_consumption_base;
-
-        // This value only changes when pop changes and
-        // should be calculated in SysPopulationGrowth
-        consumption *= population;
+        const double consumers = static_cast<double>(segment.population / 10);
 
-        cqspc::Wallet& wallet = universe.get_or_emplace<cqspc::Wallet>(segmententity);
-        const double cost = (consumption * market.price).GetSum();
-        wallet -= cost;    // Spend, even if it puts the pop into debt
+        wallet -= consumers * basis.autonomous_cost;  // Spend, even if it puts the pop into debt
         if (wallet > 0) {  // If the pop has cash left over spend it
-            // Add to the cost of price of transport
-            cqspc::ResourceConsumption extraconsumption = marginal_propensity_base;
-            // Loop through all the things, if there isn't enough resources for a
-            // If the market supply has all of the goods, then they can buy the goods
-            // Get previous market supply
-            // the total consumption
-            // Add to the cost
-            // They can buy less because of things
-            //extraconsumption *= infra_cost;
-            extraconsumption *= wallet;        // Distribute wallet amongst goods
-            extraconsumption /= market.price;  // Find out how much of each good you can buy
-            consumption += extraconsumption;   // Remove purchased goods from the market
-            for (auto& t : consumption) {
-                // Look for in the market, and then if supply is zero, then deny them buying
-                if (market.previous_supply[t.first] <= 0) {
-                    // Then they cannot buy the stuff
-                    // Then do the consumption
-                    // Add to latent demand
-                    market.latent_demand[t.first] += t.second;
-                    t.second = 0;
-                }
-            }
-            // Consumption
-            // Check if there's enough on the market
+            // Distribute the wallet amongst the goods, and find out how much of each good they can buy. The goods
+            // that the market has no supply of can't be bought, so they are only paid for the goods with supply.
+            const double money = wallet;
+            consumption.MultiplyAdd(basis.supplied_autonomous, consumers);
+            consumption.MultiplyAdd(basis.supplied_marginal, money);
+            totals.spending_consumers += consumers;
+            totals.spending_money += money;
+            totals.spending_segments++;
             // Add the transport costs, and because they're importing it, we only account this
-            double cost = consumption.GetSum() * infra_cost;
+            double cost =
+                (consumers * basis.supplied_autonomous_sum + money * basis.supplied_marginal_sum) * infra_cost;
             wallet *= savings;  // Update savings
             wallet -= cost;
+        } else {
+            consumption.MultiplyAdd(autonomous_consumption_base, consumers);
+            totals.broke_consumers += consumers;
+            totals.broke_segments++;
         }
 
         // TODO(EhWhoAmI): Don't inject cash, take the money from the government
-        wallet += segment.population * 50000;  // Inject cash
-
-        market.demand += consumption;
+        wallet += static_cast<double>(segment.population * 50000);  // Inject cash
     }
 }
 }  // namespace
 
+SysPopulationConsumption::SysPopulationConsumption(Game& game) : ISimulationSystem(game) {
+    Reads<cqspc::ConsumerGood, cqspc::Habitation, cqspc::Settlement, cqspc::infrastructure::CityInfrastructure,
+          cqspc::PopulationSegment>();
+    Writes<cqspc::Market, cqspc::Wallet, cqspc::ResourceConsumption>();
+}
+
 // In economics, the consumption function describes a relationship between
 // consumption and disposable income.
 // Its simplest form is the linear consumption function used frequently in
@@ -169,8 +238,8 @@ void SysPopulationConsumption::DoSystem() {
     ZoneScoped;
     Universe& universe = GetUniverse();
 
-    cqspc::ResourceConsumption marginal_propensity_base;
-    cqspc::ResourceConsumption autonomous_consumption_base;
+    cqspc::ResourceLedger marginal_propensity_base;
+    cqspc::ResourceLedger autonomous_consumption_base;
     float savings = 1;  // We calculate how much is saved since it is simpler
                         // than calculating spending
     for (entt::entity cgentity : universe.consumergoods) {
@@ -179,23 +248,28 @@ void SysPopulationConsumption::DoSystem() {
         autonomous_consumption_base[cgentity] = good.autonomous_consumption;
         savings -= good.marginal_propensity;
     }  // These tables technically never need to be recalculated
-    auto settlementview = universe.view<cqspc::Settlement>();
 
     // Loop through the settlements on a planet, then process the market?
     auto market_view = universe.view<cqspc::Habitation>();
     int settlement_count = 0;
+    ConsumptionBasis basis;
     for (entt::entity entity : market_view) {
         // Get the children, because reasons
         // All planets with a habitation WILL have a market
         auto& market = universe.get_or_emplace<cqspc::Market>(entity);
+        // The prices and last tick's supply don't change while the segments consume
+        market.SettlePrices();
+        basis.Build(market, autonomous_consumption_base, marginal_propensity_base);
+        ConsumptionTotals totals;
         // Read the segment information
         auto& habit = universe.get<cqspc::Habitation>(entity);
         for (entt::entity settlement : habit.settlements) {
-            ProcessSettlement(universe, settlement, market, marginal_propensity_base, autonomous_consumption_base,
-                              savings);
+            ProcessSettlement(universe, settlement, autonomous_consumption_base, basis, totals, savings);
             settlement_count++;
         }
+        totals.AddTo(market, autonomous_consumption_base, basis);
     }
+    CountProcessed(settlement_count);
     SPDLOG_TRACE("Processing {} settlements in {} markets", settlement_count, market_view.size());
 }
 }  // namespace cqsp::common::systems
@@ -28,7 +28,7 @@ class SysPopulationGrowth : public ISimulationSystem {
 
 class SysPopulationConsumption : public ISimulationSystem {
  public:
-    explicit SysPopulationConsumption(Game& game) : ISimulationSystem(game) {}
+    explicit SysPopulationConsumption(Game& game);
     void DoSystem() override;
     int Interval() override { return components::StarDate::DAY; }
 };
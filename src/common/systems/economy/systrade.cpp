@@ -16,10 +16,19 @@
  */
 #include "common/systems/economy/systrade.h"
 
+#include <tracy/Tracy.hpp>
+
 #include "common/components/economy.h"
+#include "common/components/infrastructure.h"
 #include "common/components/surface.h"
 
+cqsp::common::systems::SysTrade::SysTrade(Game& game) : ISimulationSystem(game) {
+    Reads<components::PlanetaryMarket, components::Habitation, components::infrastructure::CityInfrastructure>();
+    Writes<components::Market>();
+}
+
 void cqsp::common::systems::SysTrade::DoSystem() {
+    ZoneScoped;
     // Sort through all the districts, and figure out their trade
     // Get all the markets
     // Then cross reference to see if they can buy or sell
@@ -39,4 +48,10 @@ void cqsp::common::systems::SysTrade::DoSystem() {
             p_market.demand += market.latent_demand;
         }
     }
+
+    // Then trade between the connected markets
+    network.Build(GetUniverse());
+    network.Solve(GetThreadPool());
+    network.Apply(GetUniverse());
+    CountProcessed(network.EdgeCount());
 }
@@ -16,6 +16,7 @@
  */
 #pragma once
 
+#include "common/systems/economy/tradenetwork.h"
 #include "common/systems/isimulationsystem.h"
 #include "common/universe.h"
 
@@ -25,8 +26,14 @@ namespace cqsp::common::systems {
 // Main goal is to maintain stable pricing
 class SysTrade : public ISimulationSystem {
  public:
-    explicit SysTrade(Game& game) : ISimulationSystem(game) {}
+    explicit SysTrade(Game& game);
     void DoSystem() override;
     int Interval() override { return components::StarDate::DAY; }
+
+    const TradeNetwork& GetNetwork() const { return network; }
+
+ private:
+    // Keeps the flows between ticks
+    TradeNetwork network;
 };
 }  // namespace cqsp::common::systems
@@ -0,0 +1,257 @@
+/* Conquer Space
+ * Copyright (C) 2021-2023 Conquer Space
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#include "common/systems/economy/tradenetwork.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#include <tracy/Tracy.hpp>
+
+#include "common/components/economy.h"
+#include "common/components/infrastructure.h"
+#include "common/components/resource.h"
+
+namespace cqsp::common::systems {
+namespace cqspc = cqsp::common::components;
+
+namespace {
+double TransportCost(Universe& universe, entt::entity city) {
+    const auto* infrastructure = universe.try_get<cqspc::infrastructure::CityInfrastructure>(city);
+    if (infrastructure == nullptr) {
+        return 0;
+    }
+    return std::max(0., infrastructure->default_purchase_cost - infrastructure->improvement);
+}
+
+/// <summary>
+/// The flow that the prices call for from one market to another, when the buying price is more than the
+/// selling price and the transport cost. The larger the margin, the more of the supply is shipped.
+/// </summary>
+double TargetFlow(double from_price, double to_price, double cost, double supply) {
+    const double margin = to_price - from_price - cost;
+    if (margin <= 0 || supply <= 0) {
+        return 0;
+    }
+    return supply * std::min(1., margin / std::max(from_price, 1e-9));
+}
+}  // namespace
+
+uint64_t TradeNetwork::EdgeKey(entt::entity a, entt::entity b) {
+    uint64_t first = entt::to_integral(a);
+    uint64_t second = entt::to_integral(b);
+    if (first > second) {
+        std::swap(first, second);
+    }
+    return (first << 32) | second;
+}
+
+uint32_t TradeNetwork::AddNode(entt::entity market) {
+    auto [it, inserted] = node_index.try_emplace(market, static_cast<uint32_t>(nodes.size()));
+    if (inserted) {
+        nodes.push_back(market);
+    }
+    return it->second;
+}
+
+bool TradeNetwork::TopologyChanged(Universe& universe) const {
+    if (!built) {
+        return true;
+    }
+    auto markets = universe.view<cqspc::Market>();
+    if (markets.size() != market_count) {
+        return true;
+    }
+    size_t connections = 0;
+    for (entt::entity entity : markets) {
+        connections += markets.get<cqspc::Market>(entity).connected_markets.size();
+    }
+    if (connections != connection_count) {
+        return true;
+    }
+    // A market could have been replaced by another one with as many connections
+    return std::any_of(nodes.begin(), nodes.end(), [&](entt::entity node) {
+        return !universe.valid(node) || !universe.all_of<cqspc::Market>(node);
+    });
+}
+
+void TradeNetwork::BuildTopology(Universe& universe) {
+    ZoneScoped;
+    std::vector<uint64_t> old_keys = std::move(edge_keys);
+    const size_t old_edges = old_keys.size();
+    nodes.clear();
+    node_index.clear();
+    edges.clear();
+    edge_keys.clear();
+    market_count = 0;
+    connection_count = 0;
+
+    // Connections are listed by one or both of the cities, but trade goes both ways
+    std::unordered_map<uint64_t, size_t> edge_lookup;
+    auto markets = universe.view<cqspc::Market>();
+    for (entt::entity entity : markets) {
+        const auto& market = markets.get<cqspc::Market>(entity);
+        market_count++;
+        connection_count += market.connected_markets.size();
+        for (entt::entity connected : market.connected_markets) {
+            if (connected == entity || !universe.valid(connected) || !universe.all_of<cqspc::Market>(connected)) {
+                continue;
+            }
+            const uint64_t key = EdgeKey(entity, connected);
+            if (!edge_lookup.try_emplace(key, edges.size()).second) {
+                continue;
+            }
+            const uint32_t a = AddNode(entity);
+            const uint32_t b = AddNode(connected);
+            // The cost is read every tick
+            edges.push_back({a, b, 0});
+            edge_keys.push_back(key);
+        }
+    }
+    built = true;
+
+    // Keep the flows of the edges that are still there
+    if (old_keys != edge_keys) {
+        std::vector<double> new_flows(static_cast<size_t>(goods) * edges.size(), 0);
+        for (size_t old_edge = 0; old_edge < old_edges; old_edge++) {
+            auto it = edge_lookup.find(old_keys[old_edge]);
+            if (it == edge_lookup.end()) {
+                continue;
+            }
+            for (uint32_t good = 0; good < goods; good++) {
+                new_flows[good * edges.size() + it->second] = flows[good * old_edges + old_edge];
+            }
+        }
+        flows = std::move(new_flows);
+    }
+}
+
+void TradeNetwork::Build(Universe& universe) {
+    ZoneScoped;
+    if (TopologyChanged(universe)) {
+        BuildTopology(universe);
+    }
+    // The goods are the outer index, so the goods that were added since the last tick start with no flow
+    goods = cqspc::GoodIndex::Count();
+    flows.resize(static_cast<size_t>(goods) * edges.size(), 0);
+
+    const size_t node_count = nodes.size();
+    transport_costs.resize(node_count);
+    prices.assign(static_cast<size_t>(goods) * node_count, std::numeric_limits<double>::quiet_NaN());
+    available.assign(static_cast<size_t>(goods) * node_count, 0);
+    for (uint32_t node = 0; node < node_count; node++) {
+        transport_costs[node] = TransportCost(universe, nodes[node]);
+        const auto& market = universe.get<cqspc::Market>(nodes[node]);
+        for (const auto& [good, price] : market.price) {
+            prices[cqspc::GoodIndex::Find(good) * node_count + node] = market.SettledPrice(good);
+        }
+        for (const auto& [good, amount] : market.previous_supply) {
+            available[cqspc::GoodIndex::Find(good) * node_count + node] = std::max(0., amount);
+        }
+    }
+    for (Edge& edge : edges) {
+        edge.cost = (transport_costs[edge.a] + transport_costs[edge.b]) / 2;
+    }
+}
+
+void TradeNetwork::Solve(util::ThreadPool* pool) {
+    ZoneScoped;
+    if (edges.empty()) {
+        return;
+    }
+    auto solve = [this](size_t good) {
+        // Each thread keeps its own, so the goods don't have to share
+        thread_local std::vector<double> outflow;
+        SolveGood(static_cast<uint32_t>(good), outflow);
+    };
+    if (pool != nullptr) {
+        pool->ParallelFor(goods, solve);
+    } else {
+        for (uint32_t good = 0; good < goods; good++) {
+            solve(good);
+        }
+    }
+}
+
+void TradeNetwork::SolveGood(uint32_t good, std::vector<double>& outflow) {
+    const size_t node_count = nodes.size();
+    const double* good_prices = &prices[good * node_count];
+    const double* good_available = &available[good * node_count];
+    double* good_flows = &flows[good * edges.size()];
+    outflow.assign(node_count, 0);
+
+    for (size_t e = 0; e < edges.size(); e++) {
+        const Edge& edge = edges[e];
+        const double price_a = good_prices[edge.a];
+        const double price_b = good_prices[edge.b];
+        double target = 0;
+        // Both markets have to trade the good
+        if (!std::isnan(price_a) && !std::isnan(price_b)) {
+            target = TargetFlow(price_a, price_b, edge.cost, good_available[edge.a]) -
+                     TargetFlow(price_b, price_a, edge.cost, good_available[edge.b]);
+        }
+        double& flow = good_flows[e];
+        flow += (target - flow) * relaxation;
+        if (std::abs(flow) < min_flow) {
+            // Stop the flows that are dying out, instead of trading tiny amounts forever
+            flow = 0;
+        }
+        outflow[flow > 0 ? edge.a : edge.b] += std::abs(flow);
+    }
+
+    // A market can't export more than it supplied, so scale down the exports of the markets that do
+    for (size_t e = 0; e < edges.size(); e++) {
+        const Edge& edge = edges[e];
+        double& flow = good_flows[e];
+        const uint32_t exporter = flow > 0 ? edge.a : edge.b;
+        if (outflow[exporter] > good_available[exporter]) {
+            flow *= good_available[exporter] / outflow[exporter];
+        }
+    }
+}
+
+void TradeNetwork::Apply(Universe& universe) const {
+    ZoneScoped;
+    std::vector<cqspc::Market*> markets(nodes.size());
+    for (size_t node = 0; node < nodes.size(); node++) {
+        markets[node] = &universe.get<cqspc::Market>(nodes[node]);
+    }
+    for (uint32_t good = 0; good < goods; good++) {
+        const entt::entity good_entity = cqspc::GoodIndex::Entity(good);
+        const double* good_flows = &flows[good * edges.size()];
+        for (size_t e = 0; e < edges.size(); e++) {
+            const double flow = good_flows[e];
+            if (flow == 0) {
+                continue;
+            }
+            const Edge& edge = edges[e];
+            cqspc::Market& exporter = *markets[flow > 0 ? edge.a : edge.b];
+            cqspc::Market& importer = *markets[flow > 0 ? edge.b : edge.a];
+            exporter.demand[good_entity] += std::abs(flow);
+            importer.supply[good_entity] += std::abs(flow);
+        }
+    }
+}
+
+double TradeNetwork::GetFlow(size_t edge, entt::entity good) const {
+    const uint32_t index = cqspc::GoodIndex::Find(good);
+    if (index >= goods) {
+        return 0;
+    }
+    return flows[index * edges.size() + edge];
+}
+}  // namespace cqsp::common::systems
@@ -0,0 +1,119 @@
+/* Conquer Space
+ * Copyright (C) 2021-2023 Conquer Space
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <entt/entt.hpp>
+
+#include "common/universe.h"
+#include "common/util/threadpool.h"
+
+namespace cqsp::common::systems {
+/// <summary>
+/// Moves goods between connected markets (Market::connected_markets) towards where they are worth more.
+/// </summary>
+/// The markets are the nodes of a graph, and every connection is an edge that costs the transport cost of its
+/// two cities (CityInfrastructure::default_purchase_cost minus the improvement) to ship a unit of goods along.
+/// When the price difference across an edge is more than that cost, goods flow from the cheap market to the
+/// expensive one, more the larger the margin, limited by what the exporting market supplied last tick.
+///
+/// The flows aren't solved from scratch every tick. Each tick moves the flows of the last tick part of the way
+/// towards the flows the current prices call for, and the prices then react to the trade, which diffuses the
+/// price differences through the network without having to look at more than the edges. Every good is solved
+/// on its own, so the goods are split across threads.
+///
+/// The graph is only built again when the markets or their connections change, which is checked with the
+/// number of markets and connections. Every tick only reads the prices, supply and transport costs.
+class TradeNetwork {
+ public:
+    struct Edge {
+        // Node indices
+        uint32_t a;
+        uint32_t b;
+        // Per unit of goods
+        double cost;
+    };
+
+    // How far the flows move towards their target each tick
+    static constexpr double relaxation = 0.5;
+    // Flows smaller than this are stopped
+    static constexpr double min_flow = 1e-6;
+
+    /// <summary>
+    /// Reads the transport costs, prices and last tick's supply of every connected market, and the connections
+    /// if they changed. The flows of edges that are still in the network are kept.
+    /// </summary>
+    void Build(Universe& universe);
+
+    /// <summary>
+    /// Updates the flows of every good from the prices read in Build
+    /// </summary>
+    /// <param name="pool">Splits the goods between threads, can be null</param>
+    void Solve(util::ThreadPool* pool = nullptr);
+
+    /// <summary>
+    /// Adds the flows to the markets, as demand in the exporting market and supply in the importing one
+    /// </summary>
+    void Apply(Universe& universe) const;
+
+    size_t NodeCount() const { return nodes.size(); }
+    size_t EdgeCount() const { return edges.size(); }
+    entt::entity GetNode(uint32_t node) const { return nodes[node]; }
+    const Edge& GetEdge(size_t edge) const { return edges[edge]; }
+
+    /// <summary>
+    /// Amount of good shipped along the edge each tick, positive from a to b and negative from b to a
+    /// </summary>
+    double GetFlow(size_t edge, entt::entity good) const;
+
+ private:
+    static uint64_t EdgeKey(entt::entity a, entt::entity b);
+    uint32_t AddNode(entt::entity market);
+    bool TopologyChanged(Universe& universe) const;
+    /// <summary>
+    /// Builds the nodes and edges from the connections of the markets
+    /// </summary>
+    void BuildTopology(Universe& universe);
+    void SolveGood(uint32_t good, std::vector<double>& outflow);
+
+    std::vector<entt::entity> nodes;
+    std::unordered_map<entt::entity, uint32_t> node_index;
+    std::vector<Edge> edges;
+    // Identifies the edges, so that flows can be kept when the network changes
+    std::vector<uint64_t> edge_keys;
+    // What the topology was built from, to tell when it has to be built again
+    size_t market_count = 0;
+    size_t connection_count = 0;
+    bool built = false;
+    // By node
+    std::vector<double> transport_costs;
+
+    // Number of goods in the arrays, see GoodIndex
+    uint32_t goods = 0;
+    // By good, then node. NaN if the market has no price for the good.
+    std::vector<double> prices;
+    // By good, then node
+    std::vector<double> available;
+    // By good, then edge
+    std::vector<double> flows;
+};
+}  // namespace cqsp::common::systems
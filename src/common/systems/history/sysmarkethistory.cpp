@@ -16,33 +16,28 @@
  */
 #include "common/systems/history/sysmarkethistory.h"
 
+#include <tracy/Tracy.hpp>
+
 #include "common/components/economy.h"
 #include "common/components/history.h"
 
-void cqsp::common::systems::history::SysMarketHistory::DoSystem() {
-    /*
-    auto view = GetUniverse().view<components::Market, components::MarketHistory>();
+cqsp::common::systems::history::SysMarketHistory::SysMarketHistory(Game& game) : ISimulationSystem(game) {
+    Reads<components::Market, components::Wallet>();
+    Writes<components::MarketHistory>();
+}
 
-    for (entt::entity marketentity : GetUniverse().view<components::Market>()) {
-        components::Market& market_data = GetUniverse().get<components::Market>(marketentity);
-        market_data.history.push_back(market_data);
-    }
-    auto view = GetUniverse().view<components::Market, components::MarketHistory>();
-    for (entt::entity entity : view) {
-        auto& history = GetUniverse().get<components::MarketHistory>(entity);
-        components::Market& market_data = GetUniverse().get<components::Market>(entity);
-        // Loop through the prices
-        for (auto resource : market_data.market_information) {
-            history.price_history[resource.first].push_back(resource.second.price);
-            history.volume[resource.first].push_back(market_data.last_market_information[resource.first].demand);
-        }
-        double val = 0;
-        for (entt::entity ent : market_data.participants) {
-            if (GetUniverse().any_of<components::Wallet>(ent)) {
-                auto& wallet = GetUniverse().get<components::Wallet>(ent);
-                val += wallet.GetGDPChange();
+void cqsp::common::systems::history::SysMarketHistory::DoSystem() {
+    ZoneScoped;
+    Universe& universe = GetUniverse();
+    const int date = universe.date.GetDate();
+    for (entt::entity entity : universe.view<components::Market>()) {
+        const components::Market& market = universe.get<components::Market>(entity);
+        double gdp = 0;
+        for (entt::entity participant : market.participants) {
+            if (universe.any_of<components::Wallet>(participant)) {
+                gdp += universe.get<components::Wallet>(participant).GetGDPChange();
             }
         }
-        history.gdp.push_back(val);
-    }*/
+        universe.get_or_emplace<components::MarketHistory>(entity).Record(date, market, gdp);
+    }
 }
@@ -22,8 +22,8 @@ namespace cqsp::common::systems {
 namespace history {
 class SysMarketHistory : public ISimulationSystem {
  public:
-    explicit SysMarketHistory(Game& game) : ISimulationSystem(game) {}
-    void DoSystem();
+    explicit SysMarketHistory(Game& game);
+    void DoSystem() override;
 };
 }  // namespace history
 }  // namespace cqsp::common::systems
@@ -16,14 +16,50 @@
  */
 #pragma once
 
+#include <cstddef>
+#include <set>
+
 #include <entt/entt.hpp>
 
 #include "common/game.h"
 #include "common/universe.h"
+#include "common/util/threadpool.h"
 
 namespace cqsp {
 namespace common {
 namespace systems {
+/// <summary>
+/// The components that a system reads and writes.
+/// </summary>
+/// The simulation uses this to run systems that don't touch the same components at the same time.
+/// A system that doesn't declare anything is exclusive, and is always run by itself.
+struct SystemAccess {
+    std::set<entt::id_type> reads;
+    std::set<entt::id_type> writes;
+    bool exclusive = true;
+
+    /// <summary>
+    /// If the two systems have to run in order, because one of them writes something that the other
+    /// reads or writes.
+    /// </summary>
+    bool ConflictsWith(const SystemAccess& other) const {
+        if (exclusive || other.exclusive) {
+            return true;
+        }
+        for (entt::id_type id : writes) {
+            if (other.reads.contains(id) || other.writes.contains(id)) {
+                return true;
+            }
+        }
+        for (entt::id_type id : other.writes) {
+            if (reads.contains(id)) {
+                return true;
+            }
+        }
+        return false;
+    }
+};
+
 class ISimulationSystem {
  public:
     explicit ISimulationSystem(Game& game) : game(game) {}
@@ -35,12 +71,69 @@ class ISimulationSystem {
     /// The default is 24
     virtual int Interval() { return components::StarDate::DAY; }
 
+    const SystemAccess& GetAccess() const { return access; }
+
+    /// <summary>
+    /// The simulation's worker threads, set by the simulation when the system is added.
+    /// </summary>
+    void SetThreadPool(util::ThreadPool* pool) { thread_pool = pool; }
+
+    /// <summary>
+    /// Number of entities the system reported with CountProcessed since the last call, for the telemetry
+    /// </summary>
+    size_t TakeProcessedCount() {
+        const size_t count = processed;
+        processed = 0;
+        return count;
+    }
+
  protected:
     Game& GetGame() { return game; }
     Universe& GetUniverse() { return game.GetUniverse(); }
+    /// <summary>
+    /// Worker threads that the system can split its own work over. This can be null, so systems have to
+    /// be able to run on their own.
+    /// </summary>
+    util::ThreadPool* GetThreadPool() { return thread_pool; }
+
+    /// <summary>
+    /// Adds to the number of entities processed this tick, which is shown in the tick telemetry.
+    /// Call it from DoSystem, not from tasks on the thread pool.
+    /// </summary>
+    void CountProcessed(size_t count) { processed += count; }
+
+    /// <summary>
+    /// Declares the components that this system only reads. Call this in the constructor.
+    /// </summary>
+    /// Systems that declare their components must not touch anything else in the universe, apart from
+    /// reading the date and the lookup tables that are filled while loading.
+    template <typename... Components>
+    void Reads() {
+        (Declare<Components>(access.reads), ...);
+    }
+
+    /// <summary>
+    /// Declares the components that this system writes, emplaces or removes. Call this in the constructor.
+    /// </summary>
+    template <typename... Components>
+    void Writes() {
+        (Declare<Components>(access.writes), ...);
+    }
 
  private:
+    template <typename Component>
+    void Declare(std::set<entt::id_type>& set) {
+        access.exclusive = false;
+        set.insert(entt::type_hash<Component>::value());
+        // Create the storage now, because the registry isn't thread safe when it adds a new storage
+        // while other systems are running
+        GetUniverse().template storage<Component>();
+    }
+
     Game& game;
+    SystemAccess access;
+    util::ThreadPool* thread_pool = nullptr;
+    size_t processed = 0;
 };
 }  // namespace systems
 }  // namespace common
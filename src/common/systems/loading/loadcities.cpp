@@ -72,6 +72,7 @@ bool CityLoader::LoadValue(const Hjson::Value& values, entt::entity entity) {
             segment.population = size;
             segment.labor_force = labor_force;
             universe.emplace<components::LaborInformation>(pop_ent);
+            universe.emplace<components::Wallet>(pop_ent);
             settlement.population.push_back(pop_ent);
         }
     } else {
@@ -84,6 +85,7 @@ bool CityLoader::LoadValue(const Hjson::Value& values, entt::entity entity) {
         segment.population = size;
         segment.labor_force = labor_force;
         universe.emplace<components::LaborInformation>(pop_ent);
+        universe.emplace<components::Wallet>(pop_ent);
         settlement.population.push_back(pop_ent);
         SPDLOG_WARN("City {} does not have any population", universe.get<components::Identifier>(entity).identifier);
     }
@@ -130,6 +130,8 @@ bool GoodLoader::LoadValue(const Hjson::Value& values, entt::entity entity) {
 
     // Basically if it fails at any point, we'll remove the component
     universe.goods[identifier] = entity;
+    // Give the good a compact index so that ledgers can store it densely
+    cqspc::GoodIndex::Register(entity);
     return true;
 }
 
@@ -195,6 +197,9 @@ bool RecipeLoader::LoadValue(const Hjson::Value& values, entt::entity entity) {
         }
     }
 
+    // Factories read the recipe in this form every tick
+    universe.emplace<cqspc::CompiledRecipe>(entity, cqspc::CompileRecipe(recipe_component));
+
     auto& name_object = universe.get<cqspc::Identifier>(entity);
     universe.recipes[name_object] = entity;
     return true;
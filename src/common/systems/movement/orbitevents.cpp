@@ -0,0 +1,69 @@
+/* Conquer Space
+ * Copyright (C) 2021-2023 Conquer Space
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#include "common/systems/movement/orbitevents.h"
+
+#include <utility>
+
+namespace cqsp::common::systems {
+void OrbitEventQueue::Schedule(entt::entity entity, double time) {
+    auto it = scheduled.find(entity);
+    if (it != scheduled.end() && it->second == time) {
+        return;
+    }
+    scheduled[entity] = time;
+    queue.push({time, entity});
+    if (queue.size() > 2 * scheduled.size() + 64) {
+        // Mostly replaced events, so rebuild the heap before it grows without bound
+        std::vector<Event> events;
+        events.reserve(scheduled.size());
+        for (const auto& [scheduled_entity, scheduled_time] : scheduled) {
+            events.push_back({scheduled_time, scheduled_entity});
+        }
+        queue = decltype(queue)(std::greater<Event>(), std::move(events));
+    }
+}
+
+void OrbitEventQueue::Remove(entt::entity entity) { scheduled.erase(entity); }
+
+void OrbitEventQueue::Clear() {
+    queue = {};
+    scheduled.clear();
+}
+
+void OrbitEventQueue::PopDue(double time, std::vector<entt::entity>& due) {
+    entt::entity entity;
+    while (PopNext(time, entity)) {
+        due.push_back(entity);
+    }
+}
+
+bool OrbitEventQueue::PopNext(double time, entt::entity& entity) {
+    while (!queue.empty() && queue.top().time <= time) {
+        const Event event = queue.top();
+        queue.pop();
+        auto it = scheduled.find(event.entity);
+        if (it == scheduled.end() || it->second != event.time) {
+            // Removed or rescheduled since
+            continue;
+        }
+        scheduled.erase(it);
+        entity = event.entity;
+        return true;
+    }
+    return false;
+}
+}  // namespace cqsp::common::systems
@@ -0,0 +1,68 @@
+/* Conquer Space
+ * Copyright (C) 2021-2023 Conquer Space
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#pragma once
+
+#include <functional>
+#include <queue>
+#include <unordered_map>
+#include <vector>
+
+#include <entt/entt.hpp>
+
+namespace cqsp::common::systems {
+/// <summary>
+/// Orbits ordered by the time of their next event, such as leaving their SOI, crashing, or their next burn.
+/// Each entity has at most one event. Rescheduling an entity leaves its old entry in the heap, which is
+/// skipped when it comes up.
+/// </summary>
+class OrbitEventQueue {
+ public:
+    /// <summary>
+    /// Sets the time of the next event of entity, replacing the previous one
+    /// </summary>
+    void Schedule(entt::entity entity, double time);
+    void Remove(entt::entity entity);
+    void Clear();
+
+    /// <summary>
+    /// Removes every event that happens at or before time, and adds their entities to due
+    /// </summary>
+    void PopDue(double time, std::vector<entt::entity>& due);
+
+    /// <summary>
+    /// Removes the earliest event if it happens at or before time. Use it instead of PopDue when handling an
+    /// event can schedule another one that is due before the rest.
+    /// </summary>
+    /// <returns>If there was an event that was due</returns>
+    bool PopNext(double time, entt::entity& entity);
+
+    bool IsScheduled(entt::entity entity) const { return scheduled.contains(entity); }
+    size_t Size() const { return scheduled.size(); }
+
+ private:
+    struct Event {
+        double time;
+        entt::entity entity;
+
+        bool operator>(const Event& other) const { return time > other.time; }
+    };
+
+    std::priority_queue<Event, std::vector<Event>, std::greater<Event>> queue;
+    // The current event of each entity, to tell apart the events that were replaced
+    std::unordered_map<entt::entity, double> scheduled;
+};
+}  // namespace cqsp::common::systems
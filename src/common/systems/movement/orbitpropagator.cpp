@@ -0,0 +1,167 @@
+/* Conquer Space
+ * Copyright (C) 2021-2023 Conquer Space
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#include "common/systems/movement/orbitpropagator.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include <tracy/Tracy.hpp>
+
+#include "common/components/bodies.h"
+#include "common/components/coordinates.h"
+#include "common/components/orbit.h"
+
+namespace cqsp::common::systems {
+namespace cqspc = cqsp::common::components;
+namespace cqspt = cqsp::common::components::types;
+
+namespace {
+// Orbits per task, small enough to split a few thousand orbits between threads
+constexpr size_t block_size = 256;
+}  // namespace
+
+void OrbitPropagator::Gather(Universe& universe, entt::entity root) {
+    ZoneScoped;
+    entities.clear();
+    parents.clear();
+    if (!universe.valid(root) || !universe.all_of<cqspt::Orbit>(root)) {
+        return;
+    }
+    entities.push_back(root);
+    parents.push_back(no_parent);
+    // Breadth first, so every orbit comes after its parent
+    for (size_t i = 0; i < entities.size(); i++) {
+        const auto* system = universe.try_get<cqspc::bodies::OrbitalSystem>(entities[i]);
+        if (system == nullptr) {
+            continue;
+        }
+        for (entt::entity child : system->children) {
+            if (!universe.valid(child) || !universe.all_of<cqspt::Orbit>(child)) {
+                continue;
+            }
+            entities.push_back(child);
+            parents.push_back(static_cast<uint32_t>(i));
+        }
+    }
+
+    const size_t count = entities.size();
+    eccentricity.resize(count);
+    mean_motion.resize(count);
+    M0.resize(count);
+    epoch.resize(count);
+    semi_param.resize(count);
+    velocity_scale.resize(count);
+    periapsis.resize(count);
+    ahead.resize(count);
+    for (size_t i = 0; i < count; i++) {
+        const auto& orbit = universe.get<cqspt::Orbit>(entities[i]);
+        const auto* cache = universe.try_get<cqspt::OrbitCache>(entities[i]);
+        if (cache == nullptr) {
+            cache = &universe.emplace<cqspt::OrbitCache>(entities[i], orbit);
+        }
+        eccentricity[i] = orbit.eccentricity;
+        M0[i] = orbit.M0;
+        epoch[i] = orbit.epoch;
+        mean_motion[i] = cache->mean_motion;
+        semi_param[i] = cache->semi_param;
+        velocity_scale[i] = cache->velocity_scale;
+        periapsis[i] = cache->rotation[0];
+        ahead[i] = cache->rotation[1];
+    }
+}
+
+void OrbitPropagator::Propagate(double time, double future_time, util::ThreadPool* pool) {
+    ZoneScoped;
+    const size_t count = entities.size();
+    mean_anomaly.resize(count);
+    future_mean_anomaly.resize(count);
+    eccentric_anomaly.resize(count);
+    future_eccentric_anomaly.resize(count);
+    true_anomaly.resize(count);
+    position.resize(count);
+    velocity.resize(count);
+    future_position.resize(count);
+
+    const size_t blocks = (count + block_size - 1) / block_size;
+    auto run_block = [&](size_t block) {
+        PropagateRange(block * block_size, std::min(count, (block + 1) * block_size), time, future_time);
+    };
+    if (pool != nullptr && blocks > 1) {
+        pool->ParallelFor(blocks, run_block);
+    } else {
+        for (size_t block = 0; block < blocks; block++) {
+            run_block(block);
+        }
+    }
+}
+
+void OrbitPropagator::PropagateRange(size_t begin, size_t end, double time, double future_time) {
+    for (size_t i = begin; i < end; i++) {
+        mean_anomaly[i] = cqspt::normalize_radian(M0[i] + (time - epoch[i]) * mean_motion[i]);
+        future_mean_anomaly[i] = cqspt::normalize_radian(M0[i] + (future_time - epoch[i]) * mean_motion[i]);
+    }
+    // Hyperbolic orbits go through the kernel as well to keep it branch free, and are solved again below
+    cqspt::SolveKeplerEllipticBatch(&mean_anomaly[begin], &eccentricity[begin], &eccentric_anomaly[begin],
+                                    end - begin);
+    cqspt::SolveKeplerEllipticBatch(&future_mean_anomaly[begin], &eccentricity[begin],
+                                    &future_eccentric_anomaly[begin], end - begin);
+
+    for (size_t i = begin; i < end; i++) {
+        const double e = eccentricity[i];
+        double v;
+        double future_v;
+        if (e < 1) {
+            v = cqspt::EccentricAnomalyToTrueAnomaly(e, eccentric_anomaly[i]);
+            future_v = cqspt::EccentricAnomalyToTrueAnomaly(e, future_eccentric_anomaly[i]);
+        } else {
+            const double Mt = cqspt::GetMtHyperbolic(M0[i], mean_motion[i], time, epoch[i]);
+            const double future_Mt = cqspt::GetMtHyperbolic(M0[i], mean_motion[i], future_time, epoch[i]);
+            v = cqspt::HyperbolicAnomalyToTrueAnomaly(e, cqspt::SolveKeplerHyperbolic(Mt, e));
+            future_v = cqspt::HyperbolicAnomalyToTrueAnomaly(e, cqspt::SolveKeplerHyperbolic(future_Mt, e));
+        }
+        true_anomaly[i] = v;
+
+        if (semi_param[i] == 0) {
+            position[i] = glm::dvec3(0);
+            velocity[i] = glm::dvec3(0);
+            future_position[i] = glm::dvec3(0);
+            continue;
+        }
+        const double cos_v = std::cos(v);
+        const double sin_v = std::sin(v);
+        const double r = semi_param[i] / (1 + e * cos_v);
+        position[i] = r * (cos_v * periapsis[i] + sin_v * ahead[i]);
+        velocity[i] = velocity_scale[i] * (-sin_v * periapsis[i] + (e + cos_v) * ahead[i]);
+
+        const double future_cos_v = std::cos(future_v);
+        const double future_r = semi_param[i] / (1 + e * future_cos_v);
+        future_position[i] = future_r * (future_cos_v * periapsis[i] + std::sin(future_v) * ahead[i]);
+    }
+}
+
+void OrbitPropagator::Scatter(Universe& universe) {
+    ZoneScoped;
+    for (size_t i = 0; i < entities.size(); i++) {
+        const entt::entity entity = entities[i];
+        universe.get<cqspt::Orbit>(entity).v = true_anomaly[i];
+        auto& kinematics = universe.get_or_emplace<cqspt::Kinematics>(entity);
+        kinematics.position = position[i];
+        kinematics.velocity = velocity[i];
+        universe.get_or_emplace<cqspt::FuturePosition>(entity).position = future_position[i];
+    }
+}
+}  // namespace cqsp::common::systems
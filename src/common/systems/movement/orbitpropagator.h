@@ -0,0 +1,96 @@
+/* Conquer Space
+ * Copyright (C) 2021-2023 Conquer Space
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+#include <entt/entt.hpp>
+#include <glm/glm.hpp>
+
+#include "common/universe.h"
+#include "common/util/threadpool.h"
+
+namespace cqsp::common::systems {
+/// <summary>
+/// Propagates every orbit in an orbit tree together. The orbital elements are gathered into flat arrays, Kepler's
+/// equation is solved for all of them in one batch, and the positions are written back, instead of walking the
+/// tree and solving one orbit at a time.
+/// </summary>
+class OrbitPropagator {
+ public:
+    static constexpr uint32_t no_parent = std::numeric_limits<uint32_t>::max();
+
+    /// <summary>
+    /// Collects the orbits of root and everything that orbits it, in topological order, so parents always
+    /// come before their children. The constants come from each orbit's OrbitCache, which is created for orbits
+    /// that don't have one yet.
+    /// </summary>
+    void Gather(Universe& universe, entt::entity root);
+
+    /// <summary>
+    /// Solves the position and velocity of every gathered orbit at time, and the position at future_time.
+    /// </summary>
+    /// <param name="pool">Splits the orbits between threads, can be null</param>
+    void Propagate(double time, double future_time, util::ThreadPool* pool = nullptr);
+
+    /// <summary>
+    /// Writes the true anomaly into the orbits, and the positions into Kinematics and FuturePosition, relative to
+    /// the parent. The centers are left to the caller, as they depend on the parent's state after the tick.
+    /// </summary>
+    void Scatter(Universe& universe);
+
+    size_t Size() const { return entities.size(); }
+    entt::entity GetEntity(size_t index) const { return entities[index]; }
+    /// <summary>
+    /// Index of the orbit's parent, or no_parent for the root
+    /// </summary>
+    uint32_t GetParent(size_t index) const { return parents[index]; }
+
+ private:
+    void PropagateRange(size_t begin, size_t end, double time, double future_time);
+
+    std::vector<entt::entity> entities;
+    std::vector<uint32_t> parents;
+
+    // Orbital elements
+    std::vector<double> eccentricity;
+    std::vector<double> mean_motion;
+    std::vector<double> M0;
+    std::vector<double> epoch;
+    // Semi latus rectum, 0 for orbits that have no size, such as crashed ships
+    std::vector<double> semi_param;
+    std::vector<double> velocity_scale;
+    // Unit vectors to the periapsis and 90 degrees ahead of it, in the parent frame
+    std::vector<glm::dvec3> periapsis;
+    std::vector<glm::dvec3> ahead;
+
+    // Scratch space for the kernel
+    std::vector<double> mean_anomaly;
+    std::vector<double> future_mean_anomaly;
+    std::vector<double> eccentric_anomaly;
+    std::vector<double> future_eccentric_anomaly;
+
+    // Results
+    std::vector<double> true_anomaly;
+    std::vector<glm::dvec3> position;
+    std::vector<glm::dvec3> velocity;
+    std::vector<glm::dvec3> future_position;
+};
+}  // namespace cqsp::common::systems
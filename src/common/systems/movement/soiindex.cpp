@@ -0,0 +1,90 @@
+/* Conquer Space
+ * Copyright (C) 2021-2023 Conquer Space
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#include "common/systems/movement/soiindex.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include <tracy/Tracy.hpp>
+
+#include "common/components/bodies.h"
+#include "common/components/coordinates.h"
+
+namespace cqsp::common::systems {
+namespace cqspc = cqsp::common::components;
+namespace cqspt = cqsp::common::components::types;
+
+void SOIIndex::Build(Universe& universe, const OrbitPropagator& propagator) {
+    ZoneScoped;
+    Clear();
+    for (size_t i = 0; i < propagator.Size(); i++) {
+        const uint32_t parent = propagator.GetParent(i);
+        if (parent == OrbitPropagator::no_parent) {
+            continue;
+        }
+        const entt::entity entity = propagator.GetEntity(i);
+        const auto* body = universe.try_get<cqspc::bodies::Body>(entity);
+        if (body == nullptr) {
+            continue;
+        }
+        Add(propagator.GetEntity(parent), entity, universe.get<cqspt::Kinematics>(entity).position, body->SOI);
+    }
+    Sort();
+}
+
+void SOIIndex::Add(entt::entity parent, entt::entity body, const glm::dvec3& position, double soi) {
+    System& system = systems[parent];
+    system.entries.push_back({glm::length(position), soi, position, body});
+    system.max_soi = std::max(system.max_soi, soi);
+}
+
+void SOIIndex::Sort() {
+    for (auto& [parent, system] : systems) {
+        std::sort(system.entries.begin(), system.entries.end(),
+                  [](const Entry& a, const Entry& b) { return a.radius < b.radius; });
+    }
+}
+
+void SOIIndex::Clear() {
+    // Keep the systems, so that their memory is reused on the next tick
+    for (auto& [parent, system] : systems) {
+        system.entries.clear();
+        system.max_soi = 0;
+    }
+}
+
+entt::entity SOIIndex::Find(entt::entity parent, const glm::dvec3& position, entt::entity ignore) const {
+    auto it = systems.find(parent);
+    if (it == systems.end()) {
+        return entt::null;
+    }
+    const System& system = it->second;
+    const double radius = glm::length(position);
+    // Any body further than the largest SOI away in radius can't contain the position
+    auto entry = std::lower_bound(system.entries.begin(), system.entries.end(), radius - system.max_soi,
+                                  [](const Entry& e, double value) { return e.radius < value; });
+    for (; entry != system.entries.end() && entry->radius <= radius + system.max_soi; entry++) {
+        if (entry->body == ignore || std::abs(entry->radius - radius) > entry->soi) {
+            continue;
+        }
+        if (glm::distance(entry->position, position) <= entry->soi) {
+            return entry->body;
+        }
+    }
+    return entt::null;
+}
+}  // namespace cqsp::common::systems
@@ -0,0 +1,73 @@
+/* Conquer Space
+ * Copyright (C) 2021-2023 Conquer Space
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#pragma once
+
+#include <unordered_map>
+#include <vector>
+
+#include <entt/entt.hpp>
+#include <glm/glm.hpp>
+
+#include "common/systems/movement/orbitpropagator.h"
+#include "common/universe.h"
+
+namespace cqsp::common::systems {
+/// <summary>
+/// Finds which sphere of influence an object has entered without checking every body in its orbital system.
+/// The bodies of each orbital system are sorted by their distance from the parent. An object can only be
+/// inside a SOI if its own distance from the parent is within the SOI radius of the body's distance, so only
+/// the bodies in that band are checked.
+/// </summary>
+class SOIIndex {
+ public:
+    /// <summary>
+    /// Rebuilds the index from the bodies in the propagator, with their positions after propagation.
+    /// </summary>
+    void Build(Universe& universe, const OrbitPropagator& propagator);
+
+    /// <summary>
+    /// Adds a body to the orbital system of parent. The system has to be sorted with Sort before it is queried.
+    /// </summary>
+    void Add(entt::entity parent, entt::entity body, const glm::dvec3& position, double soi);
+    void Sort();
+    void Clear();
+
+    /// <summary>
+    /// Finds a body orbiting parent whose SOI contains position
+    /// </summary>
+    /// <param name="ignore">An entity to skip, such as the object itself</param>
+    /// <returns>The body, or entt::null if the position isn't in any SOI</returns>
+    entt::entity Find(entt::entity parent, const glm::dvec3& position, entt::entity ignore = entt::null) const;
+
+ private:
+    struct Entry {
+        // Distance from the parent
+        double radius;
+        double soi;
+        glm::dvec3 position;
+        entt::entity body;
+    };
+
+    struct System {
+        // Sorted by radius
+        std::vector<Entry> entries;
+        double max_soi = 0;
+    };
+
+    std::unordered_map<entt::entity, System> systems;
+};
+}  // namespace cqsp::common::systems
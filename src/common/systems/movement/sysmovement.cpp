@@ -16,12 +16,16 @@
  */
 #include "common/systems/movement/sysmovement.h"
 
+#include <algorithm>
 #include <cmath>
+#include <limits>
 
 #include <tracy/Tracy.hpp>
 
+#include "common/components/bodies.h"
 #include "common/components/coordinates.h"
 #include "common/components/movement.h"
+#include "common/components/name.h"
 #include "common/components/orbit.h"
 #include "common/components/ships.h"
 #include "common/components/units.h"
@@ -32,10 +36,39 @@ namespace cqspc = cqsp::common::components;
 namespace cqsps = cqsp::common::components::ships;
 namespace cqspt = cqsp::common::components::types;
 
-void SysOrbit::DoSystem() {
-    ZoneScoped;
+SysOrbit::SysOrbit(Game& game) : ISimulationSystem(game) {
+    Reads<cqspc::bodies::Body, cqspc::Name, cqspc::Identifier>();
+    Writes<cqspt::Orbit, cqspt::OrbitCache, cqspt::Kinematics, cqspt::FuturePosition, cqspt::SetTrueAnomaly,
+           cqspt::Impulse, cqspc::bodies::OrbitalSystem, cqspc::bodies::DirtyOrbit, cqspc::CommandQueue,
+           cqsps::Crash>();
+
     Universe& universe = GetGame().GetUniverse();
-    ParseOrbitTree(entt::null, universe.sun);
+    universe.on_construct<cqspt::Orbit>().connect<&SysOrbit::OnOrbitChanged>(*this);
+    universe.on_destroy<cqspt::Orbit>().connect<&SysOrbit::OnOrbitChanged>(*this);
+    universe.on_construct<cqspc::bodies::DirtyOrbit>().connect<&SysOrbit::OnOrbitChanged>(*this);
+    universe.on_update<cqspc::bodies::DirtyOrbit>().connect<&SysOrbit::OnOrbitChanged>(*this);
+    universe.on_construct<cqspc::CommandQueue>().connect<&SysOrbit::OnCommandsChanged>(*this);
+    universe.on_update<cqspc::CommandQueue>().connect<&SysOrbit::OnCommandsChanged>(*this);
+}
+
+SysOrbit::~SysOrbit() {
+    Universe& universe = GetGame().GetUniverse();
+    universe.on_construct<cqspt::Orbit>().disconnect(this);
+    universe.on_destroy<cqspt::Orbit>().disconnect(this);
+    universe.on_construct<cqspc::bodies::DirtyOrbit>().disconnect(this);
+    universe.on_update<cqspc::bodies::DirtyOrbit>().disconnect(this);
+    universe.on_construct<cqspc::CommandQueue>().disconnect(this);
+    universe.on_update<cqspc::CommandQueue>().disconnect(this);
+}
+
+void SysOrbit::OnOrbitChanged(entt::registry& registry, entt::entity entity) {
+    std::scoped_lock lock(changed_mutex);
+    changed_orbits.push_back(entity);
+}
+
+void SysOrbit::OnCommandsChanged(entt::registry& registry, entt::entity entity) {
+    std::scoped_lock lock(changed_mutex);
+    changed_commands.push_back(entity);
 }
 
 void LeaveSOI(Universe& universe, const entt::entity& body, entt::entity& parent, cqspt::Orbit& orb,
@@ -68,6 +101,15 @@ void LeaveSOI(Universe& universe, const entt::entity& body, entt::entity& parent
 }
 
 namespace {
+/// <summary>
+/// Rebuilds the cache of an orbit that was just changed, and moves the body to where the new orbit puts it
+/// </summary>
+void MoveToOrbit(Universe& universe, entt::entity body, const cqspt::Orbit& orb, cqspt::Kinematics& pos) {
+    const auto& cache = universe.emplace_or_replace<cqspt::OrbitCache>(body, orb);
+    pos.position = cache.Position(orb.v);
+    pos.velocity = cache.Velocity(orb.v);
+}
+
 /// <summary>
 /// Check if the entity has crashed into its parent object
 /// </summary>
@@ -106,86 +148,260 @@ void CalculateImpulse(Universe& universe, cqspt::Orbit& orb, entt::entity body,
 
         orb = cqspt::Vec3ToOrbit(pos.position, pos.velocity + impulse.impulse, orb.GM, universe.date.ToSecond());
         orb.reference_body = reference;
-        pos.position = cqspt::toVec3(orb);
-        pos.velocity = cqspt::OrbitVelocityToVec3(orb, orb.v);
+        MoveToOrbit(universe, body, orb, pos);
         universe.emplace_or_replace<cqspc::bodies::DirtyOrbit>(body);
         // Remove impulse
         universe.remove<cqspc::types::Impulse>(body);
     }
 }
 
-void UpdateCommandQueue(Universe& universe, cqspt::Orbit& orb, entt::entity body, entt::entity parent) {
-    // Process thrust before updating orbit
-    if (!universe.any_of<cqspc::CommandQueue>(body)) {
+/// <summary>
+/// Moves body from the orbit of parent into the orbit of target, which also orbits parent
+/// </summary>
+void MoveIntoSOI(Universe& universe, entt::entity parent, entt::entity body, entt::entity target) {
+    auto& pos = universe.get<cqspt::Kinematics>(body);
+    auto& orb = universe.get<cqspt::Orbit>(body);
+    const auto& body_comp = universe.get<cqspc::bodies::Body>(target);
+    const auto& target_position = universe.get<cqspt::Kinematics>(target);
+    // Calculate position
+    orb = cqspt::Vec3ToOrbit(pos.position - target_position.position, pos.velocity - target_position.velocity,
+                             body_comp.GM, universe.date.ToSecond());
+    orb.reference_body = target;
+    // Calculate position, and change the thing
+    MoveToOrbit(universe, body, orb, pos);
+    // Then change SOI
+    universe.get_or_emplace<cqspc::bodies::OrbitalSystem>(target).push_back(body);
+    auto& vec = universe.get<cqspc::bodies::OrbitalSystem>(parent).children;
+    vec.erase(std::remove(vec.begin(), vec.end(), body), vec.end());
+    universe.emplace_or_replace<cqspc::bodies::DirtyOrbit>(body);
+}
+}  // namespace
+
+void SysOrbit::DoSystem() {
+    ZoneScoped;
+    Universe& universe = GetGame().GetUniverse();
+    const double time = universe.date.ToSecond();
+
+    // Burns change the orbit, so they have to be done before it is propagated
+    ExecuteManeuvers(time);
+
+    CollectChangedOrbits();
+    for (entt::entity entity : changed_scratch) {
+        if (universe.valid(entity) && universe.all_of<cqspt::Orbit>(entity)) {
+            universe.emplace_or_replace<cqspt::OrbitCache>(entity, universe.get<cqspt::Orbit>(entity));
+        }
+    }
+
+    propagator.Gather(universe, universe.sun);
+    propagator.Propagate(time, time + components::StarDate::TIME_INCREMENT, GetThreadPool());
+    propagator.Scatter(universe);
+    CountProcessed(propagator.Size());
+    soi_index.Build(universe, propagator);
+
+    for (entt::entity entity : changed_scratch) {
+        PredictEvents(entity, time);
+    }
+    changed_scratch.clear();
+    // Only the orbits whose predicted event has arrived are checked for leaving their SOI or crashing
+    due_scratch.clear();
+    events.PopDue(time, due_scratch);
+    due_orbits.clear();
+    due_orbits.insert(due_scratch.begin(), due_scratch.end());
+
+    // Parents are before their children, so their center is resolved by the time the children need it
+    for (size_t i = 0; i < propagator.Size(); i++) {
+        ResolveOrbit(i);
+    }
+}
+
+void SysOrbit::ExecuteManeuvers(double time) {
+    ZoneScoped;
+    Universe& universe = GetGame().GetUniverse();
+    {
+        std::scoped_lock lock(changed_mutex);
+        std::swap(changed_commands, commands_scratch);
+    }
+    if (!collected_all) {
+        // Command queues made before the system existed. CollectChangedOrbits sets collected_all afterwards
+        for (entt::entity entity : universe.view<cqspc::CommandQueue>()) {
+            commands_scratch.push_back(entity);
+        }
+    }
+    for (entt::entity ship : commands_scratch) {
+        const auto* queue = universe.valid(ship) ? universe.try_get<cqspc::CommandQueue>(ship) : nullptr;
+        if (queue == nullptr || queue->commands.empty()) {
+            maneuvers.Remove(ship);
+        } else {
+            maneuvers.Schedule(ship, queue->commands.front().time);
+        }
+    }
+    commands_scratch.clear();
+
+    // One at a time, because a ship's next burn can come before another ship's burn in the same tick
+    entt::entity ship;
+    while (maneuvers.PopNext(time, ship)) {
+        if (!universe.valid(ship) || !universe.all_of<cqspt::Orbit, cqspc::CommandQueue>(ship)) {
+            continue;
+        }
+        auto& queue = universe.get<cqspc::CommandQueue>(ship);
+        if (queue.commands.empty()) {
+            continue;
+        }
+        const cqspc::Maneuver& command = queue.commands.front();
+        auto& orb = universe.get<cqspt::Orbit>(ship);
+        orb = cqspt::ApplyImpulse(orb, command.delta_v, command.time);
+        universe.emplace_or_replace<cqspc::bodies::DirtyOrbit>(ship);
+        queue.commands.pop_front();
+        if (!queue.commands.empty()) {
+            maneuvers.Schedule(ship, queue.commands.front().time);
+        }
+    }
+}
+
+void SysOrbit::CollectChangedOrbits() {
+    Universe& universe = GetGame().GetUniverse();
+    {
+        std::scoped_lock lock(changed_mutex);
+        std::swap(changed_orbits, changed_scratch);
+    }
+    if (!collected_all) {
+        // Orbits made before the system existed, such as when a save is loaded
+        for (entt::entity entity : universe.view<cqspt::Orbit>()) {
+            changed_scratch.push_back(entity);
+        }
+        collected_all = true;
+    }
+    // A body that moves changes which objects around it could enter its SOI
+    const size_t changed_count = changed_scratch.size();
+    for (size_t i = 0; i < changed_count; i++) {
+        const entt::entity entity = changed_scratch[i];
+        if (!universe.valid(entity) || !universe.all_of<cqspc::bodies::Body, cqspt::Orbit>(entity)) {
+            continue;
+        }
+        const entt::entity parent = universe.get<cqspt::Orbit>(entity).reference_body;
+        if (!universe.valid(parent) || !universe.all_of<cqspc::bodies::OrbitalSystem>(parent)) {
+            continue;
+        }
+        const auto& system = universe.get<cqspc::bodies::OrbitalSystem>(parent);
+        for (entt::entity sibling : system.children) {
+            if (!universe.any_of<cqspc::bodies::Body>(sibling)) {
+                changed_scratch.push_back(sibling);
+            }
+        }
+    }
+    std::sort(changed_scratch.begin(), changed_scratch.end());
+    changed_scratch.erase(std::unique(changed_scratch.begin(), changed_scratch.end()), changed_scratch.end());
+}
+
+void SysOrbit::PredictEvents(entt::entity body, double time) {
+    Universe& universe = GetGame().GetUniverse();
+    events.Remove(body);
+    encounter_candidates.erase(body);
+    if (!universe.valid(body)) {
         return;
     }
-    // Check if the current date is beyond the universe date
-    auto& queue = universe.get<cqspc::CommandQueue>(body);
-    if (queue.commands.empty()) {
+    const auto* orb = universe.try_get<cqspt::Orbit>(body);
+    if (orb == nullptr || !universe.valid(orb->reference_body)) {
         return;
     }
-    auto& command = queue.commands.front();
-    if (command.time > universe.date.ToSecond()) {
+    const auto* p_bod = universe.try_get<cqspc::bodies::Body>(orb->reference_body);
+    if (p_bod == nullptr) {
         return;
     }
-    // Then execute the command
-    orb = cqspt::ApplyImpulse(orb, command.delta_v, command.time);
-    universe.emplace_or_replace<cqspc::bodies::DirtyOrbit>(body);
-    queue.commands.pop_front();
+    double next = cqspt::TimeToLeaveRadius(*orb, p_bod->SOI, time);
+    const bool is_body = universe.any_of<cqspc::bodies::Body>(body);
+    if (!is_body && !universe.any_of<cqsps::Crash>(body)) {
+        // Next time we need to account for the atmosphere
+        next = std::min(next, cqspt::TimeToEnterRadius(*orb, p_bod->radius, time));
+    }
+    if (std::isfinite(next)) {
+        events.Schedule(body, time + next);
+    }
+    if (!is_body && CouldEncounter(*orb, body)) {
+        encounter_candidates.insert(body);
+    }
 }
-}  // namespace
 
-void SysOrbit::ParseOrbitTree(entt::entity parent, entt::entity body) {
-    namespace cqspc = cqsp::common::components;
-    namespace cqsps = cqsp::common::components::ships;
-    namespace cqspt = cqsp::common::components::types;
+bool SysOrbit::CouldEncounter(const cqspt::Orbit& orbit, entt::entity body) {
     Universe& universe = GetGame().GetUniverse();
-    if (!universe.valid(body)) {
-        return;
+    const auto* system = universe.try_get<cqspc::bodies::OrbitalSystem>(orbit.reference_body);
+    if (system == nullptr || orbit.semi_major_axis == 0) {
+        return false;
     }
+    constexpr double infinity = std::numeric_limits<double>::infinity();
+    const double periapsis = orbit.GetPeriapsis();
+    const double apoapsis = orbit.eccentricity < 1 ? orbit.GetApoapsis() : infinity;
+    for (entt::entity sibling : system->children) {
+        if (sibling == body || !universe.all_of<cqspc::bodies::Body, cqspt::Orbit>(sibling)) {
+            continue;
+        }
+        const auto& sibling_orbit = universe.get<cqspt::Orbit>(sibling);
+        const double soi = universe.get<cqspc::bodies::Body>(sibling).SOI;
+        const double closest = sibling_orbit.GetPeriapsis() - soi;
+        const double furthest = (sibling_orbit.eccentricity < 1 ? sibling_orbit.GetApoapsis() : infinity) + soi;
+        if (periapsis <= furthest && apoapsis >= closest) {
+            return true;
+        }
+    }
+    return false;
+}
 
+void SysOrbit::ResolveOrbit(size_t index) {
+    Universe& universe = GetGame().GetUniverse();
+    const entt::entity body = propagator.GetEntity(index);
     auto& orb = universe.get<cqspt::Orbit>(body);
-
-    UpdateCommandQueue(universe, orb, body, parent);
-
-    cqspt::UpdateOrbit(orb, universe.date.ToSecond());
-    auto& pos = universe.get_or_emplace<cqspt::Kinematics>(body);
+    auto& pos = universe.get<cqspt::Kinematics>(body);
     if (universe.any_of<cqspt::SetTrueAnomaly>(body)) {
         orb.v = universe.get<cqspt::SetTrueAnomaly>(body).true_anomaly;
         // Set new mean anomaly at epoch
         universe.remove<cqspt::SetTrueAnomaly>(body);
+        // Only the true anomaly changed, so the cache that the propagator used still fits
+        const auto& cache = universe.get<cqspt::OrbitCache>(body);
+        pos.position = cache.Position(orb.v);
+        pos.velocity = cache.Velocity(orb.v);
     }
-    pos.position = cqspt::toVec3(orb);
-    pos.velocity = cqspt::OrbitVelocityToVec3(orb, orb.v);
 
-    if (parent != entt::null) {
-        auto& p_pos = universe.get_or_emplace<cqspt::Kinematics>(parent);
-        // If distance is above SOI, then be annoyed
-        auto& p_bod = universe.get<cqspc::bodies::Body>(parent);
-        if (glm::length(pos.position) > p_bod.SOI) {
-            LeaveSOI(universe, body, parent, orb, pos, p_pos);
-        }
+    // Whether the orbit was changed after it was propagated, and the future position is out of date
+    bool changed = false;
+    const uint32_t parent_index = propagator.GetParent(index);
+    if (parent_index != OrbitPropagator::no_parent) {
+        entt::entity parent = propagator.GetEntity(parent_index);
+        auto& p_pos = universe.get<cqspt::Kinematics>(parent);
+        // Leaving the SOI and crashing are predicted, so they are only checked once their time has come
+        if (!due_orbits.empty() && due_orbits.contains(body)) {
+            // If distance is above SOI, then be annoyed
+            auto& p_bod = universe.get<cqspc::bodies::Body>(parent);
+            if (glm::length(pos.position) > p_bod.SOI) {
+                LeaveSOI(universe, body, parent, orb, pos, p_pos);
+                changed = true;
+            }
 
-        CrashObject(universe, orb, body, parent);
+            const double semi_major_axis = orb.semi_major_axis;
+            CrashObject(universe, orb, body, parent);
+            changed |= semi_major_axis != orb.semi_major_axis;
+            if (changed) {
+                universe.emplace_or_replace<cqspt::OrbitCache>(body, orb);
+            }
+            // Predict the next event, or this one again if it is a tick away
+            OnOrbitChanged(universe, body);
+        }
 
+        changed |= universe.any_of<cqspt::Impulse>(body);
         CalculateImpulse(universe, orb, body, parent);
         pos.center = p_pos.center + p_pos.position;
-        if (EnterSOI(universe, parent, body)) {
+        if (encounter_candidates.contains(body) && EnterSOI(universe, soi_index, parent, body)) {
             SPDLOG_INFO("Entered SOI");
+            changed = true;
         }
     }
 
-    auto& future_pos = universe.get_or_emplace<cqspt::FuturePosition>(body);
-    future_pos.position = cqspt::OrbitTimeToVec3(orb, universe.date.ToSecond() + components::StarDate::TIME_INCREMENT);
-    future_pos.center = pos.center;
-
-    if (!universe.any_of<cqspc::bodies::OrbitalSystem>(body)) {
-        return;
-    }
-    for (entt::entity entity : universe.get<cqspc::bodies::OrbitalSystem>(body).children) {
-        // Calculate position
-        ParseOrbitTree(body, entity);
+    auto& future_pos = universe.get<cqspt::FuturePosition>(body);
+    if (changed) {
+        // Every change above rebuilt the cache
+        future_pos.position = cqspt::OrbitTimeToVec3(orb, universe.get<cqspt::OrbitCache>(body),
+                                                     universe.date.ToSecond() + components::StarDate::TIME_INCREMENT);
     }
+    future_pos.center = pos.center;
 }
 
 void SysSurface::DoSystem() {
@@ -228,7 +444,6 @@ bool EnterSOI(Universe& universe, const entt::entity& parent, const entt::entity
                  util::GetName(universe, parent));
 
     auto& pos = universe.get<cqspc::types::Kinematics>(body);
-    auto& orb = universe.get<cqspc::types::Orbit>(body);
     // Check parents for SOI if we're inters ecting with anything
     auto& o_system = universe.get<cqspc::bodies::OrbitalSystem>(parent);
 
@@ -244,25 +459,31 @@ bool EnterSOI(Universe& universe, const entt::entity& parent, const entt::entity
         const auto& body_comp = universe.get<cqspc::bodies::Body>(entity);
         const auto& target_position = universe.get<cqspc::types::Kinematics>(entity);
         if (glm::distance(target_position.position, pos.position) <= body_comp.SOI) {
-            // Calculate position
-            orb = cqspt::Vec3ToOrbit(pos.position - target_position.position, pos.velocity - target_position.velocity,
-                                     body_comp.GM, universe.date.ToSecond());
-            orb.reference_body = entity;
-            // Calculate position, and change the thing
-            pos.position = cqspt::toVec3(orb);
-            pos.velocity = cqspt::OrbitVelocityToVec3(orb, orb.v);
-            // Then change SOI
-            universe.get_or_emplace<cqspc::bodies::OrbitalSystem>(entity).push_back(body);
-            auto& vec = universe.get<cqspc::bodies::OrbitalSystem>(parent).children;
-            vec.erase(std::remove(vec.begin(), vec.end(), body), vec.end());
-            universe.emplace_or_replace<cqspc::bodies::DirtyOrbit>(body);
+            MoveIntoSOI(universe, parent, body, entity);
             return true;
         }
-        // Now check if it's intersecting with any things outside of stuff
-        if (parent == universe.sun) {
-            continue;
-        }
     }
     return false;
 }
+
+void QueueManeuvers(Universe& universe, entt::entity ship, const std::vector<cqspc::Maneuver>& maneuvers) {
+    auto& queue = universe.get_or_emplace<cqspc::CommandQueue>(ship);
+    queue.commands.insert(queue.commands.end(), maneuvers.begin(), maneuvers.end());
+    std::stable_sort(queue.commands.begin(), queue.commands.end(),
+                     [](const cqspc::Maneuver& a, const cqspc::Maneuver& b) { return a.time < b.time; });
+    universe.patch<cqspc::CommandQueue>(ship);
+}
+
+bool EnterSOI(Universe& universe, const SOIIndex& index, const entt::entity& parent, const entt::entity& body) {
+    // We should ignore bodies
+    if (universe.any_of<cqspc::bodies::Body>(body)) {
+        return false;
+    }
+    const entt::entity target = index.Find(parent, universe.get<cqspt::Kinematics>(body).position, body);
+    if (target == entt::null) {
+        return false;
+    }
+    MoveIntoSOI(universe, parent, body, target);
+    return true;
+}
 }  // namespace cqsp::common::systems
@@ -16,20 +16,88 @@
  */
 #pragma once
 
+#include <mutex>
+#include <unordered_set>
 #include <vector>
 
+#include "common/components/movement.h"
+#include "common/components/orbit.h"
 #include "common/systems/isimulationsystem.h"
+#include "common/systems/movement/orbitevents.h"
+#include "common/systems/movement/orbitpropagator.h"
+#include "common/systems/movement/soiindex.h"
 
 namespace cqsp {
 namespace common {
 namespace systems {
 class SysOrbit : public ISimulationSystem {
  public:
-    explicit SysOrbit(Game& game) : ISimulationSystem(game) {}
+    explicit SysOrbit(Game& game);
+    ~SysOrbit();
     void DoSystem() override;
     int Interval() override { return 1; }
 
-    void ParseOrbitTree(entt::entity parent, entt::entity body);
+ private:
+    /// <summary>
+    /// Called when an orbit is created, destroyed, or marked with DirtyOrbit, so that its cache is rebuilt and
+    /// its events are predicted again on the next tick
+    /// </summary>
+    void OnOrbitChanged(entt::registry& registry, entt::entity entity);
+
+    /// <summary>
+    /// Called when a command queue is created or patched, so that its first command is scheduled on the next tick
+    /// </summary>
+    void OnCommandsChanged(entt::registry& registry, entt::entity entity);
+
+    /// <summary>
+    /// Executes every burn that is due, across all ships, in the order of their time
+    /// </summary>
+    void ExecuteManeuvers(double time);
+
+    /// <summary>
+    /// Moves the orbits that changed since the last tick into changed_scratch, with the objects around any
+    /// body that changed, without duplicates
+    /// </summary>
+    void CollectChangedOrbits();
+
+    /// <summary>
+    /// Predicts when the orbit of body next leaves the SOI of its parent or hits its surface, and whether it
+    /// could pass through the SOI of another body orbiting its parent.
+    /// </summary>
+    void PredictEvents(entt::entity body, double time);
+
+    /// <summary>
+    /// If the distances the orbit passes through overlap the SOI of any other body orbiting the same parent.
+    /// Objects that can't reach any SOI don't have to be checked for encounters.
+    /// </summary>
+    bool CouldEncounter(const components::types::Orbit& orbit, entt::entity body);
+
+    /// <summary>
+    /// Handles everything that changes an orbit after it is propagated, such as SOI changes, crashes and
+    /// impulses, and sets its center from its parent.
+    /// </summary>
+    void ResolveOrbit(size_t index);
+
+    OrbitPropagator propagator;
+    SOIIndex soi_index;
+
+    OrbitEventQueue events;
+    // The time of the first command of every command queue
+    OrbitEventQueue maneuvers;
+    // Orbits whose events have arrived this tick
+    std::unordered_set<entt::entity> due_orbits;
+    std::vector<entt::entity> due_scratch;
+    // Objects that could enter the SOI of another body, and are checked every tick
+    std::unordered_set<entt::entity> encounter_candidates;
+
+    // Orbits whose cache has to be rebuilt and whose events have to be predicted again. Other systems can
+    // mark orbits dirty, so it's locked
+    std::mutex changed_mutex;
+    std::vector<entt::entity> changed_orbits;
+    std::vector<entt::entity> changed_scratch;
+    std::vector<entt::entity> changed_commands;
+    std::vector<entt::entity> commands_scratch;
+    bool collected_all = false;
 };
 
 /// <summary>
@@ -47,6 +115,17 @@ void LeaveSOI(Universe& universe, const entt::entity& body);
 /// <param name="body">Body that we want to check if it's entering a SOI</param>
 bool EnterSOI(Universe& universe, const entt::entity& parent, const entt::entity& body);
 
+/// <summary>
+/// Same as EnterSOI, but only checks the bodies that the index says the body could be in
+/// </summary>
+bool EnterSOI(Universe& universe, const SOIIndex& index, const entt::entity& parent, const entt::entity& body);
+
+/// <summary>
+/// Adds maneuvers to the command queue of ship, keeping it in time order, and lets the movement system know
+/// that they have to be scheduled
+/// </summary>
+void QueueManeuvers(Universe& universe, entt::entity ship, const std::vector<components::Maneuver>& maneuvers);
+
 class SysPath : public ISimulationSystem {
  public:
     explicit SysPath(Game& game) : ISimulationSystem(game) {}
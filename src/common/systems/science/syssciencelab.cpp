@@ -20,6 +20,11 @@
 
 #include "common/components/science.h"
 
+cqsp::common::systems::SysScienceLab::SysScienceLab(Game& game) : ISimulationSystem(game) {
+    Reads<components::science::Lab>();
+    Writes<components::science::ScientificProgress>();
+}
+
 void cqsp::common::systems::SysScienceLab::DoSystem() {
     ZoneScoped;
     auto view = GetUniverse().view<components::science::Lab>();
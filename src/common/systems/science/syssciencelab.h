@@ -23,7 +23,7 @@ namespace common {
 namespace systems {
 class SysScienceLab : public ISimulationSystem {
  public:
-    explicit SysScienceLab(Game& game) : ISimulationSystem(game) {}
+    explicit SysScienceLab(Game& game);
     void DoSystem() override;
     int Interval() override { return components::StarDate::DAY; }
 };
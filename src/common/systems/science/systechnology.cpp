@@ -23,6 +23,12 @@
 #include "common/components/science.h"
 #include "common/systems/science/technology.h"
 
+cqsp::common::systems::SysTechProgress::SysTechProgress(Game& game) : ISimulationSystem(game) {
+    namespace cqspcs = cqsp::common::components::science;
+    Reads<cqspcs::Technology>();
+    Writes<cqspcs::ScientificResearch, cqspcs::TechnologicalProgress>();
+}
+
 void cqsp::common::systems::SysTechProgress::DoSystem() {
     ZoneScoped;
     auto field = GetUniverse().view<components::science::ScientificResearch>();
@@ -21,7 +21,7 @@
 namespace cqsp::common::systems {
 class SysTechProgress : public ISimulationSystem {
  public:
-    explicit SysTechProgress(Game& game) : ISimulationSystem(game) {}
+    explicit SysTechProgress(Game& game);
     void DoSystem() override;
     int Interval() override { return components::StarDate::DAY; }
 };
@@ -18,30 +18,212 @@
 
 #include <spdlog/spdlog.h>
 
+#include <algorithm>
+#include <limits>
+#include <map>
 #include <string>
+#include <string_view>
 #include <vector>
 
+#include "common/components/economy.h"
+#include "common/components/infrastructure.h"
+#include "common/components/player.h"
+#include "common/components/population.h"
+#include "common/systems/population/cityinformation.h"
 #include "common/util/profiler.h"
 
-cqsp::common::systems::SysScript::SysScript(Game &game) : ISimulationSystem(game) {
-    sol::optional<std::vector<sol::table>> optional = game.GetScriptInterface()["events"]["data"];
-    events = *optional;
+namespace cqsp::common::systems {
+namespace {
+namespace cqspc = cqsp::common::components;
+
+using ComponentCheck = bool (*)(const Universe&, entt::entity);
+using StatGetter = double (*)(const Universe&, entt::entity);
+
+template <class Component>
+bool HasComponent(const Universe& universe, entt::entity entity) {
+    return universe.all_of<Component>(entity);
+}
+
+/// <summary>
+/// Components that a trigger can wait for, by the name used in lua
+/// </summary>
+const std::map<std::string_view, ComponentCheck> trigger_components = {
+    {"brownout", &HasComponent<cqspc::infrastructure::BrownOut>},
+    {"hunger", &HasComponent<cqspc::Hunger>},
+    {"player", &HasComponent<cqspc::Player>},
+    {"space_port", &HasComponent<cqspc::infrastructure::SpacePort>},
+};
+
+/// <summary>
+/// Numbers that a trigger can compare, by the name used in lua
+/// </summary>
+const std::map<std::string_view, StatGetter> trigger_stats = {
+    {"population",
+     [](const Universe& universe, entt::entity entity) {
+         return static_cast<double>(GetCityPopulation(universe, entity));
+     }},
+    {"balance",
+     [](const Universe& universe, entt::entity entity) {
+         const auto* wallet = universe.try_get<cqspc::Wallet>(entity);
+         return wallet != nullptr ? wallet->GetBalance() : 0.0;
+     }},
+};
+
+/// <summary>
+/// Makes the condition of a trigger table
+/// </summary>
+/// <returns>The condition, or an empty function if the table isn't a valid trigger</returns>
+std::function<bool(const Universe&)> ParseTrigger(const sol::table& trigger) {
+    sol::optional<entt::entity> entity = trigger["entity"];
+    if (!entity) {
+        SPDLOG_WARN("Event trigger has no entity");
+        return {};
+    }
+    if (sol::optional<std::string> component = trigger["component"]) {
+        auto it = trigger_components.find(*component);
+        if (it == trigger_components.end()) {
+            SPDLOG_WARN("Event trigger has unknown component {}", *component);
+            return {};
+        }
+        return [entity = *entity, check = it->second](const Universe& universe) {
+            return universe.valid(entity) && check(universe, entity);
+        };
+    }
+    if (sol::optional<std::string> stat = trigger["stat"]) {
+        auto it = trigger_stats.find(*stat);
+        if (it == trigger_stats.end()) {
+            SPDLOG_WARN("Event trigger has unknown stat {}", *stat);
+            return {};
+        }
+        const double above = trigger.get_or("above", -std::numeric_limits<double>::infinity());
+        const double below = trigger.get_or("below", std::numeric_limits<double>::infinity());
+        return [entity = *entity, get = it->second, above, below](const Universe& universe) {
+            if (!universe.valid(entity)) {
+                return false;
+            }
+            const double value = get(universe, entity);
+            return value > above && value < below;
+        };
+    }
+    SPDLOG_WARN("Event trigger needs a component or a stat");
+    return {};
+}
+}  // namespace
+
+SysScript::SysScript(Game &game) : ISimulationSystem(game) {
+    event_data = game.GetScriptInterface()["events"]["data"];
 }
 
-cqsp::common::systems::SysScript::~SysScript() {
+SysScript::~SysScript() {
     // So it doesn't crash when we delete this
-    for (auto &evet : events) {
-        evet.abandon();
+    for (auto &event : events) {
+        event.table.abandon();
+        event.on_tick.abandon();
     }
     events.clear();
+    event_data.abandon();
+}
+
+void SysScript::ReadEvents(int date) {
+    const size_t count = event_data.size();
+    for (size_t i = events.size(); i < count; i++) {
+        // Lua tables start at 1
+        AddEvent(event_data.get<sol::table>(i + 1), date);
+    }
+}
+
+void SysScript::AddEvent(const sol::table &table, int date) {
+    const size_t index = events.size();
+    Event &event = events.emplace_back();
+    event.table = table;
+    sol::object on_tick = table["on_tick"];
+    if (on_tick.get_type() != sol::type::function) {
+        SPDLOG_WARN("Event {} has no on_tick function, so it never runs", index);
+        return;
+    }
+    event.on_tick = on_tick.as<sol::protected_function>();
+
+    sol::optional<int> wake_date = table["wake_date"];
+    sol::optional<int> interval = table["interval"];
+    sol::optional<sol::table> trigger = table["trigger"];
+    if (trigger) {
+        event.trigger.condition = ParseTrigger(*trigger);
+        if (event.trigger.condition) {
+            triggered.push_back(index);
+        }
+    }
+    if (interval) {
+        event.interval = std::max(*interval, 1);
+    } else if (!wake_date && !trigger) {
+        // Events that don't say when to run run every tick
+        event.interval = 1;
+    }
+    if (wake_date) {
+        Schedule(index, *wake_date);
+    } else if (event.interval > 0) {
+        Schedule(index, date);
+    }
+}
+
+void SysScript::Schedule(size_t event, int date) {
+    // Any earlier entry of the event in the queue is skipped, because its date no longer matches
+    events[event].wake = date;
+    queue.push({date, event});
+}
+
+void SysScript::RunEvent(size_t index, int date) {
+    Event &event = events[index];
+    const bool woken = event.wake <= date;
+    if (woken) {
+        event.wake = no_wake;
+    }
+    run_count++;
+    sol::protected_function_result result = event.on_tick(event.table);
+    GetGame().GetScriptInterface().ParseResult(result);
+
+    sol::object next = result.valid() ? result.get<sol::object>() : sol::object(sol::lua_nil);
+    if (next.get_type() == sol::type::number) {
+        // Never in the past, or it would run again this tick
+        Schedule(index, std::max(next.as<int>(), date + 1));
+    } else if (next.get_type() == sol::type::boolean && !next.as<bool>()) {
+        event.wake = no_wake;
+    } else if (woken && event.interval > 0) {
+        Schedule(index, date + event.interval);
+    }
 }
 
-void cqsp::common::systems::SysScript::DoSystem() {
+void SysScript::DoSystem() {
     BEGIN_TIMED_BLOCK(ScriptEngine);
-    GetGame().GetScriptInterface()["date"] = GetUniverse().date.GetDate();
-    for (auto &a : events) {
-        sol::protected_function_result result = a["on_tick"](a);
-        GetGame().GetScriptInterface().ParseResult(result);
+    const int date = GetUniverse().date.GetDate();
+    ReadEvents(date);
+
+    due.clear();
+    while (!queue.empty() && queue.top().date <= date) {
+        const Wake wake = queue.top();
+        queue.pop();
+        if (events[wake.event].wake == wake.date) {
+            due.push_back(wake.event);
+        }
+    }
+    for (size_t index : triggered) {
+        Trigger &trigger = events[index].trigger;
+        const bool met = trigger.condition(GetUniverse());
+        if (met && !trigger.met) {
+            due.push_back(index);
+        }
+        trigger.met = met;
+    }
+
+    if (!due.empty()) {
+        // Run in the order that the events were inserted, and only once if both the date and the trigger are due
+        std::sort(due.begin(), due.end());
+        due.erase(std::unique(due.begin(), due.end()), due.end());
+        GetGame().GetScriptInterface()["date"] = date;
+        for (size_t index : due) {
+            RunEvent(index, date);
+        }
     }
+    CountProcessed(due.size());
     END_TIMED_BLOCK(ScriptEngine);
 }
+}  // namespace cqsp::common::systems
@@ -16,6 +16,10 @@
  */
 #pragma once
 
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <queue>
 #include <vector>
 
 #include "common/scripting/scripting.h"
@@ -29,13 +33,13 @@ namespace systems {
 /// Runs scripts that are added to the game
 /// </summary>
 ///
-/// To run a script every single tick, you have to do this:
+/// Events are tables with an `on_tick` function, added to the event queue:
 /// ```lua
 /// local test_event = {
 ///     -- you can define all sorts of variables needed here
 /// }
 ///
-/// local test_event:on_tick()
+/// function test_event:on_tick()
 ///     -- All sorts of events take place here
 /// end
 ///
@@ -43,8 +47,19 @@ namespace systems {
 /// events:insert(test_event)
 /// ```
 ///
-/// This is likely to be unoptimized because it runs all the scripts every
-/// single tick.
+/// An event without any of the fields below runs every tick. Events only run when they are due, so they can
+/// say when they should run instead:
+/// - `wake_date`: the first date that the event runs on. Without an interval, it only runs once.
+/// - `interval`: the event runs again this many ticks after it runs.
+/// - `trigger`: a condition that is checked without running any lua, and the event runs when the
+///   condition becomes true. It runs again only after the condition has been false.
+///   - `{ entity = city, component = "brownout" }` is true when the entity has the component. See
+///     `trigger_components` in scriptrunner.cpp for the names.
+///   - `{ entity = city, stat = "population", above = 1000000 }` is true when the stat is above (or `below`)
+///     the value. See `trigger_stats` in scriptrunner.cpp for the names.
+///
+/// `on_tick` can return a date to run on that date next, or `false` to stop running until the trigger fires.
+/// Events that are due on the same tick run in the order that they were inserted.
 class SysScript : public cqsp::common::systems::ISimulationSystem {
  public:
     explicit SysScript(Game& game);
@@ -52,8 +67,62 @@ class SysScript : public cqsp::common::systems::ISimulationSystem {
     void DoSystem();
     int Interval() { return 1; }
 
+    /// <summary>
+    /// Number of events that have been read from the event queue
+    /// </summary>
+    size_t GetEventCount() const { return events.size(); }
+
+    /// <summary>
+    /// Number of times on_tick has been called
+    /// </summary>
+    uint64_t GetRunCount() const { return run_count; }
+
  private:
-    std::vector<sol::table> events;
+    static constexpr int no_wake = std::numeric_limits<int>::max();
+
+    /// <summary>
+    /// A condition that is checked in C++ every tick, see the `trigger` field
+    /// </summary>
+    struct Trigger {
+        std::function<bool(const Universe&)> condition;
+        // If the condition was true when it was last checked
+        bool met = false;
+    };
+
+    struct Event {
+        sol::table table;
+        sol::protected_function on_tick;
+        int interval = 0;
+        // The date in the queue, or no_wake if it's not waiting for a date
+        int wake = no_wake;
+        Trigger trigger;
+    };
+
+    struct Wake {
+        int date;
+        size_t event;
+        // Earliest first, then in the order that the events were inserted
+        bool operator>(const Wake& other) const {
+            return date != other.date ? date > other.date : event > other.event;
+        }
+    };
+
+    /// <summary>
+    /// Reads the events that have been inserted since the last tick
+    /// </summary>
+    void ReadEvents(int date);
+    void AddEvent(const sol::table& table, int date);
+    void Schedule(size_t event, int date);
+    void RunEvent(size_t event, int date);
+
+    sol::table event_data;
+    std::vector<Event> events;
+    std::priority_queue<Wake, std::vector<Wake>, std::greater<Wake>> queue;
+    // Events with a trigger
+    std::vector<size_t> triggered;
+    // Events that are due this tick
+    std::vector<size_t> due;
+    uint64_t run_count = 0;
 };
 }  // namespace systems
 }  // namespace common
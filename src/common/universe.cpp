@@ -26,4 +26,8 @@ cqsp::common::Universe::Universe() : Universe(util::random_id()) {}
 
 cqsp::common::Universe::Universe(std::string uuid) : uuid(std::move(uuid)) {
     random = std::make_unique<cqsp::common::util::StdRandom>(42);
+    // Make the groups before anything is added, so that they never have to sort existing components. A
+    // component can only be owned by one group, and owned components can't be sorted with sort<>().
+    IndustryGroup();
+    PopulationGroup();
 }
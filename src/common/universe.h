@@ -25,6 +25,10 @@
 
 #include <entt/entt.hpp>
 
+#include "common/components/area.h"
+#include "common/components/economy.h"
+#include "common/components/population.h"
+#include "common/components/resource.h"
 #include "common/stardate.h"
 #include "common/systems/names/namegenerator.h"
 #include "common/util/random/random.h"
@@ -60,6 +64,20 @@ class Universe : public entt::registry {
     void ToggleTick() { to_tick = !to_tick; }
 
     int GetDate() { return date.GetDate(); }
+
+    /// <summary>
+    /// Factories, with the components that SysProduction uses every tick. The group owns the sizes and the
+    /// costs, so they are packed in the same order and can be walked together.
+    /// </summary>
+    auto IndustryGroup() {
+        return group<components::IndustrySize, components::CostBreakdown>(entt::get<components::Production>);
+    }
+
+    /// <summary>
+    /// Population segments and their labor, packed in the same order
+    /// </summary>
+    auto PopulationGroup() { return group<components::PopulationSegment, components::LaborInformation>(); }
+
     std::unique_ptr<cqsp::common::util::IRandom> random;
     std::string uuid;
 
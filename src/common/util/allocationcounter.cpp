@@ -0,0 +1,94 @@
+/* Conquer Space
+ * Copyright (C) 2021-2023 Conquer Space
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#include "common/util/allocationcounter.h"
+
+#include <cstdlib>
+#include <new>
+
+#ifdef _WIN32
+#include <malloc.h>
+#endif
+
+namespace {
+thread_local uint64_t allocation_count = 0;
+thread_local std::atomic<uint64_t>* allocation_counter = nullptr;
+
+#ifdef CQSP_COUNT_ALLOCATIONS
+void CountAllocation() {
+    allocation_count++;
+    if (allocation_counter != nullptr) {
+        allocation_counter->fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+// Calls the new handler until the allocation succeeds, like the standard operator new does
+template <typename Allocate>
+void* AllocateOrThrow(Allocate allocate) {
+    CountAllocation();
+    while (true) {
+        if (void* block = allocate()) {
+            return block;
+        }
+        std::new_handler handler = std::get_new_handler();
+        if (handler == nullptr) {
+            throw std::bad_alloc();
+        }
+        handler();
+    }
+}
+#endif  // CQSP_COUNT_ALLOCATIONS
+}  // namespace
+
+namespace cqsp::common::util {
+uint64_t GetThreadAllocationCount() { return allocation_count; }
+
+AllocationScope::AllocationScope(std::atomic<uint64_t>* counter) : previous(allocation_counter) {
+    allocation_counter = counter;
+}
+
+AllocationScope::~AllocationScope() { allocation_counter = previous; }
+
+std::atomic<uint64_t>* AllocationScope::Current() { return allocation_counter; }
+}  // namespace cqsp::common::util
+
+#ifdef CQSP_COUNT_ALLOCATIONS
+// The standard library's other forms of new and delete (array, sized and nothrow) go through these four
+void* operator new(std::size_t size) {
+    return AllocateOrThrow([size]() { return std::malloc(size == 0 ? 1 : size); });
+}
+
+void operator delete(void* block) noexcept { std::free(block); }
+
+void* operator new(std::size_t size, std::align_val_t alignment) {
+    const auto align = static_cast<std::size_t>(alignment);
+    // aligned_alloc needs the size to be a multiple of the alignment
+    const std::size_t rounded = (size + align - 1) / align * align;
+#ifdef _WIN32
+    return AllocateOrThrow([=]() { return _aligned_malloc(rounded == 0 ? align : rounded, align); });
+#else
+    return AllocateOrThrow([=]() { return std::aligned_alloc(align, rounded == 0 ? align : rounded); });
+#endif
+}
+
+void operator delete(void* block, std::align_val_t) noexcept {
+#ifdef _WIN32
+    _aligned_free(block);
+#else
+    std::free(block);
+#endif
+}
+#endif  // CQSP_COUNT_ALLOCATIONS
@@ -0,0 +1,61 @@
+/* Conquer Space
+ * Copyright (C) 2021-2023 Conquer Space
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+namespace cqsp::common::util {
+/// <summary>
+/// If the global operator new is replaced to count allocations. It is only replaced with the
+/// CQSP_COUNT_ALLOCATIONS cmake option, and every count is 0 without it.
+/// </summary>
+#ifdef CQSP_COUNT_ALLOCATIONS
+constexpr bool kCountAllocations = true;
+#else
+constexpr bool kCountAllocations = false;
+#endif
+
+/// <summary>
+/// Number of times the calling thread has called operator new, so the difference before and after a piece of
+/// code is how many allocations it made on this thread.
+/// </summary>
+uint64_t GetThreadAllocationCount();
+
+/// <summary>
+/// While this is alive, every allocation made on the calling thread is also added to `counter`. Work that is
+/// handed to other threads takes the counter of the thread that started it with Current(), so that its
+/// allocations are added to the same counter.
+/// </summary>
+class AllocationScope {
+ public:
+    /// <param name="counter">Counter to add to, or nullptr to stop adding to the counter of the outer scope</param>
+    explicit AllocationScope(std::atomic<uint64_t>* counter);
+    ~AllocationScope();
+
+    AllocationScope(const AllocationScope&) = delete;
+    AllocationScope& operator=(const AllocationScope&) = delete;
+
+    /// <summary>
+    /// The counter that the calling thread is adding to, or nullptr if it isn't in a scope.
+    /// </summary>
+    static std::atomic<uint64_t>* Current();
+
+ private:
+    std::atomic<uint64_t>* previous;
+};
+}  // namespace cqsp::common::util
@@ -0,0 +1,92 @@
+/* Conquer Space
+ * Copyright (C) 2021-2023 Conquer Space
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#include "common/util/framearena.h"
+
+#include <new>
+
+namespace cqsp::common::util {
+namespace {
+// The arena that the thread asked for last, and its resource for the thread
+struct ThreadCache {
+    uint64_t generation = 0;
+    std::pmr::memory_resource* resource = nullptr;
+};
+thread_local ThreadCache thread_cache;
+}  // namespace
+
+void* FrameArena::Overflow::do_allocate(size_t size, size_t alignment) {
+    bytes += size;
+    return ::operator new(size, std::align_val_t(alignment));
+}
+
+void FrameArena::Overflow::do_deallocate(void* pointer, size_t size, size_t alignment) {
+    ::operator delete(pointer, std::align_val_t(alignment));
+}
+
+FrameArena::ThreadArena::ThreadArena(size_t size) : buffer(std::make_unique<std::byte[]>(size)), size(size) {
+    resource.emplace(buffer.get(), size, &overflow);
+}
+
+void FrameArena::ThreadArena::Reset() {
+    // Gives the overflow back to the heap
+    resource.reset();
+    if (overflow.bytes > 0) {
+        // Leave some room, so that a frame that is a bit bigger doesn't make it grow again
+        size = (size + overflow.bytes) * 2;
+        buffer = std::make_unique<std::byte[]>(size);
+        overflow.bytes = 0;
+    }
+    resource.emplace(buffer.get(), size, &overflow);
+}
+
+std::pmr::memory_resource* FrameArena::GetThreadResource() {
+    if (thread_cache.generation != generation) {
+        thread_cache.resource = FindThreadResource();
+        thread_cache.generation = generation;
+    }
+    return thread_cache.resource;
+}
+
+std::pmr::memory_resource* FrameArena::FindThreadResource() {
+    std::scoped_lock lock(mutex);
+    auto& arena = arenas[std::this_thread::get_id()];
+    if (arena == nullptr) {
+        arena = std::make_unique<ThreadArena>(buffer_size);
+    }
+    return &*arena->resource;
+}
+
+void FrameArena::Reset() {
+    std::scoped_lock lock(mutex);
+    for (auto& [thread, arena] : arenas) {
+        arena->Reset();
+    }
+}
+
+size_t FrameArena::GetCapacity() const {
+    std::scoped_lock lock(mutex);
+    size_t capacity = 0;
+    for (const auto& [thread, arena] : arenas) {
+        capacity += arena->size;
+    }
+    return capacity;
+}
+
+FrameScope::FrameScope(std::pmr::memory_resource* resource) : previous(current) { current = resource; }
+
+FrameScope::~FrameScope() { current = previous; }
+}  // namespace cqsp::common::util
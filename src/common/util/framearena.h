@@ -0,0 +1,120 @@
+/* Conquer Space
+ * Copyright (C) 2021-2023 Conquer Space
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <memory_resource>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <unordered_map>
+
+namespace cqsp::common::util {
+/// <summary>
+/// Memory for temporaries that only live for one tick, such as the ledgers made by the ledger arithmetic.
+/// Allocating only bumps a pointer, and freeing does nothing until Reset frees everything at once, so the
+/// temporaries don't go through the global heap.
+/// </summary>
+/// Every thread gets its own arena, because the systems and their loops run on many threads. Each arena
+/// starts with one buffer. Anything that doesn't fit goes to the heap for the rest of the tick, and the
+/// buffer grows on Reset so that the next tick fits.
+class FrameArena {
+ public:
+    static constexpr size_t default_buffer_size = 1 << 20;
+
+    explicit FrameArena(size_t buffer_size = default_buffer_size)
+        : buffer_size(buffer_size), generation(next_generation++) {}
+
+    /// <summary>
+    /// The arena of the calling thread, made the first time the thread asks for it. The thread remembers the
+    /// arena it got last, so asking again doesn't take the lock.
+    /// </summary>
+    std::pmr::memory_resource* GetThreadResource();
+
+    /// <summary>
+    /// Frees everything that was allocated from the arenas. Nothing allocated from them can be used after
+    /// this, and no other thread can be using them while this runs.
+    /// </summary>
+    void Reset();
+
+    /// <summary>
+    /// Size of the buffers of all the threads, in bytes
+    /// </summary>
+    size_t GetCapacity() const;
+
+ private:
+    /// <summary>
+    /// Where the arena gets memory from when its buffer is full. Counts how much it gave out, so that the
+    /// buffer can grow by that much.
+    /// </summary>
+    class Overflow : public std::pmr::memory_resource {
+     public:
+        size_t bytes = 0;
+
+     private:
+        void* do_allocate(size_t size, size_t alignment) override;
+        void do_deallocate(void* pointer, size_t size, size_t alignment) override;
+        bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override { return this == &other; }
+    };
+
+    struct ThreadArena {
+        explicit ThreadArena(size_t size);
+        void Reset();
+
+        std::unique_ptr<std::byte[]> buffer;
+        size_t size;
+        Overflow overflow;
+        std::optional<std::pmr::monotonic_buffer_resource> resource;
+    };
+
+    std::pmr::memory_resource* FindThreadResource();
+
+    size_t buffer_size;
+    // Tells the arenas apart in the per-thread cache, even if one is made where another was destroyed. A
+    // thread's resource lives as long as the arena, because Reset keeps it in place.
+    uint64_t generation;
+    mutable std::mutex mutex;
+    std::unordered_map<std::thread::id, std::unique_ptr<ThreadArena>> arenas;
+
+    inline static std::atomic<uint64_t> next_generation = 1;
+};
+
+/// <summary>
+/// Makes the calling thread put temporaries into resource until the scope ends, see FrameArena
+/// </summary>
+/// Scopes can be nested, and the outer scope's resource is used again when the inner scope ends.
+class FrameScope {
+ public:
+    explicit FrameScope(std::pmr::memory_resource* resource);
+    ~FrameScope();
+
+    FrameScope(const FrameScope&) = delete;
+    FrameScope& operator=(const FrameScope&) = delete;
+
+    /// <summary>
+    /// The resource of the innermost scope on the calling thread, or nullptr if there isn't one
+    /// </summary>
+    static std::pmr::memory_resource* Current() { return current; }
+
+ private:
+    std::pmr::memory_resource* previous;
+    inline static thread_local std::pmr::memory_resource* current = nullptr;
+};
+}  // namespace cqsp::common::util
@@ -16,12 +16,202 @@
  */
 #include "common/util/profiler.h"
 
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+
+#include <fmt/format.h>
 #include <spdlog/spdlog.h>
 
-// Define the thing
-std::map<std::string, int> profiler_information_map;
+namespace cqsp::common::util {
+namespace {
+// Zones that the calling thread is inside of
+thread_local uint32_t zone_depth = 0;
+
+double ToMicroseconds(int64_t nanoseconds) { return nanoseconds / 1000.0; }
+
+/// <summary>
+/// The duration at percentile of the sorted durations
+/// </summary>
+int64_t Percentile(const std::vector<int64_t>& sorted, double percentile) {
+    const size_t index = static_cast<size_t>(percentile * (sorted.size() - 1) + 0.5);
+    return sorted[std::min(index, sorted.size() - 1)];
+}
+
+/// <summary>
+/// Escapes a string to put it in a json string
+/// </summary>
+std::string EscapeJson(const char* str) {
+    std::string result;
+    for (; *str != '\0'; str++) {
+        switch (*str) {
+            case '"':
+                result += "\\\"";
+                break;
+            case '\\':
+                result += "\\\\";
+                break;
+            default:
+                result += *str;
+        }
+    }
+    return result;
+}
+}  // namespace
+
+ProfileZone::ProfileZone(const char* name, const char* file, int line) : name(name), file(file), line(line) {
+    id = Profiler::Get().Register(this);
+}
+
+Profiler& Profiler::Get() {
+    static Profiler profiler;
+    return profiler;
+}
+
+int64_t Profiler::Now() {
+    static const auto epoch = std::chrono::steady_clock::now();
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - epoch).count();
+}
+
+uint32_t Profiler::Register(ProfileZone* zone) {
+    std::scoped_lock lock(zone_mutex);
+    zones.push_back(zone);
+    return static_cast<uint32_t>(zones.size() - 1);
+}
+
+Profiler::ThreadBuffer& Profiler::GetThreadBuffer() {
+    // The profiler owns the buffers, so the events of threads that have exited can still be collected
+    thread_local ThreadBuffer* buffer = nullptr;
+    if (buffer == nullptr) {
+        auto new_buffer = std::make_shared<ThreadBuffer>();
+        std::scoped_lock lock(buffer_mutex);
+        new_buffer->thread_id = static_cast<uint32_t>(buffers.size());
+        buffers.push_back(new_buffer);
+        buffer = new_buffer.get();
+    }
+    return *buffer;
+}
+
+void Profiler::Record(const ProfileZone& zone, int64_t start, int64_t end, uint32_t depth) {
+    ThreadBuffer& buffer = GetThreadBuffer();
+    const size_t head = buffer.head.load(std::memory_order_relaxed);
+    if (head - buffer.tail.load(std::memory_order_acquire) >= buffer_size) {
+        dropped.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    buffer.events[head % buffer_size] = {&zone, start, end, depth};
+    buffer.head.store(head + 1, std::memory_order_release);
+}
+
+void Profiler::Collect() {
+    std::scoped_lock lock(collect_mutex);
+    CollectLocked();
+}
+
+void Profiler::CollectLocked() {
+    std::vector<std::shared_ptr<ThreadBuffer>> current;
+    {
+        std::scoped_lock lock(buffer_mutex);
+        current = buffers;
+    }
+    const bool keep_trace = tracing;
+    for (auto& buffer : current) {
+        const size_t head = buffer->head.load(std::memory_order_acquire);
+        size_t tail = buffer->tail.load(std::memory_order_relaxed);
+        for (; tail != head; tail++) {
+            const Event& event = buffer->events[tail % buffer_size];
+            if (event.zone->id >= histories.size()) {
+                histories.resize(event.zone->id + 1);
+            }
+            ZoneHistory& history = histories[event.zone->id];
+            const int64_t duration = event.end - event.start;
+            if (history.durations.size() < history_size) {
+                history.durations.push_back(duration);
+            } else {
+                history.durations[history.next] = duration;
+            }
+            history.next = (history.next + 1) % history_size;
+            history.count++;
+            history.last = duration;
+            if (keep_trace && trace.size() < max_trace_events) {
+                trace.push_back({event.zone, event.start, event.end, buffer->thread_id, event.depth});
+            }
+        }
+        buffer->tail.store(tail, std::memory_order_release);
+    }
+}
+
+std::vector<ProfileZoneStats> Profiler::GetStats() {
+    std::scoped_lock lock(collect_mutex);
+    CollectLocked();
+    std::vector<ProfileZoneStats> stats;
+    std::vector<int64_t> sorted;
+    for (size_t i = 0; i < histories.size(); i++) {
+        const ZoneHistory& history = histories[i];
+        if (history.count == 0) {
+            continue;
+        }
+        sorted = history.durations;
+        std::sort(sorted.begin(), sorted.end());
+        ProfileZoneStats& zone_stats = stats.emplace_back();
+        {
+            std::scoped_lock zone_lock(zone_mutex);
+            zone_stats.name = zones[i]->name;
+        }
+        zone_stats.count = history.count;
+        zone_stats.last_us = ToMicroseconds(history.last);
+        zone_stats.p50_us = ToMicroseconds(Percentile(sorted, 0.5));
+        zone_stats.p95_us = ToMicroseconds(Percentile(sorted, 0.95));
+        zone_stats.p99_us = ToMicroseconds(Percentile(sorted, 0.99));
+        zone_stats.max_us = ToMicroseconds(sorted.back());
+    }
+    return stats;
+}
+
+void Profiler::SetTracing(bool tracing) {
+    std::scoped_lock lock(collect_mutex);
+    // Events from before tracing was turned on shouldn't end up in the trace
+    CollectLocked();
+    if (tracing && !this->tracing) {
+        trace.clear();
+    }
+    this->tracing = tracing;
+}
+
+bool Profiler::WriteChromeTrace(const std::string& path) {
+    std::scoped_lock lock(collect_mutex);
+    CollectLocked();
+    std::ofstream stream(path);
+    if (!stream) {
+        SPDLOG_ERROR("Failed to write trace to {}", path);
+        return false;
+    }
+    // Complete events, the viewer nests them by their times
+    stream << "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [\n";
+    for (size_t i = 0; i < trace.size(); i++) {
+        const TraceEvent& event = trace[i];
+        stream << fmt::format(
+            "{{\"name\": \"{}\", \"cat\": \"cqsp\", \"ph\": \"X\", \"ts\": {:.3f}, \"dur\": {:.3f}, \"pid\": 1, "
+            "\"tid\": {}, \"args\": {{\"file\": \"{}\", \"line\": {}, \"depth\": {}}}}}{}\n",
+            EscapeJson(event.zone->name), ToMicroseconds(event.start), ToMicroseconds(event.end - event.start),
+            event.thread_id, EscapeJson(event.zone->file), event.zone->line, event.depth,
+            i + 1 < trace.size() ? "," : "");
+    }
+    stream << "]}\n";
+    if (trace.size() >= max_trace_events) {
+        SPDLOG_WARN("Trace reached {} events, later events were not recorded", max_trace_events);
+    }
+    return static_cast<bool>(stream);
+}
+
+ProfileBlock::ProfileBlock(const ProfileZone& zone) : zone(&zone), start(Profiler::Now()), depth(zone_depth++) {}
 
-void set_time_block(const std::string& str, std::chrono::high_resolution_clock::time_point start,
-                    std::chrono::high_resolution_clock::time_point end) {
-    profiler_information_map[str] = std::chrono::duration_cast<std::chrono::microseconds>(end - start).count();
+void ProfileBlock::End() {
+    if (zone == nullptr) {
+        return;
+    }
+    Profiler::Get().Record(*zone, start, Profiler::Now(), depth);
+    zone_depth--;
+    zone = nullptr;
 }
+}  // namespace cqsp::common::util
@@ -16,18 +16,187 @@
  */
 #pragma once
 
-#include <chrono>
-#include <map>
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
 #include <string>
+#include <vector>
 
-extern std::map<std::string, int> profiler_information_map;
+namespace cqsp::common::util {
+/// <summary>
+/// Describes a profiled block of code. There is one for each place that is profiled, made once as a static
+/// variable by the macros, so recording a block doesn't need to allocate or look up its name.
+/// </summary>
+struct ProfileZone {
+    ProfileZone(const char* name, const char* file, int line);
 
-#define BEGIN_TIMED_BLOCK(NAME) \
-    std::chrono::high_resolution_clock::time_point block_start_##NAME = std::chrono::high_resolution_clock::now();
+    const char* name;
+    const char* file;
+    int line;
+    // Index of the zone in the profiler
+    uint32_t id;
+};
 
-void set_time_block(const std::string& str, std::chrono::high_resolution_clock::time_point start,
-                    std::chrono::high_resolution_clock::time_point end);
+/// <summary>
+/// Timings of a zone over its last runs
+/// </summary>
+struct ProfileZoneStats {
+    std::string name;
+    // Number of runs since the profiler started
+    uint64_t count = 0;
+    double last_us = 0;
+    double p50_us = 0;
+    double p95_us = 0;
+    double p99_us = 0;
+    double max_us = 0;
+};
 
-#define END_TIMED_BLOCK(NAME)                                                                                    \
-    std::chrono::high_resolution_clock::time_point block_end_##NAME = std::chrono::high_resolution_clock::now(); \
-    set_time_block(#NAME, block_start_##NAME, block_end_##NAME);
+/// <summary>
+/// Collects the timings of profiled blocks from every thread.
+/// Each thread writes into its own ring buffer without taking a lock, and Collect moves the events out of the
+/// buffers into the history of their zones. Only the last history_size runs of each zone are kept, so the
+/// percentiles follow recent behavior. While tracing is on, the events are kept as well, so that they can be
+/// written as a Chrome trace (chrome://tracing or https://ui.perfetto.dev) when there is no profiler GUI.
+/// </summary>
+class Profiler {
+ public:
+    static constexpr size_t buffer_size = 1 << 12;
+    static constexpr size_t history_size = 512;
+    // Stops tracing from taking all of the memory on long runs
+    static constexpr size_t max_trace_events = 1 << 22;
+
+    static Profiler& Get();
+
+    /// <summary>
+    /// Called by the zones when they are made
+    /// </summary>
+    uint32_t Register(ProfileZone* zone);
+
+    /// <summary>
+    /// Adds a run of zone to the buffer of the calling thread. If the buffer is full, the run is dropped.
+    /// </summary>
+    /// <param name="start">Nanoseconds since the profiler started, see Now</param>
+    /// <param name="depth">How many zones the run is nested in</param>
+    void Record(const ProfileZone& zone, int64_t start, int64_t end, uint32_t depth);
+
+    /// <summary>
+    /// Moves the runs recorded by every thread into the zone histories, and into the trace if tracing is on.
+    /// This should be called regularly, such as after every tick, so the buffers don't fill up.
+    /// </summary>
+    void Collect();
+
+    /// <summary>
+    /// Collects, then returns the timings of every zone that has run
+    /// </summary>
+    std::vector<ProfileZoneStats> GetStats();
+
+    void SetTracing(bool tracing);
+    bool IsTracing() const { return tracing; }
+
+    /// <summary>
+    /// Collects, then writes the events recorded while tracing was on in the Chrome trace event format
+    /// </summary>
+    /// <returns>false if the file couldn't be written</returns>
+    bool WriteChromeTrace(const std::string& path);
+
+    /// <summary>
+    /// Runs that were dropped because a buffer was full
+    /// </summary>
+    uint64_t GetDroppedCount() const { return dropped; }
+
+    /// <summary>
+    /// Nanoseconds since the profiler started
+    /// </summary>
+    static int64_t Now();
+
+ private:
+    Profiler() = default;
+
+    struct Event {
+        const ProfileZone* zone;
+        int64_t start;
+        int64_t end;
+        uint32_t depth;
+    };
+
+    /// <summary>
+    /// Written only by its thread, and read only by Collect
+    /// </summary>
+    struct ThreadBuffer {
+        std::array<Event, buffer_size> events;
+        std::atomic<size_t> head = 0;
+        std::atomic<size_t> tail = 0;
+        uint32_t thread_id;
+    };
+
+    struct ZoneHistory {
+        // Durations in nanoseconds, used as a ring buffer
+        std::vector<int64_t> durations;
+        size_t next = 0;
+        uint64_t count = 0;
+        int64_t last = 0;
+    };
+
+    struct TraceEvent {
+        const ProfileZone* zone;
+        int64_t start;
+        int64_t end;
+        uint32_t thread_id;
+        uint32_t depth;
+    };
+
+    ThreadBuffer& GetThreadBuffer();
+    // Has to be called with collect_mutex held
+    void CollectLocked();
+
+    std::mutex zone_mutex;
+    std::vector<ProfileZone*> zones;
+
+    std::mutex buffer_mutex;
+    std::vector<std::shared_ptr<ThreadBuffer>> buffers;
+
+    std::mutex collect_mutex;
+    std::vector<ZoneHistory> histories;
+    std::vector<TraceEvent> trace;
+
+    std::atomic<bool> tracing = false;
+    std::atomic<uint64_t> dropped = 0;
+};
+
+/// <summary>
+/// Times a zone from when it is made until End is called, or until it is destroyed
+/// </summary>
+class ProfileBlock {
+ public:
+    explicit ProfileBlock(const ProfileZone& zone);
+    ~ProfileBlock() { End(); }
+
+    ProfileBlock(const ProfileBlock&) = delete;
+    ProfileBlock& operator=(const ProfileBlock&) = delete;
+
+    void End();
+
+ private:
+    const ProfileZone* zone;
+    int64_t start;
+    uint32_t depth;
+};
+}  // namespace cqsp::common::util
+
+#define CQSP_PROFILE_CONCAT_INNER(A, B) A##B
+#define CQSP_PROFILE_CONCAT(A, B) CQSP_PROFILE_CONCAT_INNER(A, B)
+
+/// Profiles the rest of the scope
+#define PROFILE_SCOPE(NAME)                                                                                    \
+    static cqsp::common::util::ProfileZone CQSP_PROFILE_CONCAT(profile_zone_, __LINE__)(NAME, __FILE__,        \
+                                                                                      __LINE__);               \
+    cqsp::common::util::ProfileBlock CQSP_PROFILE_CONCAT(profile_block_, __LINE__)(                            \
+        CQSP_PROFILE_CONCAT(profile_zone_, __LINE__));
+
+#define BEGIN_TIMED_BLOCK(NAME)                                                                   \
+    static cqsp::common::util::ProfileZone profile_zone_##NAME(#NAME, __FILE__, __LINE__);        \
+    cqsp::common::util::ProfileBlock profile_block_##NAME(profile_zone_##NAME);
+
+#define END_TIMED_BLOCK(NAME) profile_block_##NAME.End();
@@ -0,0 +1,322 @@
+/* Conquer Space
+ * Copyright (C) 2021-2023 Conquer Space
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <map>
+#include <set>
+#include <stdexcept>
+#include <string>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include <entt/entt.hpp>
+
+#include "common/components/resource.h"
+
+namespace cqsp::common::save {
+/// <summary>
+/// Describes how a type is written into a binary archive. Trivially copyable types are copied as raw bytes
+/// and empty types are skipped, so only types that own memory or hide their fields need a specialization.
+///
+/// A specialization sets `custom` to true and has a `template <typename Archive> static void Apply(Archive&, T&)`
+/// that calls the archive with every field. The same function is used for saving and loading, use
+/// `Archive::is_loading` to tell them apart.
+/// </summary>
+template <typename T, typename Enable = void>
+struct Serializer {
+    static constexpr bool custom = false;
+};
+
+/// <summary>
+/// Writes values into a byte buffer. This is the archive that entt's snapshot is given when saving.
+/// </summary>
+class BinaryOutputArchive {
+ public:
+    static constexpr bool is_loading = false;
+
+    explicit BinaryOutputArchive(std::vector<char>& buffer) : buffer(buffer) {}
+
+    template <typename... T>
+    void operator()(const T&... values) {
+        (Process(const_cast<T&>(values)), ...);
+    }
+
+    void Bytes(const void* data, size_t size) {
+        const char* bytes = static_cast<const char*>(data);
+        buffer.insert(buffer.end(), bytes, bytes + size);
+    }
+
+    size_t Position() const { return buffer.size(); }
+
+ private:
+    template <typename T>
+    void Process(T& value);
+
+    std::vector<char>& buffer;
+};
+
+/// <summary>
+/// Reads values out of a block of memory, such as a save file that was read in one go or mapped into memory.
+/// Throws std::runtime_error if the data ends before the value is read.
+/// </summary>
+class BinaryInputArchive {
+ public:
+    static constexpr bool is_loading = true;
+
+    BinaryInputArchive(const char* data, size_t size) : data(data), size(size) {}
+
+    template <typename... T>
+    void operator()(T&... values) {
+        (Process(values), ...);
+    }
+
+    void Bytes(void* out, size_t length) {
+        if (length > Remaining()) {
+            throw std::runtime_error("Save data ends unexpectedly");
+        }
+        std::memcpy(out, data + position, length);
+        position += length;
+    }
+
+    /// <summary>
+    /// Reads an element count, and makes sure the data left can hold that many elements so that corrupt
+    /// saves don't turn into huge allocations.
+    /// </summary>
+    size_t Count(size_t element_size) {
+        uint64_t count = 0;
+        Bytes(&count, sizeof(count));
+        if (element_size != 0 && count > Remaining() / element_size) {
+            throw std::runtime_error("Save data has an invalid element count");
+        }
+        return static_cast<size_t>(count);
+    }
+
+    size_t Remaining() const { return size - position; }
+    size_t Position() const { return position; }
+
+ private:
+    template <typename T>
+    void Process(T& value);
+
+    const char* data;
+    size_t size;
+    size_t position = 0;
+};
+
+template <typename T>
+void BinaryOutputArchive::Process(T& value) {
+    if constexpr (Serializer<T>::custom) {
+        Serializer<T>::Apply(*this, value);
+    } else if constexpr (std::is_empty_v<T>) {
+        // Tags carry no data
+    } else {
+        static_assert(std::is_trivially_copyable_v<T>, "Type needs a save::Serializer specialization");
+        Bytes(&value, sizeof(T));
+    }
+}
+
+template <typename T>
+void BinaryInputArchive::Process(T& value) {
+    if constexpr (Serializer<T>::custom) {
+        Serializer<T>::Apply(*this, value);
+    } else if constexpr (std::is_empty_v<T>) {
+        // Tags carry no data
+    } else {
+        static_assert(std::is_trivially_copyable_v<T>, "Type needs a save::Serializer specialization");
+        Bytes(&value, sizeof(T));
+    }
+}
+
+namespace detail {
+template <typename Archive>
+size_t Count(Archive& archive, size_t size, size_t element_size) {
+    if constexpr (Archive::is_loading) {
+        return archive.Count(element_size);
+    } else {
+        uint64_t count = size;
+        archive(count);
+        return size;
+    }
+}
+
+template <typename T>
+constexpr bool is_raw_v = std::is_trivially_copyable_v<T> && !Serializer<T>::custom;
+}  // namespace detail
+
+template <typename Char>
+struct Serializer<std::basic_string<Char>> {
+    static constexpr bool custom = true;
+
+    template <typename Archive>
+    static void Apply(Archive& archive, std::basic_string<Char>& value) {
+        const size_t size = detail::Count(archive, value.size(), sizeof(Char));
+        if constexpr (Archive::is_loading) {
+            value.resize(size);
+        }
+        archive.Bytes(value.data(), size * sizeof(Char));
+    }
+};
+
+template <typename T, typename Alloc>
+struct Serializer<std::vector<T, Alloc>> {
+    static constexpr bool custom = true;
+
+    template <typename Archive>
+    static void Apply(Archive& archive, std::vector<T, Alloc>& value) {
+        const size_t size = detail::Count(archive, value.size(), std::is_empty_v<T> ? 0 : 1);
+        if constexpr (Archive::is_loading) {
+            value.clear();
+            value.resize(size);
+        }
+        if constexpr (detail::is_raw_v<T>) {
+            archive.Bytes(value.data(), size * sizeof(T));
+        } else {
+            for (T& element : value) {
+                archive(element);
+            }
+        }
+    }
+};
+
+template <typename T, typename Alloc>
+struct Serializer<std::deque<T, Alloc>> {
+    static constexpr bool custom = true;
+
+    template <typename Archive>
+    static void Apply(Archive& archive, std::deque<T, Alloc>& value) {
+        const size_t size = detail::Count(archive, value.size(), std::is_empty_v<T> ? 0 : 1);
+        if constexpr (Archive::is_loading) {
+            value.clear();
+            value.resize(size);
+        }
+        for (T& element : value) {
+            archive(element);
+        }
+    }
+};
+
+template <typename Key, typename Value, typename Compare, typename Alloc>
+struct Serializer<std::map<Key, Value, Compare, Alloc>> {
+    static constexpr bool custom = true;
+
+    template <typename Archive>
+    static void Apply(Archive& archive, std::map<Key, Value, Compare, Alloc>& value) {
+        const size_t size = detail::Count(archive, value.size(), 1);
+        if constexpr (Archive::is_loading) {
+            value.clear();
+            for (size_t i = 0; i < size; i++) {
+                Key key {};
+                Value element {};
+                archive(key, element);
+                value.emplace_hint(value.end(), std::move(key), std::move(element));
+            }
+        } else {
+            for (auto& [key, element] : value) {
+                archive(key, element);
+            }
+        }
+    }
+};
+
+template <typename Key, typename Compare, typename Alloc>
+struct Serializer<std::set<Key, Compare, Alloc>> {
+    static constexpr bool custom = true;
+
+    template <typename Archive>
+    static void Apply(Archive& archive, std::set<Key, Compare, Alloc>& value) {
+        const size_t size = detail::Count(archive, value.size(), 1);
+        if constexpr (Archive::is_loading) {
+            value.clear();
+            for (size_t i = 0; i < size; i++) {
+                Key key {};
+                archive(key);
+                value.emplace_hint(value.end(), std::move(key));
+            }
+        } else {
+            for (const Key& key : value) {
+                archive(key);
+            }
+        }
+    }
+};
+
+template <typename... T>
+struct Serializer<std::tuple<T...>> {
+    static constexpr bool custom = true;
+
+    template <typename Archive>
+    static void Apply(Archive& archive, std::tuple<T...>& value) {
+        std::apply([&archive](T&... elements) { archive(elements...); }, value);
+    }
+};
+
+template <typename Entity>
+struct Serializer<entt::basic_sparse_set<Entity>> {
+    static constexpr bool custom = true;
+
+    template <typename Archive>
+    static void Apply(Archive& archive, entt::basic_sparse_set<Entity>& value) {
+        const size_t size = detail::Count(archive, value.size(), sizeof(Entity));
+        if constexpr (Archive::is_loading) {
+            value.clear();
+            for (size_t i = 0; i < size; i++) {
+                Entity entity;
+                archive(entity);
+                value.emplace(entity);
+            }
+        } else {
+            for (Entity entity : value) {
+                archive(entity);
+            }
+        }
+    }
+};
+
+/// <summary>
+/// Ledgers are saved as good and amount pairs, because the dense index of a good depends on the order that
+/// goods were registered in, and that can change between runs.
+/// </summary>
+template <typename T>
+struct Serializer<T, std::enable_if_t<std::is_base_of_v<components::ResourceLedger, T>>> {
+    static constexpr bool custom = true;
+
+    template <typename Archive>
+    static void Apply(Archive& archive, T& value) {
+        const size_t size = detail::Count(archive, value.size(), sizeof(entt::entity) + sizeof(double));
+        if constexpr (Archive::is_loading) {
+            value.clear();
+            for (size_t i = 0; i < size; i++) {
+                entt::entity good;
+                double amount;
+                archive(good, amount);
+                value[good] = amount;
+            }
+        } else {
+            for (auto& [good, amount] : value) {
+                entt::entity key = good;
+                archive(key, amount);
+            }
+        }
+    }
+};
+}  // namespace cqsp::common::save
@@ -16,13 +16,517 @@
  */
 #include "common/util/save/save.h"
 
+#include <fmt/format.h>
 #include <hjson.h>
+#include <spdlog/spdlog.h>
 
+#include <cstring>
 #include <filesystem>
+#include <map>
+#include <memory>
+#include <stdexcept>
 #include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+#include <vector>
 
+#include "common/components/area.h"
+#include "common/components/auction.h"
+#include "common/components/bodies.h"
+#include "common/components/coordinates.h"
+#include "common/components/economy.h"
+#include "common/components/history.h"
+#include "common/components/infrastructure.h"
+#include "common/components/model.h"
+#include "common/components/movement.h"
+#include "common/components/name.h"
+#include "common/components/orbit.h"
+#include "common/components/organizations.h"
+#include "common/components/player.h"
+#include "common/components/population.h"
+#include "common/components/ports.h"
+#include "common/components/resource.h"
+#include "common/components/science.h"
+#include "common/components/ships.h"
+#include "common/components/surface.h"
+#include "common/util/save/archive.h"
 #include "common/version.h"
 
+namespace cqsp::common::save {
+// Components with fields that can't be copied as raw bytes list their fields here
+#define CQSP_SERIALIZER(Type, ...)                                \
+    template <>                                                   \
+    struct Serializer<Type> {                                     \
+        static constexpr bool custom = true;                      \
+                                                                  \
+        template <typename Archive>                               \
+        static void Apply(Archive& archive, Type& value) {        \
+            archive(__VA_ARGS__);                                 \
+        }                                                         \
+    };
+
+CQSP_SERIALIZER(components::Name, value.name)
+CQSP_SERIALIZER(components::Identifier, value.identifier)
+CQSP_SERIALIZER(components::Description, value.description)
+CQSP_SERIALIZER(components::WorldModel, value.name)
+CQSP_SERIALIZER(components::IndustrialZone, value.industries)
+CQSP_SERIALIZER(components::CountryCityList, value.city_list, value.province_list)
+CQSP_SERIALIZER(components::AuctionHouse, value.sell_orders, value.buy_orders)
+CQSP_SERIALIZER(components::bodies::TexturedTerrain, value.terrain_name, value.normal_name, value.roughness_name)
+CQSP_SERIALIZER(components::bodies::OrbitalSystem, value.children)
+CQSP_SERIALIZER(components::bodies::TerrainData, value.sea_level, value.data)
+CQSP_SERIALIZER(components::types::Orbit, value.eccentricity, value.semi_major_axis, value.inclination, value.LAN,
+                value.w, value.M0, value.epoch, value.v, value.GM, value.reference_body)
+CQSP_SERIALIZER(components::Market, value.demand, value.sd_ratio, value.ds_ratio, value.supply, value.volume,
+                value.price, value.previous_demand, value.previous_supply, value.latent_supply,
+                value.last_latent_demand, value.latent_demand, value.market_information,
+                value.last_market_information, value.participants, value.connected_markets, value.GDP,
+                value.pricing_runs, value.priced_run)
+CQSP_SERIALIZER(components::Wallet, value.balance, value.change, value.GDP_change, value.currency)
+CQSP_SERIALIZER(components::CommandQueue, value.commands)
+CQSP_SERIALIZER(components::Unit, value.unit_name)
+CQSP_SERIALIZER(components::Recipe, value.input, value.output, value.type, value.interval, value.workers,
+                value.capitalcost)
+CQSP_SERIALIZER(components::RecipeCost, value.fixed, value.scaling)
+CQSP_SERIALIZER(components::ResourceIO, value.input, value.output)
+CQSP_SERIALIZER(components::ResourceDistribution, value.dist)
+CQSP_SERIALIZER(components::science::Field, value.parents, value.adjacent)
+CQSP_SERIALIZER(components::science::Science, value.difficulty, value.fields)
+CQSP_SERIALIZER(components::science::Lab, value.science_contribution)
+CQSP_SERIALIZER(components::science::ScientificProgress, value.science_progress)
+CQSP_SERIALIZER(components::science::ScientificResearch, value.current_research, value.potential_research)
+CQSP_SERIALIZER(components::science::TechnologicalProgress, value.researched_techs, value.researched_recipes,
+                value.researched_mining)
+CQSP_SERIALIZER(components::science::Technology, value.fields, value.actions, value.difficulty)
+CQSP_SERIALIZER(components::ships::Fleet, value.echelon, value.subfleets, value.ships, value.parent_fleet,
+                value.owner)
+CQSP_SERIALIZER(components::Habitation, value.settlements)
+CQSP_SERIALIZER(components::ProvincedPlanet, value.province_texture, value.province_map)
+CQSP_SERIALIZER(components::Settlement, value.population)
+CQSP_SERIALIZER(components::Province, value.country, value.cities)
+
+#undef CQSP_SERIALIZER
+
+/// <summary>
+/// Order books are saved as their orders, best price first, and rebuilt by putting them back in that order,
+/// which keeps the order of each price level.
+/// </summary>
+template <typename Compare>
+struct Serializer<components::OrderBook<Compare>> {
+    static constexpr bool custom = true;
+
+    template <typename Archive>
+    static void Apply(Archive& archive, components::OrderBook<Compare>& value) {
+        std::vector<components::Order> orders;
+        if constexpr (!Archive::is_loading) {
+            orders.reserve(value.size());
+            for (const auto& [price, level] : value.GetLevels()) {
+                orders.insert(orders.end(), level.orders.begin(), level.orders.end());
+            }
+        }
+        archive(orders);
+        if constexpr (Archive::is_loading) {
+            value.clear();
+            for (const components::Order& order : orders) {
+                value.put(order);
+            }
+        }
+    }
+};
+
+/// <summary>
+/// The goods of the history columns are saved by entity, and their dense good indices are looked up again when
+/// the save is loaded. The columns keep their order, so their data is saved as is.
+/// </summary>
+template <>
+struct Serializer<components::MarketHistory> {
+    static constexpr bool custom = true;
+    static constexpr size_t metric_count = static_cast<size_t>(components::MarketMetric::Count);
+
+    template <typename Archive>
+    static void Apply(Archive& archive, components::MarketHistory& value) {
+        using components::GoodIndex;
+        std::vector<entt::entity> goods;
+        if constexpr (!Archive::is_loading) {
+            for (uint32_t good_index : value.goods) {
+                goods.push_back(GoodIndex::Entity(good_index));
+            }
+        }
+        archive(goods);
+        if constexpr (Archive::is_loading) {
+            value.goods.clear();
+            value.column_of.clear();
+            for (entt::entity good : goods) {
+                const uint32_t good_index = GoodIndex::Register(good);
+                if (value.FindColumn(good_index) != components::MarketHistory::null_column) {
+                    throw std::runtime_error("Save has invalid market history");
+                }
+                value.AddColumn(good_index);
+            }
+        }
+
+        for (components::HistoryTier& tier : value.tiers) {
+            archive(tier.capacity, tier.head, tier.size, tier.merge, tier.dates, tier.gdp, tier.pending_gdp,
+                    tier.pending_count);
+            if constexpr (Archive::is_loading) {
+                if (tier.dates.size() != tier.capacity || tier.gdp.size() != tier.capacity ||
+                    tier.size > tier.capacity || (tier.capacity != 0 && tier.head >= tier.capacity)) {
+                    throw std::runtime_error("Save has invalid market history");
+                }
+                // The columns of the saved goods have to fit in the rest of the data, so that a corrupt capacity
+                // can't turn into a huge allocation
+                const size_t column_count = metric_count * goods.size();
+                if (column_count != 0 && tier.capacity > archive.Remaining() / column_count / sizeof(double)) {
+                    throw std::runtime_error("Save has invalid market history");
+                }
+                tier.goods = static_cast<uint32_t>(goods.size());
+                tier.columns.assign(column_count * tier.capacity, 0.0);
+                tier.pending.assign(column_count, 0.0);
+            }
+            archive.Bytes(tier.columns.data(), tier.columns.size() * sizeof(double));
+            archive.Bytes(tier.pending.data(), tier.pending.size() * sizeof(double));
+        }
+    }
+};
+
+namespace {
+namespace cqspc = cqsp::common::components;
+
+// Every component that is saved. The type name is the name of the chunk it is saved in, so renaming a
+// component here makes old saves skip it.
+// Not saved:
+// - event::EventQueue, because it holds lua functions.
+// - Client components, which are rebuilt from the universe when the game scene starts.
+// - CompiledRecipe, because it holds GoodIndex values, which depend on the order that goods are registered
+//   in. SysProduction compiles every Recipe that doesn't have one.
+// - types::OrbitCache, which SysOrbit builds from the Orbit when it's missing.
+// - OrderBook isn't a component, the books are saved with their AuctionHouse.
+// - The maneuver queue of SysOrbit isn't in the universe. It's rebuilt from the CommandQueues on the first tick.
+#define CQSP_SAVED_COMPONENTS(X)                   \
+    X(cqspc::Name)                                 \
+    X(cqspc::Identifier)                           \
+    X(cqspc::Description)                          \
+    X(cqspc::WorldModel)                           \
+    X(cqspc::Governed)                             \
+    X(cqspc::Organization)                         \
+    X(cqspc::Country)                              \
+    X(cqspc::CountryCityList)                      \
+    X(cqspc::Player)                               \
+    X(cqspc::PopulationSegment)                    \
+    X(cqspc::Hunger)                               \
+    X(cqspc::LaunchVehicle)                        \
+    X(cqspc::IndustrialZone)                       \
+    X(cqspc::Production)                           \
+    X(cqspc::Factory)                              \
+    X(cqspc::Mine)                                 \
+    X(cqspc::Service)                              \
+    X(cqspc::Farm)                                 \
+    X(cqspc::RawResourceGen)                       \
+    X(cqspc::AuctionHouse)                         \
+    X(cqspc::bodies::Body)                         \
+    X(cqspc::bodies::TexturedTerrain)              \
+    X(cqspc::bodies::NautralObject)                \
+    X(cqspc::bodies::OrbitalSystem)                \
+    X(cqspc::bodies::DirtyOrbit)                   \
+    X(cqspc::bodies::Terrain)                      \
+    X(cqspc::bodies::TerrainData)                  \
+    X(cqspc::bodies::Star)                         \
+    X(cqspc::bodies::Planet)                       \
+    X(cqspc::bodies::LightEmitter)                 \
+    X(cqspc::types::OrbitDirty)                    \
+    X(cqspc::types::Kinematics)                    \
+    X(cqspc::types::FuturePosition)                \
+    X(cqspc::types::Impulse)                       \
+    X(cqspc::types::GalacticCoordinate)            \
+    X(cqspc::types::PolarCoordinate)               \
+    X(cqspc::types::MoveTarget)                    \
+    X(cqspc::types::SurfaceCoordinate)             \
+    X(cqspc::types::Orbit)                         \
+    X(cqspc::types::SetTrueAnomaly)                \
+    X(cqspc::PlanetaryMarket)                      \
+    X(cqspc::Market)                               \
+    X(cqspc::Price)                                \
+    X(cqspc::Currency)                             \
+    X(cqspc::CostTable)                            \
+    X(cqspc::Wallet)                               \
+    X(cqspc::MarketAgent)                          \
+    X(cqspc::MarketCenter)                         \
+    X(cqspc::InternationalPort)                    \
+    X(cqspc::Commercial)                           \
+    X(cqspc::Employer)                             \
+    X(cqspc::LaborInformation)                     \
+    X(cqspc::FactoryProducing)                     \
+    X(cqspc::Owned)                                \
+    X(cqspc::MarketHistory)                        \
+    X(cqspc::infrastructure::Infrastructure)       \
+    X(cqspc::infrastructure::CityInfrastructure)   \
+    X(cqspc::infrastructure::PowerPlant)           \
+    X(cqspc::infrastructure::PowerConsumption)     \
+    X(cqspc::infrastructure::CityPower)            \
+    X(cqspc::infrastructure::BrownOut)             \
+    X(cqspc::infrastructure::SpacePort)            \
+    X(cqspc::infrastructure::Highway)              \
+    X(cqspc::CommandQueue)                         \
+    X(cqspc::Matter)                               \
+    X(cqspc::Energy)                               \
+    X(cqspc::Unit)                                 \
+    X(cqspc::Good)                                 \
+    X(cqspc::ConsumerGood)                         \
+    X(cqspc::Mineral)                              \
+    X(cqspc::CapitalGood)                          \
+    X(cqspc::Recipe)                               \
+    X(cqspc::RecipeCost)                           \
+    X(cqspc::IndustrySize)                         \
+    X(cqspc::CostBreakdown)                        \
+    X(cqspc::ResourceIO)                           \
+    X(cqspc::FactoryTimer)                         \
+    X(cqspc::ResourceConsumption)                  \
+    X(cqspc::ResourceProduction)                   \
+    X(cqspc::ResourceConverter)                    \
+    X(cqspc::ResourceStockpile)                    \
+    X(cqspc::FailedResourceTransfer)               \
+    X(cqspc::FailedResourceProduction)             \
+    X(cqspc::FailedResourceConsumption)            \
+    X(cqspc::ResourceDistribution)                 \
+    X(cqspc::science::Field)                       \
+    X(cqspc::science::Science)                     \
+    X(cqspc::science::Lab)                         \
+    X(cqspc::science::ScientificProgress)          \
+    X(cqspc::science::ScienceProject)              \
+    X(cqspc::science::ScientificResearch)          \
+    X(cqspc::science::TechnologicalProgress)       \
+    X(cqspc::science::Technology)                  \
+    X(cqspc::ships::Ship)                          \
+    X(cqspc::ships::Crash)                         \
+    X(cqspc::ships::Fleet)                         \
+    X(cqspc::Surface)                              \
+    X(cqspc::Habitation)                           \
+    X(cqspc::ProvincedPlanet)                      \
+    X(cqspc::Settlement)                           \
+    X(cqspc::TimeZone)                             \
+    X(cqspc::CityTimeZone)                         \
+    X(cqspc::Province)                             \
+    X(cqspc::ProvinceColor)                        \
+    X(cqspc::CapitalCity)
+
+/// <summary>
+/// The save starts with this header, and is followed by `chunk_count` chunks that are each a ChunkHeader
+/// followed by `size` bytes of data. Everything is stored in the native byte order.
+/// </summary>
+struct FileHeader {
+    char magic[sizeof(save_magic)];
+    uint32_t format_version;
+    uint32_t chunk_count;
+};
+
+enum class ChunkType : uint32_t {
+    // Date, uuid and the version of the game that wrote the save
+    Meta = 1,
+    // The name maps of the universe
+    Names = 2,
+    // The entity list of the registry
+    Entities = 3,
+    // The storage of one component type, starting with the name of the component
+    Component = 4,
+};
+
+struct ChunkHeader {
+    ChunkType type;
+    uint32_t reserved;
+    uint64_t size;
+};
+
+struct Chunk {
+    ChunkType type;
+    const char* data;
+    size_t size;
+};
+
+class ChunkWriter {
+ public:
+    explicit ChunkWriter(std::vector<char>& buffer) : buffer(buffer) {
+        FileHeader header {};
+        std::memcpy(header.magic, save_magic, sizeof(save_magic));
+        header.format_version = save_format_version;
+        Append(header);
+    }
+
+    /// <summary>
+    /// Starts a chunk, and returns an archive that appends to it. The chunk lasts until the next call to Begin
+    /// or Finish.
+    /// </summary>
+    BinaryOutputArchive Begin(ChunkType type) {
+        End();
+        chunk_start = buffer.size();
+        ChunkHeader header {type, 0, 0};
+        Append(header);
+        return BinaryOutputArchive(buffer);
+    }
+
+    void Finish() {
+        End();
+        std::memcpy(buffer.data() + offsetof(FileHeader, chunk_count), &chunk_count, sizeof(chunk_count));
+    }
+
+ private:
+    template <typename T>
+    void Append(const T& value) {
+        const char* bytes = reinterpret_cast<const char*>(&value);
+        buffer.insert(buffer.end(), bytes, bytes + sizeof(T));
+    }
+
+    void End() {
+        if (chunk_start == npos) {
+            return;
+        }
+        const uint64_t size = buffer.size() - chunk_start - sizeof(ChunkHeader);
+        std::memcpy(buffer.data() + chunk_start + offsetof(ChunkHeader, size), &size, sizeof(size));
+        chunk_start = npos;
+        chunk_count++;
+    }
+
+    static constexpr size_t npos = static_cast<size_t>(-1);
+
+    std::vector<char>& buffer;
+    size_t chunk_start = npos;
+    uint32_t chunk_count = 0;
+};
+
+/// <summary>
+/// Checks the header and the bounds of every chunk before anything in the universe is touched, so that a
+/// truncated save fails without destroying the game that is loaded.
+/// </summary>
+std::vector<Chunk> ReadChunks(const char* data, size_t size) {
+    FileHeader header;
+    if (size < sizeof(header)) {
+        throw std::runtime_error("Save is too small to be a save");
+    }
+    std::memcpy(&header, data, sizeof(header));
+    if (std::memcmp(header.magic, save_magic, sizeof(save_magic)) != 0) {
+        throw std::runtime_error("Save is not a Conquer Space save");
+    }
+    if (header.format_version != save_format_version) {
+        throw std::runtime_error(fmt::format("Save format version {} is not supported, expected {}",
+                                             header.format_version, save_format_version));
+    }
+
+    std::vector<Chunk> chunks;
+    chunks.reserve(header.chunk_count);
+    size_t position = sizeof(header);
+    for (uint32_t i = 0; i < header.chunk_count; i++) {
+        ChunkHeader chunk;
+        if (size - position < sizeof(chunk)) {
+            throw std::runtime_error("Save ends in the middle of a chunk header");
+        }
+        std::memcpy(&chunk, data + position, sizeof(chunk));
+        position += sizeof(chunk);
+        if (chunk.size > size - position) {
+            throw std::runtime_error("Save ends in the middle of a chunk");
+        }
+        chunks.push_back({chunk.type, data + position, static_cast<size_t>(chunk.size)});
+        position += chunk.size;
+    }
+    return chunks;
+}
+
+/// <summary>
+/// Calls func with all of the name maps of the universe
+/// </summary>
+template <typename Function>
+void ApplyNames(Universe& universe, Function&& func) {
+    func(universe.goods, universe.consumergoods, universe.recipes, universe.terrain_data, universe.fields,
+         universe.technologies, universe.planets, universe.time_zones, universe.countries, universe.provinces,
+         universe.cities, universe.province_colors, universe.colors_province, universe.sun);
+}
+
+template <typename Archive>
+void SerializeNames(Archive& archive, Universe& universe) {
+    ApplyNames(universe, [&archive](auto&... names) { archive(names...); });
+}
+
+template <typename Component>
+void SaveComponent(ChunkWriter& writer, const Universe& universe, const std::string& name) {
+    BinaryOutputArchive archive = writer.Begin(ChunkType::Component);
+    archive(name);
+    entt::snapshot {universe}.component<Component>(archive);
+}
+
+/// <summary>
+/// Copies the component of every entity that has one into copy, which already has the same entities
+/// </summary>
+template <typename Component>
+void CopyComponent(Universe& universe, Universe& copy) {
+    auto& storage = universe.storage<Component>();
+    const entt::sparse_set& entities = storage;
+    if constexpr (std::is_empty_v<Component>) {
+        copy.insert<Component>(entities.begin(), entities.end());
+    } else {
+        // The components are in the same order as the entities of the storage
+        copy.insert<Component>(entities.begin(), entities.end(), storage.begin());
+    }
+}
+
+using ComponentLoader = void (*)(const entt::snapshot_loader&, BinaryInputArchive&);
+
+const std::map<std::string_view, ComponentLoader>& GetComponentLoaders() {
+#define CQSP_COMPONENT_LOADER(Type) \
+    {#Type, [](const entt::snapshot_loader& loader, BinaryInputArchive& archive) { loader.component<Type>(archive); }},
+    static const std::map<std::string_view, ComponentLoader> loaders = {CQSP_SAVED_COMPONENTS(CQSP_COMPONENT_LOADER)};
+#undef CQSP_COMPONENT_LOADER
+    return loaders;
+}
+
+/// <summary>
+/// Restores the chunks into universe, which has to be empty
+/// </summary>
+void LoadChunks(Universe& universe, const std::vector<Chunk>& chunks) {
+    const entt::snapshot_loader loader {universe};
+    bool loaded_entities = false;
+    for (const Chunk& chunk : chunks) {
+        BinaryInputArchive archive(chunk.data, chunk.size);
+        switch (chunk.type) {
+            case ChunkType::Meta: {
+                int date;
+                std::string version;
+                archive(date, universe.uuid, version);
+                universe.date.SetDate(date);
+                if (version != CQSP_VERSION) {
+                    SPDLOG_WARN("Loading a save from version {} into version {}", version, CQSP_VERSION);
+                }
+                break;
+            }
+            case ChunkType::Names:
+                SerializeNames(archive, universe);
+                break;
+            case ChunkType::Entities:
+                loader.entities(archive);
+                loaded_entities = true;
+                break;
+            case ChunkType::Component: {
+                if (!loaded_entities) {
+                    throw std::runtime_error("Save has components before its entities");
+                }
+                std::string name;
+                archive(name);
+                const auto& loaders = GetComponentLoaders();
+                auto it = loaders.find(name);
+                if (it == loaders.end()) {
+                    SPDLOG_WARN("Skipping unknown component {} in save", name);
+                    break;
+                }
+                it->second(loader, archive);
+                break;
+            }
+            default:
+                SPDLOG_WARN("Skipping unknown chunk {} in save", static_cast<uint32_t>(chunk.type));
+                break;
+        }
+    }
+}
+}  // namespace
+}  // namespace cqsp::common::save
+
 Hjson::Value cqsp::common::save::Save::GetMetadata() {
     // This generates the basic information of the save
     Hjson::Value value;
@@ -32,9 +536,46 @@ Hjson::Value cqsp::common::save::Save::GetMetadata() {
     return value;
 }
 
-Hjson::Value cqsp::common::save::Save::SaveGame() {
-    // Save all the game information
-    return Hjson::Value();
+std::vector<char> cqsp::common::save::Save::SaveGame() {
+    std::vector<char> buffer;
+    ChunkWriter writer(buffer);
+    {
+        BinaryOutputArchive archive = writer.Begin(ChunkType::Meta);
+        archive(universe.date.GetDate(), universe.uuid, std::string(CQSP_VERSION));
+    }
+    {
+        BinaryOutputArchive archive = writer.Begin(ChunkType::Names);
+        SerializeNames(archive, universe);
+    }
+    {
+        BinaryOutputArchive archive = writer.Begin(ChunkType::Entities);
+        entt::snapshot {universe}.entities(archive);
+    }
+#define CQSP_SAVE_COMPONENT(Type) SaveComponent<Type>(writer, universe, #Type);
+    CQSP_SAVED_COMPONENTS(CQSP_SAVE_COMPONENT)
+#undef CQSP_SAVE_COMPONENT
+    writer.Finish();
+    return buffer;
+}
+
+std::unique_ptr<cqsp::common::Universe> cqsp::common::save::Save::Capture() {
+    auto copy = std::make_unique<Universe>(universe.uuid);
+    copy->date = universe.date;
+    ApplyNames(universe, [&copy](auto&... names) {
+        ApplyNames(*copy, [&](auto&... copy_names) { ((copy_names = names), ...); });
+    });
+    {
+        // Going through the snapshot keeps the versions of the entities and the list of destroyed entities
+        std::vector<char> entities;
+        BinaryOutputArchive output(entities);
+        entt::snapshot {universe}.entities(output);
+        BinaryInputArchive input(entities.data(), entities.size());
+        entt::snapshot_loader {*copy}.entities(input);
+    }
+#define CQSP_COPY_COMPONENT(Type) CopyComponent<Type>(universe, *copy);
+    CQSP_SAVED_COMPONENTS(CQSP_COPY_COMPONENT)
+#undef CQSP_COPY_COMPONENT
+    return copy;
 }
 
 void cqsp::common::save::Load::LoadMetadata(Hjson::Value& data) {
@@ -43,6 +584,30 @@ void cqsp::common::save::Load::LoadMetadata(Hjson::Value& data) {
     universe.uuid = data["uuid"].to_string();
 }
 
+void cqsp::common::save::Load::LoadGame(const char* data, size_t size) {
+    const std::vector<Chunk> chunks = ReadChunks(data, size);
+
+    // Load into an empty universe first, so that a save that is corrupt halfway through leaves the game that
+    // is loaded as it was
+    Universe loaded(universe.uuid);
+    LoadChunks(loaded, chunks);
+
+    // The context holds client state, which isn't saved, so it's kept. The signals of the universe are
+    // replaced along with its storage, so systems that connect to them have to be made after loading.
+    auto context = std::move(universe.ctx());
+    static_cast<entt::registry&>(universe) = std::move(static_cast<entt::registry&>(loaded));
+    universe.ctx() = std::move(context);
+    ApplyNames(loaded, [&universe = universe](auto&... loaded_names) {
+        ApplyNames(universe, [&](auto&... names) { ((names = std::move(loaded_names)), ...); });
+    });
+    universe.date = loaded.date;
+    universe.uuid = std::move(loaded.uuid);
+}
+
 std::string cqsp::common::save::GetMetaPath(std::string_view folder) {
     return (std::filesystem::path(folder) / "meta.hjson").string();
 }
+
+std::string cqsp::common::save::GetUniversePath(std::string_view folder) {
+    return (std::filesystem::path(folder) / "universe.bin").string();
+}
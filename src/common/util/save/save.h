@@ -18,7 +18,11 @@
 
 #include <hjson.h>
 
+#include <cstddef>
+#include <cstdint>
+#include <memory>
 #include <string>
+#include <vector>
 
 #include "common/universe.h"
 
@@ -30,7 +34,19 @@ class Save {
     Universe& universe;
 
     Hjson::Value GetMetadata();
-    Hjson::Value SaveGame();
+
+    /// <summary>
+    /// Writes the entire universe, every entity and component, the name maps and the date, into the binary
+    /// save format. The result is laid out so that it can be written with a single write.
+    /// </summary>
+    std::vector<char> SaveGame();
+
+    /// <summary>
+    /// Copies everything that SaveGame writes into a new universe: the entities with their identifiers, the
+    /// saved components, the name maps and the date. The copy can then be saved on another thread while the
+    /// game keeps running. Only the copy of the storages happens on the calling thread.
+    /// </summary>
+    std::unique_ptr<Universe> Capture();
 };
 
 class Load {
@@ -39,8 +55,24 @@ class Load {
 
     void LoadMetadata(Hjson::Value& data);
 
+    /// <summary>
+    /// Replaces everything in the universe with the contents of a binary save. The data can be a file read
+    /// in one go, or a mapped file. Throws std::runtime_error if the save is from an incompatible format or
+    /// is corrupt, and leaves the universe as it was.
+    /// </summary>
+    /// The registry is replaced, so this has to be done before any system connects to its signals. The
+    /// context of the registry is kept.
+    void LoadGame(const char* data, size_t size);
+
     Universe& universe;
 };
 
+/// <summary>
+/// Identifies a binary save, and the version of its layout. Saves with a different format version are rejected.
+/// </summary>
+constexpr char save_magic[8] = {'C', 'Q', 'S', 'P', 'S', 'A', 'V', 'E'};
+constexpr uint32_t save_format_version = 2;
+
 std::string GetMetaPath(std::string_view folder);
+std::string GetUniversePath(std::string_view folder);
 }  // namespace cqsp::common::save
@@ -0,0 +1,161 @@
+/* Conquer Space
+ * Copyright (C) 2021-2023 Conquer Space
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#include "common/util/threadpool.h"
+
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <memory>
+#include <utility>
+
+#include "common/util/allocationcounter.h"
+#include "common/util/framearena.h"
+
+namespace cqsp::common::util {
+ThreadPool::ThreadPool(unsigned int threads) {
+    for (unsigned int i = 0; i < threads; i++) {
+        workers.emplace_back([this]() { Work(); });
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::scoped_lock lock(mutex);
+        stopping = true;
+    }
+    condition.notify_all();
+    for (auto& worker : workers) {
+        worker.join();
+    }
+}
+
+void ThreadPool::Submit(std::function<void()> task) {
+    {
+        std::scoped_lock lock(mutex);
+        tasks.push_back(std::move(task));
+    }
+    condition.notify_one();
+}
+
+void ThreadPool::ParallelFor(size_t count, const std::function<void(size_t)>& func) {
+    if (count == 0) {
+        return;
+    }
+    const size_t chunks = std::min(count, workers.size() + 1);
+    if (chunks <= 1) {
+        for (size_t i = 0; i < count; i++) {
+            func(i);
+        }
+        return;
+    }
+
+    // Shared with the tasks, because a task can still be queued after this returns if the other threads took
+    // all of the chunks before it ran
+    struct Loop {
+        const std::function<void(size_t)>* func;
+        size_t count;
+        size_t chunks;
+        std::atomic<size_t> next = 0;
+        size_t finished = 0;
+        std::exception_ptr exception;
+        std::mutex mutex;
+        std::condition_variable done;
+        // Allocations of every chunk are counted for whatever started the loop
+        std::atomic<uint64_t>* allocation_counter;
+    };
+    auto loop = std::make_shared<Loop>();
+    loop->func = &func;
+    loop->allocation_counter = AllocationScope::Current();
+    loop->count = count;
+    loop->chunks = chunks;
+    // Takes chunks of this loop until there are none left. Only chunks of this loop are run, so a system
+    // that waits here never runs another system in the middle of its own timing and allocation counts.
+    auto run_chunks = [](Loop& loop) {
+        AllocationScope allocation_scope(loop.allocation_counter);
+        size_t chunk;
+        while ((chunk = loop.next++) < loop.chunks) {
+            const size_t begin = loop.count * chunk / loop.chunks;
+            const size_t end = loop.count * (chunk + 1) / loop.chunks;
+            try {
+                for (size_t i = begin; i < end; i++) {
+                    (*loop.func)(i);
+                }
+            } catch (...) {
+                std::scoped_lock lock(loop.mutex);
+                loop.exception = std::current_exception();
+            }
+            std::scoped_lock lock(loop.mutex);
+            if (++loop.finished == loop.chunks) {
+                loop.done.notify_one();
+            }
+        }
+    };
+
+    for (size_t chunk = 1; chunk < chunks; chunk++) {
+        Submit([loop, run_chunks]() { run_chunks(*loop); });
+    }
+    // The calling thread works too, and takes the chunks that no worker got to. It only has to wait for the
+    // chunks that are already running, so it can't be starved even if this is running on a worker.
+    run_chunks(*loop);
+
+    std::unique_lock lock(loop->mutex);
+    loop->done.wait(lock, [&]() { return loop->finished == loop->chunks; });
+    if (loop->exception) {
+        std::rethrow_exception(loop->exception);
+    }
+}
+
+bool ThreadPool::RunPendingTask() {
+    std::function<void()> task;
+    {
+        std::scoped_lock lock(mutex);
+        if (tasks.empty()) {
+            return false;
+        }
+        task = std::move(tasks.front());
+        tasks.pop_front();
+    }
+    RunTask(task);
+    return true;
+}
+
+void ThreadPool::RunTask(const std::function<void()>& task) {
+    FrameArena* arena = frame_arena;
+    if (arena == nullptr) {
+        task();
+        return;
+    }
+    FrameScope scope(arena->GetThreadResource());
+    task();
+}
+
+void ThreadPool::Work() {
+    while (true) {
+        std::function<void()> task;
+        {
+            std::unique_lock lock(mutex);
+            condition.wait(lock, [this]() { return stopping || !tasks.empty(); });
+            if (stopping && tasks.empty()) {
+                return;
+            }
+            task = std::move(tasks.front());
+            tasks.pop_front();
+        }
+        RunTask(task);
+    }
+}
+}  // namespace cqsp::common::util
@@ -0,0 +1,78 @@
+/* Conquer Space
+ * Copyright (C) 2021-2023 Conquer Space
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace cqsp::common::util {
+class FrameArena;
+
+/// <summary>
+/// A fixed set of worker threads that run submitted tasks in the order that they are submitted.
+/// </summary>
+class ThreadPool {
+ public:
+    /// <param name="threads">Number of workers, defaults to one per hardware thread</param>
+    explicit ThreadPool(unsigned int threads = std::thread::hardware_concurrency());
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    void Submit(std::function<void()> task);
+
+    /// <summary>
+    /// Runs `func(i)` for every i in [0, count) on the workers and the calling thread, and returns when all
+    /// of them are done. The work is split into contiguous chunks, so each index is only run by one thread.
+    /// While it waits, the calling thread only runs chunks of this loop and never other queued tasks.
+    /// </summary>
+    void ParallelFor(size_t count, const std::function<void(size_t)>& func);
+
+    /// <summary>
+    /// Runs one queued task on the calling thread. Threads that wait on other tasks should call this, so
+    /// that waiting inside a task can't starve the pool.
+    /// </summary>
+    /// <returns>false if there were no tasks queued</returns>
+    bool RunPendingTask();
+
+    size_t Size() const { return workers.size(); }
+
+    /// <summary>
+    /// While this is set, every task runs with the arena of its thread in frame_arena as its FrameScope, so
+    /// the temporaries of loops that are split over the workers go into the arena like the ones of the system
+    /// that started them. Set it back to nullptr before the arena is reset.
+    /// </summary>
+    void SetFrameArena(FrameArena* frame_arena) { this->frame_arena = frame_arena; }
+
+ private:
+    void Work();
+    void RunTask(const std::function<void()>& task);
+
+    std::vector<std::thread> workers;
+    std::deque<std::function<void()>> tasks;
+    std::mutex mutex;
+    std::condition_variable condition;
+    bool stopping = false;
+    std::atomic<FrameArena*> frame_arena = nullptr;
+};
+}  // namespace cqsp::common::util
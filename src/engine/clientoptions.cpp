@@ -47,6 +47,9 @@ Hjson::Value cqsp::client::ClientOptions::GetDefaultOptions() {
     default_options["audio"]["ui"] = 0.80f;
     default_options["splashscreens"] = "../data/core/gui/splashscreens";
     default_options["samples"] = 4;
+    // Autosave interval in in-game days, 0 turns autosaving off
+    default_options["autosave"]["interval"] = 30;
+    default_options["autosave"]["slots"] = 3;
     return default_options;
 }
 
@@ -0,0 +1,126 @@
+/* Conquer Space
+ * Copyright (C) 2021-2023 Conquer Space
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#include "engine/windowreplay.h"
+
+#include <imgui_internal.h>
+
+#include <algorithm>
+
+namespace cqsp::engine {
+namespace {
+bool IsDrawn(const ImGuiWindow* window) { return window->Active && !window->Hidden; }
+
+// These are templates because WindowReplay::DrawList is private
+
+template <typename DrawList>
+void CopyDrawLists(const ImGuiWindow* window, std::vector<DrawList>& draw_lists) {
+    const ImDrawList* draw_list = window->DrawList;
+    draw_lists.push_back({draw_list->CmdBuffer, draw_list->IdxBuffer, draw_list->VtxBuffer});
+    for (const ImGuiWindow* child : window->DC.ChildWindows) {
+        if (IsDrawn(child)) {
+            CopyDrawLists(child, draw_lists);
+        }
+    }
+}
+
+/// <summary>
+/// Adds the commands of a recorded draw list to the end of `draw_list`, moved by `offset`
+/// </summary>
+template <typename DrawList>
+void AppendDrawList(ImDrawList* draw_list, const DrawList& from, const ImVec2& offset) {
+    for (const ImDrawCmd& command : from.commands) {
+        if (command.UserCallback != nullptr || command.ElemCount == 0) {
+            continue;
+        }
+        // Only copy the vertices that the command uses
+        const ImDrawIdx* indices = from.indices.Data + command.IdxOffset;
+        unsigned int first = indices[0];
+        unsigned int last = indices[0];
+        for (unsigned int i = 1; i < command.ElemCount; i++) {
+            first = std::min<unsigned int>(first, indices[i]);
+            last = std::max<unsigned int>(last, indices[i]);
+        }
+        const int vertex_count = static_cast<int>(last - first + 1);
+        const ImDrawVert* vertices = from.vertices.Data + command.VtxOffset + first;
+
+        draw_list->PushClipRect(ImVec2(command.ClipRect.x + offset.x, command.ClipRect.y + offset.y),
+                                ImVec2(command.ClipRect.z + offset.x, command.ClipRect.w + offset.y));
+        draw_list->PushTextureID(command.TextureId);
+        draw_list->PrimReserve(static_cast<int>(command.ElemCount), vertex_count);
+        // PrimReserve can start a new vertex offset, so the base is only known after it
+        const unsigned int base = draw_list->_VtxCurrentIdx;
+        for (int i = 0; i < vertex_count; i++) {
+            ImDrawVert vertex = vertices[i];
+            vertex.pos.x += offset.x;
+            vertex.pos.y += offset.y;
+            draw_list->_VtxWritePtr[i] = vertex;
+        }
+        for (unsigned int i = 0; i < command.ElemCount; i++) {
+            draw_list->_IdxWritePtr[i] = static_cast<ImDrawIdx>(base + indices[i] - first);
+        }
+        draw_list->_VtxWritePtr += vertex_count;
+        draw_list->_IdxWritePtr += command.ElemCount;
+        draw_list->_VtxCurrentIdx += vertex_count;
+        draw_list->PopTextureID();
+        draw_list->PopClipRect();
+    }
+}
+}  // namespace
+
+void WindowReplay::BeginRecord() {
+    drawn_before.clear();
+    for (const ImGuiWindow* window : ImGui::GetCurrentContext()->Windows) {
+        if (window->Active) {
+            drawn_before.insert(window->ID);
+        }
+    }
+}
+
+void WindowReplay::EndRecord() {
+    windows.clear();
+    for (const ImGuiWindow* window : ImGui::GetCurrentContext()->Windows) {
+        // Child windows are recorded with their parent, and popups and tooltips only last while they are hovered
+        const ImGuiWindowFlags skipped =
+            ImGuiWindowFlags_ChildWindow | ImGuiWindowFlags_Popup | ImGuiWindowFlags_Tooltip;
+        if (!IsDrawn(window) || (window->Flags & skipped) != 0 || drawn_before.contains(window->ID)) {
+            continue;
+        }
+        Window& recorded = windows.emplace_back();
+        recorded.name = window->Name;
+        recorded.flags = window->Flags;
+        recorded.position = window->Pos;
+        recorded.content_size = window->ContentSize;
+        CopyDrawLists(window, recorded.draw_lists);
+    }
+}
+
+void WindowReplay::Replay() {
+    for (const Window& window : windows) {
+        ImGui::Begin(window.name.c_str(), nullptr, window.flags);
+        // The window can still be moved while it is replayed
+        const ImVec2 position = ImGui::GetWindowPos();
+        const ImVec2 offset(position.x - window.position.x, position.y - window.position.y);
+        ImDrawList* draw_list = ImGui::GetWindowDrawList();
+        for (const DrawList& recorded : window.draw_lists) {
+            AppendDrawList(draw_list, recorded, offset);
+        }
+        // Keep the size of the contents, so that windows that fit their contents stay the same size
+        ImGui::Dummy(window.content_size);
+        ImGui::End();
+    }
+}
+}  // namespace cqsp::engine
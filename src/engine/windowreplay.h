@@ -0,0 +1,60 @@
+/* Conquer Space
+ * Copyright (C) 2021-2023 Conquer Space
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#pragma once
+
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+#include "engine/gui.h"
+
+namespace cqsp::engine {
+/// <summary>
+/// Keeps what a group of ImGui windows showed, so that they can be shown again on a frame where they can't be
+/// drawn, instead of disappearing for that frame.
+/// </summary>
+/// Call BeginRecord before the windows are drawn and EndRecord after. On a frame where the windows can't be
+/// drawn, Replay submits the recorded windows again with what they showed when they were recorded. They keep
+/// their place, size and state, so nothing flickers or resets, but their widgets don't respond until they are
+/// drawn again.
+class WindowReplay {
+ public:
+    void BeginRecord();
+    void EndRecord();
+    void Replay();
+
+ private:
+    struct DrawList {
+        ImVector<ImDrawCmd> commands;
+        ImVector<ImDrawIdx> indices;
+        ImVector<ImDrawVert> vertices;
+    };
+
+    struct Window {
+        std::string name;
+        ImGuiWindowFlags flags = 0;
+        ImVec2 position;
+        ImVec2 content_size;
+        /// The draw list of the window, then the ones of its child windows, in the order that they are drawn
+        std::vector<DrawList> draw_lists;
+    };
+
+    // Windows that were already drawn this frame when the recording started, which aren't recorded
+    std::unordered_set<ImGuiID> drawn_before;
+    std::vector<Window> windows;
+};
+}  // namespace cqsp::engine
@@ -20,8 +20,10 @@
 
 #include <algorithm>
 #include <iostream>
+#include <vector>
 
 #include "common/systems/economy/auctionhandler.h"
+#include "common/util/threadpool.h"
 
 using cqsp::common::components::AscendingSortedOrderList;
 using cqsp::common::components::AuctionHouse;
@@ -248,3 +250,98 @@ TEST(AuctionTest, OverpricedSellOrderTest) {
     EXPECT_EQ(100, auction_house.GetDemand(test_good));
     EXPECT_EQ(100, auction_house.GetSupply(test_good));
 }
+
+// The cheapest sell orders are bought first, and orders at the same price in the order they were placed
+TEST(AuctionTest, PriceLevelPriorityTest) {
+    AuctionHouse auction_house;
+    const entt::entity first_agent = static_cast<entt::entity>(3);
+    const entt::entity second_agent = static_cast<entt::entity>(4);
+    auction_house.AddSellOrder(test_good, Order(12, 10, test_agent));
+    auction_house.AddSellOrder(test_good, Order(10, 10, first_agent));
+    auction_house.AddSellOrder(test_good, Order(10, 10, second_agent));
+    EXPECT_EQ(auction_house.sell_orders[test_good].GetLevels().size(), 2);
+    EXPECT_EQ(30, auction_house.GetSupply(test_good));
+
+    EXPECT_TRUE(cqsp::common::systems::BuyGood(auction_house, test_agent, test_good, 11, 15));
+    auto& sell_orders = auction_house.sell_orders[test_good];
+    EXPECT_EQ(sell_orders.size(), 2);
+    EXPECT_EQ(sell_orders.BestPrice(), 10);
+    EXPECT_EQ(sell_orders.front().agent, second_agent);
+    EXPECT_EQ(sell_orders.front().quantity, 5);
+    EXPECT_EQ(15, auction_house.GetSupply(test_good));
+
+    // Only the order at 10 is cheap enough, the rest becomes a buy order
+    EXPECT_FALSE(cqsp::common::systems::BuyGood(auction_house, test_agent, test_good, 11, 10));
+    EXPECT_EQ(sell_orders.size(), 1);
+    EXPECT_EQ(sell_orders.BestPrice(), 12);
+    EXPECT_EQ(10, auction_house.GetSupply(test_good));
+    EXPECT_EQ(5, auction_house.GetDemand(test_good));
+    EXPECT_EQ(auction_house.buy_orders[test_good].BestPrice(), 11);
+}
+
+TEST(AuctionTest, CallAuctionTest) {
+    AuctionHouse auction_house;
+    auction_house.AddBuyOrder(test_good, Order(12, 10, test_agent));
+    auction_house.AddBuyOrder(test_good, Order(11, 10, test_agent));
+    auction_house.AddBuyOrder(test_good, Order(9, 10, test_agent));
+    auction_house.AddSellOrder(test_good, Order(8, 5, test_agent));
+    auction_house.AddSellOrder(test_good, Order(10, 10, test_agent));
+    auction_house.AddSellOrder(test_good, Order(11, 10, test_agent));
+
+    // 11 trades the most, with 20 bid at or above it and 25 offered at or below it
+    std::vector<cqsp::common::systems::AuctionFill> fills;
+    auto result = cqsp::common::systems::ClearAuction(auction_house.sell_orders[test_good],
+                                                      auction_house.buy_orders[test_good], test_good, fills);
+    EXPECT_EQ(result.price, 11);
+    EXPECT_EQ(result.volume, 20);
+    double bought = 0;
+    double sold = 0;
+    for (const auto& fill : fills) {
+        EXPECT_EQ(fill.price, 11);
+        EXPECT_EQ(fill.good, test_good);
+        (fill.buy ? bought : sold) += fill.quantity;
+    }
+    EXPECT_EQ(bought, 20);
+    EXPECT_EQ(sold, 20);
+
+    // Half of the sell order at 11 and the bid at 9 are left over
+    EXPECT_EQ(5, auction_house.GetSupply(test_good));
+    EXPECT_EQ(10, auction_house.GetDemand(test_good));
+    EXPECT_EQ(auction_house.sell_orders[test_good].BestPrice(), 11);
+    EXPECT_EQ(auction_house.buy_orders[test_good].BestPrice(), 9);
+
+    // Nothing crosses anymore
+    fills.clear();
+    result = cqsp::common::systems::ClearAuction(auction_house.sell_orders[test_good],
+                                                 auction_house.buy_orders[test_good], test_good, fills);
+    EXPECT_EQ(result.volume, 0);
+    EXPECT_TRUE(fills.empty());
+}
+
+// Clearing on the thread pool has to give the same trades as clearing on one thread
+TEST(AuctionTest, ParallelCallAuctionTest) {
+    AuctionHouse single;
+    for (int good = 0; good < 50; good++) {
+        const entt::entity good_entity = static_cast<entt::entity>(good + 10);
+        for (int i = 0; i < 20; i++) {
+            single.AddBuyOrder(good_entity, Order(10 + (i * 7 + good) % 13, 1 + i % 5, test_agent));
+            single.AddSellOrder(good_entity, Order(8 + (i * 5 + good) % 11, 1 + i % 3, test_agent));
+        }
+    }
+    AuctionHouse parallel = single;
+
+    cqsp::common::util::ThreadPool pool(4);
+    auto expected = cqsp::common::systems::ClearAuctions(single);
+    auto fills = cqsp::common::systems::ClearAuctions(parallel, &pool);
+    ASSERT_EQ(expected.size(), fills.size());
+    ASSERT_FALSE(fills.empty());
+    for (size_t i = 0; i < fills.size(); i++) {
+        EXPECT_EQ(expected[i].good, fills[i].good);
+        EXPECT_EQ(expected[i].quantity, fills[i].quantity);
+        EXPECT_EQ(expected[i].price, fills[i].price);
+        EXPECT_EQ(expected[i].buy, fills[i].buy);
+    }
+    for (const auto& [good, book] : parallel.sell_orders) {
+        EXPECT_EQ(book.GetQuantity(), single.GetSupply(good));
+    }
+}
@@ -36,6 +36,9 @@ TEST(FactoryConstuctTest, ConstructTest) {
     // Ensure that it has everything
     ASSERT_TRUE(universe.any_of<cqsp::common::components::Employer>(factory));
     ASSERT_EQ(universe.get<cqsp::common::components::Employer>(factory).population_needed, 10 * 10);
+    // Made with everything that production needs
+    EXPECT_TRUE(universe.IndustryGroup().contains(factory));
+    EXPECT_EQ(universe.get<cqsp::common::components::IndustrySize>(factory).size, 10);
 }
 
 TEST(FactoryConstuctTest, ConstructExpectNoCrash) {
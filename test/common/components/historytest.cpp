@@ -0,0 +1,103 @@
+/* Conquer Space
+ * Copyright (C) 2021-2023 Conquer Space
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#include <gtest/gtest.h>
+
+#include "common/components/economy.h"
+#include "common/components/history.h"
+
+using cqsp::common::components::HistoryResolution;
+using cqsp::common::components::Market;
+using cqsp::common::components::MarketHistory;
+using cqsp::common::components::MarketMetric;
+
+TEST(Common_MarketHistory, RingBufferTest) {
+    entt::registry reg;
+    entt::entity good = reg.create();
+    Market market;
+    MarketHistory history(5, 3, 3);
+
+    EXPECT_EQ(history.Latest(MarketMetric::Price, good), 0);
+    for (int day = 0; day < 8; day++) {
+        market.price[good] = day;
+        market.previous_supply[good] = 1;
+        history.Record(day, market, day * 2);
+    }
+    const auto& daily = history.GetTier(HistoryResolution::Daily);
+    // Only the last 5 days are kept
+    ASSERT_EQ(daily.Size(), 5);
+    EXPECT_EQ(daily.GetDate(0), 3);
+    EXPECT_EQ(daily.GetDate(4), 7);
+    EXPECT_EQ(history.Latest(MarketMetric::Price, good), 7);
+    EXPECT_EQ(history.LatestGDP(), 14);
+}
+
+TEST(Common_MarketHistory, DownsamplingTest) {
+    entt::registry reg;
+    entt::entity good = reg.create();
+    Market market;
+    MarketHistory history;
+
+    // 8 weeks
+    for (int day = 0; day < 56; day++) {
+        market.sd_ratio[good] = day;
+        history.Record(day, market, 0);
+    }
+    const auto& weekly = history.GetTier(HistoryResolution::Weekly);
+    const cqsp::common::components::HistoryTier& monthly = history.GetTier(HistoryResolution::Monthly);
+    ASSERT_EQ(weekly.Size(), 8);
+    const uint32_t index = history.FindColumn(good);
+    ASSERT_NE(index, MarketHistory::null_column);
+    // Average of days 0 to 6
+    EXPECT_EQ(weekly.Get(MarketMetric::SDRatio, index, 0), 3);
+    EXPECT_EQ(weekly.Get(MarketMetric::SDRatio, index, 7), 52);
+    ASSERT_EQ(monthly.Size(), 2);
+    // Average of days 0 to 27
+    EXPECT_EQ(monthly.Get(MarketMetric::SDRatio, index, 0), 13.5);
+    EXPECT_EQ(monthly.Get(MarketMetric::SDRatio, index, 1), 41.5);
+}
+
+// Only the goods that the market deals in get columns, and a good that starts trading later keeps the
+// samples of the goods that were already recorded
+TEST(Common_MarketHistory, TradedGoodsTest) {
+    entt::registry reg;
+    entt::entity traded = reg.create();
+    entt::entity priced = reg.create();
+    entt::entity later = reg.create();
+    Market market;
+    market.price[priced] = 5;
+    market.price[traded] = 2;
+    market.previous_demand[traded] = 3;
+    MarketHistory history(5, 3, 3);
+
+    history.Record(0, market, 0);
+    EXPECT_EQ(history.ColumnCount(), 1);
+    EXPECT_EQ(history.FindColumn(priced), MarketHistory::null_column);
+    EXPECT_EQ(history.Latest(MarketMetric::Price, priced), 0);
+    EXPECT_EQ(history.Latest(MarketMetric::Demand, traded), 3);
+
+    market.volume[later] = 4;
+    market.price[later] = 8;
+    history.Record(1, market, 0);
+    ASSERT_EQ(history.ColumnCount(), 2);
+    const auto& daily = history.GetTier(HistoryResolution::Daily);
+    EXPECT_EQ(daily.Get(MarketMetric::Price, history.FindColumn(traded), 0), 2);
+    EXPECT_EQ(daily.Get(MarketMetric::Demand, history.FindColumn(traded), 1), 3);
+    // Nothing was recorded for the good before it traded
+    EXPECT_EQ(daily.Get(MarketMetric::Volume, history.FindColumn(later), 0), 0);
+    EXPECT_EQ(history.Latest(MarketMetric::Price, later), 8);
+    EXPECT_EQ(history.Latest(MarketMetric::Volume, later), 4);
+}
@@ -18,7 +18,9 @@
 #include <gtest/gtest.h>
 #include <hjson.h>
 
+#include <cmath>
 #include <fstream>
+#include <vector>
 
 #include "common/components/coordinates.h"
 #include "common/components/orbit.h"
@@ -175,6 +177,81 @@ TEST(OrbitTest, SolveKeplerElliptic) {
     }
 }
 
+TEST(OrbitTest, SolveKeplerEllipticBatch) {
+    std::vector<double> mean_anomaly;
+    std::vector<double> ecc;
+    for (double e : {0.0, 0.1, 0.5, 0.9, 0.99}) {
+        for (int step = 0; step < 64; step++) {
+            mean_anomaly.push_back(step * cqspt::TWOPI / 64);
+            ecc.push_back(e);
+        }
+    }
+    std::vector<double> result(mean_anomaly.size());
+    cqspt::SolveKeplerEllipticBatch(mean_anomaly.data(), ecc.data(), result.data(), result.size());
+    for (size_t i = 0; i < result.size(); i++) {
+        EXPECT_NEAR(result[i] - ecc[i] * sin(result[i]), mean_anomaly[i], 1e-12);
+        EXPECT_NEAR(result[i], cqspt::SolveKeplerElliptic(mean_anomaly[i], ecc[i]), 1e-9);
+    }
+}
+
+// The predicted time has to be when the orbit crosses the radius, and it can't have crossed it before
+TEST(OrbitTest, TimeToRadiusTest) {
+    auto radius_at = [](const cqspt::Orbit& orbit, double time) {
+        return glm::length(cqspt::toVec3(orbit, cqspt::GetTrueAnomaly(orbit, time)));
+    };
+    cqspt::Orbit elliptic(10000, 0.5, 0.1, 0.2, 0.3, 0.4);
+    elliptic.GM = 398600;
+    cqspt::Orbit hyperbolic(-20000, 1.5, 0.2, 0.1, 0.1, -1);
+    hyperbolic.GM = 398600;
+    for (const cqspt::Orbit& orbit : {elliptic, hyperbolic}) {
+        for (double time : {0., 5000., 12345.}) {
+            const double leave = cqspt::TimeToLeaveRadius(orbit, 12000, time);
+            ASSERT_TRUE(std::isfinite(leave));
+            if (leave == 0) {
+                EXPECT_GT(radius_at(orbit, time), 12000);
+            } else {
+                EXPECT_NEAR(radius_at(orbit, time + leave), 12000, 1e-3);
+                EXPECT_LT(radius_at(orbit, time + leave * 0.99), 12000);
+            }
+
+            const double enter = cqspt::TimeToEnterRadius(orbit, 6000, time);
+            if (orbit.eccentricity < 1 && enter > 0) {
+                ASSERT_TRUE(std::isfinite(enter));
+                EXPECT_NEAR(radius_at(orbit, time + enter), 6000, 1e-3);
+                EXPECT_GT(radius_at(orbit, time + enter * 0.99), 6000);
+            }
+        }
+    }
+    // Already past the periapsis, so it never gets closer
+    EXPECT_TRUE(std::isinf(cqspt::TimeToEnterRadius(hyperbolic, 15000, 1e5)));
+    EXPECT_EQ(cqspt::TimeToEnterRadius(elliptic, 20000, 0), 0);
+    EXPECT_TRUE(std::isinf(cqspt::TimeToLeaveRadius(elliptic, 20000, 0)));
+    EXPECT_TRUE(std::isinf(cqspt::TimeToEnterRadius(elliptic, 4000, 0)));
+}
+
+TEST(OrbitTest, OrbitCacheTest) {
+    cqspt::Orbit elliptic(10000, 0.5, 0.1, 0.2, 0.3, 0.4);
+    elliptic.GM = 398600;
+    cqspt::Orbit hyperbolic(-20000, 1.5, 0.2, 0.1, 0.1, -1);
+    hyperbolic.GM = 398600;
+    for (const cqspt::Orbit& orbit : {elliptic, hyperbolic}) {
+        const cqspt::OrbitCache cache(orbit);
+        EXPECT_DOUBLE_EQ(cache.mean_motion, orbit.nu());
+        for (double v : {-1.0, 0.0, 0.5, 1.2}) {
+            const glm::dvec3 position = cqspt::toVec3(orbit, v);
+            const glm::dvec3 velocity = cqspt::OrbitVelocityToVec3(orbit, v);
+            EXPECT_NEAR(glm::distance(cache.Position(v), position), 0, glm::length(position) * 1e-12);
+            EXPECT_NEAR(glm::distance(cache.Velocity(v), velocity), 0, glm::length(velocity) * 1e-12);
+        }
+        const glm::dvec3 later = cqspt::OrbitTimeToVec3(orbit, 5000);
+        EXPECT_NEAR(glm::distance(cqspt::OrbitTimeToVec3(orbit, cache, 5000), later), 0, glm::length(later) * 1e-12);
+    }
+    // Crashed objects stay at the center of their parent
+    cqspt::Orbit crashed = elliptic;
+    crashed.semi_major_axis = 0;
+    EXPECT_EQ(cqspt::OrbitCache(crashed).Position(0.5), glm::dvec3(0));
+}
+
 TEST(Common_TransferTest, TransferTimeTest_Mars) {
     namespace cqspt = cqsp::common::components::types;
     using namespace cqspt;  // NOLINT
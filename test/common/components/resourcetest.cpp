@@ -16,6 +16,10 @@
  */
 #include <gtest/gtest.h>
 
+#include <limits>
+#include <thread>
+#include <vector>
+
 #include "common/components/resource.h"
 
 using cqsp::common::components::ResourceLedger;
@@ -167,3 +171,123 @@ TEST(Common_ResourceLedger, LedgerSubtractionTest1) {
     EXPECT_EQ(first.size(), 1);
     EXPECT_EQ(second.size(), 1);
 }
+
+TEST(Common_ResourceLedger, LedgerMultiplicationTest) {
+    ResourceLedger first;
+    ResourceLedger second;
+
+    entt::registry reg;
+    entt::entity good_one = reg.create();
+    entt::entity good_two = reg.create();
+    entt::entity good_three = reg.create();
+
+    first[good_one] = 10;
+    first[good_two] = 4;
+    second[good_two] = 3;
+    second[good_three] = 2;
+    first *= second;
+    // Goods that aren't in the other ledger stay the same
+    EXPECT_EQ(first[good_one], 10);
+    EXPECT_EQ(first[good_two], 12);
+    // Goods that aren't in this ledger are added as 0
+    EXPECT_EQ(first[good_three], 0);
+    EXPECT_TRUE(first.HasGood(good_three));
+    EXPECT_EQ(first.size(), 3);
+}
+
+TEST(Common_ResourceLedger, LedgerSafeDivisionTest) {
+    ResourceLedger supply;
+    ResourceLedger demand;
+
+    entt::registry reg;
+    entt::entity good_one = reg.create();
+    entt::entity good_two = reg.create();
+    entt::entity good_three = reg.create();
+
+    supply[good_one] = 10;
+    supply[good_two] = 10;
+    demand[good_one] = 5;
+    demand[good_two] = 0;
+    demand[good_three] = 5;
+    ResourceLedger ratio = supply.SafeDivision(demand);
+    EXPECT_EQ(ratio[good_one], 2);
+    EXPECT_EQ(ratio[good_two], std::numeric_limits<double>::infinity());
+    EXPECT_EQ(ratio[good_three], 0);
+    EXPECT_EQ(ratio.size(), 3);
+}
+
+TEST(Common_ResourceLedger, LedgerIterationTest) {
+    ResourceLedger ledger;
+
+    entt::registry reg;
+    entt::entity good_one = reg.create();
+    entt::entity good_two = reg.create();
+    entt::entity good_three = reg.create();
+
+    ledger[good_one] = 1;
+    ledger[good_three] = 3;
+    int count = 0;
+    for (auto& element : ledger) {
+        EXPECT_NE(element.first, good_two);
+        element.second *= 2;
+        count++;
+    }
+    EXPECT_EQ(count, 2);
+    EXPECT_EQ(ledger[good_one], 2);
+    EXPECT_EQ(ledger[good_three], 6);
+    EXPECT_EQ(ledger.GetSum(), 8);
+
+    ledger.clear();
+    EXPECT_TRUE(ledger.empty());
+    EXPECT_EQ(ledger.begin(), ledger.end());
+    EXPECT_EQ(ledger.GetSum(), 0);
+}
+
+TEST(Common_ResourceLedger, GoodIndexVersionTest) {
+    using cqsp::common::components::GoodIndex;
+    using traits = entt::entt_traits<entt::entity>;
+    // Far from the entities that the other tests make
+    const entt::entity old_good = traits::construct(50000, 0);
+    const entt::entity recycled = traits::construct(50000, 1);
+    const uint32_t old_index = GoodIndex::Register(old_good);
+    EXPECT_EQ(GoodIndex::Find(old_good), old_index);
+    EXPECT_EQ(GoodIndex::Find(recycled), GoodIndex::null);
+
+    const uint32_t new_index = GoodIndex::Register(recycled);
+    EXPECT_NE(new_index, old_index);
+    EXPECT_EQ(GoodIndex::Entity(new_index), recycled);
+    EXPECT_EQ(GoodIndex::Find(recycled), new_index);
+    EXPECT_EQ(GoodIndex::Find(old_good), GoodIndex::null);
+}
+
+TEST(Common_ResourceLedger, GoodIndexThreadTest) {
+    using cqsp::common::components::GoodIndex;
+    const uint32_t first = 60000;
+    const uint32_t goods = 5000;
+    const int thread_count = 4;
+    std::vector<std::vector<uint32_t>> indices(thread_count, std::vector<uint32_t>(goods));
+    std::vector<std::thread> threads;
+    for (int t = 0; t < thread_count; t++) {
+        threads.emplace_back([&, t]() {
+            // Every thread registers the same goods in a different order, and looks them up through ledgers
+            for (uint32_t i = 0; i < goods; i++) {
+                const uint32_t good = t % 2 == 0 ? i : goods - i - 1;
+                const entt::entity entity = entt::entt_traits<entt::entity>::construct(first + good, 0);
+                ResourceLedger ledger;
+                ledger[entity] = 1;
+                indices[t][good] = GoodIndex::Find(entity);
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    for (uint32_t good = 0; good < goods; good++) {
+        const entt::entity entity = entt::entt_traits<entt::entity>::construct(first + good, 0);
+        ASSERT_NE(indices[0][good], GoodIndex::null);
+        EXPECT_EQ(GoodIndex::Entity(indices[0][good]), entity);
+        for (int t = 1; t < thread_count; t++) {
+            EXPECT_EQ(indices[t][good], indices[0][good]);
+        }
+    }
+}
@@ -18,6 +18,7 @@
 
 #include <iostream>
 
+#include "common/components/auction.h"
 #include "common/components/economy.h"
 #include "common/systems/economy/markethelpers.h"
 #include "common/systems/economy/sysmarket.h"
@@ -164,3 +165,86 @@ TEST_F(MarketTwoTest, BuySellOverSupplyTest) {
     // Check the price, lower price due to higher supply over demand
     EXPECT_LE(market_comp[good_1].price, good_1_default_price);
 }
+
+// Only the goods that were traded are priced, and the others catch up on the steps they missed when they're used
+TEST_F(MarketTwoTest, SparsePriceUpdateTest) {
+    universe.emplace<cqspc::Price>(good_1, static_cast<double>(good_1_default_price));
+    universe.emplace<cqspc::Price>(good_2, static_cast<double>(good_2_default_price));
+    auto& market_comp = universe.get<cqspc::Market>(market);
+    market_comp.price[good_1] = good_1_default_price;
+    market_comp.price[good_2] = good_2_default_price;
+    market_comp.supply[good_1] = 100;
+    market_comp.demand[good_1] = 50;
+    // The step that the market takes for a good without supply
+    auto step = [](double price) { return price + (0.02 + price * 0.01f); };
+
+    cqsp::common::systems::SysMarket market_system(game);
+    market_system.DoSystem();
+    EXPECT_LT(market_comp.price[good_1], good_1_default_price);
+    // Not touched, but it still took the step when it's read
+    EXPECT_EQ(market_comp.price[good_2], good_2_default_price);
+    EXPECT_DOUBLE_EQ(market_comp.SettledPrice(good_2), step(good_2_default_price));
+    EXPECT_DOUBLE_EQ(market_comp.sd_ratio[good_1], 2);
+    EXPECT_FALSE(market_comp.sd_ratio.HasGood(good_2));
+    EXPECT_EQ(market_comp.previous_supply[good_1], 100);
+    EXPECT_TRUE(market_comp.supply.empty());
+    EXPECT_TRUE(market_comp.demand.empty());
+
+    // Nothing was traded, so the goods only take the steps
+    double price_1 = market_comp.price[good_1];
+    double price_2 = step(good_2_default_price);
+    const int runs = 50;
+    for (int i = 0; i < runs; i++) {
+        market_system.DoSystem();
+        price_1 = step(price_1);
+        price_2 = step(price_2);
+    }
+    EXPECT_TRUE(market_comp.sd_ratio.empty());
+    EXPECT_TRUE(market_comp.previous_supply.empty());
+    EXPECT_NEAR(market_comp.SettledPrice(good_1), price_1, price_1 * 1e-12);
+    EXPECT_NEAR(market_comp.SettledPrice(good_2), price_2, price_2 * 1e-12);
+
+    // Trading the good again prices it from where it would have been
+    market_comp.supply[good_2] = 10;
+    market_comp.demand[good_2] = 20;
+    market_system.DoSystem();
+    price_1 = step(price_1);
+    price_2 = step(price_2);
+    EXPECT_NEAR(market_comp.price[good_2], price_2, price_2 * 1e-12);
+    market_comp.SettlePrices();
+    EXPECT_NEAR(market_comp.price[good_1], price_1, price_1 * 1e-12);
+    EXPECT_EQ(market_comp.SettledPrice(good_1), market_comp.price[good_1]);
+}
+
+// The orders in the market's auction house are cleared when the market runs, and the trades are paid for
+TEST_F(MarketTwoTest, AuctionTest) {
+    universe.get<cqspc::Wallet>(agent1) = 1000;
+    universe.get<cqspc::Wallet>(agent2) = 1000;
+    universe.get<cqspc::ResourceStockpile>(agent1)[good_1] = 30;
+
+    auto& auction_house = universe.emplace<cqspc::AuctionHouse>(market);
+    auction_house.AddSellOrder(good_1, cqspc::Order(8, 10, agent1));
+    auction_house.AddSellOrder(good_1, cqspc::Order(12, 20, agent1));
+    auction_house.AddBuyOrder(good_1, cqspc::Order(10, 15, agent2));
+
+    cqsp::common::systems::SysMarket market_system(game);
+    market_system.DoSystem();
+
+    // Only the sell order at 8 crosses, and it clears halfway between the prices
+    EXPECT_EQ(universe.get<cqspc::ResourceStockpile>(agent1)[good_1], 20);
+    EXPECT_EQ(universe.get<cqspc::ResourceStockpile>(agent2)[good_1], 10);
+    EXPECT_EQ(universe.get<cqspc::Wallet>(agent1).GetBalance(), 1090);
+    EXPECT_EQ(universe.get<cqspc::Wallet>(agent2).GetBalance(), 910);
+    EXPECT_EQ(auction_house.GetSupply(good_1), 20);
+    EXPECT_EQ(auction_house.GetDemand(good_1), 5);
+
+    // The trades were part of the market's supply and demand for the day
+    auto& market_comp = universe.get<cqspc::Market>(market);
+    EXPECT_EQ(market_comp.previous_supply[good_1], 10);
+    EXPECT_EQ(market_comp.previous_demand[good_1], 10);
+
+    // Nothing crosses anymore
+    market_system.DoSystem();
+    EXPECT_EQ(universe.get<cqspc::Wallet>(agent1).GetBalance(), 1090);
+    EXPECT_EQ(universe.get<cqspc::ResourceStockpile>(agent2)[good_1], 10);
+}
@@ -16,8 +16,11 @@
  */
 #include <gtest/gtest.h>
 
+#include <vector>
+
 #include "common/components/bodies.h"
 #include "common/components/coordinates.h"
+#include "common/components/movement.h"
 #include "common/components/orbit.h"
 #include "common/components/ships.h"
 #include "common/systems/actions/shiplaunchaction.h"
@@ -88,3 +91,45 @@ TEST_F(SystemsMovementTest, ShipMovementTest) {
         EXPECT_NEAR(position.position.y, vec.y, 4);
     }
 }
+
+// Burns less than a tick apart all happen in the same tick, in the order of their time
+TEST_F(SystemsMovementTest, ManeuverQueueTest) {
+    namespace cqspb = cqsp::common::components::bodies;
+    cqsp::common::Universe& universe = m_game.GetUniverse();
+    entt::entity sun = universe.create();
+    universe.sun = sun;
+    universe.emplace<cqspt::Orbit>(sun);
+    auto& body = universe.emplace<cqspb::Body>(sun);
+    body.GM = 398600;
+    body.radius = 6371;
+    auto& system = universe.emplace<cqspb::OrbitalSystem>(sun);
+
+    entt::entity orbiting = universe.create();
+    auto& orbit = universe.emplace<cqspt::Orbit>(orbiting, 8000, 0.01, 0.1, 0.2, 0.3, 0.4);
+    orbit.GM = 398600;
+    orbit.reference_body = sun;
+    system.push_back(orbiting);
+    const cqspt::Orbit start = orbit;
+
+    cqsp::common::systems::SysOrbit sys_orbit(m_game);
+    std::vector<cqsp::common::components::Maneuver> maneuvers(3);
+    maneuvers[0].delta_v = glm::dvec3(0, 0.1, 0);
+    maneuvers[0].time = 20;
+    maneuvers[1].delta_v = glm::dvec3(0.05, 0, 0);
+    maneuvers[1].time = 10;
+    maneuvers[2].delta_v = glm::dvec3(0, -0.1, 0);
+    maneuvers[2].time = 600;
+    cqsp::common::systems::QueueManeuvers(universe, orbiting, maneuvers);
+
+    universe.date.SetDate(1);
+    sys_orbit.DoSystem();
+
+    const cqspt::Orbit expected =
+        cqspt::ApplyImpulse(cqspt::ApplyImpulse(start, maneuvers[1].delta_v, 10), maneuvers[0].delta_v, 20);
+    const auto& result = universe.get<cqspt::Orbit>(orbiting);
+    EXPECT_NEAR(result.semi_major_axis, expected.semi_major_axis, 1e-6);
+    EXPECT_NEAR(result.eccentricity, expected.eccentricity, 1e-9);
+    const auto& queue = universe.get<cqsp::common::components::CommandQueue>(orbiting);
+    ASSERT_EQ(queue.commands.size(), 1);
+    EXPECT_EQ(queue.commands.front().time, 600);
+}
@@ -0,0 +1,186 @@
+/* Conquer Space
+ * Copyright (C) 2021-2023 Conquer Space
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#include <gtest/gtest.h>
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+#include "common/game.h"
+#include "common/simulation.h"
+#include "common/systems/isimulationsystem.h"
+
+using cqsp::common::systems::simulation::Simulation;
+
+namespace {
+struct Counter {
+    int64_t value = 1;
+};
+
+struct Tally {
+    int64_t value = 0;
+};
+
+struct Marker {
+    int value = 0;
+};
+
+enum TestSystem { Triple, Sum, Double, Mark, SystemCount };
+
+// If each pair of systems is allowed to run at the same time, from what they declare
+constexpr bool can_overlap[SystemCount][SystemCount] = {
+    // Triple and Double write Counter, which Sum reads
+    {false, false, false, true},
+    {false, false, false, true},
+    {false, false, false, true},
+    {true, true, true, false},
+};
+
+std::array<std::atomic<int>, SystemCount> running;
+std::atomic<int> overlaps = 0;
+std::atomic<int> conflicts = 0;
+
+/// <summary>
+/// Records which systems are running while it's alive, and counts the systems that it overlaps with
+/// </summary>
+class RunningScope {
+ public:
+    explicit RunningScope(TestSystem system) : system(system) {
+        running[system]++;
+        for (int other = 0; other < SystemCount; other++) {
+            if (running[other] == 0 || other == system) {
+                continue;
+            }
+            overlaps++;
+            if (!can_overlap[system][other]) {
+                conflicts++;
+            }
+        }
+        // Give the other systems time to start, so that a wrong schedule shows up
+        std::this_thread::sleep_for(std::chrono::microseconds(200));
+    }
+    ~RunningScope() { running[system]--; }
+
+ private:
+    TestSystem system;
+};
+
+class SysTriple : public cqsp::common::systems::ISimulationSystem {
+ public:
+    explicit SysTriple(cqsp::common::Game& game) : ISimulationSystem(game) { Writes<Counter>(); }
+    void DoSystem() override {
+        RunningScope scope(Triple);
+        for (auto&& [entity, counter] : GetUniverse().view<Counter>().each()) {
+            counter.value = (counter.value * 3 + 1) % 1000003;
+        }
+    }
+    int Interval() override { return 1; }
+};
+
+class SysSum : public cqsp::common::systems::ISimulationSystem {
+ public:
+    explicit SysSum(cqsp::common::Game& game) : ISimulationSystem(game) {
+        Reads<Counter>();
+        Writes<Tally>();
+    }
+    void DoSystem() override {
+        RunningScope scope(Sum);
+        for (auto&& [entity, counter, tally] : GetUniverse().view<Counter, Tally>().each()) {
+            tally.value = (tally.value * 7 + counter.value) % 1000003;
+        }
+    }
+    int Interval() override { return 1; }
+};
+
+class SysDouble : public cqsp::common::systems::ISimulationSystem {
+ public:
+    explicit SysDouble(cqsp::common::Game& game) : ISimulationSystem(game) { Writes<Counter>(); }
+    void DoSystem() override {
+        RunningScope scope(Double);
+        for (auto&& [entity, counter] : GetUniverse().view<Counter>().each()) {
+            counter.value = (counter.value * 2) % 1000003;
+        }
+    }
+    int Interval() override { return 1; }
+};
+
+class SysMark : public cqsp::common::systems::ISimulationSystem {
+ public:
+    explicit SysMark(cqsp::common::Game& game) : ISimulationSystem(game) { Writes<Marker>(); }
+    void DoSystem() override {
+        RunningScope scope(Mark);
+        for (auto&& [entity, marker] : GetUniverse().view<Marker>().each()) {
+            marker.value++;
+        }
+    }
+    int Interval() override { return 1; }
+};
+
+/// <summary>
+/// Runs the test systems for a number of ticks, and returns the counters and tallies of the entities
+/// </summary>
+std::vector<int64_t> RunTicks(bool parallel, int ticks) {
+    cqsp::common::Game game;
+    auto& script = game.GetScriptInterface();
+    script["events"] = script.create_table_with("data", script.create_table());
+    auto& universe = game.GetUniverse();
+    universe.sun = entt::null;
+    for (int i = 0; i < 100; i++) {
+        entt::entity entity = universe.create();
+        universe.emplace<Counter>(entity, i);
+        universe.emplace<Tally>(entity);
+        universe.emplace<Marker>(entity);
+    }
+
+    Simulation simulation(game);
+    simulation.AddSystem<SysTriple>();
+    simulation.AddSystem<SysSum>();
+    simulation.AddSystem<SysDouble>();
+    simulation.AddSystem<SysMark>();
+    simulation.SetParallel(parallel);
+    for (int i = 0; i < ticks; i++) {
+        simulation.tick();
+    }
+
+    std::vector<int64_t> state;
+    for (auto&& [entity, counter, tally, marker] : universe.view<Counter, Tally, Marker>().each()) {
+        state.push_back(counter.value);
+        state.push_back(tally.value);
+        state.push_back(marker.value);
+    }
+    return state;
+}
+}  // namespace
+
+// Systems that conflict never run at the same time, and run in the order that they were added
+TEST(Common_SchedulerTest, ConflictTest) {
+    const int ticks = 50;
+    const std::vector<int64_t> serial = RunTicks(false, ticks);
+    EXPECT_EQ(overlaps, 0);
+    overlaps = 0;
+    conflicts = 0;
+
+    const std::vector<int64_t> parallel = RunTicks(true, ticks);
+    EXPECT_EQ(conflicts, 0);
+    EXPECT_EQ(parallel, serial);
+    if (std::thread::hardware_concurrency() > 1) {
+        // Mark doesn't conflict with the other systems, so it should have overlapped at least once
+        EXPECT_GT(overlaps, 0);
+    }
+}
@@ -0,0 +1,125 @@
+/* Conquer Space
+ * Copyright (C) 2021-2023 Conquer Space
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "common/game.h"
+#include "common/simulation.h"
+
+using cqsp::common::systems::simulation::Simulation;
+
+TEST(Common_TelemetryTest, SummaryTest) {
+    cqsp::common::Game game;
+    auto& script = game.GetScriptInterface();
+    // The script system needs the event table, even when there aren't any events
+    script["events"] = script.create_table_with("data", script.create_table());
+    game.GetUniverse().sun = entt::null;
+
+    Simulation simulation(game);
+    const int ticks = 5;
+    for (int i = 0; i < ticks; i++) {
+        simulation.tick();
+    }
+    EXPECT_EQ(simulation.GetTelemetryTicks(), ticks);
+
+    const auto& names = simulation.GetSystemNames();
+    ASSERT_FALSE(names.empty());
+    for (size_t i = 0; i < names.size(); i++) {
+        auto summary = simulation.SummarizeSystem(i);
+        EXPECT_LE(summary.runs, ticks);
+        EXPECT_LE(summary.mean_us, summary.worst_us);
+        EXPECT_LE(summary.mean_allocations, summary.worst_allocations);
+        EXPECT_LE(simulation.SummarizeSystem(i, 2).runs, 2);
+    }
+
+    const std::string path = (std::filesystem::temp_directory_path() / "cqsp_telemetry_test.csv").string();
+    ASSERT_TRUE(simulation.WriteTelemetryCsv(path));
+    std::ifstream stream(path);
+    std::string header;
+    std::getline(stream, header);
+    EXPECT_EQ(header, "date,system,duration_us,entities,allocations");
+    size_t rows = 0;
+    for (std::string line; std::getline(stream, line);) {
+        rows++;
+    }
+    size_t runs = 0;
+    for (size_t i = 0; i < names.size(); i++) {
+        runs += simulation.SummarizeSystem(i).runs;
+    }
+    EXPECT_EQ(rows, runs);
+    stream.close();
+    std::filesystem::remove(path);
+}
+
+TEST(Common_TelemetryTest, HistoryTest) {
+    cqsp::common::Game game;
+    auto& script = game.GetScriptInterface();
+    script["events"] = script.create_table_with("data", script.create_table());
+    game.GetUniverse().sun = entt::null;
+    // The script system reports the events that it ran, so it processes three every tick
+    script(R"(
+        for i = 1, 3 do
+            table.insert(events.data, { on_tick = function(self) end })
+        end
+    )");
+
+    Simulation simulation(game);
+    const auto& names = simulation.GetSystemNames();
+    const auto script_name =
+        std::find_if(names.begin(), names.end(), [](const std::string& name) { return name.ends_with("SysScript"); });
+    ASSERT_NE(script_name, names.end());
+    const size_t script_system = script_name - names.begin();
+
+    // Goes around the ring buffer
+    const size_t ticks = Simulation::telemetry_history + 10;
+    for (size_t i = 0; i < ticks; i++) {
+        simulation.tick();
+    }
+    EXPECT_EQ(simulation.GetTelemetryTicks(), Simulation::telemetry_history);
+    const auto summary = simulation.SummarizeSystem(script_system);
+    EXPECT_EQ(summary.runs, Simulation::telemetry_history);
+    EXPECT_EQ(summary.last.entities, 3);
+    EXPECT_EQ(summary.worst_entities, 3);
+    EXPECT_DOUBLE_EQ(summary.mean_entities, 3);
+    EXPECT_EQ(simulation.SummarizeSystem(script_system, 10).runs, 10);
+
+    // Only the ticks that are kept are written, oldest first
+    const std::string path = (std::filesystem::temp_directory_path() / "cqsp_telemetry_history.csv").string();
+    ASSERT_TRUE(simulation.WriteTelemetryCsv(path));
+    std::ifstream stream(path);
+    std::string line;
+    std::getline(stream, line);
+    std::vector<int> dates;
+    for (; std::getline(stream, line);) {
+        const size_t date_end = line.find(',');
+        if (line.compare(date_end + 1, names[script_system].size(), names[script_system]) == 0) {
+            dates.push_back(std::stoi(line.substr(0, date_end)));
+        }
+    }
+    stream.close();
+    std::filesystem::remove(path);
+    ASSERT_EQ(dates.size(), Simulation::telemetry_history);
+    const int last_date = game.GetUniverse().date.GetDate();
+    EXPECT_EQ(dates.front(), last_date - static_cast<int>(Simulation::telemetry_history) + 1);
+    EXPECT_EQ(dates.back(), last_date);
+    EXPECT_TRUE(std::is_sorted(dates.begin(), dates.end()));
+}
@@ -0,0 +1,49 @@
+/* Conquer Space
+ * Copyright (C) 2021-2023 Conquer Space
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#include <gtest/gtest.h>
+
+#include <vector>
+
+#include "common/systems/movement/orbitevents.h"
+
+TEST(Common_OrbitEventQueueTest, PopDueTest) {
+    cqsp::common::systems::OrbitEventQueue queue;
+    const auto a = static_cast<entt::entity>(1);
+    const auto b = static_cast<entt::entity>(2);
+    const auto c = static_cast<entt::entity>(3);
+    queue.Schedule(a, 100);
+    queue.Schedule(b, 50);
+    queue.Schedule(c, 200);
+    // Replaced, so the old event at 50 doesn't count anymore
+    queue.Schedule(b, 300);
+    queue.Remove(c);
+    EXPECT_EQ(queue.Size(), 2);
+
+    std::vector<entt::entity> due;
+    queue.PopDue(60, due);
+    EXPECT_TRUE(due.empty());
+    queue.PopDue(250, due);
+    ASSERT_EQ(due.size(), 1);
+    EXPECT_EQ(due[0], a);
+    EXPECT_FALSE(queue.IsScheduled(a));
+
+    due.clear();
+    queue.PopDue(1000, due);
+    ASSERT_EQ(due.size(), 1);
+    EXPECT_EQ(due[0], b);
+    EXPECT_EQ(queue.Size(), 0);
+}
@@ -0,0 +1,79 @@
+/* Conquer Space
+ * Copyright (C) 2021-2023 Conquer Space
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#include <gtest/gtest.h>
+
+#include "common/components/bodies.h"
+#include "common/components/coordinates.h"
+#include "common/components/orbit.h"
+#include "common/systems/movement/orbitpropagator.h"
+#include "common/universe.h"
+#include "common/util/threadpool.h"
+
+namespace cqspb = cqsp::common::components::bodies;
+namespace cqspt = cqsp::common::components::types;
+
+// The batch has to give the same positions as solving each orbit on its own
+TEST(Common_OrbitPropagatorTest, MatchesScalarTest) {
+    cqsp::common::Universe universe;
+    entt::entity sun = universe.create();
+    universe.emplace<cqspt::Orbit>(sun);
+    auto& sun_system = universe.emplace<cqspb::OrbitalSystem>(sun);
+
+    entt::entity planet = universe.create();
+    universe.emplace<cqspt::Orbit>(planet, 1.5e8, 0.0167, 0.1, 1.2, 0.3, 2);
+    sun_system.push_back(planet);
+    auto& planet_system = universe.emplace<cqspb::OrbitalSystem>(planet);
+
+    for (int i = 0; i < 1000; i++) {
+        entt::entity satellite = universe.create();
+        auto& orbit = universe.emplace<cqspt::Orbit>(satellite, 7000 + i * 10, (i % 95) / 100.0, i * 0.01,
+                                                     i * 0.02, i * 0.03, i * 0.04);
+        orbit.GM = 398600;
+        planet_system.push_back(satellite);
+    }
+    // Escaping on a hyperbolic orbit
+    entt::entity escaping = universe.create();
+    auto& hyperbolic = universe.emplace<cqspt::Orbit>(escaping, -20000, 1.5, 0.2, 0.1, 0.1, 0.5);
+    hyperbolic.GM = 398600;
+    planet_system.push_back(escaping);
+
+    cqsp::common::systems::OrbitPropagator propagator;
+    cqsp::common::util::ThreadPool pool(4);
+    const double time = 3600;
+    const double future_time = time + 60;
+    propagator.Gather(universe, sun);
+    ASSERT_EQ(propagator.Size(), 1003);
+    EXPECT_EQ(propagator.GetEntity(0), sun);
+    EXPECT_EQ(propagator.GetParent(0), cqsp::common::systems::OrbitPropagator::no_parent);
+    EXPECT_EQ(propagator.GetEntity(propagator.GetParent(2)), planet);
+    propagator.Propagate(time, future_time, &pool);
+    propagator.Scatter(universe);
+
+    for (size_t i = 1; i < propagator.Size(); i++) {
+        entt::entity entity = propagator.GetEntity(i);
+        const auto& orbit = universe.get<cqspt::Orbit>(entity);
+        const glm::dvec3 expected = cqspt::toVec3(orbit, cqspt::GetTrueAnomaly(orbit, time));
+        const glm::dvec3 expected_future = cqspt::OrbitTimeToVec3(orbit, future_time);
+        const auto& kinematics = universe.get<cqspt::Kinematics>(entity);
+        const auto& future = universe.get<cqspt::FuturePosition>(entity);
+        const double tolerance = glm::length(expected) * 1e-9;
+        EXPECT_NEAR(glm::distance(kinematics.position, expected), 0, tolerance);
+        EXPECT_NEAR(glm::distance(kinematics.velocity, cqspt::OrbitVelocityToVec3(orbit, orbit.v)), 0,
+                    glm::length(kinematics.velocity) * 1e-9);
+        EXPECT_NEAR(glm::distance(future.position, expected_future), 0, tolerance);
+    }
+}
@@ -0,0 +1,164 @@
+/* Conquer Space
+ * Copyright (C) 2021-2023 Conquer Space
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#include <gtest/gtest.h>
+
+#include <cmath>
+#include <utility>
+#include <vector>
+
+#include "common/components/economy.h"
+#include "common/components/infrastructure.h"
+#include "common/components/population.h"
+#include "common/components/resource.h"
+#include "common/components/surface.h"
+#include "common/game.h"
+#include "common/systems/economy/syspopulation.h"
+
+namespace cqspc = cqsp::common::components;
+
+namespace {
+struct TestWorld {
+    entt::entity planet;
+    std::vector<entt::entity> goods;
+    std::vector<entt::entity> segments;
+};
+
+TestWorld CreateWorld(cqsp::common::Universe& universe) {
+    TestWorld world;
+    for (int i = 0; i < 4; i++) {
+        world.goods.push_back(universe.create());
+    }
+    // The last good isn't a consumer good, but it has a price
+    for (int i = 0; i < 3; i++) {
+        universe.emplace<cqspc::ConsumerGood>(world.goods[i], 0.5 + i * 0.25, 0.1 + i * 0.05);
+        universe.consumergoods.push_back(world.goods[i]);
+    }
+
+    world.planet = universe.create();
+    auto& market = universe.emplace<cqspc::Market>(world.planet);
+    // The third good has no price
+    market.price[world.goods[0]] = 10;
+    market.price[world.goods[1]] = 5;
+    market.price[world.goods[3]] = 7;
+    // The second good had no supply, so it can't be bought
+    market.previous_supply[world.goods[0]] = 100;
+    market.previous_supply[world.goods[2]] = 50;
+
+    auto& habitation = universe.emplace<cqspc::Habitation>(world.planet);
+    for (int i = 0; i < 2; i++) {
+        entt::entity settlement = universe.create();
+        universe.emplace<cqspc::infrastructure::CityInfrastructure>(settlement, 1.0, 0.2 * i);
+        auto& population = universe.emplace<cqspc::Settlement>(settlement).population;
+        for (int j = 0; j < 4; j++) {
+            entt::entity segment = universe.create();
+            universe.emplace<cqspc::PopulationSegment>(segment, 1000u + 377u * j + 91u * i, 0u);
+            // Some of the segments are broke after paying for the autonomous consumption
+            universe.emplace<cqspc::Wallet>(segment, entt::null, (j % 2 == 0) ? 0.0 : 1e7 * (j + i));
+            population.push_back(segment);
+            world.segments.push_back(segment);
+        }
+        habitation.settlements.push_back(settlement);
+    }
+    return world;
+}
+
+/// <summary>
+/// Consumption worked out one segment at a time with ledgers, how SysPopulationConsumption used to do it
+/// </summary>
+void ReferenceConsumption(cqsp::common::Universe& universe, const TestWorld& world) {
+    cqspc::ResourceLedger marginal_propensity_base;
+    cqspc::ResourceLedger autonomous_consumption_base;
+    float savings = 1;
+    for (entt::entity good : universe.consumergoods) {
+        const auto& consumer_good = universe.get<cqspc::ConsumerGood>(good);
+        marginal_propensity_base[good] = consumer_good.marginal_propensity;
+        autonomous_consumption_base[good] = consumer_good.autonomous_consumption;
+        savings -= consumer_good.marginal_propensity;
+    }
+    auto& market = universe.get<cqspc::Market>(world.planet);
+    for (entt::entity settlement : universe.get<cqspc::Habitation>(world.planet).settlements) {
+        auto& infrastructure = universe.get<cqspc::infrastructure::CityInfrastructure>(settlement);
+        double infra_cost = infrastructure.default_purchase_cost - infrastructure.improvement;
+        for (entt::entity segment_entity : universe.get<cqspc::Settlement>(settlement).population) {
+            auto& segment = universe.get<cqspc::PopulationSegment>(segment_entity);
+            const uint64_t population = segment.population / 10;
+            cqspc::ResourceLedger consumption = autonomous_consumption_base;
+            consumption *= population;
+            auto& wallet = universe.get<cqspc::Wallet>(segment_entity);
+            wallet -= (consumption * market.price).GetSum();
+            if (wallet > 0) {
+                cqspc::ResourceLedger extraconsumption = marginal_propensity_base;
+                extraconsumption *= wallet;
+                extraconsumption /= market.price;
+                consumption += extraconsumption;
+                for (auto& t : consumption) {
+                    if (std::as_const(market.previous_supply)[t.first] <= 0) {
+                        market.latent_demand[t.first] += t.second;
+                        t.second = 0;
+                    }
+                }
+                double cost = consumption.GetSum() * infra_cost;
+                wallet *= savings;
+                wallet -= cost;
+            }
+            wallet += segment.population * 50000;
+            market.demand += consumption;
+            universe.emplace_or_replace<cqspc::ResourceConsumption>(segment_entity, consumption);
+        }
+    }
+}
+
+void ExpectLedgersNear(const cqspc::ResourceLedger& expected, const cqspc::ResourceLedger& actual,
+                       const std::vector<entt::entity>& goods) {
+    for (entt::entity good : goods) {
+        EXPECT_EQ(expected.HasGood(good), actual.HasGood(good));
+        EXPECT_NEAR(expected[good], actual[good], std::abs(expected[good]) * 1e-9);
+    }
+}
+}  // namespace
+
+// Working out the consumption once per market has to give the same results as doing it for every segment
+TEST(SysPopulationConsumptionTest, MatchesReferenceTest) {
+    cqsp::common::Game game;
+    cqsp::common::Game reference_game;
+    TestWorld world = CreateWorld(game.GetUniverse());
+    TestWorld reference_world = CreateWorld(reference_game.GetUniverse());
+
+    cqsp::common::systems::SysPopulationConsumption system(game);
+    system.DoSystem();
+    ReferenceConsumption(reference_game.GetUniverse(), reference_world);
+
+    auto& universe = game.GetUniverse();
+    auto& reference_universe = reference_game.GetUniverse();
+    const auto& market = universe.get<cqspc::Market>(world.planet);
+    const auto& reference_market = reference_universe.get<cqspc::Market>(reference_world.planet);
+    ExpectLedgersNear(reference_market.demand, market.demand, world.goods);
+    ExpectLedgersNear(reference_market.latent_demand, market.latent_demand, world.goods);
+    EXPECT_GT(market.latent_demand[world.goods[1]], 0);
+
+    for (size_t i = 0; i < world.segments.size(); i++) {
+        const double expected = reference_universe.get<cqspc::Wallet>(reference_world.segments[i]).GetBalance();
+        EXPECT_NEAR(universe.get<cqspc::Wallet>(world.segments[i]).GetBalance(), expected,
+                    std::abs(expected) * 1e-9);
+        ExpectLedgersNear(reference_universe.get<cqspc::ResourceConsumption>(reference_world.segments[i]),
+                          universe.get<cqspc::ResourceConsumption>(world.segments[i]), world.goods);
+    }
+
+    // The consumption ledgers are reused on the next tick
+    system.DoSystem();
+    EXPECT_TRUE(universe.get<cqspc::ResourceConsumption>(world.segments[0]).HasGood(world.goods[0]));
+}
@@ -0,0 +1,166 @@
+/* Conquer Space
+ * Copyright (C) 2021-2023 Conquer Space
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#include <gtest/gtest.h>
+
+#include <vector>
+
+#include "common/components/area.h"
+#include "common/components/economy.h"
+#include "common/components/history.h"
+#include "common/components/infrastructure.h"
+#include "common/components/surface.h"
+#include "common/game.h"
+#include "common/systems/economy/sysfactory.h"
+#include "common/util/threadpool.h"
+
+namespace cqspc = cqsp::common::components;
+
+namespace {
+/// <summary>
+/// Creates cities that all pay wages to the same population, so the order of the payments matters
+/// </summary>
+std::vector<entt::entity> CreateCities(cqsp::common::Universe& universe, int count) {
+    entt::entity input_good = universe.create();
+    entt::entity output_good = universe.create();
+    entt::entity recipe_entity = universe.create();
+    auto& recipe = universe.emplace<cqspc::Recipe>(recipe_entity);
+    recipe.input[input_good] = 1.5;
+    recipe.output.entity = output_good;
+    recipe.output.amount = 2;
+    recipe.workers = 0.37;
+
+    entt::entity population = universe.create();
+    universe.emplace<cqspc::Wallet>(population);
+
+    std::vector<entt::entity> cities;
+    for (int i = 0; i < count; i++) {
+        entt::entity city = universe.create();
+        auto& market = universe.emplace<cqspc::Market>(city);
+        market[input_good].price = 10;
+        market.price[input_good] = 10;
+        market.price[output_good] = 40 + i * 0.1;
+        market.sd_ratio[input_good] = 0.5 + (i % 5) * 0.2;
+        universe.emplace<cqspc::MarketHistory>(city).Record(0, market, 0);
+        market.sd_ratio[output_good] = (i % 3) * 0.6;
+        universe.emplace<cqspc::infrastructure::CityInfrastructure>(city, 1.0, 0.1 * (i % 4));
+        universe.emplace<cqspc::Settlement>(city).population.push_back(population);
+        auto& zone = universe.emplace<cqspc::IndustrialZone>(city);
+        for (int j = 0; j < 3; j++) {
+            entt::entity factory = universe.create();
+            universe.emplace<cqspc::Production>(factory, cqspc::ProductionType::factory, recipe_entity);
+            universe.emplace<cqspc::IndustrySize>(factory, 1000.0 + j * 13.7, 500.0 + i, 100.0 + j);
+            universe.emplace<cqspc::CostBreakdown>(factory);
+            zone.industries.push_back(factory);
+        }
+        cities.push_back(city);
+    }
+    return cities;
+}
+}  // namespace
+
+TEST(SysProductionTest, ParallelMatchesSerialTest) {
+    cqsp::common::Game serial_game;
+    cqsp::common::Game parallel_game;
+    auto serial_cities = CreateCities(serial_game.GetUniverse(), 200);
+    auto parallel_cities = CreateCities(parallel_game.GetUniverse(), 200);
+
+    cqsp::common::systems::SysProduction serial(serial_game);
+    cqsp::common::systems::SysProduction parallel(parallel_game);
+    cqsp::common::util::ThreadPool pool(4);
+    parallel.SetThreadPool(&pool);
+    for (int tick = 0; tick < 5; tick++) {
+        serial.DoSystem();
+        parallel.DoSystem();
+    }
+
+    auto& serial_universe = serial_game.GetUniverse();
+    auto& parallel_universe = parallel_game.GetUniverse();
+    for (size_t i = 0; i < serial_cities.size(); i++) {
+        auto& serial_market = serial_universe.get<cqspc::Market>(serial_cities[i]);
+        auto& parallel_market = parallel_universe.get<cqspc::Market>(parallel_cities[i]);
+        EXPECT_EQ(serial_market.supply.GetSum(), parallel_market.supply.GetSum());
+        EXPECT_EQ(serial_market.demand.GetSum(), parallel_market.demand.GetSum());
+        EXPECT_EQ(serial_market.price.GetSum(), parallel_market.price.GetSum());
+
+        entt::entity serial_population = serial_universe.get<cqspc::Settlement>(serial_cities[i]).population.front();
+        entt::entity parallel_population =
+            parallel_universe.get<cqspc::Settlement>(parallel_cities[i]).population.front();
+        // Exact comparison, the wages have to be paid in the same order
+        EXPECT_EQ(serial_universe.get<cqspc::Wallet>(serial_population).GetBalance(),
+                  parallel_universe.get<cqspc::Wallet>(parallel_population).GetBalance());
+    }
+}
+
+// The compiled recipe has to consume and produce the same amounts as the recipe's ledgers
+TEST(SysProductionTest, CompiledRecipeTest) {
+    cqsp::common::Game game;
+    auto& universe = game.GetUniverse();
+    entt::entity input_good = universe.create();
+    entt::entity capital_good = universe.create();
+    entt::entity output_good = universe.create();
+    entt::entity recipe_entity = universe.create();
+    auto& recipe = universe.emplace<cqspc::Recipe>(recipe_entity);
+    recipe.input[input_good] = 1.5;
+    recipe.capitalcost[input_good] = 0.25;
+    recipe.capitalcost[capital_good] = 2;
+    recipe.output.entity = output_good;
+    recipe.output.amount = 2;
+    recipe.workers = 0.37;
+
+    entt::entity population = universe.create();
+    universe.emplace<cqspc::Wallet>(population);
+    entt::entity city = universe.create();
+    auto& market = universe.emplace<cqspc::Market>(city);
+    market.price[input_good] = 10;
+    market.price[capital_good] = 5;
+    market.price[output_good] = 40;
+    market.sd_ratio[input_good] = 0.8;
+    market.sd_ratio[capital_good] = 0.5;
+    universe.emplace<cqspc::MarketHistory>(city).Record(0, market, 0);
+    universe.emplace<cqspc::infrastructure::CityInfrastructure>(city, 1.0, 0.25);
+    universe.emplace<cqspc::Settlement>(city).population.push_back(population);
+    entt::entity factory = universe.create();
+    universe.emplace<cqspc::Production>(factory, cqspc::ProductionType::factory, recipe_entity);
+    universe.emplace<cqspc::IndustrySize>(factory, 1000.0, 500.0, 100.0);
+    universe.emplace<cqspc::CostBreakdown>(factory);
+    universe.emplace<cqspc::IndustrialZone>(city).industries.push_back(factory);
+
+    cqsp::common::systems::SysProduction production(game);
+    production.DoSystem();
+
+    const auto& compiled = universe.get<cqspc::CompiledRecipe>(recipe_entity);
+    EXPECT_EQ(compiled.input_goods.size(), 1);
+    EXPECT_EQ(compiled.capital_goods.size(), 2);
+    EXPECT_EQ(compiled.output_good, cqspc::GoodIndex::Find(output_good));
+
+    // The same calculation with ledgers, throttled by the capital good's supply
+    const double ratio = 0.5;
+    cqspc::ResourceLedger capital = recipe.capitalcost * (0.01 * 1000);
+    cqspc::ResourceLedger input = ((recipe.input + 500.0) + capital) * ratio;
+    EXPECT_DOUBLE_EQ(market.demand[input_good], input[input_good]);
+    EXPECT_DOUBLE_EQ(market.demand[capital_good], input[capital_good]);
+    EXPECT_DOUBLE_EQ(market.supply[output_good], 2 * 500.0 * ratio);
+    EXPECT_DOUBLE_EQ(market[output_good].inputratio, ratio);
+
+    const auto& costs = universe.get<cqspc::CostBreakdown>(factory);
+    const double utilization = universe.get<cqspc::IndustrySize>(factory).utilization;
+    EXPECT_DOUBLE_EQ(utilization, 500.0 * (1 + 0.01 * ratio));
+    EXPECT_DOUBLE_EQ(costs.materialcosts, 1.5 * utilization * 10);
+    EXPECT_DOUBLE_EQ(costs.revenue, 2 * 40);
+    EXPECT_DOUBLE_EQ(costs.transport, (input.GetSum() + 2 * 500.0 * ratio) * 0.75);
+    EXPECT_DOUBLE_EQ(costs.wages, 1000 * 0.37 * 100);
+}
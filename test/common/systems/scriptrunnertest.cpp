@@ -0,0 +1,79 @@
+/* Conquer Space
+ * Copyright (C) 2021-2023 Conquer Space
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#include <gtest/gtest.h>
+
+#include "common/components/infrastructure.h"
+#include "common/game.h"
+#include "common/systems/scriptrunner.h"
+
+namespace cqspc = cqsp::common::components;
+
+TEST(Common_ScriptRunnerTest, ScheduleTest) {
+    cqsp::common::Game game;
+    auto& universe = game.GetUniverse();
+    auto& script = game.GetScriptInterface();
+    script.RegisterDataGroup("events");
+    entt::entity city = universe.create();
+    script["city"] = city;
+    script(R"(
+        function count(self)
+            self.runs = self.runs + 1
+        end
+        daily = { runs = 0, on_tick = count }
+        events:insert(daily)
+        weekly = { runs = 0, interval = 7, on_tick = count }
+        events:insert(weekly)
+        once = { runs = 0, wake_date = 3, on_tick = count }
+        events:insert(once)
+        brownout = { runs = 0, trigger = { entity = city, component = "brownout" }, on_tick = count }
+        events:insert(brownout)
+        stopping = { runs = 0, on_tick = function(self)
+            self.runs = self.runs + 1
+            if self.runs == 2 then return false end
+        end }
+        events:insert(stopping)
+        rescheduling = { runs = 0, wake_date = 1, on_tick = function(self)
+            self.runs = self.runs + 1
+            return date + 5
+        end }
+        events:insert(rescheduling)
+    )");
+
+    cqsp::common::systems::SysScript system(game);
+    const int ticks = 14;
+    for (int i = 0; i < ticks; i++) {
+        // The date starts before the first tick, like in the simulation
+        universe.date.IncrementDate();
+        // The trigger only runs the event when the brownout starts, not while it lasts
+        if (i == 4 || i == 10) {
+            universe.emplace<cqspc::infrastructure::BrownOut>(city);
+        } else if (i == 6) {
+            universe.remove<cqspc::infrastructure::BrownOut>(city);
+        }
+        system.DoSystem();
+    }
+
+    EXPECT_EQ(system.GetEventCount(), 6);
+    EXPECT_EQ(script["daily"]["runs"].get<int>(), ticks);
+    EXPECT_EQ(script["weekly"]["runs"].get<int>(), 2);
+    EXPECT_EQ(script["once"]["runs"].get<int>(), 1);
+    EXPECT_EQ(script["brownout"]["runs"].get<int>(), 2);
+    EXPECT_EQ(script["stopping"]["runs"].get<int>(), 2);
+    // Dates 1, 6 and 11
+    EXPECT_EQ(script["rescheduling"]["runs"].get<int>(), 3);
+    EXPECT_EQ(system.GetRunCount(), ticks + 2 + 1 + 2 + 2 + 3);
+}
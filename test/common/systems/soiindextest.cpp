@@ -0,0 +1,44 @@
+/* Conquer Space
+ * Copyright (C) 2021-2023 Conquer Space
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#include <gtest/gtest.h>
+
+#include "common/systems/movement/soiindex.h"
+
+TEST(Common_SOIIndexTest, FindTest) {
+    entt::registry registry;
+    entt::entity parent = registry.create();
+    entt::entity near_moon = registry.create();
+    entt::entity far_moon = registry.create();
+    entt::entity other_parent = registry.create();
+
+    cqsp::common::systems::SOIIndex index;
+    index.Add(parent, near_moon, glm::dvec3(1000, 0, 0), 100);
+    index.Add(parent, far_moon, glm::dvec3(0, 5000, 0), 500);
+    index.Sort();
+
+    EXPECT_EQ(index.Find(parent, glm::dvec3(1050, 0, 0)), near_moon);
+    EXPECT_EQ(index.Find(parent, glm::dvec3(0, 4600, 0)), far_moon);
+    // Right distance from the parent, but on the other side of it
+    EXPECT_EQ(index.Find(parent, glm::dvec3(-1000, 0, 0)), entt::null);
+    EXPECT_EQ(index.Find(parent, glm::dvec3(3000, 0, 0)), entt::null);
+    // The object itself is skipped
+    EXPECT_EQ(index.Find(parent, glm::dvec3(1000, 0, 0), near_moon), entt::null);
+    EXPECT_EQ(index.Find(other_parent, glm::dvec3(1000, 0, 0)), entt::null);
+
+    index.Clear();
+    EXPECT_EQ(index.Find(parent, glm::dvec3(1000, 0, 0)), entt::null);
+}
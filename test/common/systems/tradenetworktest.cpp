@@ -0,0 +1,156 @@
+/* Conquer Space
+ * Copyright (C) 2021-2023 Conquer Space
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#include <gtest/gtest.h>
+
+#include <cmath>
+#include <vector>
+
+#include "common/components/economy.h"
+#include "common/components/infrastructure.h"
+#include "common/systems/economy/tradenetwork.h"
+#include "common/universe.h"
+#include "common/util/threadpool.h"
+
+namespace cqspc = cqsp::common::components;
+
+namespace {
+entt::entity CreateCity(cqsp::common::Universe& universe, entt::entity good, double price, double supply) {
+    entt::entity city = universe.create();
+    auto& market = universe.emplace<cqspc::Market>(city);
+    market.price[good] = price;
+    market.previous_supply[good] = supply;
+    universe.emplace<cqspc::infrastructure::CityInfrastructure>(city, 3.0, 1.0);
+    return city;
+}
+
+/// <summary>
+/// Flow along the edge between the markets, positive from `from` to `to`
+/// </summary>
+double GetFlow(const cqsp::common::systems::TradeNetwork& network, entt::entity from, entt::entity to,
+               entt::entity good) {
+    for (size_t e = 0; e < network.EdgeCount(); e++) {
+        const auto& edge = network.GetEdge(e);
+        if (network.GetNode(edge.a) == from && network.GetNode(edge.b) == to) {
+            return network.GetFlow(e, good);
+        }
+        if (network.GetNode(edge.a) == to && network.GetNode(edge.b) == from) {
+            return -network.GetFlow(e, good);
+        }
+    }
+    ADD_FAILURE() << "No edge between the markets";
+    return 0;
+}
+}  // namespace
+
+TEST(Common_TradeNetworkTest, FlowTest) {
+    cqsp::common::Universe universe;
+    entt::entity good = universe.create();
+    entt::entity cheap = CreateCity(universe, good, 10, 100);
+    entt::entity expensive = CreateCity(universe, good, 20, 50);
+    entt::entity close = CreateCity(universe, good, 21, 0);
+    // The connections are listed from both sides, but are only one edge each
+    universe.get<cqspc::Market>(cheap).connected_markets.emplace(expensive);
+    universe.get<cqspc::Market>(expensive).connected_markets.emplace(cheap);
+    universe.get<cqspc::Market>(expensive).connected_markets.emplace(close);
+
+    cqsp::common::systems::TradeNetwork network;
+    network.Build(universe);
+    ASSERT_EQ(network.NodeCount(), 3);
+    ASSERT_EQ(network.EdgeCount(), 2);
+    EXPECT_EQ(network.GetEdge(0).cost, 2);
+
+    // The margin from cheap to expensive is 8 on a price of 10, so 80% of the supply should be shipped. The flow
+    // gets there over a few ticks.
+    network.Solve();
+    EXPECT_DOUBLE_EQ(GetFlow(network, cheap, expensive, good), 40);
+    // The price difference of 1 doesn't pay for the transport
+    EXPECT_EQ(GetFlow(network, expensive, close, good), 0);
+
+    network.Apply(universe);
+    EXPECT_DOUBLE_EQ(universe.get<cqspc::Market>(cheap).demand[good], 40);
+    EXPECT_DOUBLE_EQ(universe.get<cqspc::Market>(expensive).supply[good], 40);
+
+    // The flows are kept from the last tick
+    network.Build(universe);
+    network.Solve();
+    EXPECT_DOUBLE_EQ(GetFlow(network, cheap, expensive, good), 60);
+    for (int i = 0; i < 50; i++) {
+        network.Build(universe);
+        network.Solve();
+    }
+    EXPECT_NEAR(GetFlow(network, cheap, expensive, good), 80, 1e-6);
+}
+
+// A market can't export more than it supplied last tick
+TEST(Common_TradeNetworkTest, SupplyLimitTest) {
+    cqsp::common::Universe universe;
+    entt::entity good = universe.create();
+    entt::entity exporter = CreateCity(universe, good, 10, 100);
+    std::vector<entt::entity> importers;
+    for (int i = 0; i < 10; i++) {
+        importers.push_back(CreateCity(universe, good, 40, 0));
+    }
+    for (entt::entity importer : importers) {
+        universe.get<cqspc::Market>(exporter).connected_markets.emplace(importer);
+    }
+
+    cqsp::common::systems::TradeNetwork network;
+    cqsp::common::util::ThreadPool pool(4);
+    for (int tick = 0; tick < 10; tick++) {
+        network.Build(universe);
+        network.Solve(&pool);
+    }
+    double exported = 0;
+    for (size_t e = 0; e < network.EdgeCount(); e++) {
+        exported += std::abs(network.GetFlow(e, good));
+    }
+    EXPECT_NEAR(exported, 100, 1e-9);
+}
+
+// The graph is only built again when the connections change, but the transport costs are read every tick
+TEST(Common_TradeNetworkTest, TopologyChangeTest) {
+    cqsp::common::Universe universe;
+    entt::entity good = universe.create();
+    entt::entity cheap = CreateCity(universe, good, 10, 100);
+    entt::entity expensive = CreateCity(universe, good, 20, 50);
+    universe.get<cqspc::Market>(cheap).connected_markets.emplace(expensive);
+
+    cqsp::common::systems::TradeNetwork network;
+    network.Build(universe);
+    network.Solve();
+    ASSERT_EQ(network.EdgeCount(), 1);
+    EXPECT_DOUBLE_EQ(GetFlow(network, cheap, expensive, good), 40);
+
+    universe.get<cqspc::infrastructure::CityInfrastructure>(cheap).improvement = 3;
+    network.Build(universe);
+    EXPECT_EQ(network.EdgeCount(), 1);
+    EXPECT_EQ(network.GetEdge(0).cost, 1);
+
+    entt::entity added = CreateCity(universe, good, 30, 0);
+    universe.get<cqspc::Market>(expensive).connected_markets.emplace(added);
+    network.Build(universe);
+    ASSERT_EQ(network.NodeCount(), 3);
+    ASSERT_EQ(network.EdgeCount(), 2);
+    // The flow of the edge that was already there is kept
+    EXPECT_DOUBLE_EQ(GetFlow(network, cheap, expensive, good), 40);
+    EXPECT_EQ(GetFlow(network, expensive, added, good), 0);
+
+    universe.destroy(added);
+    network.Build(universe);
+    EXPECT_EQ(network.NodeCount(), 2);
+    EXPECT_EQ(network.EdgeCount(), 1);
+}
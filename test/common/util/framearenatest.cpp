@@ -0,0 +1,123 @@
+/* Conquer Space
+ * Copyright (C) 2021-2023 Conquer Space
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#include <gtest/gtest.h>
+
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include <entt/entt.hpp>
+
+#include "common/components/resource.h"
+#include "common/util/allocationcounter.h"
+#include "common/util/framearena.h"
+
+using cqsp::common::components::ResourceLedger;
+using cqsp::common::components::ResourceStockpile;
+using cqsp::common::util::FrameArena;
+using cqsp::common::util::FrameScope;
+
+// Temporaries made in a frame shouldn't touch the heap once the arena has been made
+TEST(FrameArenaTest, TemporariesTest) {
+    entt::registry registry;
+    entt::entity good_one = registry.create();
+    entt::entity good_two = registry.create();
+    ResourceLedger first;
+    first[good_one] = 10;
+    first[good_two] = 4;
+    ResourceLedger second;
+    second[good_one] = 2;
+
+    FrameArena arena;
+    std::pmr::memory_resource* resource = arena.GetThreadResource();
+    double sum = 0;
+    const uint64_t allocations = cqsp::common::util::GetThreadAllocationCount();
+    {
+        FrameScope scope(resource);
+        for (int i = 0; i < 100; i++) {
+            ResourceLedger result = (first + second) * 2 + first.SafeDivision(second);
+            sum += result.GetSum();
+        }
+    }
+    EXPECT_EQ(cqsp::common::util::GetThreadAllocationCount(), allocations);
+    EXPECT_EQ(FrameScope::Current(), nullptr);
+    EXPECT_DOUBLE_EQ(sum, 100 * ((12 + 4) * 2 + 5 + 4));
+}
+
+// A temporary that is kept has to be moved to the heap, so that it survives the arena being reset
+TEST(FrameArenaTest, KeepTemporaryTest) {
+    entt::registry registry;
+    entt::entity good = registry.create();
+    ResourceLedger first;
+    first[good] = 3;
+
+    FrameArena arena(64);
+    ResourceLedger assigned;
+    std::vector<ResourceLedger> moved;
+    {
+        FrameScope scope(arena.GetThreadResource());
+        // The buffer only fits one ledger, so the other one goes past it
+        assigned = first * 2;
+        moved.push_back(first + 1);
+    }
+    const size_t capacity = arena.GetCapacity();
+    arena.Reset();
+    // Memory that was used after the buffer ran out is added to the buffer
+    EXPECT_GT(arena.GetCapacity(), capacity);
+    {
+        FrameScope scope(arena.GetThreadResource());
+        // Reuse the arena memory
+        ResourceLedger overwrite = first * 100;
+        EXPECT_EQ(overwrite[good], 300);
+    }
+    EXPECT_EQ(assigned[good], 6);
+    EXPECT_EQ(moved.front()[good], 4);
+}
+
+// A temporary that directly initializes a component isn't moved, so the component has to copy it itself
+TEST(FrameArenaTest, ComponentTemporaryTest) {
+    entt::registry registry;
+    entt::entity good = registry.create();
+    ResourceLedger first;
+    first[good] = 3;
+
+    FrameArena arena;
+    FrameScope scope(arena.GetThreadResource());
+    ResourceLedger temporary = first * 2;
+    EXPECT_TRUE(temporary.IsTemporary());
+    ResourceStockpile stockpile {first * 2};
+    EXPECT_FALSE(stockpile.IsTemporary());
+    EXPECT_EQ(stockpile[good], 6);
+}
+
+// Each thread gets its own resource, and a new arena never hands out the resource of an old one
+TEST(FrameArenaTest, ThreadResourceTest) {
+    auto arena = std::make_unique<FrameArena>(64);
+    std::pmr::memory_resource* resource = arena->GetThreadResource();
+    EXPECT_EQ(arena->GetThreadResource(), resource);
+    arena->Reset();
+    EXPECT_EQ(arena->GetThreadResource(), resource);
+
+    std::pmr::memory_resource* other_thread = nullptr;
+    std::thread([&]() { other_thread = arena->GetThreadResource(); }).join();
+    EXPECT_NE(other_thread, resource);
+    EXPECT_EQ(arena->GetCapacity(), 128);
+
+    arena = std::make_unique<FrameArena>(64);
+    arena->GetThreadResource();
+    EXPECT_EQ(arena->GetCapacity(), 64);
+}
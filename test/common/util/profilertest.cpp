@@ -0,0 +1,107 @@
+/* Conquer Space
+ * Copyright (C) 2021-2023 Conquer Space
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "common/util/profiler.h"
+
+namespace {
+// Each test has its own zones, because the profiler is shared by every test in the process
+void StatsWork() {
+    BEGIN_TIMED_BLOCK(ProfilerStatsOuter);
+    for (int i = 0; i < 3; i++) {
+        PROFILE_SCOPE("ProfilerStatsInner");
+        std::this_thread::sleep_for(std::chrono::microseconds(50));
+    }
+    END_TIMED_BLOCK(ProfilerStatsOuter);
+}
+
+void TraceWork() {
+    BEGIN_TIMED_BLOCK(ProfilerTraceOuter);
+    for (int i = 0; i < 3; i++) {
+        PROFILE_SCOPE("ProfilerTraceInner");
+        std::this_thread::sleep_for(std::chrono::microseconds(50));
+    }
+    END_TIMED_BLOCK(ProfilerTraceOuter);
+}
+
+const cqsp::common::util::ProfileZoneStats* FindZone(const std::vector<cqsp::common::util::ProfileZoneStats>& stats,
+                                                     const std::string& name) {
+    for (const auto& zone : stats) {
+        if (zone.name == name) {
+            return &zone;
+        }
+    }
+    return nullptr;
+}
+
+uint64_t GetCount(const std::vector<cqsp::common::util::ProfileZoneStats>& stats, const std::string& name) {
+    const auto* zone = FindZone(stats, name);
+    return zone == nullptr ? 0 : zone->count;
+}
+}  // namespace
+
+TEST(Common_ProfilerTest, StatsTest) {
+    auto& profiler = cqsp::common::util::Profiler::Get();
+    // Counted from here, so the test can be repeated in the same process
+    const auto before = profiler.GetStats();
+    std::vector<std::thread> threads;
+    for (int i = 0; i < 4; i++) {
+        threads.emplace_back(StatsWork);
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    const auto stats = profiler.GetStats();
+    const auto* outer = FindZone(stats, "ProfilerStatsOuter");
+    const auto* inner = FindZone(stats, "ProfilerStatsInner");
+    ASSERT_NE(outer, nullptr);
+    ASSERT_NE(inner, nullptr);
+    EXPECT_EQ(outer->count - GetCount(before, "ProfilerStatsOuter"), 4);
+    EXPECT_EQ(inner->count - GetCount(before, "ProfilerStatsInner"), 12);
+    EXPECT_GE(inner->p50_us, 50);
+    EXPECT_LE(inner->p50_us, inner->p95_us);
+    EXPECT_LE(inner->p99_us, inner->max_us);
+    // The outer block contains three inner ones
+    EXPECT_GE(outer->p50_us, 150);
+}
+
+TEST(Common_ProfilerTest, ChromeTraceTest) {
+    auto& profiler = cqsp::common::util::Profiler::Get();
+    profiler.SetTracing(true);
+    TraceWork();
+    const auto path = std::filesystem::temp_directory_path() / "cqsp_profiler_trace.json";
+    ASSERT_TRUE(profiler.WriteChromeTrace(path.string()));
+    profiler.SetTracing(false);
+
+    std::ifstream stream(path);
+    std::stringstream buffer;
+    buffer << stream.rdbuf();
+    const std::string trace = buffer.str();
+    std::filesystem::remove(path);
+    EXPECT_EQ(trace.rfind("{\"displayTimeUnit\"", 0), 0);
+    EXPECT_NE(trace.find("\"name\": \"ProfilerTraceOuter\""), std::string::npos);
+    EXPECT_NE(trace.find("\"ph\": \"X\""), std::string::npos);
+    EXPECT_NE(trace.find("\"depth\": 1"), std::string::npos);
+}
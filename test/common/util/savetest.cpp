@@ -0,0 +1,238 @@
+/* Conquer Space
+ * Copyright (C) 2021-2023 Conquer Space
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <stdexcept>
+#include <vector>
+
+#include "common/components/economy.h"
+#include "common/components/history.h"
+#include "common/components/name.h"
+#include "common/components/orbit.h"
+#include "common/components/player.h"
+#include "common/game.h"
+#include "common/simulation.h"
+#include "common/systems/economy/sysmarket.h"
+#include "common/universe.h"
+#include "common/util/save/save.h"
+
+namespace cqspc = cqsp::common::components;
+namespace cqspt = cqsp::common::components::types;
+
+TEST(Common_SaveTest, RoundTripTest) {
+    cqsp::common::Universe universe("save-test");
+    universe.date.SetDate(1234);
+
+    entt::entity good = universe.create();
+    universe.emplace<cqspc::Good>(good);
+    universe.goods["test_good"] = good;
+
+    entt::entity destroyed = universe.create();
+    entt::entity city = universe.create();
+    universe.destroy(destroyed);
+    universe.emplace<cqspc::Name>(city, "Test City");
+    universe.emplace<cqspc::Player>(city);
+    universe.emplace<cqspc::Wallet>(city, good, 500.0);
+    universe.cities["test_city"] = city;
+
+    auto& market = universe.emplace<cqspc::Market>(city);
+    market.price[good] = 12.5;
+    market.supply[good] = 3;
+    // So that the history records the good
+    market.previous_supply[good] = 3;
+    market.participants.insert(city);
+    market.connected_markets.emplace(good);
+    auto& history = universe.emplace<cqspc::MarketHistory>(city);
+    history.Record(0, market, 10);
+    history.Record(1, market, 20);
+
+    cqspt::Orbit orbit(1000, 0.1, 0.2, 0.3, 0.4, 0.5);
+    orbit.reference_body = good;
+    universe.emplace<cqspt::Orbit>(city, orbit);
+
+    std::vector<char> data = cqsp::common::save::Save(universe).SaveGame();
+
+    cqsp::common::Universe loaded;
+    // Anything in the universe before loading is replaced, apart from the context
+    loaded.emplace<cqspc::Name>(loaded.create(), "Old");
+    loaded.ctx().emplace<int>(42);
+    cqsp::common::save::Load(loaded).LoadGame(data.data(), data.size());
+    EXPECT_EQ(loaded.ctx().at<int>(), 42);
+
+    EXPECT_EQ(loaded.GetDate(), 1234);
+    EXPECT_EQ(loaded.uuid, "save-test");
+    EXPECT_EQ(loaded.goods["test_good"], good);
+    EXPECT_EQ(loaded.cities["test_city"], city);
+    EXPECT_FALSE(loaded.valid(destroyed));
+    // Entities keep their identifiers, so the references between them still work
+    ASSERT_TRUE(loaded.valid(city));
+    EXPECT_TRUE(loaded.all_of<cqspc::Good>(good));
+    EXPECT_TRUE(loaded.all_of<cqspc::Player>(city));
+    EXPECT_EQ(loaded.get<cqspc::Name>(city).name, "Test City");
+    EXPECT_EQ(loaded.view<cqspc::Name>().size(), 1);
+    EXPECT_EQ(loaded.get<cqspc::Wallet>(city).GetBalance(), 500.0);
+
+    const auto& loaded_market = loaded.get<cqspc::Market>(city);
+    EXPECT_EQ(loaded_market.price[good], 12.5);
+    EXPECT_EQ(loaded_market.supply[good], 3);
+    EXPECT_EQ(loaded_market.participants.count(city), 1);
+    EXPECT_TRUE(loaded_market.connected_markets.contains(good));
+
+    const auto& loaded_history = loaded.get<cqspc::MarketHistory>(city);
+    EXPECT_EQ(loaded_history.GetTier(cqspc::HistoryResolution::Daily).Size(), 2);
+    EXPECT_EQ(loaded_history.Latest(cqspc::MarketMetric::Price, good), 12.5);
+    EXPECT_EQ(loaded_history.LatestGDP(), 20);
+
+    const auto& loaded_orbit = loaded.get<cqspt::Orbit>(city);
+    EXPECT_EQ(loaded_orbit.semi_major_axis, 1000);
+    EXPECT_EQ(loaded_orbit.eccentricity, 0.1);
+    EXPECT_EQ(loaded_orbit.reference_body, good);
+}
+
+TEST(Common_SaveTest, CorruptSaveTest) {
+    cqsp::common::Universe universe("save-test");
+    entt::entity entity = universe.create();
+    universe.emplace<cqspc::Name>(entity, "Kept");
+    std::vector<char> data = cqsp::common::save::Save(universe).SaveGame();
+
+    cqsp::common::Universe loaded;
+    entt::entity existing = loaded.create();
+    loaded.emplace<cqspc::Name>(existing, "Existing");
+    cqsp::common::save::Load load(loaded);
+
+    // A truncated save is rejected before the universe is touched
+    EXPECT_THROW(load.LoadGame(data.data(), data.size() - 1), std::runtime_error);
+    EXPECT_THROW(load.LoadGame(data.data(), 4), std::runtime_error);
+    std::vector<char> wrong_magic = data;
+    wrong_magic[0] = 'X';
+    EXPECT_THROW(load.LoadGame(wrong_magic.data(), wrong_magic.size()), std::runtime_error);
+    ASSERT_TRUE(loaded.valid(existing));
+    EXPECT_EQ(loaded.get<cqspc::Name>(existing).name, "Existing");
+}
+
+TEST(Common_SaveTest, CorruptComponentTest) {
+    cqsp::common::Universe universe("save-test");
+    universe.date.SetDate(50);
+    entt::entity entity = universe.create();
+    universe.emplace<cqspc::Name>(entity, "Saved");
+    universe.cities["saved"] = entity;
+    std::vector<char> data = cqsp::common::save::Save(universe).SaveGame();
+
+    // Give the first component chunk a name that is longer than the chunk. Its bounds are still valid, so
+    // this is only found after the entities and names are loaded.
+    const size_t file_header = 16;
+    const size_t chunk_header = 16;
+    size_t position = file_header;
+    while (true) {
+        uint32_t type;
+        uint64_t size;
+        std::memcpy(&type, data.data() + position, sizeof(type));
+        std::memcpy(&size, data.data() + position + 8, sizeof(size));
+        if (type == 4) {
+            const uint64_t length = size * 2;
+            std::memcpy(data.data() + position + chunk_header, &length, sizeof(length));
+            break;
+        }
+        position += chunk_header + size;
+        ASSERT_LT(position, data.size());
+    }
+
+    cqsp::common::Universe loaded("loaded");
+    loaded.date.SetDate(10);
+    entt::entity existing = loaded.create();
+    loaded.emplace<cqspc::Name>(existing, "Existing");
+    loaded.cities["existing"] = existing;
+    EXPECT_THROW(cqsp::common::save::Load(loaded).LoadGame(data.data(), data.size()), std::runtime_error);
+
+    // The game that was loaded is left as it was
+    EXPECT_EQ(loaded.GetDate(), 10);
+    EXPECT_EQ(loaded.uuid, "loaded");
+    EXPECT_EQ(loaded.cities.size(), 1);
+    EXPECT_EQ(loaded.cities["existing"], existing);
+    ASSERT_TRUE(loaded.valid(existing));
+    EXPECT_EQ(loaded.get<cqspc::Name>(existing).name, "Existing");
+}
+
+TEST(Common_SaveTest, CaptureTest) {
+    cqsp::common::Universe universe("save-test");
+    universe.date.SetDate(77);
+    entt::entity destroyed = universe.create();
+    entt::entity city = universe.create();
+    universe.destroy(destroyed);
+    universe.emplace<cqspc::Name>(city, "Captured");
+    universe.emplace<cqspc::Player>(city);
+    universe.cities["test_city"] = city;
+
+    std::unique_ptr<cqsp::common::Universe> copy = cqsp::common::save::Save(universe).Capture();
+    // Changes after the capture don't show up in the save
+    universe.get<cqspc::Name>(city).name = "Changed";
+    universe.date.SetDate(78);
+    std::vector<char> data = cqsp::common::save::Save(*copy).SaveGame();
+
+    cqsp::common::Universe loaded;
+    cqsp::common::save::Load(loaded).LoadGame(data.data(), data.size());
+    EXPECT_EQ(loaded.GetDate(), 77);
+    EXPECT_EQ(loaded.cities["test_city"], city);
+    EXPECT_FALSE(loaded.valid(destroyed));
+    ASSERT_TRUE(loaded.valid(city));
+    EXPECT_EQ(loaded.get<cqspc::Name>(city).name, "Captured");
+    EXPECT_TRUE(loaded.all_of<cqspc::Player>(city));
+}
+
+// Starting the simulation on a loaded save keeps the economy that was saved
+TEST(Common_SaveTest, LoadedMarketTest) {
+    cqsp::common::Universe universe("save-test");
+    universe.date.SetDate(500);
+    universe.sun = entt::null;
+    entt::entity good = universe.create();
+    universe.emplace<cqspc::Good>(good);
+    universe.emplace<cqspc::Price>(good, 10.0);
+    entt::entity city = universe.create();
+    auto& market = universe.emplace<cqspc::Market>(city);
+    market.price[good] = 42;
+    market.previous_supply[good] = 7;
+    auto& history = universe.emplace<cqspc::MarketHistory>(city);
+    history.Record(498, market, 10);
+    history.Record(499, market, 20);
+    std::vector<char> data = cqsp::common::save::Save(universe).SaveGame();
+
+    cqsp::common::Game game;
+    auto& script = game.GetScriptInterface();
+    script["events"] = script.create_table_with("data", script.create_table());
+    cqsp::common::save::Load(game.GetUniverse()).LoadGame(data.data(), data.size());
+    cqsp::common::systems::simulation::Simulation simulation(game);
+
+    const auto& loaded_market = game.GetUniverse().get<cqspc::Market>(city);
+    EXPECT_EQ(loaded_market.price[good], 42);
+    EXPECT_EQ(loaded_market.previous_supply[good], 7);
+    const auto& loaded_history = game.GetUniverse().get<cqspc::MarketHistory>(city);
+    EXPECT_EQ(loaded_history.GetTier(cqspc::HistoryResolution::Daily).Size(), 2);
+    EXPECT_EQ(loaded_history.Latest(cqspc::MarketMetric::Price, good), 42);
+    EXPECT_EQ(loaded_history.LatestGDP(), 20);
+
+    // A market that was never recorded is still set up
+    cqsp::common::Universe& loaded = game.GetUniverse();
+    entt::entity new_city = loaded.create();
+    loaded.emplace<cqspc::Market>(new_city);
+    cqsp::common::systems::SysMarket::InitializeMarket(game);
+    EXPECT_EQ(loaded.get<cqspc::Market>(new_city).price[good], 10);
+    EXPECT_EQ(loaded.get<cqspc::MarketHistory>(new_city).GetTier(cqspc::HistoryResolution::Daily).Size(), 1);
+    EXPECT_EQ(loaded_market.price[good], 42);
+}
@@ -0,0 +1,151 @@
+/* Conquer Space
+ * Copyright (C) 2021-2023 Conquer Space
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <new>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include "common/util/allocationcounter.h"
+#include "common/util/framearena.h"
+#include "common/util/threadpool.h"
+
+using cqsp::common::util::AllocationScope;
+using cqsp::common::util::FrameArena;
+using cqsp::common::util::FrameScope;
+using cqsp::common::util::ThreadPool;
+
+TEST(ThreadPoolTest, ParallelForTest) {
+    ThreadPool pool(4);
+    std::vector<int> values(1000, 0);
+    pool.ParallelFor(values.size(), [&](size_t i) { values[i] += static_cast<int>(i); });
+    for (size_t i = 0; i < values.size(); i++) {
+        EXPECT_EQ(values[i], i);
+    }
+}
+
+TEST(ThreadPoolTest, NestedParallelForTest) {
+    ThreadPool pool(2);
+    std::atomic<int> count = 0;
+    pool.ParallelFor(8, [&](size_t) { pool.ParallelFor(8, [&](size_t) { count++; }); });
+    EXPECT_EQ(count, 64);
+}
+
+// The allocations of every chunk go to the counter of the thread that started the loop, aligned ones included
+TEST(ThreadPoolTest, AllocationScopeTest) {
+    if (!cqsp::common::util::kCountAllocations) {
+        GTEST_SKIP() << "Built without CQSP_COUNT_ALLOCATIONS";
+    }
+    ThreadPool pool(4);
+    std::atomic<uint64_t> allocations = 0;
+    const size_t count = 16;
+    {
+        AllocationScope scope(&allocations);
+        pool.ParallelFor(count, [](size_t) {
+            auto value = std::make_unique<int>(0);
+            void* aligned = ::operator new(64, std::align_val_t(64));
+            ::operator delete(aligned, std::align_val_t(64));
+            // Slow enough that the workers get some of the chunks
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        });
+    }
+    EXPECT_GE(allocations, count * 2);
+    EXPECT_EQ(AllocationScope::Current(), nullptr);
+
+    // Nothing is counted outside of the scope
+    const uint64_t before = allocations;
+    pool.ParallelFor(count, [](size_t) { auto value = std::make_unique<int>(0); });
+    EXPECT_EQ(allocations, before);
+}
+
+TEST(ThreadPoolTest, ExceptionTest) {
+    ThreadPool pool(4);
+    EXPECT_THROW(pool.ParallelFor(100,
+                                  [](size_t i) {
+                                      if (i == 50) {
+                                          throw std::runtime_error("fail");
+                                      }
+                                  }),
+                 std::runtime_error);
+}
+
+// A thread that waits for its loop only helps with the loop, so a system that waits never runs another
+// system's task in the middle of its own
+TEST(ThreadPoolTest, WaitOnlyRunsLoopTest) {
+    const std::thread::id caller = std::this_thread::get_id();
+    std::atomic<bool> looping = true;
+    std::atomic<int> ran = 0;
+    std::atomic<int> ran_inside = 0;
+    std::atomic<bool> blocked = false;
+    // Made last so that the workers are stopped before the counters go away
+    ThreadPool pool(1);
+    // Keeps the worker busy, so that the other tasks are still queued while the loop runs
+    pool.Submit([&]() {
+        blocked = true;
+        while (looping) {
+            std::this_thread::yield();
+        }
+    });
+    while (!blocked) {
+        std::this_thread::yield();
+    }
+    const int tasks = 16;
+    for (int i = 0; i < tasks; i++) {
+        pool.Submit([&]() {
+            if (looping && std::this_thread::get_id() == caller) {
+                ran_inside++;
+            }
+            ran++;
+        });
+    }
+    pool.ParallelFor(2, [](size_t) {});
+    looping = false;
+    while (ran < tasks) {
+        pool.RunPendingTask();
+    }
+    EXPECT_EQ(ran_inside, 0);
+}
+
+// While a frame arena is set, the chunks that run on the workers use the arena of their thread
+TEST(ThreadPoolTest, FrameArenaTest) {
+    FrameArena arena;
+    ThreadPool pool(2);
+    pool.SetFrameArena(&arena);
+    std::atomic<int> wrong = 0;
+    {
+        // Like the system that starts the loop
+        FrameScope scope(arena.GetThreadResource());
+        pool.ParallelFor(64, [&](size_t) {
+            if (FrameScope::Current() != arena.GetThreadResource()) {
+                wrong++;
+            }
+        });
+    }
+    EXPECT_EQ(wrong, 0);
+
+    pool.SetFrameArena(nullptr);
+    pool.ParallelFor(64, [&](size_t) {
+        if (FrameScope::Current() != nullptr) {
+            wrong++;
+        }
+    });
+    EXPECT_EQ(wrong, 0);
+}